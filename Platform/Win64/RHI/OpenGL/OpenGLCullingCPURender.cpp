@@ -8,6 +8,8 @@
 #include <RHI/OpenGL/Framework/LineCanvasGL.hpp>
 #include <RHI/OpenGL/Framework/GLSkyboxRenderer.hpp>
 #include <Utils/UtilsFPS.hpp>
+#include <Utils/UtilsCulling.hpp>
+#include <Scene/SceneBVH.hpp>
 
 #include <Camera/TestCamera.hpp>
 #include <UserInput/GLFW/GLFWUserInput.hpp>
@@ -24,6 +26,7 @@ mat4 g_CullingView;
 bool g_DrawMeshes = true;
 bool g_DrawBoxes = true;
 bool g_DrawGrid = true;
+bool g_UseBVH = true;
 
 OpenGLCullingCPURender::OpenGLCullingCPURender(GLApp* app)
 	: OpenGLBaseRender(app)
@@ -70,6 +73,10 @@ int OpenGLCullingCPURender::draw()
 	ImGuiGLRenderer rendererUI;
 	CanvasGL canvas;
 
+	// built from the local-space mesh boxes, before they are pretransformed below
+	SceneBVH bvh;
+	buildSceneBVH(bvh, sceneData.scene_, sceneData.meshData_, sceneData.shapes_);
+
 	// pretransform bounding boxes to world space
 	for(const auto& c : sceneData.shapes_)
 	{
@@ -79,6 +86,14 @@ int OpenGLCullingCPURender::draw()
 
 	const BoundingBox fullScene = combineBoxes(sceneData.meshData_.boxes_);
 
+	// world-space boxes of all shapes in the SoA layout used by the batch culler
+	CullingBoxes cullingBoxes;
+	cullingBoxes.resize(sceneData.shapes_.size());
+	for (size_t i = 0; i != sceneData.shapes_.size(); i++)
+		cullingBoxes.set(i, sceneData.meshData_.boxes_[sceneData.shapes_[i].meshIndex]);
+
+	std::vector<uint32_t> visibilityMask;
+
 	FramesPerSecondCounter fpsCounter(0.5f);
 
 	while (!glfwWindowShouldClose(app_->getWindow()))
@@ -111,12 +126,13 @@ int OpenGLCullingCPURender::draw()
 		// cull
 		int numVisibleMeshes = 0;
 		{
+			numVisibleMeshes = g_UseBVH ?
+				(int)cullSceneBVH(bvh, frustumPlanes, frustumCorners, visibilityMask) :
+				(int)cullBoxes(cullingBoxes, frustumPlanes, frustumCorners, visibilityMask);
+
 			DrawElementsIndirectCommand* cmd = mesh.bufferIndirect_.drawCommands_.data();
-			for (const auto& c : sceneData.shapes_)
-			{
-				cmd->instanceCount_ = isBoxInFrustum(frustumPlanes, frustumCorners, sceneData.meshData_.boxes_[c.meshIndex]) ? 1 : 0;
-				numVisibleMeshes += (cmd++)->instanceCount_;
-			}
+			for (size_t i = 0; i != sceneData.shapes_.size(); i++)
+				(cmd++)->instanceCount_ = isVisible(visibilityMask, i) ? 1 : 0;
 			mesh.bufferIndirect_.uploadIndirectBuffer();
 		}
 
@@ -162,6 +178,7 @@ int OpenGLCullingCPURender::draw()
 		ImGui::Checkbox("Grid", &g_DrawGrid);
 		ImGui::Separator();
 		ImGui::Checkbox("Freeze culling frustum (P)", &input.freezeCullingView);
+		ImGui::Checkbox("Hierarchical culling (BVH)", &g_UseBVH);
 		ImGui::Separator();
 		ImGui::Text("Visible meshes: %i", numVisibleMeshes);
 		ImGui::End();
@@ -7,6 +7,7 @@
 #include <gli/load_ktx.hpp>
 
 #include <Filesystem/FilesystemUtilities.hpp>
+#include <BitmapView.hpp>
 
 constexpr  int brdfW = 256;
 constexpr  int brdfH = 256;
@@ -29,16 +30,8 @@ gli::texture convertLUTtoTexture(const float* data)
 {
 	gli::texture lutTexture = gli::texture2d(gli::FORMAT_RG16_SFLOAT_PACK16, gli::extent2d(brdfW, brdfH), 1);
 
-	for(int y = 0; y < brdfH; y++)
-	{
-		for(int x = 0; x < brdfW; x++)
-		{
-			const int ofs = y * brdfW + x;
-			const gli::vec2 value(data[ofs * 2 + 0], data[ofs * 2 + 1]);
-			const gli::texture::extent_type uv = { x, y , 0 };
-			lutTexture.store<glm::uint32>(uv, 0, 0, 0, gli::packHalf2x16(value));
-		}
-	}
+	// a single tightly packed RG16F level, converted in one go
+	convertRowF32ToF16(data, static_cast<uint16_t*>(lutTexture.data()), size_t(brdfW) * brdfH * 2);
 
 	return lutTexture;
 }
@@ -33,9 +33,10 @@ HDRApp::HDRApp()
 			}))
 
 	// tone mapping (gamma correction / exposure)
-	, luminance(ctx_, HDRLuminance, luminanceResult)
+	// the debug view displays the intermediate textures, so they are not aliased
+	, luminance(ctx_, HDRLuminance, luminanceResult, true)
 	// Temporarily we switch between luminances [coming from PingPong light adaptation calculator]
-	, hdr(ctx_, HDRLuminance, luminanceResult, mappedUniformBufferAttachment(ctx_.resources, &hdrUniforms, VK_SHADER_STAGE_FRAGMENT_BIT))
+	, hdr(ctx_, HDRLuminance, luminanceResult, mappedUniformBufferAttachment(ctx_.resources, &hdrUniforms, VK_SHADER_STAGE_FRAGMENT_BIT), true)
 
 	, displayedTextureList(
 		{ hdrTex,
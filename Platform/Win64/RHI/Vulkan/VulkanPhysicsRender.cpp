@@ -19,6 +19,9 @@ PhysicsApp::PhysicsApp()
 	onScreenRenderers_.emplace_back(multiRenderer);
 	onScreenRenderers_.emplace_back(imgui, false);
 
+	// the generated cube mesh has no bounds to cull with
+	multiRenderer.setCullingMode(eCullingMode_None);
+
 	const int maxCubes = 1000;
 
 	for (int i = 0; i < maxCubes; i++)
@@ -28,9 +28,10 @@ SceneCompositionApp::SceneCompositionApp()
 	, finalRenderer(ctx_, sceneData, { colorTex, depthTex })
 
 	// tone mapping (gamma correction / exposure)
-	, luminance(ctx_, finalTex, luminanceResult)
+	// the HDR debug view displays the intermediate textures, so they are not aliased
+	, luminance(ctx_, finalTex, luminanceResult, true)
 	, hdrUniformBuffer(mappedUniformBufferAttachment(ctx_.resources, &hdrUniforms, VK_SHADER_STAGE_FRAGMENT_BIT))
-	, hdr(ctx_, finalTex, luminanceResult, hdrUniformBuffer)
+	, hdr(ctx_, finalTex, luminanceResult, hdrUniformBuffer, true)
 
 	, ssao(ctx_, finalRenderer.outputColor /*colorTex for no-HDR */, depthTex, finalTex)
 
@@ -141,8 +142,8 @@ void SceneCompositionApp::draw3D()
 	finalRenderer.setLightParameters(lightProj, lightView);
 	finalRenderer.setCameraPosition(positioner.getPosition());
 
-	for (int i = 0; i < 25; i++)
-		finalRenderer.checkLoadedTextures();
+	// once per frame: the streamer batches its uploads within the per-frame budget and counts frames for the deferred releases
+	finalRenderer.checkLoadedTextures();
 
 	quads.clear();
 	quads.quad(-1.0f, enableHDR ? 1.0f : -1.0f, 1.0f, enableHDR ? -1.0f : 1.0f, 15);
@@ -156,6 +157,25 @@ void SceneCompositionApp::drawUI()
 
 	ImGui::Checkbox("Show object bounding boxes", &showObjectBoxes);
 	ImGui::Checkbox("Render transparent objects", &finalRenderer.renderTransparentObjects);
+	ImGui::Separator();
+
+	ImGui::Text("Opaque objects culling");
+	ImGui::Indent(indentSize);
+		bool occlusionCulling = finalRenderer.isOcclusionCullingEnabled();
+		if (ImGui::Checkbox("Occlusion culling", &occlusionCulling))
+			finalRenderer.setOcclusionCulling(occlusionCulling);
+
+		// mismatches between the GPU results and the CPU checks are printed to the console
+		bool verifyCulling = finalRenderer.getCullingMode() == eCullingMode_Verify;
+		if (ImGui::Checkbox("Verify culling", &verifyCulling))
+			finalRenderer.setCullingMode(verifyCulling ? eCullingMode_Verify : eCullingMode_GPU);
+
+		const MultiRenderer::CullingStats& stats = finalRenderer.getCullingStats();
+		ImGui::Text("Draws: %u, outside the frustum: %u", stats.numDraws_, stats.frustumCulled_);
+		ImGui::Text("Occluded: %u, disoccluded: %u", stats.occluded_, stats.disoccluded_);
+		ImGui::Text("GPU ms: culling %.3f, draws %.3f, depth pyramid %.3f", stats.cullingTime_, stats.drawTime_, stats.pyramidTime_);
+	ImGui::Unindent(indentSize);
+	ImGui::Separator();
 
 	ImGui::Text("HDR");
 	ImGui::Indent(indentSize);
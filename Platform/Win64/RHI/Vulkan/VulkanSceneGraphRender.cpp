@@ -41,6 +41,7 @@ SceneGraphApp::SceneGraphApp()
 	onScreenRenderers_.emplace_back(imgui, false);
 
 	sceneData.scene_.localTransform_[0] = glm::rotate(glm::mat4(1.f), (float)(M_PI / 2.f), glm::vec3(1.f, 0.f, 0.0f));
+	markAsChanged(sceneData.scene_, 0);
 }
 
 void SceneGraphApp::drawUI()
@@ -71,8 +72,8 @@ void SceneGraphApp::update(float deltaSeconds)
 {
 	CameraApp::update(deltaSeconds);
 
-	// update/upload matrices for individual scene nodes
-	sceneData.recalculateAllTransforms();
+	// update/upload matrices for individual scene nodes, editNode() marks the edited subtree
+	sceneData.recalculateChangedTransforms();
 	sceneData.uploadGlobalTransforms();
 }
 
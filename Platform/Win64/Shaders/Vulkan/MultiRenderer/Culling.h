@@ -0,0 +1,79 @@
+//
+// Frustum culling of the MultiRenderer draws, shared by FrustumCulling.comp and OcclusionCulling.comp
+
+struct AABB
+{
+	float pt[6];
+};
+
+struct DrawCommand
+{
+	uint vertexCount;
+	uint instanceCount;
+	uint firstVertex;
+	uint firstInstance;
+};
+
+layout(binding = 0) uniform CullingData
+{
+	vec4 frustumPlanes[6];
+	vec4 frustumCorners[8];
+	mat4 viewProj;
+	uint numDraws;
+	uint numPyramidLevels;
+	uint phase;
+} culling;
+
+// world space bounds of the shapes, indexed by the firstInstance of the draws
+layout(std430, binding = 1) readonly buffer BoundingBoxes
+{
+	AABB in_AABBs[];
+};
+
+layout(std430, binding = 2) readonly buffer AllDraws
+{
+	DrawCommand in_DrawCommands[];
+};
+
+layout(std430, binding = 3) writeonly buffer VisibleDraws
+{
+	DrawCommand out_DrawCommands[];
+};
+
+layout(std430, binding = 4) buffer NumVisibleMeshes
+{
+	uint numVisibleMeshes;
+};
+
+#define Box_min_x box.pt[0]
+#define Box_min_y box.pt[1]
+#define Box_min_z box.pt[2]
+#define Box_max_x box.pt[3]
+#define Box_max_y box.pt[4]
+#define Box_max_z box.pt[5]
+
+bool isAABBinFrustum(AABB box)
+{
+	for (int i = 0; i < 6; i++) {
+		int r = 0;
+		r += ( dot( culling.frustumPlanes[i], vec4(Box_min_x, Box_min_y, Box_min_z, 1.0f) ) < 0.0 ) ? 1 : 0;
+		r += ( dot( culling.frustumPlanes[i], vec4(Box_max_x, Box_min_y, Box_min_z, 1.0f) ) < 0.0 ) ? 1 : 0;
+		r += ( dot( culling.frustumPlanes[i], vec4(Box_min_x, Box_max_y, Box_min_z, 1.0f) ) < 0.0 ) ? 1 : 0;
+		r += ( dot( culling.frustumPlanes[i], vec4(Box_max_x, Box_max_y, Box_min_z, 1.0f) ) < 0.0 ) ? 1 : 0;
+		r += ( dot( culling.frustumPlanes[i], vec4(Box_min_x, Box_min_y, Box_max_z, 1.0f) ) < 0.0 ) ? 1 : 0;
+		r += ( dot( culling.frustumPlanes[i], vec4(Box_max_x, Box_min_y, Box_max_z, 1.0f) ) < 0.0 ) ? 1 : 0;
+		r += ( dot( culling.frustumPlanes[i], vec4(Box_min_x, Box_max_y, Box_max_z, 1.0f) ) < 0.0 ) ? 1 : 0;
+		r += ( dot( culling.frustumPlanes[i], vec4(Box_max_x, Box_max_y, Box_max_z, 1.0f) ) < 0.0 ) ? 1 : 0;
+		if ( r == 8 ) return false;
+	}
+
+	int r = 0;
+	r = 0; for ( int i = 0; i < 8; i++ ) r += ( (culling.frustumCorners[i].x > Box_max_x) ? 1 : 0 ); if ( r == 8 ) return false;
+	r = 0; for ( int i = 0; i < 8; i++ ) r += ( (culling.frustumCorners[i].x < Box_min_x) ? 1 : 0 ); if ( r == 8 ) return false;
+	r = 0; for ( int i = 0; i < 8; i++ ) r += ( (culling.frustumCorners[i].y > Box_max_y) ? 1 : 0 ); if ( r == 8 ) return false;
+	r = 0; for ( int i = 0; i < 8; i++ ) r += ( (culling.frustumCorners[i].y < Box_min_y) ? 1 : 0 ); if ( r == 8 ) return false;
+	r = 0; for ( int i = 0; i < 8; i++ ) r += ( (culling.frustumCorners[i].z > Box_max_z) ? 1 : 0 ); if ( r == 8 ) return false;
+	r = 0; for ( int i = 0; i < 8; i++ ) r += ( (culling.frustumCorners[i].z < Box_min_z) ? 1 : 0 ); if ( r == 8 ) return false;
+
+	return true;
+}
@@ -0,0 +1,28 @@
+//
+#version 460
+
+layout(location = 0) in vec2 texCoord;
+
+layout(location = 0) out vec4 outColor;
+
+layout(binding = 0) uniform sampler2D texSampler;
+
+void main()
+{
+	// each level is half the size of the previous one (at least 1x1), see DepthPyramid
+	ivec2 srcSize = textureSize(texSampler, 0);
+	ivec2 dstSize = max(srcSize / 2, ivec2(1));
+
+	// the source texels covered by this one: 2x2, up to 3x3 if the source size is odd
+	ivec2 p = ivec2(gl_FragCoord.xy);
+	ivec2 first = (p * srcSize) / dstSize;
+	ivec2 last = min(((p + 1) * srcSize + dstSize - 1) / dstSize, srcSize) - 1;
+
+	// the farthest depth, a box behind it is hidden in the whole texel
+	float depth = 0.0;
+	for (int y = first.y; y <= last.y; y++)
+		for (int x = first.x; x <= last.x; x++)
+			depth = max(depth, texelFetch(texSampler, ivec2(x, y), 0).r);
+
+	outColor = vec4(depth, 0.0, 0.0, 1.0);
+}
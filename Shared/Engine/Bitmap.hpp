@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -13,9 +15,75 @@ enum eBitmapType
 enum eBitmapFormat
 {
 	eBitmapFormat_UnsignedByte,
-	eBitmapFormat_Float
+	eBitmapFormat_Float,
+	eBitmapFormat_HalfFloat
 };
 
+/// IEEE 754 binary16 conversions, round to nearest even (F. Giesen, "Float->half variations")
+inline uint16_t floatToHalf(float value)
+{
+	uint32_t f;
+	memcpy(&f, &value, sizeof(f));
+
+	const uint32_t sign = f & 0x80000000u;
+	f ^= sign;
+
+	uint32_t o;
+	if (f >= 0x47800000u) // exponent overflow: Inf or NaN
+	{
+		o = (f > 0x7F800000u) ? 0x7E00u : 0x7C00u;
+	}
+	else if (f < (113u << 23)) // denormalized half, let the FPU do the rounding
+	{
+		const uint32_t denormMagic = ((127 - 15) + (23 - 10) + 1) << 23;
+		float fv, magic;
+		memcpy(&fv, &f, sizeof(fv));
+		memcpy(&magic, &denormMagic, sizeof(magic));
+		fv += magic;
+		memcpy(&o, &fv, sizeof(o));
+		o -= denormMagic;
+	}
+	else
+	{
+		const uint32_t mantOdd = (f >> 13) & 1;
+		f += ((15u - 127u) << 23) + 0xFFFu;
+		f += mantOdd;
+		o = f >> 13;
+	}
+
+	return uint16_t(o | (sign >> 16));
+}
+
+inline float halfToFloat(uint16_t h)
+{
+	const uint32_t shiftedExp = 0x7C00u << 13;
+
+	uint32_t o = uint32_t(h & 0x7FFFu) << 13;
+	const uint32_t exp = shiftedExp & o;
+	o += (127u - 15u) << 23;
+
+	if (exp == shiftedExp) // Inf/NaN
+	{
+		o += (128u - 16u) << 23;
+	}
+	else if (exp == 0) // zero/denormal
+	{
+		const uint32_t magicBits = 113u << 23;
+		o += 1u << 23;
+		float fo, magic;
+		memcpy(&fo, &o, sizeof(fo));
+		memcpy(&magic, &magicBits, sizeof(magic));
+		fo -= magic;
+		memcpy(&o, &fo, sizeof(o));
+	}
+
+	o |= uint32_t(h & 0x8000u) << 16;
+
+	float result;
+	memcpy(&result, &o, sizeof(result));
+	return result;
+}
+
 /// R/RG/RGB/RGBA bitmaps
 struct Bitmap
 {
@@ -49,6 +117,7 @@ struct Bitmap
 	{
 		if (fmt == eBitmapFormat_UnsignedByte) return 1;
 		if (fmt == eBitmapFormat_Float) return 4;
+		if (fmt == eBitmapFormat_HalfFloat) return 2;
 		return 0;
 	}
 
@@ -79,6 +148,10 @@ private:
 			setPixelFunc = &Bitmap::setPixelFloat;
 			getPixelFunc = &Bitmap::getPixelFloat;
 			break;
+		case eBitmapFormat_HalfFloat:
+			setPixelFunc = &Bitmap::setPixelHalfFloat;
+			getPixelFunc = &Bitmap::getPixelHalfFloat;
+			break;
 		}
 	}
 
@@ -102,6 +175,26 @@ private:
 			comp_ > 3 ? data[ofs + 3] : 0.0f);
 	}
 
+	void setPixelHalfFloat(int x, int y, const glm::vec4& c)
+	{
+		const int ofs = comp_ * (y * w_ + x);
+		uint16_t* data = reinterpret_cast<uint16_t*>(data_.data());
+		if (comp_ > 0) data[ofs + 0] = floatToHalf(c.x);
+		if (comp_ > 1) data[ofs + 1] = floatToHalf(c.y);
+		if (comp_ > 2) data[ofs + 2] = floatToHalf(c.z);
+		if (comp_ > 3) data[ofs + 3] = floatToHalf(c.w);
+	}
+	glm::vec4 getPixelHalfFloat(int x, int y) const
+	{
+		const int ofs = comp_ * (y * w_ + x);
+		const uint16_t* data = reinterpret_cast<const uint16_t*>(data_.data());
+		return glm::vec4(
+			comp_ > 0 ? halfToFloat(data[ofs + 0]) : 0.0f,
+			comp_ > 1 ? halfToFloat(data[ofs + 1]) : 0.0f,
+			comp_ > 2 ? halfToFloat(data[ofs + 2]) : 0.0f,
+			comp_ > 3 ? halfToFloat(data[ofs + 3]) : 0.0f);
+	}
+
 	void setPixelUnsignedByte(int x, int y, const glm::vec4& c)
 	{
 		const int ofs = comp_ * (y * w_ + x);
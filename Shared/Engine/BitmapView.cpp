@@ -0,0 +1,162 @@
+#include <BitmapView.hpp>
+#include <Utils/UtilsSIMD.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+#if UTILS_SIMD_SSE
+	// vectorized floatToHalf(), the same rounding and special values
+	inline __m128i floatToHalf4(__m128 f)
+	{
+		const __m128i f16max = _mm_set1_epi32((127 + 16) << 23);
+		const __m128i nanBit = _mm_set1_epi32(0x200);
+		const __m128i infAsHalf = _mm_set1_epi32(0x7C00);
+		const __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);
+		const __m128i denormMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+		const __m128i normalBias = _mm_set1_epi32(0xFFF - ((127 - 15) << 23));
+
+		const __m128 justSign = _mm_and_ps(f, _mm_castsi128_ps(_mm_set1_epi32(int(0x80000000u))));
+		const __m128 absf = _mm_xor_ps(f, justSign);
+		const __m128i absi = _mm_castps_si128(absf);
+
+		const __m128 isNan = _mm_cmpunord_ps(absf, absf);
+		const __m128i isRegular = _mm_cmpgt_epi32(f16max, absi);
+		const __m128i infOrNan = _mm_or_si128(_mm_and_si128(_mm_castps_si128(isNan), nanBit), infAsHalf);
+
+		const __m128i isDenorm = _mm_cmpgt_epi32(minNormal, absi);
+		const __m128i denorm = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absf, _mm_castsi128_ps(denormMagic))), denormMagic);
+
+		const __m128i mantOdd = _mm_srai_epi32(_mm_slli_epi32(absi, 31 - 13), 31);
+		const __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absi, normalBias), mantOdd), 13);
+
+		const __m128i nonSpecial = _mm_or_si128(_mm_and_si128(denorm, isDenorm), _mm_andnot_si128(isDenorm, normal));
+		const __m128i joined = _mm_or_si128(_mm_and_si128(nonSpecial, isRegular), _mm_andnot_si128(isRegular, infOrNan));
+
+		// the sign ends up in the upper 17 bits, so the signed saturating pack keeps the low 16 bits intact
+		return _mm_or_si128(joined, _mm_srai_epi32(_mm_castps_si128(justSign), 16));
+	}
+#endif
+
+	struct SRGBTable
+	{
+		float Table[256];
+
+		SRGBTable()
+		{
+			for (int i = 0; i != 256; i++)
+			{
+				const float c = float(i) / 255.0f;
+				Table[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+		}
+	};
+
+	const SRGBTable& getSRGBTable()
+	{
+		static const SRGBTable Table;
+		return Table;
+	}
+}
+
+void convertRowU8ToF32(const uint8_t* src, float* dst, size_t count)
+{
+	size_t i = 0;
+
+#if UTILS_SIMD_SSE
+	const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; i + 16 <= count; i += 16)
+	{
+		const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+		const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+
+		_mm_storeu_ps(dst + i + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+		_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+		_mm_storeu_ps(dst + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+		_mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+	}
+#endif
+
+	for (; i != count; i++)
+		dst[i] = float(src[i]) * (1.0f / 255.0f);
+}
+
+void convertRowF32ToU8(const float* src, uint8_t* dst, size_t count)
+{
+	size_t i = 0;
+
+#if UTILS_SIMD_SSE
+	const __m128 scale = _mm_set1_ps(255.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	// truncation like Bitmap::setPixel(), clamped to [0..255] before the conversion (which overflows above 2^31)
+	// maxps returns its second operand if either one is NaN, so NaN becomes 0
+	auto toInt = [&](__m128 v) { return _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(v, scale), zero), scale)); };
+
+	for (; i + 16 <= count; i += 16)
+	{
+		const __m128i a = toInt(_mm_loadu_ps(src + i + 0));
+		const __m128i b = toInt(_mm_loadu_ps(src + i + 4));
+		const __m128i c = toInt(_mm_loadu_ps(src + i + 8));
+		const __m128i d = toInt(_mm_loadu_ps(src + i + 12));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+	}
+#endif
+
+	// the same clamping as above: the comparisons are false for NaN
+	for (; i != count; i++)
+	{
+		const float v = src[i] * 255.0f;
+		dst[i] = uint8_t(v > 0.0f ? (v < 255.0f ? v : 255.0f) : 0.0f);
+	}
+}
+
+void convertRowF32ToF16(const float* src, uint16_t* dst, size_t count)
+{
+	size_t i = 0;
+
+#if UTILS_SIMD_SSE
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m128i lo = floatToHalf4(_mm_loadu_ps(src + i + 0));
+		const __m128i hi = floatToHalf4(_mm_loadu_ps(src + i + 4));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(lo, hi));
+	}
+#endif
+
+	for (; i != count; i++)
+		dst[i] = floatToHalf(src[i]);
+}
+
+void convertRowF16ToF32(const uint16_t* src, float* dst, size_t count)
+{
+	for (size_t i = 0; i != count; i++)
+		dst[i] = halfToFloat(src[i]);
+}
+
+void convertRowSRGB8ToLinearF32(const uint8_t* src, float* dst, size_t count, int channels)
+{
+	const float* table = getSRGBTable().Table;
+
+	if (channels < 4)
+	{
+		const size_t numComponents = count * channels;
+		for (size_t i = 0; i != numComponents; i++)
+			dst[i] = table[src[i]];
+		return;
+	}
+
+	for (size_t i = 0; i != count; i++, src += channels, dst += channels)
+	{
+		dst[0] = table[src[0]];
+		dst[1] = table[src[1]];
+		dst[2] = table[src[2]];
+		for (int c = 3; c < channels; c++)
+			dst[c] = float(src[c]) * (1.0f / 255.0f);
+	}
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include <Bitmap.hpp>
+
+/**
+	Compile-time typed access to bitmap pixels.
+	BitmapView<Format, Channels> resolves the component type and count at compile time, so getPixel()/setPixel() are
+	inlined without the pointer-to-member dispatch of Bitmap. Whole rows should go through the bulk conversions below.
+*/
+
+template<eBitmapFormat Format>
+struct BitmapFormatTraits;
+
+template<>
+struct BitmapFormatTraits<eBitmapFormat_UnsignedByte>
+{
+	using Type = uint8_t;
+	static float toFloat(uint8_t v) { return float(v) / 255.0f; }
+	static uint8_t fromFloat(float v) { return uint8_t(v * 255.0f); }
+};
+
+template<>
+struct BitmapFormatTraits<eBitmapFormat_Float>
+{
+	using Type = float;
+	static float toFloat(float v) { return v; }
+	static float fromFloat(float v) { return v; }
+};
+
+template<>
+struct BitmapFormatTraits<eBitmapFormat_HalfFloat>
+{
+	using Type = uint16_t;
+	static float toFloat(uint16_t v) { return halfToFloat(v); }
+	static uint16_t fromFloat(float v) { return floatToHalf(v); }
+};
+
+/* [Component] is the (possibly const) storage type of the format, use the BitmapView/ConstBitmapView aliases */
+template<eBitmapFormat Format, int Channels, typename Component>
+class BasicBitmapView
+{
+public:
+	static_assert(Channels >= 1 && Channels <= 4, "1..4 channels are supported");
+	static_assert(std::is_same<typename std::remove_const<Component>::type, typename BitmapFormatTraits<Format>::Type>::value, "Component type does not match the format");
+
+	using Traits = BitmapFormatTraits<Format>;
+	using BitmapType = typename std::conditional<std::is_const<Component>::value, const Bitmap, Bitmap>::type;
+
+	BasicBitmapView(Component* data, int w, int h, int d = 1)
+		: data_(data), w_(w), h_(h), d_(d)
+	{}
+
+	explicit BasicBitmapView(BitmapType& b)
+		: data_(reinterpret_cast<Component*>(b.data_.data())), w_(b.w_), h_(b.h_), d_(b.d_)
+	{
+		assert(b.fmt_ == Format && b.comp_ == Channels);
+	}
+
+	int w() const { return w_; }
+	int h() const { return h_; }
+	int d() const { return d_; }
+
+	Component* data() const { return data_; }
+
+	/* Rows of all the layers (cube faces) are stored one after another */
+	Component* row(int y, int layer = 0) const
+	{
+		return data_ + (size_t(layer) * h_ + y) * size_t(w_) * Channels;
+	}
+
+	Component* pixel(int x, int y, int layer = 0) const
+	{
+		return row(y, layer) + size_t(x) * Channels;
+	}
+
+	glm::vec4 getPixel(int x, int y, int layer = 0) const
+	{
+		const Component* p = pixel(x, y, layer);
+		return glm::vec4(
+			Traits::toFloat(p[0]),
+			Channels > 1 ? Traits::toFloat(p[Channels > 1 ? 1 : 0]) : 0.0f,
+			Channels > 2 ? Traits::toFloat(p[Channels > 2 ? 2 : 0]) : 0.0f,
+			Channels > 3 ? Traits::toFloat(p[Channels > 3 ? 3 : 0]) : 0.0f);
+	}
+
+	void setPixel(int x, int y, const glm::vec4& c, int layer = 0) const
+	{
+		static_assert(!std::is_const<Component>::value, "Cannot write through a ConstBitmapView");
+
+		Component* p = pixel(x, y, layer);
+		p[0] = Traits::fromFloat(c.x);
+		if (Channels > 1) p[Channels > 1 ? 1 : 0] = Traits::fromFloat(c.y);
+		if (Channels > 2) p[Channels > 2 ? 2 : 0] = Traits::fromFloat(c.z);
+		if (Channels > 3) p[Channels > 3 ? 3 : 0] = Traits::fromFloat(c.w);
+	}
+
+private:
+	Component* data_ = nullptr;
+	int w_ = 0;
+	int h_ = 0;
+	int d_ = 1;
+};
+
+template<eBitmapFormat Format, int Channels>
+using BitmapView = BasicBitmapView<Format, Channels, typename BitmapFormatTraits<Format>::Type>;
+
+template<eBitmapFormat Format, int Channels>
+using ConstBitmapView = BasicBitmapView<Format, Channels, const typename BitmapFormatTraits<Format>::Type>;
+
+template<eBitmapFormat Format>
+using BitmapFormatConstant = std::integral_constant<eBitmapFormat, Format>;
+
+template<int Channels>
+using BitmapChannelsConstant = std::integral_constant<int, Channels>;
+
+template<eBitmapFormat Format, typename Fn>
+bool dispatchBitmapChannels(int comp, Fn&& fn)
+{
+	switch (comp)
+	{
+	case 1: fn(BitmapFormatConstant<Format>(), BitmapChannelsConstant<1>()); return true;
+	case 2: fn(BitmapFormatConstant<Format>(), BitmapChannelsConstant<2>()); return true;
+	case 3: fn(BitmapFormatConstant<Format>(), BitmapChannelsConstant<3>()); return true;
+	case 4: fn(BitmapFormatConstant<Format>(), BitmapChannelsConstant<4>()); return true;
+	}
+	return false;
+}
+
+/**
+	Call fn(format, channels) with both as integral constants matching the runtime bitmap description,
+	so that a generic lambda can instantiate the right BitmapView. Returns false for unsupported combinations.
+*/
+template<typename Fn>
+bool dispatchBitmapFormat(eBitmapFormat fmt, int comp, Fn&& fn)
+{
+	switch (fmt)
+	{
+	case eBitmapFormat_UnsignedByte: return dispatchBitmapChannels<eBitmapFormat_UnsignedByte>(comp, fn);
+	case eBitmapFormat_Float:        return dispatchBitmapChannels<eBitmapFormat_Float>(comp, fn);
+	case eBitmapFormat_HalfFloat:    return dispatchBitmapChannels<eBitmapFormat_HalfFloat>(comp, fn);
+	}
+	return false;
+}
+
+/* Bulk conversions of [count] components (not pixels), the u8 <-> f32 and f32 -> f16 directions have SSE2 paths */
+void convertRowU8ToF32(const uint8_t* src, float* dst, size_t count);
+void convertRowF32ToU8(const float* src, uint8_t* dst, size_t count);
+void convertRowF32ToF16(const float* src, uint16_t* dst, size_t count);
+void convertRowF16ToF32(const uint16_t* src, float* dst, size_t count);
+
+/* 8-bit sRGB to linear floats for [count] pixels of [channels] components, the 4th component (alpha) stays linear */
+void convertRowSRGB8ToLinearF32(const uint8_t* src, float* dst, size_t count, int channels);
@@ -0,0 +1,329 @@
+#include <Filesystem/ChunkFile.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+#include <thread>
+
+namespace
+{
+	/* Slice-by-4 CRC32 (IEEE polynomial) tables */
+	struct Crc32Tables
+	{
+		uint32_t Table[4][256];
+
+		Crc32Tables()
+		{
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t Crc = i;
+				for (int j = 0; j < 8; j++)
+					Crc = (Crc >> 1) ^ (0xEDB88320u & (0u - (Crc & 1u)));
+				Table[0][i] = Crc;
+			}
+
+			for (uint32_t i = 0; i < 256; i++)
+				for (int s = 1; s < 4; s++)
+					Table[s][i] = (Table[s - 1][i] >> 8) ^ Table[0][Table[s - 1][i] & 0xFF];
+		}
+	};
+
+	const Crc32Tables& GetCrc32Tables()
+	{
+		static const Crc32Tables Tables;
+		return Tables;
+	}
+
+	size_t AlignUp(size_t Value, size_t Alignment)
+	{
+		return (Value + Alignment - 1) & ~(Alignment - 1);
+	}
+}
+
+uint32_t ChunkFileReader::ComputeChecksum(const void* Data, size_t Size)
+{
+	const Crc32Tables& T = GetCrc32Tables();
+	const uint8_t* Bytes = static_cast<const uint8_t*>(Data);
+
+	uint32_t Crc = 0xFFFFFFFFu;
+
+	while (Size >= 4)
+	{
+		uint32_t Word;
+		memcpy(&Word, Bytes, sizeof(Word));
+		Crc ^= Word;
+		Crc = T.Table[3][Crc & 0xFF] ^ T.Table[2][(Crc >> 8) & 0xFF] ^ T.Table[1][(Crc >> 16) & 0xFF] ^ T.Table[0][Crc >> 24];
+		Bytes += 4;
+		Size -= 4;
+	}
+
+	while (Size--)
+		Crc = (Crc >> 8) ^ T.Table[0][(Crc ^ *Bytes++) & 0xFF];
+
+	return ~Crc;
+}
+
+void ChunkFileWriter::AddSection(uint32_t Id, const void* Data, size_t Size)
+{
+	Sections.push_back({ Id, Data, Size, -1 });
+}
+
+void ChunkFileWriter::AddStringList(uint32_t Id, const std::vector<std::string>& Lines)
+{
+	std::vector<uint8_t> Blob;
+
+	auto AppendU32 = [&Blob](uint32_t Value)
+	{
+		const uint8_t* Ptr = reinterpret_cast<const uint8_t*>(&Value);
+		Blob.insert(Blob.end(), Ptr, Ptr + sizeof(Value));
+	};
+
+	AppendU32(static_cast<uint32_t>(Lines.size()));
+	for (const std::string& Line : Lines)
+	{
+		AppendU32(static_cast<uint32_t>(Line.length()));
+		Blob.insert(Blob.end(), Line.begin(), Line.end());
+	}
+
+	OwnedData.push_back(std::move(Blob));
+	Sections.push_back({ Id, nullptr, OwnedData.back().size(), static_cast<int>(OwnedData.size() - 1) });
+}
+
+bool ChunkFileWriter::Save(const std::string& FilePath) const
+{
+	FILE* F = fopen(FilePath.c_str(), "wb");
+	if (!F)
+	{
+		printf("Cannot open file '%s' for writing\n", FilePath.c_str());
+		return false;
+	}
+
+	std::vector<ChunkSectionEntry> Directory(Sections.size());
+
+	size_t Offset = AlignUp(sizeof(ChunkFileHeader) + Sections.size() * sizeof(ChunkSectionEntry), kChunkFileAlignment);
+	for (size_t i = 0; i < Sections.size(); i++)
+	{
+		const Section& S = Sections[i];
+		const void* Data = S.OwnedIndex >= 0 ? OwnedData[S.OwnedIndex].data() : S.Data;
+
+		ChunkSectionEntry& E = Directory[i];
+		E.Id = S.Id;
+		E.Flags = 0;
+		E.Offset = Offset;
+		E.Size = S.Size;
+		E.Checksum = ChunkFileReader::ComputeChecksum(Data, S.Size);
+		E.Reserved = 0;
+
+		Offset = AlignUp(Offset + S.Size, kChunkFileAlignment);
+	}
+
+	ChunkFileHeader Header{};
+	Header.Magic = kChunkFileMagic;
+	Header.Version = kChunkFileVersion;
+	Header.HeaderSize = sizeof(ChunkFileHeader);
+	Header.EndianTag = kChunkFileEndianTag;
+	Header.FileType = FileType;
+	Header.SectionCount = static_cast<uint32_t>(Sections.size());
+	Header.DirectoryChecksum = ChunkFileReader::ComputeChecksum(Directory.data(), Directory.size() * sizeof(ChunkSectionEntry));
+	Header.DirectoryOffset = sizeof(ChunkFileHeader);
+
+	bool Result = fwrite(&Header, sizeof(Header), 1, F) == 1;
+	if (!Directory.empty())
+		Result = Result && fwrite(Directory.data(), sizeof(ChunkSectionEntry), Directory.size(), F) == Directory.size();
+
+	static const std::array<uint8_t, kChunkFileAlignment> Padding{};
+	size_t Written = sizeof(ChunkFileHeader) + Directory.size() * sizeof(ChunkSectionEntry);
+
+	for (size_t i = 0; i < Sections.size() && Result; i++)
+	{
+		const Section& S = Sections[i];
+		const void* Data = S.OwnedIndex >= 0 ? OwnedData[S.OwnedIndex].data() : S.Data;
+
+		const size_t PadSize = Directory[i].Offset - Written;
+		if (PadSize > 0)
+			Result = fwrite(Padding.data(), 1, PadSize, F) == PadSize;
+		if (S.Size > 0)
+			Result = Result && fwrite(Data, 1, S.Size, F) == S.Size;
+
+		Written = Directory[i].Offset + S.Size;
+	}
+
+	fclose(F);
+
+	if (!Result)
+		printf("Error writing chunk file '%s'\n", FilePath.c_str());
+
+	return Result;
+}
+
+bool ChunkFileWriter::SaveAtomically(const std::string& FilePath) const
+{
+	// unique temporary name per writer, rename() replaces the file atomically
+	static std::atomic<uint32_t> Counter = 0;
+	const std::string TmpPath = FilePath + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + "." + std::to_string(Counter++) + ".tmp";
+
+	if (!Save(TmpPath))
+		return false;
+
+	std::error_code Ec;
+	std::filesystem::rename(TmpPath, FilePath, Ec);
+	if (Ec)
+	{
+		std::filesystem::remove(TmpPath, Ec);
+		return false;
+	}
+	return true;
+}
+
+bool ChunkFileReader::IsChunkFile(const std::string& FilePath)
+{
+	FILE* F = fopen(FilePath.c_str(), "rb");
+	if (!F)
+		return false;
+
+	uint32_t Magic = 0;
+	const bool Result = fread(&Magic, sizeof(Magic), 1, F) == 1 && Magic == kChunkFileMagic;
+	fclose(F);
+	return Result;
+}
+
+bool ChunkFileReader::Open(const std::string& FilePath, uint32_t ExpectedType)
+{
+	Close();
+
+	if (!File.Open(FilePath))
+		return false;
+
+	const uint8_t* Data = File.GetData();
+	const size_t Size = File.GetSize();
+
+	const ChunkFileHeader* H = reinterpret_cast<const ChunkFileHeader*>(Data);
+	if (Size < sizeof(ChunkFileHeader) || H->Magic != kChunkFileMagic)
+	{
+		printf("'%s' is not a chunk file\n", FilePath.c_str());
+		Close();
+		return false;
+	}
+
+	if (H->EndianTag != kChunkFileEndianTag)
+	{
+		printf("Chunk file '%s' was written on a machine with different endianness\n", FilePath.c_str());
+		Close();
+		return false;
+	}
+
+	if (H->Version > kChunkFileVersion || H->HeaderSize < sizeof(ChunkFileHeader))
+	{
+		printf("Unsupported chunk file version %u in '%s'\n", H->Version, FilePath.c_str());
+		Close();
+		return false;
+	}
+
+	if (ExpectedType != 0 && H->FileType != ExpectedType)
+	{
+		printf("Chunk file '%s' has unexpected type\n", FilePath.c_str());
+		Close();
+		return false;
+	}
+
+	const size_t DirectorySize = size_t(H->SectionCount) * sizeof(ChunkSectionEntry);
+	if (H->DirectoryOffset > Size || DirectorySize > Size - H->DirectoryOffset || (H->DirectoryOffset % alignof(ChunkSectionEntry)) != 0)
+	{
+		printf("Chunk file '%s' is truncated\n", FilePath.c_str());
+		Close();
+		return false;
+	}
+
+	const ChunkSectionEntry* Entries = reinterpret_cast<const ChunkSectionEntry*>(Data + H->DirectoryOffset);
+	if (ComputeChecksum(Entries, DirectorySize) != H->DirectoryChecksum)
+	{
+		printf("Chunk file '%s' has a corrupted section directory\n", FilePath.c_str());
+		Close();
+		return false;
+	}
+
+	for (uint32_t i = 0; i < H->SectionCount; i++)
+	{
+		if (Entries[i].Offset > Size || Entries[i].Size > Size - Entries[i].Offset)
+		{
+			printf("Chunk file '%s' is truncated\n", FilePath.c_str());
+			Close();
+			return false;
+		}
+	}
+
+	Header = H;
+	Directory = Entries;
+	return true;
+}
+
+void ChunkFileReader::Close()
+{
+	File.Close();
+	Header = nullptr;
+	Directory = nullptr;
+}
+
+const ChunkSectionEntry* ChunkFileReader::FindSection(uint32_t Id) const
+{
+	/* The directory is tiny (a dozen entries at most), a linear search is the fastest option */
+	for (uint32_t i = 0; i < GetSectionCount(); i++)
+		if (Directory[i].Id == Id)
+			return &Directory[i];
+
+	return nullptr;
+}
+
+const uint8_t* ChunkFileReader::GetSectionData(uint32_t Id, size_t& OutSize, bool Verify) const
+{
+	OutSize = 0;
+
+	const ChunkSectionEntry* Entry = FindSection(Id);
+	if (!Entry)
+		return nullptr;
+
+	const uint8_t* Data = File.GetData() + Entry->Offset;
+	if (Verify && ComputeChecksum(Data, Entry->Size) != Entry->Checksum)
+	{
+		printf("Checksum mismatch in chunk file section '%.4s'\n", reinterpret_cast<const char*>(&Entry->Id));
+		return nullptr;
+	}
+
+	OutSize = Entry->Size;
+	return Data;
+}
+
+bool ChunkFileReader::ReadStringList(uint32_t Id, std::vector<std::string>& Out) const
+{
+	size_t Size = 0;
+	const uint8_t* Data = GetSectionData(Id, Size);
+	if (!Data || Size < sizeof(uint32_t))
+		return false;
+
+	const uint8_t* End = Data + Size;
+
+	uint32_t Count = 0;
+	memcpy(&Count, Data, sizeof(Count));
+	Data += sizeof(Count);
+
+	Out.clear();
+	Out.reserve(Count);
+
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		uint32_t Length = 0;
+		if (size_t(End - Data) < sizeof(Length))
+			return false;
+		memcpy(&Length, Data, sizeof(Length));
+		Data += sizeof(Length);
+
+		if (size_t(End - Data) < Length)
+			return false;
+		Out.emplace_back(reinterpret_cast<const char*>(Data), Length);
+		Data += Length;
+	}
+
+	return true;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <Filesystem/MappedFile.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+constexpr uint32_t MakeChunkId(char A, char B, char C, char D)
+{
+	return uint32_t(uint8_t(A)) | (uint32_t(uint8_t(B)) << 8) | (uint32_t(uint8_t(C)) << 16) | (uint32_t(uint8_t(D)) << 24);
+}
+
+constexpr const uint32_t kChunkFileMagic = MakeChunkId('M', 'Y', 'T', 'H');
+constexpr const uint16_t kChunkFileVersion = 1;
+/* Written in native byte order, reads back as 0x04030201 on a machine with the other endianness */
+constexpr const uint32_t kChunkFileEndianTag = 0x01020304;
+/* Every section payload starts at a multiple of this value, so the mapped data can be used directly by SIMD code and GPU uploads */
+constexpr const uint32_t kChunkFileAlignment = 64;
+
+/**
+	Layout of a chunk file:
+		ChunkFileHeader
+		ChunkSectionEntry[SectionCount] (section directory)
+		payloads, each one aligned to kChunkFileAlignment
+*/
+struct ChunkFileHeader
+{
+	uint32_t Magic;
+	uint16_t Version;
+	uint16_t HeaderSize;
+	uint32_t EndianTag;
+	/* What kind of asset is stored in the file (scene, materials, meshes) */
+	uint32_t FileType;
+	uint32_t SectionCount;
+	/* CRC32 of the section directory */
+	uint32_t DirectoryChecksum;
+	uint64_t DirectoryOffset;
+};
+
+struct ChunkSectionEntry
+{
+	uint32_t Id;
+	uint32_t Flags;
+	uint64_t Offset;
+	uint64_t Size;
+	/* CRC32 of the payload */
+	uint32_t Checksum;
+	uint32_t Reserved;
+};
+
+static_assert(sizeof(ChunkFileHeader) == 32);
+static_assert(sizeof(ChunkSectionEntry) == 32);
+
+/**
+	Collects the sections in memory and writes the whole container in one go.
+	AddSection() does not copy the payload, the data must stay alive until Save() is called.
+*/
+class ChunkFileWriter
+{
+public:
+	explicit ChunkFileWriter(uint32_t FileType) : FileType(FileType) {}
+
+	void AddSection(uint32_t Id, const void* Data, size_t Size);
+
+	template <typename T>
+	void AddArray(uint32_t Id, const std::vector<T>& Values)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		AddSection(Id, Values.data(), Values.size() * sizeof(T));
+	}
+
+	/* Strings are serialized as [count] followed by [length, characters] pairs, the blob is owned by the writer */
+	void AddStringList(uint32_t Id, const std::vector<std::string>& Lines);
+
+	bool Save(const std::string& FilePath) const;
+
+	/* Save() into a temporary file next to FilePath and rename it, so that other threads and processes never see a partially written file */
+	bool SaveAtomically(const std::string& FilePath) const;
+
+private:
+	struct Section
+	{
+		uint32_t Id = 0;
+		const void* Data = nullptr;
+		size_t Size = 0;
+		/* Index into OwnedData or -1 for external payloads */
+		int OwnedIndex = -1;
+	};
+
+	uint32_t FileType = 0;
+	std::vector<Section> Sections;
+	std::vector<std::vector<uint8_t>> OwnedData;
+};
+
+/**
+	Read-only view of a chunk file on top of a memory mapping.
+	After Open() the reader is never modified, so different sections can be fetched and decoded from several threads at once.
+	Checksums are verified per section on access, which means sections that are never requested are never touched.
+*/
+class ChunkFileReader
+{
+public:
+	ChunkFileReader() = default;
+
+	/* Validates header and section directory. ExpectedType == 0 accepts any file type */
+	bool Open(const std::string& FilePath, uint32_t ExpectedType = 0);
+	void Close();
+
+	bool IsValid() const
+	{
+		return Header != nullptr;
+	}
+
+	uint32_t GetFileType() const
+	{
+		return Header ? Header->FileType : 0;
+	}
+
+	uint32_t GetSectionCount() const
+	{
+		return Header ? Header->SectionCount : 0;
+	}
+
+	const ChunkSectionEntry* FindSection(uint32_t Id) const;
+
+	bool HasSection(uint32_t Id) const
+	{
+		return FindSection(Id) != nullptr;
+	}
+
+	/* Returns nullptr if the section is missing or its checksum does not match */
+	const uint8_t* GetSectionData(uint32_t Id, size_t& OutSize, bool Verify = true) const;
+
+	template <typename T>
+	bool ReadArray(uint32_t Id, std::vector<T>& Out, bool Verify = true) const
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+
+		size_t Size = 0;
+		const uint8_t* Data = GetSectionData(Id, Size, Verify);
+		if (!Data || (Size % sizeof(T)) != 0)
+			return false;
+
+		Out.resize(Size / sizeof(T));
+		if (Size > 0)
+			memcpy(Out.data(), Data, Size);
+		return true;
+	}
+
+	bool ReadStringList(uint32_t Id, std::vector<std::string>& Out) const;
+
+	/* Cheap check of the first bytes to distinguish chunk files from the legacy raw formats */
+	static bool IsChunkFile(const std::string& FilePath);
+
+	static uint32_t ComputeChecksum(const void* Data, size_t Size);
+
+private:
+	MappedFile File;
+
+	const ChunkFileHeader* Header = nullptr;
+	const ChunkSectionEntry* Directory = nullptr;
+};
@@ -0,0 +1,144 @@
+#include <Filesystem/MappedFile.hpp>
+
+#include <cstdio>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& Other) noexcept
+{
+	*this = std::move(Other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& Other) noexcept
+{
+	if (this != &Other)
+	{
+		Close();
+		std::swap(Data, Other.Data);
+		std::swap(Size, Other.Size);
+#ifdef _WIN32
+		std::swap(FileHandle, Other.FileHandle);
+		std::swap(MappingHandle, Other.MappingHandle);
+#endif
+	}
+	return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& FilePath)
+{
+	Close();
+
+	HANDLE File = CreateFileA(FilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+	{
+		printf("Cannot open file '%s' for mapping\n", FilePath.c_str());
+		return false;
+	}
+
+	LARGE_INTEGER FileSize{};
+	if (!GetFileSizeEx(File, &FileSize) || FileSize.QuadPart == 0)
+	{
+		CloseHandle(File);
+		return false;
+	}
+
+	HANDLE Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!Mapping)
+	{
+		printf("Cannot create file mapping for '%s'\n", FilePath.c_str());
+		CloseHandle(File);
+		return false;
+	}
+
+	const void* View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!View)
+	{
+		printf("Cannot map view of file '%s'\n", FilePath.c_str());
+		CloseHandle(Mapping);
+		CloseHandle(File);
+		return false;
+	}
+
+	FileHandle = File;
+	MappingHandle = Mapping;
+	Data = static_cast<const uint8_t*>(View);
+	Size = static_cast<size_t>(FileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (Data)
+		UnmapViewOfFile(Data);
+	if (MappingHandle)
+		CloseHandle(MappingHandle);
+	if (FileHandle)
+		CloseHandle(FileHandle);
+
+	Data = nullptr;
+	Size = 0;
+	FileHandle = nullptr;
+	MappingHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& FilePath)
+{
+	Close();
+
+	const int File = open(FilePath.c_str(), O_RDONLY);
+	if (File < 0)
+	{
+		printf("Cannot open file '%s' for mapping\n", FilePath.c_str());
+		return false;
+	}
+
+	struct stat FileStat{};
+	if (fstat(File, &FileStat) != 0 || FileStat.st_size == 0)
+	{
+		close(File);
+		return false;
+	}
+
+	void* View = mmap(nullptr, static_cast<size_t>(FileStat.st_size), PROT_READ, MAP_PRIVATE, File, 0);
+	// the mapping keeps its own reference to the file
+	close(File);
+
+	if (View == MAP_FAILED)
+	{
+		printf("Cannot map file '%s'\n", FilePath.c_str());
+		return false;
+	}
+
+	// most users stream the whole file into GPU buffers front to back
+	madvise(View, static_cast<size_t>(FileStat.st_size), MADV_SEQUENTIAL);
+
+	Data = static_cast<const uint8_t*>(View);
+	Size = static_cast<size_t>(FileStat.st_size);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (Data)
+		munmap(const_cast<uint8_t*>(Data), Size);
+
+	Data = nullptr;
+	Size = 0;
+}
+
+#endif
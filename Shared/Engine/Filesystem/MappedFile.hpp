@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+	Read-only memory mapping of a whole file.
+	The pages are served straight from the OS page cache, nothing is copied until the caller touches the data.
+*/
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::string& FilePath)
+	{
+		Open(FilePath);
+	}
+	~MappedFile()
+	{
+		Close();
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& Other) noexcept;
+	MappedFile& operator=(MappedFile&& Other) noexcept;
+
+	bool Open(const std::string& FilePath);
+	void Close();
+
+	bool IsValid() const
+	{
+		return Data != nullptr;
+	}
+
+	const uint8_t* GetData() const
+	{
+		return Data;
+	}
+
+	size_t GetSize() const
+	{
+		return Size;
+	}
+
+private:
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+
+#ifdef _WIN32
+	void* FileHandle = nullptr;
+	void* MappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,207 @@
+#include <Scene/AssetConverter.hpp>
+
+#include <Filesystem/ChunkFile.hpp>
+#include <Filesystem/Config.hpp>
+#include <Filesystem/FilesystemUtilities.hpp>
+#include <Scene/Mareial.hpp>
+#include <Scene/Scene.hpp>
+#include <Scene/VtxData.hpp>
+#include <TextureCompression.hpp>
+
+#include <stb_image.h>
+
+#include <taskflow/taskflow.hpp>
+#include <taskflow/algorithm/for_each.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <stdio.h>
+
+static bool checkInputFile(const char* inFile)
+{
+	if (!std::filesystem::exists(inFile))
+	{
+		printf("Cannot convert '%s': file not found\n", inFile);
+		return false;
+	}
+	return true;
+}
+
+bool upgradeSceneFile(const char* inFile, const char* outFile)
+{
+	if (!checkInputFile(inFile))
+		return false;
+
+	Scene scene;
+	if (!loadScene(inFile, scene))
+		return false;
+
+	saveScene(outFile, scene);
+
+	return ChunkFileReader::IsChunkFile(outFile);
+}
+
+bool upgradeMaterialFile(const char* inFile, const char* outFile)
+{
+	if (!checkInputFile(inFile))
+		return false;
+
+	std::vector<MaterialDescription> materials;
+	std::vector<std::string> files;
+	loadMaterials(inFile, materials, files);
+	saveMaterials(outFile, materials, files);
+
+	return ChunkFileReader::IsChunkFile(outFile);
+}
+
+bool upgradeMeshFile(const char* inFile, const char* outFile)
+{
+	if (!checkInputFile(inFile))
+		return false;
+
+	MeshData meshData;
+	loadMeshData(inFile, meshData);
+	saveMeshData(outFile, meshData);
+
+	return ChunkFileReader::IsChunkFile(outFile);
+}
+
+bool upgradeAssetFile(const char* fileName)
+{
+	const std::string ext = std::filesystem::path(fileName).extension().string();
+
+	if (ext == ".scene")
+		return upgradeSceneFile(fileName, fileName);
+	if (ext == ".materials" || ext == ".material")
+		return upgradeMaterialFile(fileName, fileName);
+	if (ext == ".meshes")
+		return upgradeMeshFile(fileName, fileName);
+
+	printf("Cannot convert '%s': unknown asset type\n", fileName);
+	return false;
+}
+
+// a texture shared by several material slots is encoded for the most demanding one
+enum eTextureRole
+{
+	eTextureRole_Linear,
+	eTextureRole_Color,
+	eTextureRole_Normal,
+};
+
+static void assignTextureRole(std::vector<eTextureRole>& roles, uint64_t idx, eTextureRole role)
+{
+	if (idx != INVALID_TEXTURE && idx < roles.size())
+		roles[idx] = std::max(roles[idx], role);
+}
+
+static bool compressTextureFile(const std::string& inFile, const std::string& outFile, eTextureRole role)
+{
+	CompressedTexture tex;
+	int w, h;
+
+	if (stbi_is_hdr(inFile.c_str()))
+	{
+		float* img = stbi_loadf(inFile.c_str(), &w, &h, nullptr, STBI_rgb);
+		if (!img)
+			return false;
+		compressTextureHDR(img, w, h, tex);
+		stbi_image_free(img);
+	}
+	else
+	{
+		uint8_t* img = stbi_load(inFile.c_str(), &w, &h, nullptr, STBI_rgb_alpha);
+		if (!img)
+			return false;
+		const eCompressedFormat format =
+			(role == eTextureRole_Normal) ? eCompressedFormat_BC5 :
+			(role == eTextureRole_Color) ? eCompressedFormat_BC7_SRGB : eCompressedFormat_BC7;
+		compressTexture(img, w, h, format, tex);
+		stbi_image_free(img);
+	}
+
+	return saveCompressedTexture(outFile.c_str(), tex);
+}
+
+bool compressMaterialTextures(const char* inFile, const char* outFile, const std::string& textureRoot, tf::Executor* executor)
+{
+	if (!checkInputFile(inFile))
+		return false;
+
+	std::vector<MaterialDescription> materials;
+	std::vector<std::string> files;
+	loadMaterials(inFile, materials, files);
+
+	std::vector<eTextureRole> roles(files.size(), eTextureRole_Linear);
+	for (const auto& m : materials)
+	{
+		assignTextureRole(roles, m.albedoMap_, eTextureRole_Color);
+		assignTextureRole(roles, m.emissiveMap_, eTextureRole_Color);
+		assignTextureRole(roles, m.normalMap_, eTextureRole_Normal);
+	}
+
+	std::vector<std::string> newFiles(files);
+	std::vector<uint8_t> failed(files.size(), 0);
+
+	auto compressFile = [&](uint32_t i)
+	{
+		if (isCompressedTextureFile(files[i].c_str()))
+			return;
+
+		const std::filesystem::path src = textureRoot + files[i];
+		const std::string ktxName = std::filesystem::path(files[i]).replace_extension(".ktx").string();
+		const std::filesystem::path dst = textureRoot + ktxName;
+
+		if (!std::filesystem::exists(src))
+		{
+			printf("Cannot compress '%s': file not found\n", src.string().c_str());
+			failed[i] = 1;
+			return;
+		}
+
+		const bool isUpToDate = std::filesystem::exists(dst) && std::filesystem::last_write_time(dst) >= std::filesystem::last_write_time(src);
+		if (!isUpToDate && !compressTextureFile(src.string(), dst.string(), roles[i]))
+		{
+			printf("Cannot compress '%s'\n", src.string().c_str());
+			failed[i] = 1;
+			return;
+		}
+
+		newFiles[i] = ktxName;
+	};
+
+	if (executor)
+	{
+		tf::Taskflow taskflow;
+		taskflow.for_each_index(0u, (uint32_t)files.size(), 1u, compressFile);
+		executor->run(taskflow).wait();
+	}
+	else
+	{
+		for (uint32_t i = 0; i != (uint32_t)files.size(); i++)
+			compressFile(i);
+	}
+
+	// textures which could not be compressed keep their original names, the loaders accept both
+	saveMaterials(outFile, materials, newFiles);
+
+	return std::find(failed.begin(), failed.end(), 1) == failed.end();
+}
+
+std::string getMaterialFileToLoad(const char* materialFile, tf::Executor* executor)
+{
+	Config config(FilesystemUtilities::GetPlatformDir() + "/Config.ini");
+
+	int compressTextures = 0;
+	config.ReadValueSafety("Assets", "CompressTextures", compressTextures);
+
+	if (!compressTextures)
+		return materialFile;
+
+	const std::string compressedFile = std::filesystem::path(materialFile).replace_extension(".ktx.materials").string();
+
+	// textures which fail to compress keep their names in the new list, so it is usable anyway
+	compressMaterialTextures(materialFile, compressedFile.c_str(), FilesystemUtilities::GetResourcesDir(), executor);
+
+	return std::filesystem::exists(compressedFile) ? compressedFile : std::string(materialFile);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+
+namespace tf { class Executor; }
+
+/**
+	Upgrade of the legacy raw .scene/.materials/.meshes files to the chunk file container.
+	The loaders accept both formats, so these are only needed to get rid of the slow legacy path (checksums, skippable sections).
+	[outFile] may be the same as [inFile], files which are already chunk files are rewritten unchanged.
+*/
+bool upgradeSceneFile(const char* inFile, const char* outFile);
+bool upgradeMaterialFile(const char* inFile, const char* outFile);
+bool upgradeMeshFile(const char* inFile, const char* outFile);
+
+/* Picks the converter by file extension (.scene, .materials/.material, .meshes) and upgrades the file in place */
+bool upgradeAssetFile(const char* fileName);
+
+/**
+	Offline texture compression of a material list.
+	Every texture referenced by [inFile] is encoded with a full mip chain into a .ktx file next to the source image
+	(BC5 for normal maps, BC7 sRGB for albedo/emissive maps, BC7 for the rest, BC6H for HDR images)
+	and the material list with the new texture names is written to [outFile], which may be the same as [inFile].
+	Texture names are relative to [textureRoot], up-to-date .ktx files are reused.
+*/
+bool compressMaterialTextures(const char* inFile, const char* outFile, const std::string& textureRoot, tf::Executor* executor = nullptr);
+
+/**
+	The material list the scene loaders open for [materialFile].
+	With CompressTextures = 1 in the [Assets] section of Config.ini the textures are compressed by compressMaterialTextures()
+	into a .ktx.materials list next to [materialFile] and its name is returned. Up-to-date .ktx files are reused,
+	so only the first run pays for the encoding. Otherwise, or if the list cannot be written, [materialFile] is returned.
+*/
+std::string getMaterialFileToLoad(const char* materialFile, tf::Executor* executor = nullptr);
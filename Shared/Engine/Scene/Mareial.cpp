@@ -1,8 +1,14 @@
 #include <Scene/Mareial.hpp>
 
 #include <unordered_map>
+#include <Filesystem/ChunkFile.hpp>
 #include <Utils/Utils.hpp>
 
+constexpr const uint32_t kMaterialFileType = MakeChunkId('M', 'T', 'L', 'S');
+
+constexpr const uint32_t kMaterialSectionDescriptions = MakeChunkId('M', 'D', 'S', 'C');
+constexpr const uint32_t kMaterialSectionTextureFiles = MakeChunkId('T', 'E', 'X', 'F');
+
 void saveStringList(FILE* f, const std::vector<std::string>& lines)
 {
 	uint32_t sz = (uint32_t)lines.size();
@@ -35,19 +41,28 @@ void loadStringList(FILE* f, std::vector<std::string>& lines)
 
 void saveMaterials(const char* fileName, const std::vector<MaterialDescription>& materials, const std::vector<std::string>& files)
 {
-	FILE* f = fopen(fileName, "wb");
-	if (!f)
-		return;
-
-	uint32_t sz = (uint32_t)materials.size();
-	fwrite(&sz, 1, sizeof(uint32_t), f);
-	fwrite(materials.data(), sizeof(MaterialDescription), sz, f);
-	saveStringList(f, files);
-	fclose(f);
+	ChunkFileWriter writer(kMaterialFileType);
+	writer.AddArray(kMaterialSectionDescriptions, materials);
+	writer.AddStringList(kMaterialSectionTextureFiles, files);
+	writer.Save(fileName);
 }
 
 void loadMaterials(const char* fileName, std::vector<MaterialDescription>& materials, std::vector<std::string>& files)
 {
+	if (ChunkFileReader::IsChunkFile(fileName))
+	{
+		ChunkFileReader reader;
+		if (!reader.Open(fileName, kMaterialFileType) ||
+			!reader.ReadArray(kMaterialSectionDescriptions, materials) ||
+			!reader.ReadStringList(kMaterialSectionTextureFiles, files))
+		{
+			printf("Cannot load materials from %s\n", fileName);
+			exit(255);
+		}
+		return;
+	}
+
+	// legacy raw format (use upgradeMaterialFile() to convert)
 	FILE* f = fopen(fileName, "rb");
 	if (!f)
 	{
@@ -37,6 +37,7 @@ struct PACKED_STRUCT MaterialDescription final
 };
 
 void saveMaterials(const char* fileName, const std::vector<MaterialDescription>& materials, const std::vector<std::string>& files);
+/* Accepts both chunk files and the legacy raw format */
 void loadMaterials(const char* fileName, std::vector<MaterialDescription>& materials, std::vector<std::string>& files);
 
 // Merge material lists from multiple scenes (follows the logic of merging in mergeScenes)
@@ -1,12 +1,19 @@
 #include <Scene/MergeUtil.hpp>
 
+#include <algorithm>
 #include <map>
 
 static uint32_t shiftMeshIndices(MeshData& meshData, const std::vector<uint32_t>& meshesToMerge)
 {
 	auto minVtxOffset = std::numeric_limits<uint32_t>::max();
+	auto maxVtxEnd = 0u;
+	bool hasVertexCounts = true;
 	for (auto i : meshesToMerge)
+	{
 		minVtxOffset = std::min(meshData.meshes_[i].vertexOffset, minVtxOffset);
+		maxVtxEnd = std::max(meshData.meshes_[i].vertexOffset + meshData.meshes_[i].vertexCount, maxVtxEnd);
+		hasVertexCounts = hasVertexCounts && meshData.meshes_[i].vertexCount > 0;
+	}
 
 	auto mergeCount = 0u; // calculated by summing index counts in meshesToMerge
 
@@ -22,6 +29,8 @@ static uint32_t shiftMeshIndices(MeshData& meshData, const std::vector<uint32_t>
 			meshData.indexData_[m.indexOffset + ii] += delta;
 
 		m.vertexOffset = minVtxOffset;
+		// the merged vertex range spans all the merged meshes (and the vertices of other meshes in between), unknown if any count is
+		m.vertexCount = hasVertexCounts ? maxVtxEnd - minVtxOffset : 0;
 
 		// sum all the deleted meshes' indices
 		mergeCount += idxCount;
@@ -69,16 +78,21 @@ static void mergeIndexArray(MeshData& md, const std::vector<uint32_t>& meshesToM
 	md.meshes_.push_back(lastMesh);
 }
 
-void mergeScene(Scene& scene, MeshData& meshData, const std::string& materialName)
+void mergeScene(Scene& scene, MeshData& meshData, std::vector<MaterialDescription>& materials, const std::string& materialName)
 {
 	// Find material index
 	int oldMaterial = (int)std::distance(std::begin(scene.materialNames_), std::find(std::begin(scene.materialNames_), std::end(scene.materialNames_), materialName));
 
 	std::vector<uint32_t> toDelete;
 
-	for (auto i = 0u; i < scene.hierarchy_.size(); i++)
-		if (scene.meshes_.count(i) > 0 && scene.materialForNode_.count(i) > 0 && (scene.materialForNode_.at(i) == oldMaterial))
-			toDelete.push_back(i);
+	// iterate only over the nodes which actually have meshes
+	for (const auto& m : scene.meshes_)
+	{
+		const auto material = scene.materialForNode_.find(m.first);
+		if (material != scene.materialForNode_.end() && material->second == (uint32_t)oldMaterial)
+			toDelete.push_back(m.first);
+	}
+	std::sort(toDelete.begin(), toDelete.end());
 
 	std::vector<uint32_t> meshesToMerge(toDelete.size());
 
@@ -104,5 +118,13 @@ void mergeScene(Scene& scene, MeshData& meshData, const std::string& materialNam
 	scene.meshes_[newNode] = meshData.meshes_.size() - 1;
 	scene.materialForNode_[newNode] = (uint32_t)oldMaterial;
 
-	deleteSceneNodes(scene, toDelete);
+	// the subtrees of the merged nodes may have held the last users of some materials
+	std::vector<int> materialRemap;
+	deleteSceneNodes(scene, toDelete, &materialRemap);
+
+	std::vector<MaterialDescription> usedMaterials(scene.materialNames_.size());
+	for (size_t i = 0; i != materialRemap.size() && i != materials.size(); i++)
+		if (materialRemap[i] != -1)
+			usedMaterials[materialRemap[i]] = materials[i];
+	materials = std::move(usedMaterials);
 }
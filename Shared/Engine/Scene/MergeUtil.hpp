@@ -1,6 +1,8 @@
 #pragma once
 
+#include <Scene/Mareial.hpp>
 #include <Scene/Scene.hpp>
 #include <Scene/VtxData.hpp>
 
-void mergeScene(Scene& scene, MeshData& meshData, const std::string& materialName);
+/* Materials which are no longer used by any node are removed from [materials] and from scene.materialNames_ */
+void mergeScene(Scene& scene, MeshData& meshData, std::vector<MaterialDescription>& materials, const std::string& materialName);
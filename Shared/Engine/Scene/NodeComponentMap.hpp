@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+	Sparse set which maps scene node indices to component values (mesh, material or name index).
+
+	The (node, value) pairs are stored densely in insertion order, so iterating over all the components of a scene
+	is a linear walk over one array, and a lookup is a single indexed load into the sparse array instead of hashing.
+	The interface mirrors the subset of std::unordered_map<uint32_t, uint32_t> used by the scene code.
+	Keys must not be modified through iterators.
+ */
+class NodeComponentMap final
+{
+public:
+	using value_type = std::pair<uint32_t, uint32_t>;
+	using iterator = std::vector<value_type>::iterator;
+	using const_iterator = std::vector<value_type>::const_iterator;
+
+	iterator begin() { return dense_.begin(); }
+	iterator end() { return dense_.end(); }
+	const_iterator begin() const { return dense_.begin(); }
+	const_iterator end() const { return dense_.end(); }
+
+	size_t size() const { return dense_.size(); }
+	bool empty() const { return dense_.empty(); }
+
+	void clear()
+	{
+		dense_.clear();
+		sparse_.clear();
+	}
+
+	/* [nodeCount] is the expected upper bound for node indices */
+	void reserve(size_t count, size_t nodeCount = 0)
+	{
+		dense_.reserve(count);
+		if (nodeCount > sparse_.size())
+			sparse_.resize(nodeCount, kInvalidIndex);
+	}
+
+	size_t count(uint32_t node) const
+	{
+		return (node < sparse_.size() && sparse_[node] != kInvalidIndex) ? 1 : 0;
+	}
+
+	iterator find(uint32_t node)
+	{
+		return count(node) ? dense_.begin() + sparse_[node] : dense_.end();
+	}
+
+	const_iterator find(uint32_t node) const
+	{
+		return count(node) ? dense_.begin() + sparse_[node] : dense_.end();
+	}
+
+	uint32_t& at(uint32_t node)
+	{
+		assert(count(node));
+		return dense_[sparse_[node]].second;
+	}
+
+	const uint32_t& at(uint32_t node) const
+	{
+		assert(count(node));
+		return dense_[sparse_[node]].second;
+	}
+
+	uint32_t& operator[](uint32_t node)
+	{
+		if (node >= sparse_.size())
+			sparse_.resize(node + 1, kInvalidIndex);
+
+		if (sparse_[node] == kInvalidIndex)
+		{
+			sparse_[node] = static_cast<uint32_t>(dense_.size());
+			dense_.emplace_back(node, 0);
+		}
+
+		return dense_[sparse_[node]].second;
+	}
+
+	/**
+		Bulk insertion for parallel merges: appendSlots() adds [count] empty slots and returns the index of the first one,
+		then every slot must be filled with setSlot(). Slots can be filled from different threads as long as the nodes are unique
+		and not present in the map yet.
+	*/
+	size_t appendSlots(size_t count, size_t nodeCount)
+	{
+		const size_t first = dense_.size();
+		dense_.resize(first + count);
+		if (nodeCount > sparse_.size())
+			sparse_.resize(nodeCount, kInvalidIndex);
+		return first;
+	}
+
+	void setSlot(size_t slot, uint32_t node, uint32_t value)
+	{
+		assert(node < sparse_.size() && sparse_[node] == kInvalidIndex);
+		dense_[slot] = value_type(node, value);
+		sparse_[node] = static_cast<uint32_t>(slot);
+	}
+
+	/* Swap'n'pop removal, the order of the remaining items changes */
+	size_t erase(uint32_t node)
+	{
+		if (!count(node))
+			return 0;
+
+		const uint32_t idx = sparse_[node];
+		if (idx != dense_.size() - 1)
+		{
+			dense_[idx] = dense_.back();
+			sparse_[dense_[idx].first] = idx;
+		}
+
+		dense_.pop_back();
+		sparse_[node] = kInvalidIndex;
+		return 1;
+	}
+
+private:
+	static constexpr uint32_t kInvalidIndex = ~0u;
+
+	std::vector<value_type> dense_;
+	std::vector<uint32_t> sparse_;
+};
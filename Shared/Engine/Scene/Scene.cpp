@@ -1,12 +1,30 @@
 #include <algorithm>
+#include <cassert>
 #include <numeric>
 #include <Scene/Scene.hpp>
 
+#include <Filesystem/ChunkFile.hpp>
+#include <Utils/UtilsSIMD.hpp>
+
+#include <taskflow/taskflow.hpp>
+#include <taskflow/algorithm/for_each.hpp>
+
 #include "Utils/Utils.hpp"
 
 void saveStringList(FILE* f, const std::vector<std::string>& lines);
 void loadStringList(FILE* f, std::vector<std::string>& lines);
 
+constexpr const uint32_t kSceneFileType = MakeChunkId('S', 'C', 'N', 'E');
+
+constexpr const uint32_t kSceneSectionLocalTransforms = MakeChunkId('L', 'X', 'F', 'M');
+constexpr const uint32_t kSceneSectionGlobalTransforms = MakeChunkId('G', 'X', 'F', 'M');
+constexpr const uint32_t kSceneSectionHierarchy = MakeChunkId('H', 'I', 'E', 'R');
+constexpr const uint32_t kSceneSectionMaterialForNode = MakeChunkId('N', 'M', 'T', 'L');
+constexpr const uint32_t kSceneSectionMeshForNode = MakeChunkId('N', 'M', 'S', 'H');
+constexpr const uint32_t kSceneSectionNameForNode = MakeChunkId('N', 'N', 'A', 'M');
+constexpr const uint32_t kSceneSectionNames = MakeChunkId('N', 'A', 'M', 'E');
+constexpr const uint32_t kSceneSectionMaterialNames = MakeChunkId('M', 'N', 'A', 'M');
+
 int addNode(Scene& scene, int parent, int level)
 {
 	int node = (int)scene.hierarchy_.size();
@@ -50,36 +68,136 @@ int addNode(Scene& scene, int parent, int level)
 
 void markAsChanged(Scene& scene, int node)
 {
-	int level = scene.hierarchy_[node].level_;
-	scene.changedAtThisFrame_[level].push_back(node);
+	if (scene.isNodeChanged_.size() < scene.hierarchy_.size())
+		scene.isNodeChanged_.resize(scene.hierarchy_.size(), false);
 
-	// TODO: use non-recursive iteration with aux stack
-	for (int s = scene.hierarchy_[node].firstChild_; s != -1; s = scene.hierarchy_[s].nextSibling_)
-		markAsChanged(scene, s);
+	// pre-order walk of the subtree over the firstChild_/nextSibling_/parent_ links, no stack needed.
+	// A queued node always has its whole subtree queued as well, so such subtrees are skipped entirely
+	int n = node;
+	for (;;)
+	{
+		bool descend = false;
+
+		if (!scene.isNodeChanged_[n])
+		{
+			const int level = scene.hierarchy_[n].level_;
+			assert(level < MAX_NODE_LEVEL);
+			if (level < MAX_NODE_LEVEL)
+			{
+				scene.isNodeChanged_[n] = true;
+				scene.changedAtThisFrame_[level].push_back(n);
+				descend = true;
+			}
+			else
+				printf("Scene node %d is deeper than MAX_NODE_LEVEL (%d), its transform will not be updated\n", n, MAX_NODE_LEVEL);
+		}
+
+		if (descend && scene.hierarchy_[n].firstChild_ != -1)
+		{
+			n = scene.hierarchy_[n].firstChild_;
+			continue;
+		}
+
+		// the next sibling of the closest ancestor which has one, without leaving the subtree of [node]
+		while (n != node && scene.hierarchy_[n].nextSibling_ == -1)
+			n = scene.hierarchy_[n].parent_;
+
+		if (n == node)
+			break;
+
+		n = scene.hierarchy_[n].nextSibling_;
+	}
+}
+
+static void clearChangedLevel(Scene& scene, int level)
+{
+	for (const int& c : scene.changedAtThisFrame_[level])
+		scene.isNodeChanged_[c] = false;
+	scene.changedAtThisFrame_[level].clear();
+}
+
+static void recalculateRootTransforms(Scene& scene)
+{
+	for (const int& c : scene.changedAtThisFrame_[0])
+		scene.globalTransform_[c] = scene.localTransform_[c];
+	clearChangedLevel(scene, 0);
+}
+
+static void recalculateLevelTransforms(Scene& scene, const std::vector<int>& nodes, size_t first, size_t last)
+{
+	for (size_t i = first; i < last; i++)
+	{
+		const int c = nodes[i];
+		const int p = scene.hierarchy_[c].parent_;
+		multiplyMat4(scene.globalTransform_[p], scene.localTransform_[c], scene.globalTransform_[c]);
+	}
 }
 
 // CPU version of global transform update []
 void recalculateGlobalTransforms(Scene& scene)
 {
-	if (!scene.changedAtThisFrame_[0].empty())
+	recalculateRootTransforms(scene);
+
+	// a changed subtree fills the levels from its root down, the levels above it stay empty
+	for (int i = 1; i < MAX_NODE_LEVEL; i++)
 	{
-		int c = scene.changedAtThisFrame_[0][0];
-		scene.globalTransform_[c] = scene.localTransform_[c];
-		scene.changedAtThisFrame_[0].clear();
+		if (scene.changedAtThisFrame_[i].empty())
+			continue;
+
+		recalculateLevelTransforms(scene, scene.changedAtThisFrame_[i], 0, scene.changedAtThisFrame_[i].size());
+		clearChangedLevel(scene, i);
+	}
+}
+
+void recalculateGlobalTransforms(Scene& scene, tf::Executor& executor)
+{
+	// nodes on one level only depend on the (already updated) previous level,
+	// so every level is split into batches and the levels are chained one after another
+	constexpr size_t kBatchSize = 512;
+
+	recalculateRootTransforms(scene);
+
+	size_t totalNodes = 0;
+	for (int i = 1; i < MAX_NODE_LEVEL; i++)
+		totalNodes += scene.changedAtThisFrame_[i].size();
+
+	// not worth waking up the workers
+	if (totalNodes <= kBatchSize)
+	{
+		recalculateGlobalTransforms(scene);
+		return;
 	}
 
-	for (int i = 1; i < MAX_NODE_LEVEL && (!scene.changedAtThisFrame_[i].empty()); i++)
+	tf::Taskflow taskflow;
+	tf::Task prevLevel;
+
+	for (int i = 1; i < MAX_NODE_LEVEL; i++)
 	{
-		for (const int& c : scene.changedAtThisFrame_[i])
+		if (scene.changedAtThisFrame_[i].empty())
+			continue;
+
+		const std::vector<int>& nodes = scene.changedAtThisFrame_[i];
+		const uint32_t numBatches = static_cast<uint32_t>((nodes.size() + kBatchSize - 1) / kBatchSize);
+
+		tf::Task level = taskflow.for_each_index(0u, numBatches, 1u, [&scene, &nodes](uint32_t batch)
 		{
-			int p = scene.hierarchy_[c].parent_;
-			scene.globalTransform_[c] = scene.globalTransform_[p] * scene.localTransform_[c];
-		}
-		scene.changedAtThisFrame_[i].clear();
+			const size_t first = batch * kBatchSize;
+			recalculateLevelTransforms(scene, nodes, first, std::min(first + kBatchSize, nodes.size()));
+		});
+
+		if (!prevLevel.empty())
+			prevLevel.precede(level);
+		prevLevel = level;
 	}
+
+	executor.run(taskflow).wait();
+
+	// the same levels as the serial version
+	for (int i = 1; i < MAX_NODE_LEVEL; i++)
+		clearChangedLevel(scene, i);
 }
 
-void loadMap(FILE* f, std::unordered_map<uint32_t, uint32_t>& map)
+void loadMap(FILE* f, NodeComponentMap& map)
 {
 	std::vector<uint32_t> ms;
 
@@ -88,18 +206,72 @@ void loadMap(FILE* f, std::unordered_map<uint32_t, uint32_t>& map)
 
 	ms.resize(sz);
 	fread(ms.data(), sizeof(int), sz, f);
+	map.reserve(sz / 2);
 	for (size_t i = 0; i < (sz / 2); i++)
 		map[ms[i * 2 + 0]] = ms[i * 2 + 1];
 }
 
-void loadScene(const char* fileName, Scene& scene)
+static bool loadMapSection(const ChunkFileReader& reader, uint32_t id, NodeComponentMap& map)
 {
+	std::vector<uint32_t> ms;
+	if (!reader.ReadArray(id, ms))
+		return false;
+
+	map.reserve(ms.size() / 2);
+	for (size_t i = 0; i < (ms.size() / 2); i++)
+		map[ms[i * 2 + 0]] = ms[i * 2 + 1];
+
+	return true;
+}
+
+static bool loadSceneChunked(const char* fileName, Scene& scene, bool loadNames)
+{
+	ChunkFileReader reader;
+	if (!reader.Open(fileName, kSceneFileType))
+		return false;
+
+	if (!reader.ReadArray(kSceneSectionLocalTransforms, scene.localTransform_) ||
+		!reader.ReadArray(kSceneSectionGlobalTransforms, scene.globalTransform_) ||
+		!reader.ReadArray(kSceneSectionHierarchy, scene.hierarchy_))
+	{
+		printf("Scene file '%s' is corrupted\n", fileName);
+		return false;
+	}
+
+	if (!loadMapSection(reader, kSceneSectionMaterialForNode, scene.materialForNode_) ||
+		!loadMapSection(reader, kSceneSectionMeshForNode, scene.meshes_))
+	{
+		printf("Scene file '%s' is corrupted\n", fileName);
+		return false;
+	}
+
+	// the names are optional (saveScene() skips them for unnamed scenes), but must be intact when present
+	if (loadNames && reader.HasSection(kSceneSectionNameForNode))
+	{
+		if (!loadMapSection(reader, kSceneSectionNameForNode, scene.nameForNode_) ||
+			!reader.ReadStringList(kSceneSectionNames, scene.names_) ||
+			!reader.ReadStringList(kSceneSectionMaterialNames, scene.materialNames_))
+		{
+			printf("Scene file '%s' has corrupted node names\n", fileName);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool loadScene(const char* fileName, Scene& scene, bool loadNames)
+{
+	if (ChunkFileReader::IsChunkFile(fileName))
+		return loadSceneChunked(fileName, scene, loadNames);
+
+	// legacy raw format (use upgradeSceneFile() to convert)
 	FILE* f = fopen(fileName, "rb");
 
 	if (!f)
 	{
 		printf("Cannot open scene file '%s'. Please run SceneConverter from Chapter7 and/or MergeMeshes from Chapter 9", fileName);
-		return;
+		return false;
 	}
 
 	uint32_t sz = 0;
@@ -118,7 +290,7 @@ void loadScene(const char* fileName, Scene& scene)
 	loadMap(f, scene.materialForNode_);
 	loadMap(f, scene.meshes_);
 
-	if (!feof(f))
+	if (loadNames && !feof(f))
 	{
 		loadMap(f, scene.nameForNode_);
 		loadStringList(f, scene.names_);
@@ -127,9 +299,11 @@ void loadScene(const char* fileName, Scene& scene)
 	}
 
 	fclose(f);
+
+	return true;
 }
 
-void saveMap(FILE* f, const std::unordered_map<uint32_t, uint32_t>& map)
+static std::vector<uint32_t> flattenMap(const NodeComponentMap& map)
 {
 	std::vector<uint32_t> ms;
 	ms.reserve(map.size() * 2);
@@ -138,69 +312,57 @@ void saveMap(FILE* f, const std::unordered_map<uint32_t, uint32_t>& map)
 		ms.push_back(m.first);
 		ms.push_back(m.second);
 	}
-	const uint32_t sz = static_cast<uint32_t>(ms.size());
-	fwrite(&sz, sizeof(sz), 1, f);
-	fwrite(ms.data(), sizeof(int), ms.size(), f);
+	return ms;
 }
 
 void saveScene(const char* fileName, const Scene& scene)
 {
-	FILE* f = fopen(fileName, "wb");
+	const std::vector<uint32_t> materialForNode = flattenMap(scene.materialForNode_);
+	const std::vector<uint32_t> meshForNode = flattenMap(scene.meshes_);
+	const std::vector<uint32_t> nameForNode = flattenMap(scene.nameForNode_);
 
-	const uint32_t sz = (uint32_t)scene.hierarchy_.size();
-	fwrite(&sz, sizeof(sz), 1, f);
+	ChunkFileWriter writer(kSceneFileType);
 
-	fwrite(scene.localTransform_.data(), sizeof(glm::mat4), sz, f);
-	fwrite(scene.globalTransform_.data(), sizeof(glm::mat4), sz, f);
-	fwrite(scene.hierarchy_.data(), sizeof(Hierarchy), sz, f);
+	writer.AddArray(kSceneSectionLocalTransforms, scene.localTransform_);
+	writer.AddArray(kSceneSectionGlobalTransforms, scene.globalTransform_);
+	writer.AddArray(kSceneSectionHierarchy, scene.hierarchy_);
 
 	// Mesh for node [index to some list of buffers]
-	saveMap(f, scene.materialForNode_);
-	saveMap(f, scene.meshes_);
+	writer.AddArray(kSceneSectionMaterialForNode, materialForNode);
+	writer.AddArray(kSceneSectionMeshForNode, meshForNode);
 
 	if (!scene.names_.empty() && !scene.nameForNode_.empty())
 	{
-		saveMap(f, scene.nameForNode_);
-		saveStringList(f, scene.names_);
+		writer.AddArray(kSceneSectionNameForNode, nameForNode);
+		writer.AddStringList(kSceneSectionNames, scene.names_);
 
-		saveStringList(f, scene.materialNames_);
+		writer.AddStringList(kSceneSectionMaterialNames, scene.materialNames_);
 	}
-	fclose(f);
+
+	writer.Save(fileName);
 }
 
-// Shift all hierarchy components in the nodes
-void shiftNodes(Scene& scene, int startOffset, int nodeCount, int shiftAmount)
+// Shift all hierarchy components in the node
+static Hierarchy shiftNode(const Hierarchy& node, int shiftAmount)
 {
-	auto shiftNode = [shiftAmount](Hierarchy& node)
-		{
-			if (node.parent_ > -1)
-				node.parent_ += shiftAmount;
-			if (node.firstChild_ > -1)
-				node.firstChild_ += shiftAmount;
-			if (node.nextSibling_ > -1)
-				node.nextSibling_ += shiftAmount;
-			if (node.lastSibling_ > -1)
-				node.lastSibling_ += shiftAmount;
-			// node->level_ does not have to be shifted
-		};
-
-	// If there are too many nodes, we can use std::execution::par with std::transform
-//	std::transform(scene.hierarchy_.begin() + startOffset, scene.hierarchy_.begin() + nodeCount, scene.hierarchy_.begin() + startOffset, shiftNode);
-
-//	for (auto i = scene.hierarchy_.begin() + startOffset ; i != scene.hierarchy_.begin() + nodeCount ; i++)
-//		shiftNode(*i);
-
-	for (int i = 0; i < nodeCount; i++)
-		shiftNode(scene.hierarchy_[i + startOffset]);
+	Hierarchy result = node;
+	if (node.parent_ > -1)
+		result.parent_ += shiftAmount;
+	if (node.firstChild_ > -1)
+		result.firstChild_ += shiftAmount;
+	if (node.nextSibling_ > -1)
+		result.nextSibling_ += shiftAmount;
+	if (node.lastSibling_ > -1)
+		result.lastSibling_ += shiftAmount;
+	// node->level_ does not have to be shifted
+	return result;
 }
 
-using ItemMap = std::unordered_map<uint32_t, uint32_t>;
-
-// Add the items from otherMap shifting indices and values along the way
-void mergeMaps(ItemMap& m, const ItemMap& otherMap, int indexOffset, int itemOffset)
+// Copy the items from otherMap to the preallocated slots of m shifting indices and values along the way
+static void mergeMapSlots(NodeComponentMap& m, size_t firstSlot, const NodeComponentMap& otherMap, int indexOffset, int itemOffset)
 {
 	for (const auto& i : otherMap)
-		m[i.first + indexOffset] = i.second + itemOffset;
+		m.setSlot(firstSlot++, i.first + indexOffset, i.second + itemOffset);
 }
 
 /**
@@ -208,9 +370,12 @@ void mergeMaps(ItemMap& m, const ItemMap& otherMap, int indexOffset, int itemOff
 	The simplest one is the direct "gluing" of multiple scenes into one [all the material lists and mesh lists are merged and indices in all scene nodes are shifted appropriately]
 	The second one is creating a "grid" of objects (or scenes) with the same material and mesh sets.
 	For the second use case we need two flags: 'mergeMeshes' and 'mergeMaterials' to avoid shifting mesh indices
+
+	The merge is done in two passes: the offsets of every input scene in all the output arrays are calculated first (prefix sums),
+	then each input scene is copied and shifted independently (in parallel if the executor is given).
 */
 void mergeScenes(Scene& scene, const std::vector<Scene*>& scenes, const std::vector<glm::mat4>& rootTransforms, const std::vector<uint32_t>& meshCounts,
-	bool mergeMeshes, bool mergeMaterials)
+	bool mergeMeshes, bool mergeMaterials, tf::Executor* executor)
 {
 	// Create new root node
 	scene.hierarchy_ = {
@@ -223,174 +388,270 @@ void mergeScenes(Scene& scene, const std::vector<Scene*>& scenes, const std::vec
 		}
 	};
 
+	scene.meshes_.clear();
+	scene.materialForNode_.clear();
+	scene.nameForNode_.clear();
+
 	scene.nameForNode_[0] = 0;
 	scene.names_ = { "NewRoot" };
 
-	scene.localTransform_.push_back(glm::mat4(1.0f));
-	scene.globalTransform_.push_back(glm::mat4(1.0f));
+	scene.localTransform_.assign(1, glm::mat4(1.0f));
+	scene.globalTransform_.assign(1, glm::mat4(1.0f));
 
 	if(scenes.empty())
 		return;
 
-	int offs = 1;
-	int meshOffs = 0;
-	int nameOffs = (int)scene.names_.size();
-	int materialOffs = 0;
-	auto meshCount = meshCounts.begin();
+	// 1) Offsets of each input scene in the merged arrays
+	struct MergeOffsets
+	{
+		int node;
+		int mesh;
+		int material;
+		int name;
+		size_t materialName;
+		size_t meshSlot;
+		size_t materialSlot;
+		size_t nameSlot;
+	};
 
-	if (!mergeMaterials)
-		scene.materialNames_ = scenes[0]->materialNames_;
+	std::vector<MergeOffsets> offsets(scenes.size());
 
-	// FIXME: too much logic (for all the components in a scene, though mesh data and materials go separately - there are dedicated data lists)
-	for (const Scene* s : scenes)
+	MergeOffsets total{ 1, 0, 0, (int)scene.names_.size(), 0, 0, 0, 0 };
+	for (size_t i = 0; i < scenes.size(); i++)
 	{
-		mergeVectors(scene.localTransform_, s->localTransform_);
-		mergeVectors(scene.globalTransform_, s->globalTransform_);
+		const Scene* s = scenes[i];
+		offsets[i] = total;
 
-		mergeVectors(scene.hierarchy_, s->hierarchy_);
-
-		mergeVectors(scene.names_, s->names_);
-		if (mergeMaterials)
-			mergeVectors(scene.materialNames_, s->materialNames_);
+		total.node += (int)s->hierarchy_.size();
+		if (mergeMeshes)
+			total.mesh += (int)meshCounts[i];
+		total.material += (int)s->materialNames_.size();
+		total.name += (int)s->names_.size();
+		total.materialName += s->materialNames_.size();
+		total.meshSlot += s->meshes_.size();
+		total.materialSlot += s->materialForNode_.size();
+		total.nameSlot += s->nameForNode_.size();
+	}
 
-		int nodeCount = (int)s->hierarchy_.size();
+	scene.localTransform_.resize(total.node);
+	scene.globalTransform_.resize(total.node);
+	scene.hierarchy_.resize(total.node);
+	scene.names_.resize(total.name);
 
-		shiftNodes(scene, offs, nodeCount, offs);
+	if (mergeMaterials)
+		scene.materialNames_.resize(total.materialName);
+	else
+		scene.materialNames_ = scenes[0]->materialNames_;
 
-		mergeMaps(scene.meshes_, s->meshes_, offs, mergeMeshes ? meshOffs : 0);
-		mergeMaps(scene.materialForNode_, s->materialForNode_, offs, mergeMaterials ? materialOffs : 0);
-		mergeMaps(scene.nameForNode_, s->nameForNode_, offs, nameOffs);
+	const size_t firstMeshSlot = scene.meshes_.appendSlots(total.meshSlot, total.node);
+	const size_t firstMaterialSlot = scene.materialForNode_.appendSlots(total.materialSlot, total.node);
+	const size_t firstNameSlot = scene.nameForNode_.appendSlots(total.nameSlot, total.node);
 
-		offs += nodeCount;
+	// 2) Copy and shift every input scene, the destination ranges do not overlap
+	auto copyScene = [&](int idx)
+	{
+		const Scene* s = scenes[idx];
+		const MergeOffsets& o = offsets[idx];
+		const int nodeCount = (int)s->hierarchy_.size();
 
-		materialOffs += (int)s->materialNames_.size();
-		nameOffs += (int)s->names_.size();
+		std::copy(s->localTransform_.begin(), s->localTransform_.end(), scene.localTransform_.begin() + o.node);
+		std::copy(s->globalTransform_.begin(), s->globalTransform_.end(), scene.globalTransform_.begin() + o.node);
 
-		if (mergeMeshes)
+		for (int i = 0; i < nodeCount; i++)
 		{
-			meshOffs += *meshCount;
-			meshCount++;
+			Hierarchy& h = scene.hierarchy_[o.node + i];
+			h = shiftNode(s->hierarchy_[i], o.node);
+			// all the nodes are now one level below the new root
+			h.level_++;
 		}
-	}
 
-	// fixing 'nextSibling' fields in the old roots (zero-index in all the scenes)
-	offs = 1;
-	int idx = 0;
-	for (const Scene* s : scenes)
-	{
-		int nodeCount = (int)s->hierarchy_.size();
-		bool isLast = (idx == scenes.size() - 1);
+		std::copy(s->names_.begin(), s->names_.end(), scene.names_.begin() + o.name);
+		if (mergeMaterials)
+			std::copy(s->materialNames_.begin(), s->materialNames_.end(), scene.materialNames_.begin() + o.materialName);
+
+		mergeMapSlots(scene.meshes_, firstMeshSlot + o.meshSlot, s->meshes_, o.node, mergeMeshes ? o.mesh : 0);
+		mergeMapSlots(scene.materialForNode_, firstMaterialSlot + o.materialSlot, s->materialForNode_, o.node, mergeMaterials ? o.material : 0);
+		mergeMapSlots(scene.nameForNode_, firstNameSlot + o.nameSlot, s->nameForNode_, o.node, o.name);
+
+		// fixing 'nextSibling' fields in the old roots (zero-index in all the scenes)
+		const bool isLast = (idx == (int)scenes.size() - 1);
 		// calculate new next sibling for the old scene roots
-		int next = isLast ? -1 : offs + nodeCount;
-		scene.hierarchy_[offs].nextSibling_ = next;
+		scene.hierarchy_[o.node].nextSibling_ = isLast ? -1 : o.node + nodeCount;
 		// attach to new root
-		scene.hierarchy_[offs].parent_ = 0;
+		scene.hierarchy_[o.node].parent_ = 0;
 
 		// transform old root nodes, if the transforms are given
 		if (!rootTransforms.empty())
-			scene.localTransform_[offs] = rootTransforms[idx] * scene.localTransform_[offs];
+			scene.localTransform_[o.node] = rootTransforms[idx] * scene.localTransform_[o.node];
+	};
 
-		offs += nodeCount;
-		idx++;
+	if (executor && scenes.size() > 1)
+	{
+		tf::Taskflow taskflow;
+		taskflow.for_each_index(0, (int)scenes.size(), 1, copyScene);
+		executor->run(taskflow).wait();
+	}
+	else
+	{
+		for (int i = 0; i < (int)scenes.size(); i++)
+			copyScene(i);
 	}
-
-	// now shift levels of all nodes below the root
-	for (auto i = scene.hierarchy_.begin() + 1; i != scene.hierarchy_.end(); i++)
-		i->level_++;
 }
 
-
-/** A rather long algorithm (and the auxiliary routines) to delete a number of scene nodes from the hierarchy */
+/** Deletion of a number of scene nodes from the hierarchy (and the auxiliary routines) */
 /* */
 
-// Add an index to a sorted index array
-static void addUniqueIdx(std::vector<uint32_t>& v, uint32_t index)
+// Mark the nodes and all their descendants, each node is visited at most once
+static void markNodesToDelete(const Scene& scene, const std::vector<uint32_t>& nodesToDelete, std::vector<bool>& deleted)
 {
-	if (!std::binary_search(v.begin(), v.end(), index))
-		v.push_back(index);
-}
+	std::vector<int> stack(nodesToDelete.begin(), nodesToDelete.end());
 
-// Recurse down from a node and collect all nodes which are already marked for deletion
-static void collectNodesToDelete(const Scene& scene, int node, std::vector<uint32_t>& nodes)
-{
-	for (int n = scene.hierarchy_[node].firstChild_; n != -1; n = scene.hierarchy_[n].nextSibling_) 
+	while (!stack.empty())
 	{
-		addUniqueIdx(nodes, n);
-		collectNodesToDelete(scene, n, nodes);
+		const int node = stack.back();
+		stack.pop_back();
+
+		if (deleted[node])
+			continue;
+		deleted[node] = true;
+
+		for (int n = scene.hierarchy_[node].firstChild_; n != -1; n = scene.hierarchy_[n].nextSibling_)
+			stack.push_back(n);
 	}
 }
 
-int findLastNonDeletedItem(const Scene& scene, const::std::vector<int>& newIndices, int node)
+/**
+	For every node: the new index of the first non-deleted node in the sibling chain starting at this node (or -1).
+	This is what the old recursive findLastNonDeletedItem() computed for a single link, here it is memoized for all nodes,
+	so each sibling link is followed once in total.
+*/
+static std::vector<int> findNonDeletedSiblings(const Scene& scene, const std::vector<bool>& deleted, const std::vector<int>& newIndices)
 {
-	// we have to be more subtle:
-	//   if the (newIndices[firstChild_] == -1), we should follow the link and extract the last non-removed item
-	//   ..
-	if (node == -1)
-		return -1;
-
-	return (newIndices[node] == -1) ?
-		findLastNonDeletedItem(scene, newIndices, scene.hierarchy_[node].nextSibling_) :
-		newIndices[node];
+	constexpr int kUnresolved = -2;
+
+	std::vector<int> result(scene.hierarchy_.size(), kUnresolved);
+	std::vector<int> path;
+
+	for (int i = 0; i < (int)scene.hierarchy_.size(); i++)
+	{
+		int node = i;
+		while (node != -1 && result[node] == kUnresolved && deleted[node])
+		{
+			path.push_back(node);
+			node = scene.hierarchy_[node].nextSibling_;
+		}
+
+		const int value = (node == -1) ? -1 : (result[node] != kUnresolved ? result[node] : newIndices[node]);
+		if (node != -1)
+			result[node] = value;
+
+		for (int p : path)
+			result[p] = value;
+		path.clear();
+	}
+
+	return result;
 }
 
-void shiftMapIndices(std::unordered_map<uint32_t, uint32_t>& items, const std::vector<int>& newIndices)
+void shiftMapIndices(NodeComponentMap& items, const std::vector<int>& newIndices)
 {
-	std::unordered_map<uint32_t, uint32_t> newItems;
+	NodeComponentMap newItems;
+	newItems.reserve(items.size(), newIndices.size());
 	for(const auto& m : items)
 	{
 		int newIndex = newIndices[m.first];
 		if (newIndex != -1)
 			newItems[newIndex] = m.second;
 	}
-	items = newItems;
+	items = std::move(newItems);
 }
 
-// Approximately an O ( N * Log(N) * Log(M)) algorithm (N = scene.size, M = nodesToDelete.size) to delete a collection of nodes from scene graph
-void deleteSceneNodes(Scene& scene, const std::vector<uint32_t>& nodesToDelete)
+// Remove the strings which are not referenced by any node and renumber the references. Returns the old-to-new index table (-1 for removed items)
+static std::vector<int> compactStringList(std::vector<std::string>& strings, NodeComponentMap& references)
 {
-	// 0) Add all the nodes down below in the hierarchy
-	auto indicesToDelete = nodesToDelete;
-	for (auto i : indicesToDelete)
-		collectNodesToDelete(scene, i, indicesToDelete);
+	std::vector<int> remap(strings.size(), -1);
+	for (const auto& r : references)
+		if (r.second < strings.size())
+			remap[r.second] = 0;
+
+	int newCount = 0;
+	for (size_t i = 0; i < strings.size(); i++)
+	{
+		if (remap[i] == -1)
+			continue;
+		remap[i] = newCount;
+		if ((int)i != newCount)
+			strings[newCount] = std::move(strings[i]);
+		newCount++;
+	}
+	strings.resize(newCount);
 
-	// aux array with node indices to keep track of the moved ones [moved = [](node) { return (node != nodes[node]); ]
-	std::vector<int> nodes(scene.hierarchy_.size());
-	std::iota(nodes.begin(), nodes.end(), 0);
+	for (auto& r : references)
+		if (r.second < remap.size())
+			r.second = remap[r.second];
+
+	return remap;
+}
+
+// O(N + M) deletion (N = scene.size, M = nodesToDelete.size): one marking pass, one linking pass and one compaction pass
+void deleteSceneNodes(Scene& scene, const std::vector<uint32_t>& nodesToDelete, std::vector<int>* materialRemap)
+{
+	const size_t oldSize = scene.hierarchy_.size();
 
-	// 1.a) Move all the indicesToDelete to the end of 'nodes' array (and cut them off, a variation of swap'n'pop for multiple elements)
-	auto oldSize = nodes.size();
-	eraseSelected(nodes, indicesToDelete);
+	// 0) Mark the nodes and everything below them in the hierarchy
+	std::vector<bool> deleted(oldSize, false);
+	markNodesToDelete(scene, nodesToDelete, deleted);
 
-	// 1.b) Make a newIndices[oldIndex] mapping table
+	// 1) Make a newIndices[oldIndex] mapping table (the order of the remaining nodes is preserved)
 	std::vector<int> newIndices(oldSize, -1);
-	for (int i = 0; i < nodes.size(); i++)
-		newIndices[nodes[i]] = i;
+	int newSize = 0;
+	for (size_t i = 0; i < oldSize; i++)
+		if (!deleted[i])
+			newIndices[i] = newSize++;
 
 	// 2) Replace all non-null parent/firstChild/nextSibling pointers in all the nodes by new positions
-	auto nodeMover = [&scene, &newIndices](Hierarchy& h)
-		{
-			return Hierarchy{
-				(h.parent_ != -1) ? newIndices[h.parent_] : -1,
-				findLastNonDeletedItem(scene, newIndices, h.firstChild_),
-				findLastNonDeletedItem(scene, newIndices, h.nextSibling_),
-				findLastNonDeletedItem(scene, newIndices, h.lastSibling_) };
-		};
-	std::transform(scene.hierarchy_.begin(), scene.hierarchy_.end(), scene.hierarchy_.begin(), nodeMover);
-
-	// 3) Finally throw away the hierarchy items
-	eraseSelected(scene.hierarchy_, indicesToDelete);
+	//    (parents of the remaining nodes are never deleted, sibling links skip over the deleted nodes)
+	const std::vector<int> nonDeleted = findNonDeletedSiblings(scene, deleted, newIndices);
+	auto nextNonDeleted = [&nonDeleted](int node) { return (node != -1) ? nonDeleted[node] : -1; };
 
-	// 4) As in mergeScenes() routine we also have to adjust all the "components" (i.e., meshes, materials, names and transformations)
+	// 3) Compact the hierarchy and the transformations in a single pass
+	for (size_t i = 0; i < oldSize; i++)
+	{
+		if (deleted[i])
+			continue;
+
+		const Hierarchy& h = scene.hierarchy_[i];
+		const Hierarchy moved = {
+			(h.parent_ != -1) ? newIndices[h.parent_] : -1,
+			nextNonDeleted(h.firstChild_),
+			nextNonDeleted(h.nextSibling_),
+			nextNonDeleted(h.lastSibling_),
+			h.level_ };
+
+		const int dst = newIndices[i];
+		scene.hierarchy_[dst] = moved;
+		scene.localTransform_[dst] = scene.localTransform_[i];
+		scene.globalTransform_[dst] = scene.globalTransform_[i];
+	}
 
-	// 4a) Transformations are stored in arrays, so we just erase the items as we did with the scene.hierarchy_
-	eraseSelected(scene.localTransform_, indicesToDelete);
-	eraseSelected(scene.globalTransform_, indicesToDelete);
+	scene.hierarchy_.resize(newSize);
+	scene.localTransform_.resize(newSize);
+	scene.globalTransform_.resize(newSize);
 
-	// 4b) All the maps should change the key values with the newIndices[] array
+	// 4) All the component maps should change the key values with the newIndices[] array
 	shiftMapIndices(scene.meshes_, newIndices);
 	shiftMapIndices(scene.materialForNode_, newIndices);
 	shiftMapIndices(scene.nameForNode_, newIndices);
 
-	// 5) scene node names list is not modified, but in principle it can be (remove all non-used items and adjust the nameForNode_ map)
-	// 6) Material names list is not modified also, but if some materials fell out of use
-}
\ No newline at end of file
+	// 5) Scene node names which are no longer used are removed
+	compactStringList(scene.names_, scene.nameForNode_);
+
+	// 6) Material names index the external material list, so they are compacted only if the caller can remap its materials too
+	if (materialRemap)
+		*materialRemap = compactStringList(scene.materialNames_, scene.materialForNode_);
+
+	// pending updates refer to the old node indices
+	for (int i = 0; i < MAX_NODE_LEVEL; i++)
+		scene.changedAtThisFrame_[i].clear();
+	scene.isNodeChanged_.assign(newSize, false);
+}
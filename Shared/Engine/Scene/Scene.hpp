@@ -7,11 +7,18 @@
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 
+#include <Scene/NodeComponentMap.hpp>
+
 using glm::mat4;
 
+namespace tf
+{
+	class Executor;
+}
+
 // we do not define std::vector<Node*> Children - this is already present in the aiNode from assimp
 
-constexpr const int MAX_NODE_LEVEL = 16;
+constexpr const int MAX_NODE_LEVEL = 32;
 
 struct Hierarchy
 {
@@ -39,18 +46,20 @@ struct Scene
 
 	// list of nodes whose global transform must be recalculated
 	std::vector<int> changedAtThisFrame_[MAX_NODE_LEVEL];
+	// per-node flag: the node is already in changedAtThisFrame_ (cleared by recalculateGlobalTransforms)
+	std::vector<bool> isNodeChanged_;
 
 	// Hierarchy component
 	std::vector<Hierarchy> hierarchy_;
 
 	// Mesh component: Which node corresponds to which node
-	std::unordered_map<uint32_t, uint32_t> meshes_;
+	NodeComponentMap meshes_;
 
 	// Material component: Which material belongs to which node
-	std::unordered_map<uint32_t, uint32_t> materialForNode_;
+	NodeComponentMap materialForNode_;
 
 	// Node name component: Which name is assigned to the node
-	std::unordered_map<uint32_t, uint32_t> nameForNode_;
+	NodeComponentMap nameForNode_;
 
 	// List of scene node names
 	std::vector<std::string> names_;
@@ -65,17 +74,28 @@ void markAsChanged(Scene& scene, int node);
 
 inline std::string getNodeName(const Scene& scene, int node)
 {
-	int strID = scene.nameForNode_.count(node) > 0 ? scene.nameForNode_.at(node) : -1;
-	return (strID > -1) ? scene.names_[strID] : std::string();
+	const auto strID = scene.nameForNode_.find(node);
+	return (strID != scene.nameForNode_.end()) ? scene.names_[strID->second] : std::string();
 }
 
 void recalculateGlobalTransforms(Scene& scene);
-
-void loadScene(const char* fileName, Scene& scene);
+/* Same as above, but large levels are split into batches and processed on the [executor] workers. The result is identical to the serial version */
+void recalculateGlobalTransforms(Scene& scene, tf::Executor& executor);
+
+/**
+	Accepts both chunk files and the legacy raw format. Returns false for a missing file or a corrupted section.
+	Node/material names are only read by the editors and debug views, skip them with [loadNames = false] where nothing shows them.
+*/
+bool loadScene(const char* fileName, Scene& scene, bool loadNames = true);
 void saveScene(const char* fileName, const Scene& scene);
 
+/* The input scenes are copied independently, pass an [executor] to do it on its worker threads */
 void mergeScenes(Scene& scene, const std::vector<Scene*>& scenes, const std::vector<glm::mat4>& rootTransforms, const std::vector<uint32_t>& meshCounts,
-	bool mergeMeshes = true, bool mergeMaterials = true);
-
-// Delete a collection of nodes from a scenegraph
-void deleteSceneNodes(Scene& scene, const std::vector<uint32_t>& nodesToDelete);
\ No newline at end of file
+	bool mergeMeshes = true, bool mergeMaterials = true, tf::Executor* executor = nullptr);
+
+/**
+	Delete a collection of nodes (and all their descendants) from a scenegraph. Unused node names are removed as well.
+	If [materialRemap] is given, unused material names are also removed and materialForNode_ is renumbered:
+	(*materialRemap)[oldMaterial] is the new material index or -1, so the caller can compact its material list the same way.
+*/
+void deleteSceneNodes(Scene& scene, const std::vector<uint32_t>& nodesToDelete, std::vector<int>* materialRemap = nullptr);
\ No newline at end of file
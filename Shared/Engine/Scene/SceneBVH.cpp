@@ -0,0 +1,492 @@
+#include <Scene/SceneBVH.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+	constexpr uint32_t kMaxLeafShapes = 4;
+	constexpr uint32_t kNumBins = 16;
+
+	/* Below this depth nodes are split at the median, which bounds the depth of the tree (and the traversal stacks) */
+	constexpr int kMaxSAHDepth = 24;
+	constexpr int kStackSize = 64;
+
+	BoundingBox emptyBox()
+	{
+		// the BoundingBox(min, max) constructor would swap the bounds
+		BoundingBox box;
+		box.min_ = vec3(std::numeric_limits<float>::max());
+		box.max_ = vec3(std::numeric_limits<float>::lowest());
+		return box;
+	}
+
+	void growBox(BoundingBox& box, const BoundingBox& other)
+	{
+		box.min_ = glm::min(box.min_, other.min_);
+		box.max_ = glm::max(box.max_, other.max_);
+	}
+
+	float surfaceArea(const BoundingBox& box)
+	{
+		const vec3 s = box.max_ - box.min_;
+		return (s.x < 0.0f) ? 0.0f : 2.0f * (s.x * s.y + s.y * s.z + s.z * s.x);
+	}
+
+	BoundingBox getShapeBox(const Scene& scene, const MeshData& meshData, const DrawData& shape)
+	{
+		return meshData.boxes_[shape.meshIndex].getTransformed(scene.globalTransform_[shape.transformIndex]);
+	}
+
+	struct BuildContext
+	{
+		SceneBVH& bvh;
+		std::vector<vec3> centroids;
+	};
+
+	// returns the number of shapes which go to the left child, the shapes of the node are reordered accordingly
+	uint32_t splitShapes(BuildContext& ctx, const BVHNode& node, int depth)
+	{
+		uint32_t* indices = ctx.bvh.shapeIndices_.data() + node.firstShape_;
+		const uint32_t count = node.shapeCount_;
+
+		BoundingBox centroidBox = emptyBox();
+		for (uint32_t i = 0; i != count; i++)
+			centroidBox.combinePoint(ctx.centroids[indices[i]]);
+
+		const vec3 extent = centroidBox.max_ - centroidBox.min_;
+		const int largestAxis = (extent.x > extent.y) ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+		int bestAxis = -1;
+		uint32_t bestBin = 0;
+
+		if (depth < kMaxSAHDepth)
+		{
+			float bestCost = std::numeric_limits<float>::max();
+
+			for (int axis = 0; axis != 3; axis++)
+			{
+				if (extent[axis] <= 0.0f)
+					continue;
+
+				const float scale = kNumBins / extent[axis];
+				const float axisMin = centroidBox.min_[axis];
+
+				uint32_t binCount[kNumBins] = {};
+				BoundingBox binBox[kNumBins];
+				for (auto& b : binBox)
+					b = emptyBox();
+
+				for (uint32_t i = 0; i != count; i++)
+				{
+					const uint32_t bin = std::min(kNumBins - 1, (uint32_t)((ctx.centroids[indices[i]][axis] - axisMin) * scale));
+					binCount[bin]++;
+					growBox(binBox[bin], ctx.bvh.shapeBoxes_[indices[i]]);
+				}
+
+				// right-to-left sweep, then evaluate every split plane on the way back
+				float rightArea[kNumBins];
+				uint32_t rightCount[kNumBins];
+				BoundingBox acc = emptyBox();
+				uint32_t accCount = 0;
+				for (uint32_t b = kNumBins - 1; b > 0; b--)
+				{
+					growBox(acc, binBox[b]);
+					accCount += binCount[b];
+					rightArea[b] = surfaceArea(acc);
+					rightCount[b] = accCount;
+				}
+
+				acc = emptyBox();
+				accCount = 0;
+				for (uint32_t b = 0; b != kNumBins - 1; b++)
+				{
+					growBox(acc, binBox[b]);
+					accCount += binCount[b];
+
+					if (accCount == 0 || rightCount[b + 1] == 0)
+						continue;
+
+					const float cost = surfaceArea(acc) * accCount + rightArea[b + 1] * rightCount[b + 1];
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestBin = b;
+					}
+				}
+			}
+		}
+
+		if (bestAxis >= 0)
+		{
+			const float scale = kNumBins / extent[bestAxis];
+			const float axisMin = centroidBox.min_[bestAxis];
+
+			uint32_t* mid = std::partition(indices, indices + count, [&](uint32_t s)
+			{
+				return std::min(kNumBins - 1, (uint32_t)((ctx.centroids[s][bestAxis] - axisMin) * scale)) <= bestBin;
+			});
+
+			const uint32_t numLeft = (uint32_t)(mid - indices);
+			if (numLeft != 0 && numLeft != count)
+				return numLeft;
+		}
+
+		// deep nodes or coincident centroids: median split
+		const uint32_t numLeft = count / 2;
+		std::nth_element(indices, indices + numLeft, indices + count, [&](uint32_t a, uint32_t b)
+		{
+			return ctx.centroids[a][largestAxis] < ctx.centroids[b][largestAxis];
+		});
+
+		return numLeft;
+	}
+
+	void buildNode(BuildContext& ctx, uint32_t nodeIndex, int depth)
+	{
+		SceneBVH& bvh = ctx.bvh;
+
+		BVHNode& node = bvh.nodes_[nodeIndex];
+		node.box_ = emptyBox();
+		for (uint32_t i = 0; i != node.shapeCount_; i++)
+			growBox(node.box_, bvh.shapeBoxes_[bvh.shapeIndices_[node.firstShape_ + i]]);
+
+		if (node.shapeCount_ <= kMaxLeafShapes)
+		{
+			for (uint32_t i = 0; i != node.shapeCount_; i++)
+				bvh.leafForShape_[bvh.shapeIndices_[node.firstShape_ + i]] = nodeIndex;
+			return;
+		}
+
+		const uint32_t numLeft = splitShapes(ctx, node, depth);
+
+		const uint32_t left = (uint32_t)bvh.nodes_.size();
+		const BVHNode leftNode = { BoundingBox(), 0, node.firstShape_, numLeft };
+		const BVHNode rightNode = { BoundingBox(), 0, node.firstShape_ + numLeft, node.shapeCount_ - numLeft };
+
+		// [node] is invalidated here
+		bvh.nodes_[nodeIndex].firstChild_ = left;
+		bvh.nodes_.push_back(leftNode);
+		bvh.nodes_.push_back(rightNode);
+		bvh.parent_.push_back(nodeIndex);
+		bvh.parent_.push_back(nodeIndex);
+
+		buildNode(ctx, left, depth + 1);
+		buildNode(ctx, left + 1, depth + 1);
+	}
+
+	void refitNode(SceneBVH& bvh, uint32_t nodeIndex)
+	{
+		BVHNode& node = bvh.nodes_[nodeIndex];
+		if (node.isLeaf())
+		{
+			node.box_ = emptyBox();
+			for (uint32_t i = 0; i != node.shapeCount_; i++)
+				growBox(node.box_, bvh.shapeBoxes_[bvh.shapeIndices_[node.firstShape_ + i]]);
+		}
+		else
+		{
+			node.box_ = bvh.nodes_[node.firstChild_].box_;
+			growBox(node.box_, bvh.nodes_[node.firstChild_ + 1].box_);
+		}
+	}
+
+	enum class FrustumTest
+	{
+		Outside,
+		Intersects,
+		Inside,
+	};
+
+	struct FrustumParams
+	{
+		glm::vec4 planes[6];
+		glm::vec4 absPlanes[6];
+
+		bool useFrustumBox = false;
+		vec3 frustumMin;
+		vec3 frustumMax;
+	};
+
+	FrustumTest testBox(const FrustumParams& p, const BoundingBox& box)
+	{
+		FrustumTest result = FrustumTest::Inside;
+
+		if (p.useFrustumBox)
+		{
+			if (glm::any(glm::greaterThan(box.min_, p.frustumMax)) || glm::any(glm::lessThan(box.max_, p.frustumMin)))
+				return FrustumTest::Outside;
+			// keep the results exact even for plane sets which do not match the corners
+			if (glm::any(glm::lessThan(box.min_, p.frustumMin)) || glm::any(glm::greaterThan(box.max_, p.frustumMax)))
+				result = FrustumTest::Intersects;
+		}
+
+		const vec3 center = 0.5f * (box.max_ + box.min_);
+		const vec3 extent = 0.5f * (box.max_ - box.min_);
+
+		for (int i = 0; i != 6; i++)
+		{
+			const float d = glm::dot(vec3(p.planes[i]), center) + p.planes[i].w;
+			const float r = glm::dot(vec3(p.absPlanes[i]), extent);
+			if (d + r < 0.0f)
+				return FrustumTest::Outside;
+			if (d - r < 0.0f)
+				result = FrustumTest::Intersects;
+		}
+
+		return result;
+	}
+
+	bool intersectRayBox(const BoundingBox& box, const vec3& origin, const vec3& invDir, float maxT, float& outT)
+	{
+		const vec3 t1 = (box.min_ - origin) * invDir;
+		const vec3 t2 = (box.max_ - origin) * invDir;
+		const vec3 tNear = glm::min(t1, t2);
+		const vec3 tFar = glm::max(t1, t2);
+
+		const float tEnter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		const float tExit = std::min(std::min(tFar.x, tFar.y), tFar.z);
+
+		outT = tEnter;
+		return tEnter <= tExit && tEnter < maxT;
+	}
+}
+
+void buildSceneBVH(SceneBVH& bvh, const Scene& scene, const MeshData& meshData, const std::vector<DrawData>& shapes)
+{
+	const uint32_t numShapes = (uint32_t)shapes.size();
+
+	bvh.nodes_.clear();
+	bvh.parent_.clear();
+	bvh.changedShapes_.clear();
+	bvh.isShapeChanged_.assign(numShapes, false);
+	bvh.leafForShape_.assign(numShapes, 0);
+	bvh.shapeBoxes_.resize(numShapes);
+	bvh.shapeIndices_.resize(numShapes);
+
+	BuildContext ctx{ bvh, std::vector<vec3>(numShapes) };
+
+	for (uint32_t i = 0; i != numShapes; i++)
+	{
+		bvh.shapeBoxes_[i] = getShapeBox(scene, meshData, shapes[i]);
+		bvh.shapeIndices_[i] = i;
+		ctx.centroids[i] = bvh.shapeBoxes_[i].getCenter();
+	}
+
+	// scene node -> shapes, so that transform changes can be turned into shape refits
+	const size_t numNodes = scene.hierarchy_.size();
+	bvh.nodeShapeOffsets_.assign(numNodes + 1, 0);
+	for (const DrawData& s : shapes)
+		bvh.nodeShapeOffsets_[s.transformIndex + 1]++;
+	for (size_t i = 0; i != numNodes; i++)
+		bvh.nodeShapeOffsets_[i + 1] += bvh.nodeShapeOffsets_[i];
+
+	bvh.nodeShapes_.resize(numShapes);
+	std::vector<uint32_t> fill(bvh.nodeShapeOffsets_.begin(), bvh.nodeShapeOffsets_.end() - 1);
+	for (uint32_t i = 0; i != numShapes; i++)
+		bvh.nodeShapes_[fill[shapes[i].transformIndex]++] = i;
+
+	if (numShapes == 0)
+		return;
+
+	bvh.nodes_.reserve(2 * (numShapes / kMaxLeafShapes + 1));
+	bvh.parent_.reserve(bvh.nodes_.capacity());
+
+	bvh.nodes_.push_back({ BoundingBox(), 0, 0, numShapes });
+	bvh.parent_.push_back(0);
+
+	buildNode(ctx, 0, 0);
+}
+
+void collectChangedShapes(SceneBVH& bvh, const Scene& scene)
+{
+	const size_t numNodes = bvh.nodeShapeOffsets_.empty() ? 0 : bvh.nodeShapeOffsets_.size() - 1;
+
+	for (int level = 0; level < MAX_NODE_LEVEL; level++)
+	{
+		for (const int n : scene.changedAtThisFrame_[level])
+		{
+			if ((size_t)n >= numNodes)
+				continue;
+
+			for (uint32_t i = bvh.nodeShapeOffsets_[n]; i != bvh.nodeShapeOffsets_[n + 1]; i++)
+			{
+				const uint32_t s = bvh.nodeShapes_[i];
+				if (!bvh.isShapeChanged_[s])
+				{
+					bvh.isShapeChanged_[s] = true;
+					bvh.changedShapes_.push_back(s);
+				}
+			}
+		}
+	}
+}
+
+void refitSceneBVH(SceneBVH& bvh, const Scene& scene, const MeshData& meshData, const std::vector<DrawData>& shapes)
+{
+	if (bvh.changedShapes_.empty())
+		return;
+
+	std::vector<uint32_t> dirtyNodes;
+
+	for (const uint32_t s : bvh.changedShapes_)
+	{
+		bvh.shapeBoxes_[s] = getShapeBox(scene, meshData, shapes[s]);
+		bvh.isShapeChanged_[s] = false;
+
+		for (uint32_t n = bvh.leafForShape_[s]; ; n = bvh.parent_[n])
+		{
+			dirtyNodes.push_back(n);
+			if (n == 0)
+				break;
+		}
+	}
+	bvh.changedShapes_.clear();
+
+	// children are always stored after their parents, so refitting in decreasing order is bottom-up
+	std::sort(dirtyNodes.begin(), dirtyNodes.end(), std::greater<uint32_t>());
+	dirtyNodes.erase(std::unique(dirtyNodes.begin(), dirtyNodes.end()), dirtyNodes.end());
+
+	for (const uint32_t n : dirtyNodes)
+		refitNode(bvh, n);
+}
+
+uint32_t cullSceneBVH(const SceneBVH& bvh, const glm::vec4* frustumPlanes, const glm::vec4* frustumCorners, std::vector<uint32_t>& visibilityMask)
+{
+	visibilityMask.assign((bvh.shapeBoxes_.size() + 31) / 32, 0u);
+
+	if (bvh.nodes_.empty())
+		return 0;
+
+	FrustumParams p;
+	for (int i = 0; i != 6; i++)
+	{
+		p.planes[i] = frustumPlanes[i];
+		p.absPlanes[i] = glm::abs(frustumPlanes[i]);
+	}
+
+	if (frustumCorners)
+	{
+		p.useFrustumBox = true;
+		p.frustumMin = p.frustumMax = vec3(frustumCorners[0]);
+		for (int i = 1; i != 8; i++)
+		{
+			p.frustumMin = glm::min(p.frustumMin, vec3(frustumCorners[i]));
+			p.frustumMax = glm::max(p.frustumMax, vec3(frustumCorners[i]));
+		}
+	}
+
+	auto markVisible = [&visibilityMask](uint32_t s)
+	{
+		visibilityMask[s >> 5] |= 1u << (s & 31);
+	};
+
+	uint32_t numVisible = 0;
+
+	uint32_t stack[kStackSize];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const BVHNode& node = bvh.nodes_[stack[--stackSize]];
+
+		const FrustumTest test = testBox(p, node.box_);
+		if (test == FrustumTest::Outside)
+			continue;
+
+		// the whole subtree is visible, no more tests needed
+		if (test == FrustumTest::Inside)
+		{
+			for (uint32_t i = 0; i != node.shapeCount_; i++)
+				markVisible(bvh.shapeIndices_[node.firstShape_ + i]);
+			numVisible += node.shapeCount_;
+			continue;
+		}
+
+		if (node.isLeaf())
+		{
+			for (uint32_t i = 0; i != node.shapeCount_; i++)
+			{
+				const uint32_t s = bvh.shapeIndices_[node.firstShape_ + i];
+				if (testBox(p, bvh.shapeBoxes_[s]) != FrustumTest::Outside)
+				{
+					markVisible(s);
+					numVisible++;
+				}
+			}
+			continue;
+		}
+
+		stack[stackSize++] = node.firstChild_;
+		stack[stackSize++] = node.firstChild_ + 1;
+	}
+
+	return numVisible;
+}
+
+bool raycastSceneBVH(const SceneBVH& bvh, const glm::vec3& origin, const glm::vec3& dir, uint32_t& outShape, float& outT)
+{
+	if (bvh.nodes_.empty())
+		return false;
+
+	const vec3 invDir = 1.0f / dir;
+
+	float bestT = std::numeric_limits<float>::max();
+	bool hit = false;
+
+	float t = 0.0f;
+	if (!intersectRayBox(bvh.nodes_[0].box_, origin, invDir, bestT, t))
+		return false;
+
+	uint32_t stack[kStackSize];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const BVHNode& node = bvh.nodes_[stack[--stackSize]];
+
+		// the node may be farther than the best hit found after it was pushed
+		if (!intersectRayBox(node.box_, origin, invDir, bestT, t))
+			continue;
+
+		if (node.isLeaf())
+		{
+			for (uint32_t i = 0; i != node.shapeCount_; i++)
+			{
+				const uint32_t s = bvh.shapeIndices_[node.firstShape_ + i];
+				if (intersectRayBox(bvh.shapeBoxes_[s], origin, invDir, bestT, t))
+				{
+					bestT = t;
+					outShape = s;
+					hit = true;
+				}
+			}
+			continue;
+		}
+
+		// visit the nearer child first
+		float tLeft = 0.0f;
+		float tRight = 0.0f;
+		const bool hitLeft = intersectRayBox(bvh.nodes_[node.firstChild_].box_, origin, invDir, bestT, tLeft);
+		const bool hitRight = intersectRayBox(bvh.nodes_[node.firstChild_ + 1].box_, origin, invDir, bestT, tRight);
+
+		if (hitLeft && hitRight)
+		{
+			const bool leftFirst = tLeft <= tRight;
+			stack[stackSize++] = leftFirst ? node.firstChild_ + 1 : node.firstChild_;
+			stack[stackSize++] = leftFirst ? node.firstChild_ : node.firstChild_ + 1;
+		}
+		else if (hitLeft)
+			stack[stackSize++] = node.firstChild_;
+		else if (hitRight)
+			stack[stackSize++] = node.firstChild_ + 1;
+	}
+
+	if (hit)
+		outT = bestT;
+
+	return hit;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <Scene/Scene.hpp>
+#include <Scene/VtxData.hpp>
+#include <Utils/UtilsMath.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/**
+	Node of the bounding volume hierarchy.
+	Every node covers the contiguous range [firstShape_, firstShape_ + shapeCount_) of SceneBVH::shapeIndices_.
+	The children of an inner node are always stored next to each other: [firstChild_] and [firstChild_ + 1].
+*/
+struct BVHNode
+{
+	BoundingBox box_;
+	// index of the left child (0 for leaves, the root is never a child)
+	uint32_t firstChild_;
+	uint32_t firstShape_;
+	uint32_t shapeCount_;
+
+	bool isLeaf() const { return firstChild_ == 0; }
+};
+
+/**
+	Binned SAH hierarchy over the world-space boxes of the DrawData shapes of a scene.
+	Used for hierarchical frustum culling (whole subtrees are accepted or rejected at once) and for picking.
+*/
+struct SceneBVH
+{
+	std::vector<BVHNode> nodes_;
+	// shape indices ordered so that each node references a contiguous range
+	std::vector<uint32_t> shapeIndices_;
+	// world-space box of every shape
+	std::vector<BoundingBox> shapeBoxes_;
+
+	// refit support: parent of every node, leaf of every shape and the shapes of every scene node (CSR layout)
+	std::vector<uint32_t> parent_;
+	std::vector<uint32_t> leafForShape_;
+	std::vector<uint32_t> nodeShapeOffsets_;
+	std::vector<uint32_t> nodeShapes_;
+
+	// shapes whose transforms changed since the last refit (see collectChangedShapes())
+	std::vector<uint32_t> changedShapes_;
+	std::vector<bool> isShapeChanged_;
+};
+
+void buildSceneBVH(SceneBVH& bvh, const Scene& scene, const MeshData& meshData, const std::vector<DrawData>& shapes);
+
+/**
+	Gather the shapes attached to the nodes in scene.changedAtThisFrame_.
+	Must be called before recalculateGlobalTransforms(), which clears the lists.
+*/
+void collectChangedShapes(SceneBVH& bvh, const Scene& scene);
+
+/**
+	Recalculate the world-space boxes of the collected shapes (after recalculateGlobalTransforms()) and refit their ancestors.
+	The topology is kept, so rebuild the hierarchy if most of the scene moves far away from its original layout.
+*/
+void refitSceneBVH(SceneBVH& bvh, const Scene& scene, const MeshData& meshData, const std::vector<DrawData>& shapes);
+
+/**
+	Frustum query with the same results as calling isBoxInFrustum() for every shape.
+	Writes a bitmask with 1 bit per shape (see isVisible() in UtilsCulling.hpp) and returns the number of visible shapes.
+*/
+uint32_t cullSceneBVH(const SceneBVH& bvh, const glm::vec4* frustumPlanes, const glm::vec4* frustumCorners, std::vector<uint32_t>& visibilityMask);
+
+/**
+	Find the shape with the nearest box hit by the ray, [outT] is the distance along [dir] to the box entry point.
+	Returns false if nothing is hit.
+*/
+bool raycastSceneBVH(const SceneBVH& bvh, const glm::vec3& origin, const glm::vec3& dir, uint32_t& outShape, float& outT);
@@ -2,10 +2,68 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <future>
 #include <stdio.h>
+#include <string.h>
+
+#include <EasyProfilerWrapper.hpp>
+#include <Utils/UtilsSIMD.hpp>
+
+#include <taskflow/taskflow.hpp>
+#include <taskflow/algorithm/for_each.hpp>
+
+constexpr const uint32_t kMeshFileType = MakeChunkId('M', 'E', 'S', 'H');
+
+constexpr const uint32_t kMeshSectionDescriptors = MakeChunkId('M', 'D', 'S', 'C');
+constexpr const uint32_t kMeshSectionBoxes = MakeChunkId('B', 'B', 'O', 'X');
+constexpr const uint32_t kMeshSectionIndices = MakeChunkId('I', 'D', 'X', 'S');
+constexpr const uint32_t kMeshSectionVertices = MakeChunkId('V', 'T', 'X', 'S');
+
+static MeshFileHeader makeMeshFileHeader(uint32_t meshCount, uint32_t indexDataSize, uint32_t vertexDataSize)
+{
+    MeshFileHeader header{};
+    header.magicValue = kMeshFileMagic;
+    header.meshCount = meshCount;
+    header.dataBlockStartOffset = (uint32_t) (sizeof(MeshFileHeader) + meshCount * sizeof(Mesh));
+    header.indexDataSize = indexDataSize;
+    header.vertexDataSize = vertexDataSize;
+    return header;
+}
+
+static MeshFileHeader loadMeshDataChunked(const char *meshFile, MeshData &out)
+{
+    ChunkFileReader reader;
+    if (!reader.Open(meshFile, kMeshFileType))
+        exit(EXIT_FAILURE);
+
+    if (!reader.ReadArray(kMeshSectionDescriptors, out.meshes_) || !reader.ReadArray(kMeshSectionBoxes, out.boxes_))
+    {
+        printf("Could not read mesh descriptors\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // sections are independent, so the two big ones are checked and copied concurrently
+    auto indices = std::async(std::launch::async, [&reader, &out]() { return reader.ReadArray(kMeshSectionIndices, out.indexData_); });
+    const bool vertexResult = reader.ReadArray(kMeshSectionVertices, out.vertexData_);
+
+    if (!indices.get() || !vertexResult)
+    {
+        printf("Unable to read index/vertex data\n");
+        exit(255);
+    }
+
+    return makeMeshFileHeader((uint32_t) out.meshes_.size(),
+        (uint32_t) (out.indexData_.size() * sizeof(uint32_t)), (uint32_t) (out.vertexData_.size() * sizeof(float)));
+}
 
 MeshFileHeader loadMeshData(const char *meshFile, MeshData &out)
 {
+    EASY_FUNCTION();
+
+    if (ChunkFileReader::IsChunkFile(meshFile))
+        return loadMeshDataChunked(meshFile, out);
+
+    // legacy raw format (use upgradeMeshFile() to convert)
     MeshFileHeader header;
 
     FILE *f = fopen(meshFile, "rb");
@@ -52,24 +110,118 @@ MeshFileHeader loadMeshData(const char *meshFile, MeshData &out)
     return header;
 }
 
+bool MappedMeshData::open(const char *meshFile)
+{
+    EASY_FUNCTION();
+
+    close();
+
+    if (ChunkFileReader::IsChunkFile(meshFile))
+        return openChunked(meshFile);
+
+    if (!file_.Open(meshFile))
+    {
+        printf("Cannot open %s. Did you forget to run \"Ch5_Tool05_MeshConvert\"?\n", meshFile);
+        return false;
+    }
+
+    const uint8_t *data = file_.GetData();
+    const size_t fileSize = file_.GetSize();
+
+    if (fileSize < sizeof(MeshFileHeader))
+    {
+        printf("Unable to read mesh file header\n");
+        close();
+        return false;
+    }
+
+    memcpy(&header_, data, sizeof(MeshFileHeader));
+
+    if (header_.magicValue != kMeshFileMagic)
+    {
+        printf("Invalid mesh file magic value in %s\n", meshFile);
+        close();
+        return false;
+    }
+
+    /* Note: header.dataBlockStartOffset does not account for the bounding boxes, so we compute the offsets ourselves */
+    const size_t meshesOffset = sizeof(MeshFileHeader);
+    const size_t boxesOffset = meshesOffset + size_t(header_.meshCount) * sizeof(Mesh);
+    const size_t indexOffset = boxesOffset + size_t(header_.meshCount) * sizeof(BoundingBox);
+    const size_t vertexOffset = indexOffset + header_.indexDataSize;
+    const size_t totalSize = vertexOffset + header_.vertexDataSize;
+
+    if ((header_.indexDataSize % sizeof(uint32_t)) != 0 || (header_.vertexDataSize % sizeof(float)) != 0 || totalSize > fileSize)
+    {
+        printf("Mesh file %s is truncated or corrupted (expected %zu bytes, got %zu)\n", meshFile, totalSize, fileSize);
+        close();
+        return false;
+    }
+
+    meshes_ = reinterpret_cast<const Mesh *>(data + meshesOffset);
+    boxes_ = reinterpret_cast<const BoundingBox *>(data + boxesOffset);
+    indexData_ = reinterpret_cast<const uint32_t *>(data + indexOffset);
+    vertexData_ = reinterpret_cast<const float *>(data + vertexOffset);
+
+    return true;
+}
+
+bool MappedMeshData::openChunked(const char *meshFile)
+{
+    if (!chunks_.Open(meshFile, kMeshFileType))
+        return false;
+
+    size_t meshesSize = 0, boxesSize = 0, indexSize = 0, vertexSize = 0;
+
+    meshes_ = reinterpret_cast<const Mesh *>(chunks_.GetSectionData(kMeshSectionDescriptors, meshesSize));
+    boxes_ = reinterpret_cast<const BoundingBox *>(chunks_.GetSectionData(kMeshSectionBoxes, boxesSize));
+    indexData_ = reinterpret_cast<const uint32_t *>(chunks_.GetSectionData(kMeshSectionIndices, indexSize));
+    vertexData_ = reinterpret_cast<const float *>(chunks_.GetSectionData(kMeshSectionVertices, vertexSize));
+
+    const size_t meshCount = meshesSize / sizeof(Mesh);
+
+    if (!meshes_ || !boxes_ || !indexData_ || !vertexData_ ||
+        (meshesSize % sizeof(Mesh)) != 0 || boxesSize != meshCount * sizeof(BoundingBox) ||
+        (indexSize % sizeof(uint32_t)) != 0 || (vertexSize % sizeof(float)) != 0)
+    {
+        printf("Mesh file %s is corrupted\n", meshFile);
+        close();
+        return false;
+    }
+
+    header_ = makeMeshFileHeader((uint32_t) meshCount, (uint32_t) indexSize, (uint32_t) vertexSize);
+
+    return true;
+}
+
+void MappedMeshData::close()
+{
+    file_.Close();
+    chunks_.Close();
+
+    header_ = MeshFileHeader{};
+    meshes_ = nullptr;
+    boxes_ = nullptr;
+    indexData_ = nullptr;
+    vertexData_ = nullptr;
+}
+
+void MappedMeshData::copyDescriptors(MeshData &out) const
+{
+    out.meshes_.assign(meshes_, meshes_ + header_.meshCount);
+    out.boxes_.assign(boxes_, boxes_ + header_.meshCount);
+}
+
 void saveMeshData(const char *fileName, const MeshData &m)
 {
-    FILE *f = fopen(fileName, "wb");
+    ChunkFileWriter writer(kMeshFileType);
 
-    MeshFileHeader header{};
-    header.magicValue = 0x12345678;
-    header.meshCount = (uint32_t) m.meshes_.size();
-    header.dataBlockStartOffset = (uint32_t) (sizeof(MeshFileHeader) + m.meshes_.size() * sizeof(Mesh));
-    header.indexDataSize = (uint32_t) (m.indexData_.size() * sizeof(uint32_t));
-    header.vertexDataSize = (uint32_t) (m.vertexData_.size() * sizeof(float));
-
-    fwrite(&header, 1, sizeof(header), f);
-    fwrite(m.meshes_.data(), sizeof(Mesh), header.meshCount, f);
-    fwrite(m.boxes_.data(), sizeof(BoundingBox), header.meshCount, f);
-    fwrite(m.indexData_.data(), 1, header.indexDataSize, f);
-    fwrite(m.vertexData_.data(), 1, header.vertexDataSize, f);
+    writer.AddArray(kMeshSectionDescriptors, m.meshes_);
+    writer.AddArray(kMeshSectionBoxes, m.boxes_);
+    writer.AddArray(kMeshSectionIndices, m.indexData_);
+    writer.AddArray(kMeshSectionVertices, m.vertexData_);
 
-    fclose(f);
+    writer.Save(fileName);
 }
 
 void saveBoundingBoxes(const char* fileName, const std::vector<BoundingBox>& boxes)
@@ -109,66 +261,121 @@ void loadBoundingBoxes(const char* fileName, std::vector<BoundingBox>& boxes)
     fclose(f);
 }
 
-MeshFileHeader mergeMeshData(MeshData &m, const std::vector<MeshData *> md)
+// the stride comes from the first stream (if it is filled in)
+static uint32_t getVertexStride(const Mesh &mesh)
 {
-    uint32_t totalVertexDataSize = 0;
-    uint32_t totalIndexDataSize = 0;
+    return mesh.streamElementSize[0] ? mesh.streamElementSize[0] / (uint32_t) sizeof(float) : kDefaultVertexStride;
+}
 
-    uint32_t offs = 0;
-    for (const MeshData* i : md)
+MeshFileHeader mergeMeshData(MeshData &m, const std::vector<MeshData *> md, tf::Executor *executor)
+{
+    // 1) Offsets of each input mesh container in the merged arrays (prefix sums)
+    struct MergeOffsets
     {
-        mergeVectors(m.indexData_, i->indexData_);
-        mergeVectors(m.vertexData_, i->vertexData_);
-        mergeVectors(m.meshes_, i->meshes_);
-        mergeVectors(m.boxes_, i->boxes_);
+        size_t mesh;
+        size_t index;
+        size_t vertex;
+    };
 
-        uint32_t vtxOffset = totalVertexDataSize / 8; /* 8 is the number of per-vertex attributes: position, normal + UV */
+    std::vector<MergeOffsets> offsets(md.size());
 
-        for (size_t j = 0; j < (uint32_t)i->meshes_.size(); j++)
-        {
-            // m.vertexCount, m.lodCount and m.streamCount do not change
-            // m.vertexOffset also does not change, because vertex offsets are local (i.e., baked into the indices)
-            m.meshes_[offs + j].indexOffset += totalIndexDataSize;
-        }
+    MergeOffsets total{ 0, 0, 0 };
+    for (size_t i = 0; i < md.size(); i++)
+    {
+        offsets[i] = total;
+        total.mesh += md[i]->meshes_.size();
+        total.index += md[i]->indexData_.size();
+        total.vertex += md[i]->vertexData_.size();
+    }
 
-        // shift individual indices
-        for (size_t j = 0; j < i->indexData_.size(); j++)
-            m.indexData_[totalIndexDataSize + j] += vtxOffset;
+    m.meshes_.resize(total.mesh);
+    m.boxes_.resize(total.mesh);
+    m.indexData_.resize(total.index);
+    m.vertexData_.resize(total.vertex);
 
-        offs += (uint32_t) i->meshes_.size();
+    // 2) Copy and shift every input independently, the destination ranges do not overlap
+    auto copyMeshData = [&m, &md, &offsets](int idx)
+    {
+        const MeshData *i = md[idx];
+        const MergeOffsets &o = offsets[idx];
+
+        std::copy(i->vertexData_.begin(), i->vertexData_.end(), m.vertexData_.begin() + o.vertex);
+        std::copy(i->boxes_.begin(), i->boxes_.end(), m.boxes_.begin() + o.mesh);
 
-        totalIndexDataSize += (uint32_t) i->indexData_.size();
-        totalVertexDataSize += (uint32_t) i->vertexData_.size();
+        std::copy(i->indexData_.begin(), i->indexData_.end(), m.indexData_.begin() + o.index);
+
+        // m.vertexCount, m.lodCount and m.streamCount do not change
+        // the indices stay local to their mesh, the vertex range moves with the vertices of its container
+        for (size_t j = 0; j < i->meshes_.size(); j++)
+        {
+            Mesh &mesh = m.meshes_[o.mesh + j];
+            mesh = i->meshes_[j];
+            mesh.indexOffset += (uint32_t) o.index;
+            mesh.vertexOffset += (uint32_t) (o.vertex / getVertexStride(mesh));
+        }
+    };
+
+    if (executor && md.size() > 1)
+    {
+        tf::Taskflow taskflow;
+        taskflow.for_each_index(0, (int) md.size(), 1, copyMeshData);
+        executor->run(taskflow).wait();
+    }
+    else
+    {
+        for (int i = 0; i < (int) md.size(); i++)
+            copyMeshData(i);
     }
 
-    MeshFileHeader header;
-    header.magicValue = 0x12345678;
-    header.meshCount = (uint32_t) offs;
-    header.dataBlockStartOffset = (uint32_t) (sizeof(MeshFileHeader) + offs * sizeof(Mesh));
-    header.indexDataSize = static_cast<uint32_t>(totalIndexDataSize * sizeof(uint32_t));
-    header.vertexDataSize = static_cast<uint32_t>(totalVertexDataSize * sizeof(float));
-    return header;
+    return makeMeshFileHeader((uint32_t) total.mesh,
+        static_cast<uint32_t>(total.index * sizeof(uint32_t)), static_cast<uint32_t>(total.vertex * sizeof(float)));
 }
 
-void recalculateBoundingBoxes(MeshData &m)
+static BoundingBox calculateMeshBoundingBox(const MeshData &m, const Mesh &mesh)
 {
-    m.boxes_.clear();
+    glm::vec3 vmin(std::numeric_limits<float>::max());
+    glm::vec3 vmax(std::numeric_limits<float>::lowest());
+
+    // positions are the first 3 floats of every vertex
+    const size_t stride = getVertexStride(mesh);
 
-    for (const auto& mesh : m.meshes_)
+    if (mesh.vertexCount > 0 && (size_t(mesh.vertexOffset) + mesh.vertexCount) * stride <= m.vertexData_.size())
     {
+        // every vertex of the mesh is visited once, in memory order
+        minMaxStridedPoints(&m.vertexData_[size_t(mesh.vertexOffset) * stride], mesh.vertexCount, stride, vmin, vmax);
+    }
+    else
+    {
+        // no vertex range filled in: only the vertices referenced by LOD 0
         const auto numIndices = mesh.getLODIndicesCount(0);
 
-        glm::vec3 vmin(std::numeric_limits<float>::max());
-        glm::vec3 vmax(std::numeric_limits<float>::lowest());
-
-        for (auto i = 0; i != numIndices; i++)
+        for (uint32_t i = 0; i != numIndices; i++)
         {
-            auto vtxOffset = m.indexData_[mesh.indexOffset + i] + mesh.vertexOffset;
-            const float *vf = &m.vertexData_[vtxOffset * kMaxStreams];
+            const size_t vtxOffset = m.indexData_[mesh.indexOffset + i] + mesh.vertexOffset;
+            const float *vf = &m.vertexData_[vtxOffset * stride];
             vmin = glm::min(vmin, vec3(vf[0], vf[1], vf[2]));
             vmax = glm::max(vmax, vec3(vf[0], vf[1], vf[2]));
         }
+    }
+
+    return BoundingBox(vmin, vmax);
+}
+
+void recalculateBoundingBoxes(MeshData &m, tf::Executor *executor)
+{
+    m.boxes_.resize(m.meshes_.size());
+
+    auto calculateBox = [&m](int i) { m.boxes_[i] = calculateMeshBoundingBox(m, m.meshes_[i]); };
 
-        m.boxes_.emplace_back(vmin, vmax);
+    if (executor && m.meshes_.size() > 1)
+    {
+        tf::Taskflow taskflow;
+        taskflow.for_each_index(0, (int) m.meshes_.size(), 1, calculateBox);
+        executor->run(taskflow).wait();
     }
-}
\ No newline at end of file
+    else
+    {
+        for (int i = 0; i < (int) m.meshes_.size(); i++)
+            calculateBox(i);
+    }
+}
@@ -4,11 +4,21 @@
 
 #include <glm/glm.hpp>
 
+#include <Filesystem/ChunkFile.hpp>
+#include <Filesystem/MappedFile.hpp>
 #include <Utils/Utils.hpp>
 #include <Utils/UtilsMath.hpp>
 
+namespace tf
+{
+    class Executor;
+}
+
 constexpr const uint32_t kMaxLODs = 8;
 constexpr const uint32_t kMaxStreams = 8;
+/* Interleaved position + normal + UV (in floats), used when Mesh::streamElementSize[] is not filled in */
+constexpr const uint32_t kDefaultVertexStride = 8;
+constexpr const uint32_t kMeshFileMagic = 0x12345678;
 
 // All offsets are relative to the beginning of the data block (excluding headers with Mesh list)
 struct Mesh final {
@@ -81,10 +91,65 @@ struct MeshData {
 static_assert(sizeof(DrawData) == sizeof(uint32_t) * 6);
 static_assert(sizeof(BoundingBox) == sizeof(float) * 6);
 
+/* Accepts both chunk files and the legacy raw format */
 MeshFileHeader loadMeshData(const char *meshFile, MeshData &out);
+
+/**
+    Zero-copy view of a .meshes file.
+    The file is memory-mapped and all the blocks are exposed as pointers into the mapping,
+    so index and vertex data can be uploaded to the GPU straight from the page cache.
+    Both chunk files and the legacy raw format are supported.
+    The view stays valid for the lifetime of this object.
+ */
+class MappedMeshData final
+{
+public:
+    MappedMeshData() = default;
+    explicit MappedMeshData(const char *meshFile) { open(meshFile); }
+
+    /* Map the file and validate the header against the file size. Returns false for missing or corrupted files */
+    bool open(const char *meshFile);
+    void close();
+
+    bool isValid() const { return file_.IsValid() || chunks_.IsValid(); }
+
+    const MeshFileHeader &getHeader() const { return header_; }
+
+    uint32_t getMeshCount() const { return header_.meshCount; }
+    const Mesh *getMeshes() const { return meshes_; }
+    const BoundingBox *getBoxes() const { return boxes_; }
+
+    size_t getIndexCount() const { return header_.indexDataSize / sizeof(uint32_t); }
+    const uint32_t *getIndexData() const { return indexData_; }
+
+    size_t getVertexCount() const { return header_.vertexDataSize / sizeof(float); }
+    const float *getVertexData() const { return vertexData_; }
+
+    /* Copy only the (small) mesh descriptors and bounding boxes, index and vertex data stay in the mapping */
+    void copyDescriptors(MeshData &out) const;
+
+private:
+    bool openChunked(const char *meshFile);
+
+    MappedFile file_;
+    ChunkFileReader chunks_;
+
+    MeshFileHeader header_{};
+
+    const Mesh *meshes_ = nullptr;
+    const BoundingBox *boxes_ = nullptr;
+    const uint32_t *indexData_ = nullptr;
+    const float *vertexData_ = nullptr;
+};
+
 void saveMeshData(const char *fileName, const MeshData &m);
 
-void recalculateBoundingBoxes(MeshData &m);
+/**
+    Boxes are computed per mesh independently, on the [executor] workers if it is given.
+    The vertices [vertexOffset, vertexOffset + vertexCount) are scanned in memory order (mergeMeshData() and mergeScene() keep these ranges valid).
+    Meshes without a vertex count visit the vertices referenced by LOD 0 instead.
+*/
+void recalculateBoundingBoxes(MeshData &m, tf::Executor *executor = nullptr);
 
-// Combine a list of meshes to a single mesh container
-MeshFileHeader mergeMeshData(MeshData &m, const std::vector<MeshData *> md);
\ No newline at end of file
+// Combine a list of meshes to a single mesh container (the inputs are copied independently, on the [executor] workers if it is given)
+MeshFileHeader mergeMeshData(MeshData &m, const std::vector<MeshData *> md, tf::Executor *executor = nullptr);
\ No newline at end of file
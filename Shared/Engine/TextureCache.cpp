@@ -0,0 +1,207 @@
+#include <TextureCache.hpp>
+#include <Filesystem/MappedFile.hpp>
+
+#include <stb_image.h>
+
+#include <Utils/UtilsHash.hpp>
+
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+namespace
+{
+	constexpr const uint32_t kTextureCacheFileType = MakeChunkId('T', 'X', 'C', 'E');
+
+	constexpr const uint32_t kTextureCacheSectionHeader = MakeChunkId('T', 'X', 'H', 'D');
+	constexpr const uint32_t kTextureCacheSectionLevels = MakeChunkId('T', 'X', 'L', 'V');
+	constexpr const uint32_t kTextureCacheSectionData = MakeChunkId('T', 'X', 'D', 'T');
+
+	/* Bump when the decoding, mip filtering or encoders change, so that old entries are never reused */
+	constexpr const uint32_t kTextureCacheVersion = 2;
+
+	constexpr const uint32_t kTextureCacheMagic = MakeChunkId('T', 'X', 'C', 'H');
+
+	struct TextureCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		uint32_t format;
+		int32_t w;
+		int32_t h;
+		int32_t numLevels;
+	};
+
+	static_assert(sizeof(size_t) == sizeof(uint64_t), "Level offsets are mapped directly");
+
+	/* The section checksums only catch damaged files, this catches entries whose layout does not describe the payload */
+	bool isValidHeader(const TextureCacheHeader& h, uint64_t expectedKey, const size_t* offsets, size_t levelsSize, size_t dataSize)
+	{
+		if (h.magic != kTextureCacheMagic || h.version != kTextureCacheVersion || h.key != expectedKey)
+			return false;
+
+		if (h.format > eCompressedFormat_BC7_SRGB || h.w <= 0 || h.h <= 0 || h.numLevels <= 0 || h.numLevels > 32)
+			return false;
+
+		if (levelsSize != (h.numLevels + 1) * sizeof(size_t) || offsets[0] != 0 || offsets[h.numLevels] != dataSize)
+			return false;
+
+		for (int i = 0; i != h.numLevels; i++)
+		{
+			const int w = (h.w >> i) > 0 ? (h.w >> i) : 1;
+			const int lh = (h.h >> i) > 0 ? (h.h >> i) : 1;
+			if (offsets[i + 1] < offsets[i] || offsets[i + 1] - offsets[i] != getCompressedLevelSize(eCompressedFormat(h.format), w, lh))
+				return false;
+		}
+
+		return true;
+	}
+
+	bool decodeTexture(const MappedFile& src, const TextureImportSettings& settings, CompressedTexture& out)
+	{
+		const stbi_uc* data = src.GetData();
+		const int size = (int)src.GetSize();
+		int w, h;
+
+		if (settings.format_ == eCompressedFormat_BC6H)
+		{
+			float* img = stbi_loadf_from_memory(data, size, &w, &h, nullptr, STBI_rgb);
+			if (!img)
+				return false;
+			compressTextureHDR(img, w, h, out);
+			stbi_image_free(img);
+			return true;
+		}
+
+		uint8_t* img = stbi_load_from_memory(data, size, &w, &h, nullptr, STBI_rgb_alpha);
+		if (!img)
+			return false;
+		compressTexture(img, w, h, settings.format_, out);
+		stbi_image_free(img);
+		return true;
+	}
+
+	bool saveEntry(const std::string& fileName, uint64_t key, const CompressedTexture& tex)
+	{
+		const TextureCacheHeader header = { kTextureCacheMagic, kTextureCacheVersion, key, uint32_t(tex.format_), tex.w_, tex.h_, tex.getNumLevels() };
+
+		ChunkFileWriter writer(kTextureCacheFileType);
+		writer.AddSection(kTextureCacheSectionHeader, &header, sizeof(header));
+		writer.AddArray(kTextureCacheSectionLevels, tex.levelOffsets_);
+		writer.AddArray(kTextureCacheSectionData, tex.data_);
+
+		return writer.SaveAtomically(fileName);
+	}
+}
+
+bool CachedTexture::open(const std::string& fileName, uint64_t expectedKey)
+{
+	if (!file_.Open(fileName, kTextureCacheFileType))
+		return false;
+
+	size_t headerSize = 0, levelsSize = 0, dataSize = 0;
+	const uint8_t* header = file_.GetSectionData(kTextureCacheSectionHeader, headerSize);
+	const uint8_t* levels = file_.GetSectionData(kTextureCacheSectionLevels, levelsSize);
+	// the payload is not checksummed on load: the entry name is the content hash and files only appear after a complete write
+	const uint8_t* data = file_.GetSectionData(kTextureCacheSectionData, dataSize, false);
+
+	if (!header || !levels || !data || headerSize != sizeof(TextureCacheHeader))
+	{
+		file_.Close();
+		return false;
+	}
+
+	const TextureCacheHeader* h = reinterpret_cast<const TextureCacheHeader*>(header);
+	const size_t* offsets = reinterpret_cast<const size_t*>(levels);
+
+	if (!isValidHeader(*h, expectedKey, offsets, levelsSize, dataSize))
+	{
+		printf("Texture cache entry '%s' is outdated or inconsistent, it will be re-encoded\n", fileName.c_str());
+		file_.Close();
+		return false;
+	}
+
+	levels_.format_ = eCompressedFormat(h->format);
+	levels_.w_ = h->w;
+	levels_.h_ = h->h;
+	levels_.numLevels_ = h->numLevels;
+	levels_.levelOffsets_ = offsets;
+	levels_.data_ = data;
+
+	return true;
+}
+
+void CachedTexture::assign(CompressedTexture&& tex)
+{
+	file_.Close();
+	owned_ = std::move(tex);
+	levels_ = TextureLevelsView(owned_);
+}
+
+TextureCache::TextureCache(const std::string& cacheDir)
+	: cacheDir_(cacheDir)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(cacheDir_, ec);
+	if (ec)
+		printf("Cannot create texture cache directory '%s'\n", cacheDir_.c_str());
+}
+
+std::string TextureCache::getEntryFileName(uint64_t key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016" PRIx64 ".tex", key);
+	return (std::filesystem::path(cacheDir_) / name).string();
+}
+
+uint64_t TextureCache::computeKey(const void* data, size_t size, const TextureImportSettings& settings)
+{
+	const uint64_t settingsHash = mix64((uint64_t(kTextureCacheVersion) << 32) | uint64_t(settings.format_));
+	return hashBytes(data, size, settingsHash);
+}
+
+std::shared_ptr<CachedTexture> TextureCache::load(const std::string& sourceFile, const TextureImportSettings& settings) const
+{
+	if (!std::filesystem::exists(sourceFile))
+		return nullptr;
+
+	MappedFile src;
+	if (!src.Open(sourceFile))
+		return nullptr;
+
+	const uint64_t key = computeKey(src.GetData(), src.GetSize(), settings);
+	const std::string entryName = getEntryFileName(key);
+
+	auto tex = std::make_shared<CachedTexture>();
+	if (std::filesystem::exists(entryName) && tex->open(entryName, key))
+		return tex;
+
+	CompressedTexture decoded;
+	if (!decodeTexture(src, settings, decoded))
+		return nullptr;
+
+	if (saveEntry(entryName, key, decoded) && tex->open(entryName, key))
+		return tex;
+
+	tex->assign(std::move(decoded));
+	return tex;
+}
+
+std::shared_ptr<const void> TextureCache::loadLevels(const std::string& fileName, TextureLevelsView& outLevels, const TextureImportSettings& settings) const
+{
+	if (isCompressedTextureFile(fileName.c_str()))
+	{
+		auto tex = std::make_shared<CompressedTexture>();
+		if (!loadCompressedTexture(fileName.c_str(), *tex))
+			return nullptr;
+		outLevels = *tex;
+		return tex;
+	}
+
+	auto cached = load(fileName, settings);
+	if (cached)
+		outLevels = cached->getLevels();
+	return cached;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Filesystem/ChunkFile.hpp>
+#include <TextureCompression.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/* Everything that changes the cached payload of a source image is part of the cache key */
+struct TextureImportSettings
+{
+	// eCompressedFormat_None stores plain RGBA8 mips, eCompressedFormat_BC6H decodes the source as HDR
+	eCompressedFormat format_ = eCompressedFormat_None;
+};
+
+/**
+	Decoded (and optionally block-compressed) mip chain of one source image.
+	getLevels() points straight into the memory mapping of the cache entry, so uploads copy the levels
+	into staging memory without decoding anything. If the entry could not be written the decoded levels are kept in memory instead.
+*/
+class CachedTexture
+{
+public:
+	/* Map an existing entry, fails for missing, corrupted or outdated files */
+	bool open(const std::string& fileName, uint64_t expectedKey);
+	void assign(CompressedTexture&& tex);
+
+	const TextureLevelsView& getLevels() const { return levels_; }
+
+private:
+	ChunkFileReader file_;
+	CompressedTexture owned_;
+	TextureLevelsView levels_;
+};
+
+/**
+	Content-addressed disk cache of decoded textures.
+	Entries are named after a 64-bit hash of the source file contents and the import settings: edited sources miss
+	the cache automatically and duplicated files share one entry. load() may be called from several threads at once,
+	entries are written to a temporary file and renamed, so readers never see partially written files.
+*/
+class TextureCache
+{
+public:
+	explicit TextureCache(const std::string& cacheDir);
+
+	/* Returns nullptr if the source file cannot be read or decoded */
+	std::shared_ptr<CachedTexture> load(const std::string& sourceFile, const TextureImportSettings& settings = {}) const;
+
+	/**
+		What the scene loaders use: .ktx files (see compressMaterialTextures()) are read as they are, everything else goes through the cache.
+		The returned object keeps [outLevels] alive, nullptr if the file cannot be loaded.
+	*/
+	std::shared_ptr<const void> loadLevels(const std::string& fileName, TextureLevelsView& outLevels, const TextureImportSettings& settings = {}) const;
+
+	std::string getEntryFileName(uint64_t key) const;
+
+	static uint64_t computeKey(const void* data, size_t size, const TextureImportSettings& settings);
+
+private:
+	std::string cacheDir_;
+};
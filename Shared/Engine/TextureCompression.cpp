@@ -0,0 +1,623 @@
+#include <TextureCompression.hpp>
+#include <BitmapView.hpp>
+
+#include <gli/gli.hpp>
+#include <gli/texture2d.hpp>
+#include <gli/load_ktx.hpp>
+#include <gli/save_ktx.hpp>
+
+#include <taskflow/taskflow.hpp>
+#include <taskflow/algorithm/for_each.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+	constexpr size_t kBlockBytes = 16;
+
+	// 4-bit index interpolation weights shared by BC6H and BC7
+	constexpr int kWeights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	struct BlockWriter
+	{
+		uint8_t* out_;
+		uint32_t pos_ = 0;
+
+		void write(uint32_t value, int numBits)
+		{
+			for (int i = 0; i != numBits; i++, pos_++)
+				if ((value >> i) & 1)
+					out_[pos_ >> 3] |= uint8_t(1u << (pos_ & 7));
+		}
+	};
+
+	/* Endpoints along the principal axis of the block, spanning the projections of all the pixels */
+	template<int N>
+	void fitEndpoints(const float* px, float* e0, float* e1)
+	{
+		float mean[N] = {};
+		for (int i = 0; i != 16; i++)
+			for (int c = 0; c != N; c++)
+				mean[c] += px[i * N + c] * (1.0f / 16.0f);
+
+		float cov[N][N] = {};
+		for (int i = 0; i != 16; i++)
+			for (int a = 0; a != N; a++)
+				for (int b = 0; b != N; b++)
+					cov[a][b] += (px[i * N + a] - mean[a]) * (px[i * N + b] - mean[b]);
+
+		// power iteration, starting from the largest diagonal element is enough for 4x4 blocks
+		float axis[N] = {};
+		int maxDiag = 0;
+		for (int c = 1; c != N; c++)
+			if (cov[c][c] > cov[maxDiag][maxDiag])
+				maxDiag = c;
+		axis[maxDiag] = 1.0f;
+
+		for (int iter = 0; iter != 8; iter++)
+		{
+			float next[N] = {};
+			float len = 0.0f;
+			for (int a = 0; a != N; a++)
+			{
+				for (int b = 0; b != N; b++)
+					next[a] += cov[a][b] * axis[b];
+				len = std::max(len, std::fabs(next[a]));
+			}
+			if (len < 1e-12f)
+				break;
+			for (int a = 0; a != N; a++)
+				axis[a] = next[a] / len;
+		}
+
+		float tmin = std::numeric_limits<float>::max();
+		float tmax = -std::numeric_limits<float>::max();
+		float axisLen2 = 0.0f;
+		for (int c = 0; c != N; c++)
+			axisLen2 += axis[c] * axis[c];
+
+		for (int i = 0; i != 16; i++)
+		{
+			float t = 0.0f;
+			for (int c = 0; c != N; c++)
+				t += (px[i * N + c] - mean[c]) * axis[c];
+			tmin = std::min(tmin, t);
+			tmax = std::max(tmax, t);
+		}
+
+		for (int c = 0; c != N; c++)
+		{
+			e0[c] = mean[c] + axis[c] * tmin / axisLen2;
+			e1[c] = mean[c] + axis[c] * tmax / axisLen2;
+		}
+	}
+
+	/* Least squares endpoints for the chosen 4-bit indices, returns false for degenerate index sets */
+	template<int N>
+	bool refineEndpoints(const float* px, const uint8_t* indices, float* e0, float* e1)
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[N] = {};
+		float bx[N] = {};
+
+		for (int i = 0; i != 16; i++)
+		{
+			const float t = float(kWeights4[indices[i]]) / 64.0f;
+			const float a = 1.0f - t;
+			aa += a * a;
+			ab += a * t;
+			bb += t * t;
+			for (int c = 0; c != N; c++)
+			{
+				ax[c] += a * px[i * N + c];
+				bx[c] += t * px[i * N + c];
+			}
+		}
+
+		const float det = aa * bb - ab * ab;
+		if (std::fabs(det) < 1e-6f)
+			return false;
+
+		for (int c = 0; c != N; c++)
+		{
+			e0[c] = (bb * ax[c] - ab * bx[c]) / det;
+			e1[c] = (aa * bx[c] - ab * ax[c]) / det;
+		}
+		return true;
+	}
+
+	/* Pick the nearest palette entry for every pixel, returns the total squared error */
+	template<int N, typename T>
+	int64_t selectIndices(const T* px, const int (*palette)[4], uint8_t* indices)
+	{
+		int64_t total = 0;
+		for (int i = 0; i != 16; i++)
+		{
+			int64_t best = std::numeric_limits<int64_t>::max();
+			for (int k = 0; k != 16; k++)
+			{
+				int64_t err = 0;
+				for (int c = 0; c != N; c++)
+				{
+					const int64_t d = int64_t(palette[k][c]) - int64_t(px[i * N + c]);
+					err += d * d;
+				}
+				if (err < best)
+				{
+					best = err;
+					indices[i] = uint8_t(k);
+				}
+			}
+			total += best;
+		}
+		return total;
+	}
+
+	/* The anchor (first) index has an implicit zero MSB, swap the endpoints if it is set */
+	template<int N>
+	void fixAnchorIndex(int* q0, int* q1, uint8_t* indices)
+	{
+		if (indices[0] < 8)
+			return;
+
+		for (int c = 0; c != N; c++)
+			std::swap(q0[c], q1[c]);
+		for (int i = 0; i != 16; i++)
+			indices[i] = uint8_t(15 - indices[i]);
+	}
+
+	void writeIndices4(BlockWriter& w, const uint8_t* indices)
+	{
+		w.write(indices[0], 3);
+		for (int i = 1; i != 16; i++)
+			w.write(indices[i], 4);
+	}
+
+	// BC6H unsigned 10-bit endpoints (mode 11), see the D3D11 functional spec
+	int unquantizeBC6H(int q)
+	{
+		if (q == 0)
+			return 0;
+		if (q == 1023)
+			return 0xFFFF;
+		return ((q << 16) + 0x8000) >> 10;
+	}
+
+	int quantizeBC6H(float halfBits)
+	{
+		// inverse of unquantize() followed by the final (x * 31) >> 6 scaling
+		const float unq = halfBits * (64.0f / 31.0f);
+		return std::clamp(int(std::lround((unq - 32.0f) / 64.0f)), 0, 1023);
+	}
+
+	float linearToSRGB(float c)
+	{
+		c = std::clamp(c, 0.0f, 1.0f);
+		return (c <= 0.0031308f) ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	/* 2x2 box filter, the last row/column is repeated for odd sizes */
+	void downsample(const float* src, int w, int h, int comp, float* dst)
+	{
+		const int dw = std::max(w >> 1, 1);
+		const int dh = std::max(h >> 1, 1);
+
+		for (int y = 0; y != dh; y++)
+		{
+			const int y0 = std::min(2 * y, h - 1);
+			const int y1 = std::min(2 * y + 1, h - 1);
+			for (int x = 0; x != dw; x++)
+			{
+				const int x0 = std::min(2 * x, w - 1);
+				const int x1 = std::min(2 * x + 1, w - 1);
+				for (int c = 0; c != comp; c++)
+				{
+					dst[(y * dw + x) * comp + c] = 0.25f * (
+						src[(y0 * w + x0) * comp + c] + src[(y0 * w + x1) * comp + c] +
+						src[(y1 * w + x0) * comp + c] + src[(y1 * w + x1) * comp + c]);
+				}
+			}
+		}
+	}
+
+	void renormalize(float* rgba, size_t numPixels)
+	{
+		for (size_t i = 0; i != numPixels; i++, rgba += 4)
+		{
+			float n[3] = { rgba[0] * 2.0f - 1.0f, rgba[1] * 2.0f - 1.0f, rgba[2] * 2.0f - 1.0f };
+			const float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (len < 1e-6f)
+				continue;
+			for (int c = 0; c != 3; c++)
+				rgba[c] = n[c] / len * 0.5f + 0.5f;
+		}
+	}
+
+	int getNumLevels(int w, int h)
+	{
+		int levels = 1;
+		while ((w | h) >> levels)
+			levels += 1;
+		return levels;
+	}
+
+	void initLevels(CompressedTexture& out, int w, int h, eCompressedFormat format)
+	{
+		out.format_ = format;
+		out.w_ = w;
+		out.h_ = h;
+
+		const int numLevels = getNumLevels(w, h);
+		out.levelOffsets_.resize(numLevels + 1);
+		out.levelOffsets_[0] = 0;
+		for (int l = 0; l != numLevels; l++)
+			out.levelOffsets_[l + 1] = out.levelOffsets_[l] + getCompressedLevelSize(format, out.getLevelWidth(l), out.getLevelHeight(l));
+
+		out.data_.assign(out.levelOffsets_.back(), 0);
+	}
+
+	/* Encode [w x h] pixels of [comp] components, edge blocks repeat the last row/column */
+	template<typename T, typename EncodeFn>
+	void encodeLevel(const T* src, int w, int h, int comp, uint8_t* dst, EncodeFn encode, tf::Executor* executor)
+	{
+		const int bw = (w + 3) / 4;
+		const int bh = (h + 3) / 4;
+
+		auto encodeRow = [&](int by)
+		{
+			T block[16 * 4];
+			for (int bx = 0; bx != bw; bx++)
+			{
+				for (int i = 0; i != 16; i++)
+				{
+					const int x = std::min(bx * 4 + (i & 3), w - 1);
+					const int y = std::min(by * 4 + (i >> 2), h - 1);
+					memcpy(block + i * comp, src + (size_t(y) * w + x) * comp, comp * sizeof(T));
+				}
+				encode(block, dst + (size_t(by) * bw + bx) * kBlockBytes);
+			}
+		};
+
+		if (!executor)
+		{
+			for (int by = 0; by != bh; by++)
+				encodeRow(by);
+			return;
+		}
+
+		tf::Taskflow taskflow;
+		taskflow.for_each_index(0, bh, 1, encodeRow);
+		executor->run(taskflow).wait();
+	}
+
+	gli::format toGliFormat(eCompressedFormat format)
+	{
+		switch (format)
+		{
+		case eCompressedFormat_None:     return gli::FORMAT_RGBA8_UNORM_PACK8;
+		case eCompressedFormat_BC5:      return gli::FORMAT_RG_ATI2N_UNORM_BLOCK16;
+		case eCompressedFormat_BC6H:     return gli::FORMAT_RGB_BP_UFLOAT_BLOCK16;
+		case eCompressedFormat_BC7:      return gli::FORMAT_RGBA_BP_UNORM_BLOCK16;
+		case eCompressedFormat_BC7_SRGB: return gli::FORMAT_RGBA_BP_SRGB_BLOCK16;
+		}
+		return gli::FORMAT_UNDEFINED;
+	}
+
+	bool fromGliFormat(gli::format format, eCompressedFormat& out)
+	{
+		switch (format)
+		{
+		case gli::FORMAT_RGBA8_UNORM_PACK8:      out = eCompressedFormat_None; return true;
+		case gli::FORMAT_RG_ATI2N_UNORM_BLOCK16: out = eCompressedFormat_BC5; return true;
+		case gli::FORMAT_RGB_BP_UFLOAT_BLOCK16:  out = eCompressedFormat_BC6H; return true;
+		case gli::FORMAT_RGBA_BP_UNORM_BLOCK16:  out = eCompressedFormat_BC7; return true;
+		case gli::FORMAT_RGBA_BP_SRGB_BLOCK16:   out = eCompressedFormat_BC7_SRGB; return true;
+		default: break;
+		}
+		return false;
+	}
+}
+
+size_t getCompressedLevelSize(eCompressedFormat format, int w, int h)
+{
+	if (format == eCompressedFormat_None)
+		return size_t(w) * size_t(h) * 4;
+	return size_t((w + 3) / 4) * size_t((h + 3) / 4) * kBlockBytes;
+}
+
+size_t packLevels(const void* data, const size_t* levelOffsets, int numLevels, uint8_t* dst)
+{
+	const size_t size = levelOffsets[numLevels] - levelOffsets[0];
+	memcpy(dst, static_cast<const uint8_t*>(data) + levelOffsets[0], size);
+	return size;
+}
+
+/* BC7 mode 6: one subset, 7.7.7.7 endpoints with a p-bit each, 4-bit indices */
+void compressBlockBC7(const uint8_t* rgba, uint8_t* out)
+{
+	float px[16 * 4];
+	for (int i = 0; i != 16 * 4; i++)
+		px[i] = float(rgba[i]);
+
+	float e0[4], e1[4];
+	fitEndpoints<4>(px, e0, e1);
+
+	int64_t bestErr = std::numeric_limits<int64_t>::max();
+	int best0[4] = {}, best1[4] = {};
+	uint8_t bestIndices[16] = {};
+
+	for (int pass = 0; pass != 2; pass++)
+	{
+		for (int p = 0; p != 4; p++)
+		{
+			const int p0 = p & 1;
+			const int p1 = p >> 1;
+
+			int q0[4], q1[4];
+			for (int c = 0; c != 4; c++)
+			{
+				q0[c] = (std::clamp(int(std::lround((e0[c] - p0) * 0.5f)), 0, 127) << 1) | p0;
+				q1[c] = (std::clamp(int(std::lround((e1[c] - p1) * 0.5f)), 0, 127) << 1) | p1;
+			}
+
+			int palette[16][4];
+			for (int k = 0; k != 16; k++)
+				for (int c = 0; c != 4; c++)
+					palette[k][c] = ((64 - kWeights4[k]) * q0[c] + kWeights4[k] * q1[c] + 32) >> 6;
+
+			uint8_t indices[16];
+			const int64_t err = selectIndices<4>(rgba, palette, indices);
+			if (err < bestErr)
+			{
+				bestErr = err;
+				memcpy(best0, q0, sizeof(q0));
+				memcpy(best1, q1, sizeof(q1));
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+		}
+
+		if (bestErr == 0 || !refineEndpoints<4>(px, bestIndices, e0, e1))
+			break;
+	}
+
+	fixAnchorIndex<4>(best0, best1, bestIndices);
+
+	memset(out, 0, kBlockBytes);
+	BlockWriter w{ out };
+	w.write(1u << 6, 7);
+	for (int c = 0; c != 4; c++)
+	{
+		w.write(uint32_t(best0[c] >> 1), 7);
+		w.write(uint32_t(best1[c] >> 1), 7);
+	}
+	w.write(uint32_t(best0[0] & 1), 1);
+	w.write(uint32_t(best1[0] & 1), 1);
+	writeIndices4(w, bestIndices);
+}
+
+/* Two BC4 blocks, always in the 8-value mode (red0 > red1) */
+void compressBlockBC5(const uint8_t* rgba, uint8_t* out)
+{
+	for (int ch = 0; ch != 2; ch++)
+	{
+		uint8_t* dst = out + ch * 8;
+
+		int lo = 255, hi = 0;
+		for (int i = 0; i != 16; i++)
+		{
+			lo = std::min(lo, int(rgba[i * 4 + ch]));
+			hi = std::max(hi, int(rgba[i * 4 + ch]));
+		}
+
+		memset(dst, 0, 8);
+		dst[0] = uint8_t(hi);
+		dst[1] = uint8_t(lo);
+
+		if (hi == lo)
+			continue;
+
+		float palette[8] = { float(hi), float(lo) };
+		for (int k = 2; k != 8; k++)
+			palette[k] = (float(8 - k) * hi + float(k - 1) * lo) / 7.0f;
+
+		BlockWriter w{ dst, 16 };
+		for (int i = 0; i != 16; i++)
+		{
+			const float v = float(rgba[i * 4 + ch]);
+			int bestIndex = 0;
+			for (int k = 1; k != 8; k++)
+				if (std::fabs(palette[k] - v) < std::fabs(palette[bestIndex] - v))
+					bestIndex = k;
+			w.write(uint32_t(bestIndex), 3);
+		}
+	}
+}
+
+/* BC6H mode 11: one subset, unsigned 10-bit endpoints, 4-bit indices. Fitting is done on the half-float bit patterns (roughly logarithmic) */
+void compressBlockBC6H(const float* rgb, uint8_t* out)
+{
+	float px[16 * 3];
+	int target[16 * 3];
+	for (int i = 0; i != 16 * 3; i++)
+	{
+		target[i] = floatToHalf(std::clamp(rgb[i], 0.0f, 65504.0f));
+		px[i] = float(target[i]);
+	}
+
+	float e0[3], e1[3];
+	fitEndpoints<3>(px, e0, e1);
+
+	int64_t bestErr = std::numeric_limits<int64_t>::max();
+	int best0[3] = {}, best1[3] = {};
+	uint8_t bestIndices[16] = {};
+
+	for (int pass = 0; pass != 2; pass++)
+	{
+		int q0[3], q1[3];
+		int palette[16][4] = {};
+		for (int c = 0; c != 3; c++)
+		{
+			q0[c] = quantizeBC6H(e0[c]);
+			q1[c] = quantizeBC6H(e1[c]);
+
+			const int u0 = unquantizeBC6H(q0[c]);
+			const int u1 = unquantizeBC6H(q1[c]);
+			for (int k = 0; k != 16; k++)
+				palette[k][c] = ((((64 - kWeights4[k]) * u0 + kWeights4[k] * u1 + 32) >> 6) * 31) >> 6;
+		}
+
+		uint8_t indices[16];
+		const int64_t err = selectIndices<3>(target, palette, indices);
+		if (err < bestErr)
+		{
+			bestErr = err;
+			memcpy(best0, q0, sizeof(q0));
+			memcpy(best1, q1, sizeof(q1));
+			memcpy(bestIndices, indices, sizeof(indices));
+		}
+
+		if (bestErr == 0 || !refineEndpoints<3>(px, bestIndices, e0, e1))
+			break;
+	}
+
+	fixAnchorIndex<3>(best0, best1, bestIndices);
+
+	memset(out, 0, kBlockBytes);
+	BlockWriter w{ out };
+	w.write(0x03, 5);
+	for (int c = 0; c != 3; c++)
+		w.write(uint32_t(best0[c]), 10);
+	for (int c = 0; c != 3; c++)
+		w.write(uint32_t(best1[c]), 10);
+	writeIndices4(w, bestIndices);
+}
+
+void compressTexture(const uint8_t* rgba, int w, int h, eCompressedFormat format, CompressedTexture& out, tf::Executor* executor)
+{
+	initLevels(out, w, h, format);
+
+	const bool isSRGB = format == eCompressedFormat_BC7_SRGB;
+	const bool isNormalMap = format == eCompressedFormat_BC5;
+	auto encode = isNormalMap ? compressBlockBC5 : compressBlockBC7;
+
+	auto storeLevel = [&](const uint8_t* src, int lw, int lh, int level)
+	{
+		if (format == eCompressedFormat_None)
+			memcpy(out.data_.data() + out.levelOffsets_[level], src, out.getLevelSize(level));
+		else
+			encodeLevel(src, lw, lh, 4, out.data_.data() + out.levelOffsets_[level], encode, executor);
+	};
+
+	storeLevel(rgba, w, h, 0);
+
+	if (out.getNumLevels() == 1)
+		return;
+
+	// lower levels are filtered from the previous float level, sRGB data is filtered in linear space
+	std::vector<float> level(size_t(w) * h * 4);
+	if (isSRGB)
+		convertRowSRGB8ToLinearF32(rgba, level.data(), size_t(w) * h, 4);
+	else
+		convertRowU8ToF32(rgba, level.data(), level.size());
+
+	std::vector<float> next;
+	std::vector<uint8_t> bytes;
+
+	for (int l = 1; l != out.getNumLevels(); l++)
+	{
+		const int lw = out.getLevelWidth(l);
+		const int lh = out.getLevelHeight(l);
+
+		next.resize(size_t(lw) * lh * 4);
+		downsample(level.data(), out.getLevelWidth(l - 1), out.getLevelHeight(l - 1), 4, next.data());
+		if (isNormalMap)
+			renormalize(next.data(), size_t(lw) * lh);
+		level.swap(next);
+
+		bytes.resize(level.size());
+		if (isSRGB)
+		{
+			for (size_t i = 0; i != level.size(); i++)
+				bytes[i] = uint8_t(std::lround(255.0f * ((i & 3) == 3 ? std::clamp(level[i], 0.0f, 1.0f) : linearToSRGB(level[i]))));
+		}
+		else
+		{
+			for (size_t i = 0; i != level.size(); i++)
+				bytes[i] = uint8_t(std::lround(255.0f * std::clamp(level[i], 0.0f, 1.0f)));
+		}
+
+		storeLevel(bytes.data(), lw, lh, l);
+	}
+}
+
+void compressTextureHDR(const float* rgb, int w, int h, CompressedTexture& out, tf::Executor* executor)
+{
+	initLevels(out, w, h, eCompressedFormat_BC6H);
+
+	encodeLevel(rgb, w, h, 3, out.data_.data(), compressBlockBC6H, executor);
+
+	std::vector<float> level(rgb, rgb + size_t(w) * h * 3);
+	std::vector<float> next;
+
+	for (int l = 1; l != out.getNumLevels(); l++)
+	{
+		const int lw = out.getLevelWidth(l);
+		const int lh = out.getLevelHeight(l);
+
+		next.resize(size_t(lw) * lh * 3);
+		downsample(level.data(), out.getLevelWidth(l - 1), out.getLevelHeight(l - 1), 3, next.data());
+		level.swap(next);
+
+		encodeLevel(level.data(), lw, lh, 3, out.data_.data() + out.levelOffsets_[l], compressBlockBC6H, executor);
+	}
+}
+
+bool saveCompressedTexture(const char* fileName, const CompressedTexture& tex)
+{
+	gli::texture2d ktx(toGliFormat(tex.format_), gli::extent2d(tex.w_, tex.h_), tex.getNumLevels());
+
+	for (int l = 0; l != tex.getNumLevels(); l++)
+	{
+		if (ktx.size(l) != tex.getLevelSize(l))
+		{
+			printf("Cannot save %s: unexpected size of level %i\n", fileName, l);
+			return false;
+		}
+		memcpy(ktx.data(0, 0, l), tex.getLevelData(l), tex.getLevelSize(l));
+	}
+
+	return gli::save_ktx(ktx, fileName);
+}
+
+bool loadCompressedTexture(const char* fileName, CompressedTexture& tex)
+{
+	gli::texture ktx = gli::load_ktx(fileName);
+	if (ktx.empty() || ktx.target() != gli::TARGET_2D || !fromGliFormat(ktx.format(), tex.format_))
+		return false;
+
+	const gli::extent3d extent = ktx.extent(0);
+	tex.w_ = extent.x;
+	tex.h_ = extent.y;
+
+	const int numLevels = int(ktx.levels());
+	tex.levelOffsets_.resize(numLevels + 1);
+	tex.levelOffsets_[0] = 0;
+	for (int l = 0; l != numLevels; l++)
+		tex.levelOffsets_[l + 1] = tex.levelOffsets_[l] + ktx.size(l);
+
+	tex.data_.resize(tex.levelOffsets_.back());
+	for (int l = 0; l != numLevels; l++)
+		memcpy(tex.data_.data() + tex.levelOffsets_[l], ktx.data(0, 0, l), ktx.size(l));
+
+	return true;
+}
+
+bool isCompressedTextureFile(const char* fileName)
+{
+	const char* ext = strrchr(fileName, '.');
+	return ext && !strcmp(ext, ".ktx");
+}
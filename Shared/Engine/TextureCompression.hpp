@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tf { class Executor; }
+
+/**
+	Offline block compression of material textures.
+	Every texture is stored with its complete mip chain (generated on the CPU before encoding), so the loaders
+	upload the levels as they are and never call glGenerateTextureMipmap() or blit on the GPU.
+*/
+
+enum eCompressedFormat
+{
+	eCompressedFormat_None,     // plain RGBA8 levels (texture cache entries stored without block compression)
+	eCompressedFormat_BC5,      // RG, tangent-space normal maps (Z is reconstructed in the shaders)
+	eCompressedFormat_BC6H,     // unsigned HDR RGB
+	eCompressedFormat_BC7,      // linear RGBA
+	eCompressedFormat_BC7_SRGB, // sRGB RGBA (albedo, emissive), mips are filtered in linear space
+};
+
+/* All levels of a 2D texture, 16 bytes per 4x4 block for the block-compressed formats */
+struct CompressedTexture
+{
+	eCompressedFormat format_ = eCompressedFormat_BC7;
+	int w_ = 0;
+	int h_ = 0;
+	// level [i] occupies [levelOffsets_[i], levelOffsets_[i + 1]) of data_
+	std::vector<size_t> levelOffsets_;
+	std::vector<uint8_t> data_;
+
+	int getNumLevels() const { return levelOffsets_.empty() ? 0 : int(levelOffsets_.size()) - 1; }
+	int getLevelWidth(int level) const { return (w_ >> level) > 0 ? (w_ >> level) : 1; }
+	int getLevelHeight(int level) const { return (h_ >> level) > 0 ? (h_ >> level) : 1; }
+	size_t getLevelSize(int level) const { return levelOffsets_[level + 1] - levelOffsets_[level]; }
+	const uint8_t* getLevelData(int level) const { return data_.data() + levelOffsets_[level]; }
+};
+
+/* Non-owning view of the levels of a CompressedTexture or of a mapped texture cache entry, this is what the loaders upload */
+struct TextureLevelsView
+{
+	eCompressedFormat format_ = eCompressedFormat_None;
+	int w_ = 0;
+	int h_ = 0;
+	int numLevels_ = 0;
+	// [numLevels_ + 1] offsets into data_
+	const size_t* levelOffsets_ = nullptr;
+	const uint8_t* data_ = nullptr;
+
+	TextureLevelsView() = default;
+	TextureLevelsView(const CompressedTexture& tex)
+		: format_(tex.format_), w_(tex.w_), h_(tex.h_), numLevels_(tex.getNumLevels())
+		, levelOffsets_(tex.levelOffsets_.data()), data_(tex.data_.data())
+	{}
+
+	bool isCompressed() const { return format_ != eCompressedFormat_None; }
+	int getLevelWidth(int level) const { return (w_ >> level) > 0 ? (w_ >> level) : 1; }
+	int getLevelHeight(int level) const { return (h_ >> level) > 0 ? (h_ >> level) : 1; }
+	size_t getLevelSize(int level) const { return levelOffsets_[level + 1] - levelOffsets_[level]; }
+	const uint8_t* getLevelData(int level) const { return data_ + levelOffsets_[level]; }
+	// bytes of levels [firstLevel, numLevels_)
+	size_t getTailSize(int firstLevel) const { return levelOffsets_[numLevels_] - levelOffsets_[firstLevel]; }
+
+	/* Levels [firstLevel, numLevels_) as a texture of their own, the offsets still point into the same data_ */
+	TextureLevelsView getMipTail(int firstLevel) const
+	{
+		TextureLevelsView tail = *this;
+		tail.w_ = getLevelWidth(firstLevel);
+		tail.h_ = getLevelHeight(firstLevel);
+		tail.numLevels_ = numLevels_ - firstLevel;
+		tail.levelOffsets_ = levelOffsets_ + firstLevel;
+		return tail;
+	}
+};
+
+/**
+	Copy [numLevels] levels back to back into [dst], the way the staging buffers hold them. [levelOffsets] may start anywhere
+	in [data] (a mip tail of a bigger texture), level [i] ends up at levelOffsets[i] - levelOffsets[0]. Returns the bytes written.
+*/
+size_t packLevels(const void* data, const size_t* levelOffsets, int numLevels, uint8_t* dst);
+
+/* Encode one 4x4 block, [rgba]/[rgb] are 16 pixels in row order, [out] receives 16 bytes */
+void compressBlockBC7(const uint8_t* rgba, uint8_t* out);
+void compressBlockBC5(const uint8_t* rgba, uint8_t* out); // uses R and G
+void compressBlockBC6H(const float* rgb, uint8_t* out);  // negative values are clamped to zero
+
+/* Bytes of one level of the given size, as the encoders lay it out */
+size_t getCompressedLevelSize(eCompressedFormat format, int w, int h);
+
+/**
+	Build the mip chain of an 8-bit RGBA image and encode every level (BC5 and both BC7 variants).
+	Normal maps are renormalized after each downsampling step, eCompressedFormat_None keeps the levels as RGBA8.
+*/
+void compressTexture(const uint8_t* rgba, int w, int h, eCompressedFormat format, CompressedTexture& out, tf::Executor* executor = nullptr);
+
+/* The same for float RGB images, always BC6H */
+void compressTextureHDR(const float* rgb, int w, int h, CompressedTexture& out, tf::Executor* executor = nullptr);
+
+/* KTX container, only the formats listed in eCompressedFormat are accepted by the loader */
+bool saveCompressedTexture(const char* fileName, const CompressedTexture& tex);
+bool loadCompressedTexture(const char* fileName, CompressedTexture& tex);
+
+/* Texture files compressed by this module use the .ktx extension */
+bool isCompressedTextureFile(const char* fileName);
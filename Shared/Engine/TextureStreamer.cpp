@@ -0,0 +1,256 @@
+#include <TextureStreamer.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+TextureStreamer::TextureStreamer(size_t numTextures, const std::vector<MaterialDescription>& materials, const std::vector<DrawData>& shapes,
+	const TextureStreamingSettings& settings)
+	: settings_(settings)
+	, textures_(numTextures)
+	, shapes_(shapes)
+{
+	materialTextures_.resize(materials.size());
+
+	for (size_t i = 0; i != materials.size(); i++)
+	{
+		const MaterialDescription& m = materials[i];
+		const uint64_t maps[] = { m.ambientOcclusionMap_, m.emissiveMap_, m.albedoMap_, m.metallicRoughnessMap_, m.normalMap_, m.opacityMap_ };
+
+		for (uint64_t t : maps)
+			if (t != INVALID_TEXTURE && t < numTextures)
+				materialTextures_[i].push_back(uint32_t(t));
+	}
+}
+
+void TextureStreamer::updatePriorities(const glm::mat4& view, float viewportScale, const std::vector<glm::mat4>& shapeTransforms, const std::vector<BoundingBox>& meshBoxes)
+{
+	std::vector<float> pixels(textures_.size(), 0.0f);
+	std::vector<float> priorities(textures_.size(), 0.0f);
+
+	for (size_t i = 0; i != shapes_.size(); i++)
+	{
+		const DrawData& shape = shapes_[i];
+		if (shape.materialIndex >= materialTextures_.size() || shape.meshIndex >= meshBoxes.size())
+			continue;
+
+		const BoundingBox& box = meshBoxes[shape.meshIndex];
+		const glm::mat4 m = view * shapeTransforms[i];
+
+		const glm::vec3 center = glm::vec3(m * glm::vec4(box.getCenter(), 1.0f));
+		const float scale = std::max(glm::length(glm::vec3(m[0])), std::max(glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))));
+		const float radius = 0.5f * glm::length(box.getSize()) * scale;
+
+		// the camera inside the bounding sphere wants the top level
+		const float distance = glm::length(center) - radius;
+		const float projected = distance > 1e-3f ? radius / distance * viewportScale : viewportScale;
+
+		// shapes behind the camera (view space looks down -Z) are still wanted, but after the visible ones
+		const float coverage = projected * projected * (center.z - radius > 0.0f ? 0.25f : 1.0f);
+
+		for (uint32_t t : materialTextures_[shape.materialIndex])
+		{
+			pixels[t] = std::max(pixels[t], projected);
+			priorities[t] = std::max(priorities[t], coverage);
+		}
+	}
+
+	std::lock_guard lock(mutex_);
+
+	for (size_t i = 0; i != textures_.size(); i++)
+	{
+		textures_[i].pixels_ = pixels[i];
+		textures_[i].priority_ = priorities[i];
+	}
+}
+
+bool TextureStreamer::acquireNextLoad(uint32_t& index)
+{
+	std::lock_guard lock(mutex_);
+
+	int best = -1;
+	for (size_t i = 0; i != textures_.size(); i++)
+	{
+		if (textures_[i].requested_)
+			continue;
+
+		if (best < 0 || textures_[i].priority_ > textures_[best].priority_)
+			best = int(i);
+	}
+
+	if (best < 0)
+		return false;
+
+	textures_[best].requested_ = true;
+	index = uint32_t(best);
+	return true;
+}
+
+void TextureStreamer::setLevels(uint32_t index, const TextureLevelsView& levels)
+{
+	TextureState& t = textures_[index];
+
+	if (levels.numLevels_ <= 0)
+	{
+		setFailed(index);
+		return;
+	}
+
+	t.levels_ = levels;
+	t.loaded_ = true;
+	t.residentLevel_ = levels.numLevels_;
+
+	t.tailLevel_ = 0;
+	while (t.tailLevel_ < levels.numLevels_ - 1 && std::max(levels.getLevelWidth(t.tailLevel_), levels.getLevelHeight(t.tailLevel_)) > settings_.tailSize_)
+		t.tailLevel_++;
+}
+
+void TextureStreamer::setFailed(uint32_t index)
+{
+	textures_[index].failed_ = true;
+}
+
+int TextureStreamer::getWantedLevel(const TextureState& t) const
+{
+	// textures never seen by the camera keep their tails only
+	if (t.pixels_ <= 0.0f)
+		return t.tailLevel_;
+
+	// the shape diameter in pixels should get at least as many texels
+	const float maxDim = float(std::max(t.levels_.w_, t.levels_.h_));
+	const int level = int(std::floor(std::log2(std::max(maxDim / (2.0f * t.pixels_), 1.0f))));
+
+	return std::min(level, t.tailLevel_);
+}
+
+void TextureStreamer::setResidentLevel(uint32_t index, int level, std::vector<TextureStreamingUpdate>& updates)
+{
+	TextureState& t = textures_[index];
+
+	if (t.residentLevel_ < t.levels_.numLevels_)
+		residentBytes_ -= t.levels_.getTailSize(t.residentLevel_);
+	else
+		numResident_++;
+
+	t.residentLevel_ = level;
+	residentBytes_ += t.levels_.getTailSize(level);
+
+	updates.push_back(TextureStreamingUpdate{ index, level });
+	touched_[index] = 1;
+}
+
+void TextureStreamer::planUpdates(std::vector<TextureStreamingUpdate>& updates)
+{
+	updates.clear();
+
+	order_.clear();
+	size_t numFinished = 0;
+	for (size_t i = 0; i != textures_.size(); i++)
+	{
+		if (textures_[i].loaded_)
+			order_.push_back(uint32_t(i));
+		if (textures_[i].loaded_ || textures_[i].failed_)
+			numFinished++;
+	}
+
+	std::stable_sort(order_.begin(), order_.end(),
+		[this](uint32_t a, uint32_t b) { return textures_[a].priority_ > textures_[b].priority_; });
+
+	touched_.assign(textures_.size(), 0);
+
+	size_t budget = settings_.uploadBudget_;
+	const auto spend = [&budget](size_t bytes) { budget -= std::min(bytes, budget); };
+
+	// 1. mip tails of everything loaded so far, nothing is refined while some texture is missing completely
+	bool allTails = true;
+	for (uint32_t i : order_)
+	{
+		TextureState& t = textures_[i];
+		if (t.residentLevel_ < t.levels_.numLevels_)
+			continue;
+
+		const size_t cost = t.levels_.getTailSize(t.tailLevel_);
+		if (cost > budget && !updates.empty())
+		{
+			allTails = false;
+			break;
+		}
+
+		setResidentLevel(i, t.tailLevel_, updates);
+		spend(cost);
+	}
+
+	tailsResident_ = allTails && numFinished == textures_.size();
+
+	if (!allTails)
+	{
+		complete_ = false;
+		return;
+	}
+
+	// lowest priority first, over-resident textures (wanting less than they have) before everything else
+	const auto findVictim = [this](uint32_t exclude) -> int
+	{
+		const float maxPriority = textures_[exclude].priority_;
+		int victim = -1;
+
+		for (auto it = order_.rbegin(); it != order_.rend(); ++it)
+		{
+			const TextureState& v = textures_[*it];
+			if (*it == exclude || touched_[*it] || v.residentLevel_ >= v.tailLevel_)
+				continue;
+
+			if (v.residentLevel_ < getWantedLevel(v))
+				return int(*it);
+
+			if (victim < 0 && v.priority_ < maxPriority)
+				victim = int(*it);
+		}
+
+		return victim;
+	};
+
+	// 2. refine the most important textures towards their wanted levels
+	bool pending = false;
+	for (uint32_t i : order_)
+	{
+		TextureState& t = textures_[i];
+		const int wanted = getWantedLevel(t);
+		if (touched_[i] || t.residentLevel_ <= wanted)
+			continue;
+
+		// the finest level which still fits this frame, at least one level per update
+		int target = t.residentLevel_ - 1;
+		while (target > wanted && t.levels_.getTailSize(target - 1) <= budget)
+			target--;
+
+		const size_t cost = t.levels_.getTailSize(target);
+		if (cost > budget && !updates.empty())
+		{
+			pending = true;
+			break;
+		}
+
+		const size_t extra = cost - t.levels_.getTailSize(t.residentLevel_);
+		while (residentBytes_ + extra > settings_.residencyBudget_)
+		{
+			const int victim = findVictim(i);
+			if (victim < 0)
+				break;
+
+			setResidentLevel(uint32_t(victim), textures_[victim].residentLevel_ + 1, updates);
+			spend(textures_[victim].levels_.getTailSize(textures_[victim].residentLevel_));
+		}
+
+		// nothing less important left to evict, this texture stays as it is
+		if (residentBytes_ + extra > settings_.residencyBudget_)
+			continue;
+
+		setResidentLevel(i, target, updates);
+		spend(cost);
+
+		if (target > wanted)
+			pending = true;
+	}
+
+	complete_ = !pending && numFinished == textures_.size();
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <Scene/Mareial.hpp>
+#include <Scene/VtxData.hpp>
+#include <TextureCompression.hpp>
+#include <Utils/UtilsMath.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct TextureStreamingSettings
+{
+	// bytes of texel data uploaded by one planUpdates() call
+	size_t uploadBudget_ = 16u << 20;
+	// GPU memory for all the streamed textures, the least important ones lose their top levels above it
+	size_t residencyBudget_ = 512u << 20;
+	// the first upload of every texture contains only the levels not larger than this
+	int tailSize_ = 64;
+};
+
+/* Texture [index_] has to be recreated from levels [firstLevel_, numLevels) of its CPU data */
+struct TextureStreamingUpdate
+{
+	uint32_t index_;
+	int firstLevel_;
+};
+
+/**
+	Decides in which order the material textures of a scene are loaded and how many of their levels live on the GPU.
+
+	Priorities come from the shapes using each texture: the projected size of a shape bounding sphere gives both
+	the screen coverage (priority) and the finest level worth keeping (wanted level). The loader threads pick the most
+	important texture not requested yet. On the render thread every loaded texture first gets its small mip tail,
+	only then the tails are refined towards the wanted levels within the per-frame upload budget.
+	Above the residency budget the least important textures drop their top levels again.
+
+	The streamer does not touch any graphics API: planUpdates() returns the textures to recreate.
+*/
+class TextureStreamer
+{
+public:
+	TextureStreamer(size_t numTextures, const std::vector<MaterialDescription>& materials, const std::vector<DrawData>& shapes,
+		const TextureStreamingSettings& settings = {});
+
+	/**
+		[view] transforms the shapes to view space (shape transform first), [viewportScale] is proj[1][1] * viewportHeight / 2
+		so that radius / distance * viewportScale is the projected radius in pixels. [meshBoxes] are indexed by DrawData::meshIndex.
+	*/
+	void updatePriorities(const glm::mat4& view, float viewportScale, const std::vector<glm::mat4>& shapeTransforms, const std::vector<BoundingBox>& meshBoxes);
+
+	/* Loader threads: the most important texture which has not been requested yet, false once everything is requested */
+	bool acquireNextLoad(uint32_t& index);
+
+	/* Render thread: the CPU levels of [index] are available, [levels] have to stay valid while the texture is streamed */
+	void setLevels(uint32_t index, const TextureLevelsView& levels);
+
+	/* Render thread: the texture could not be loaded at all, it is skipped from now on */
+	void setFailed(uint32_t index);
+
+	/* Render thread: this frame's GPU updates, the streamer assumes they are all executed */
+	void planUpdates(std::vector<TextureStreamingUpdate>& updates);
+
+	const TextureLevelsView& getLevels(uint32_t index) const { return textures_[index].levels_; }
+
+	size_t getResidentBytes() const { return residentBytes_; }
+	uint32_t getNumResidentTextures() const { return numResident_; }
+	/* Every texture is loaded and has at least its mip tail resident: the first frame without placeholders */
+	bool areTailsResident() const { return tailsResident_; }
+	/* ...and the wanted levels are resident as well (or as many as the residency budget allows) */
+	bool isComplete() const { return complete_; }
+
+private:
+	struct TextureState
+	{
+		TextureLevelsView levels_;
+		// projected radius in pixels and screen coverage of the largest shape using this texture
+		float pixels_ = 0.0f;
+		float priority_ = 0.0f;
+		// finest resident level, [numLevels_] if nothing is resident
+		int residentLevel_ = 0;
+		int tailLevel_ = 0;
+		bool requested_ = false;
+		bool loaded_ = false;
+		bool failed_ = false;
+	};
+
+	int getWantedLevel(const TextureState& t) const;
+	void setResidentLevel(uint32_t index, int level, std::vector<TextureStreamingUpdate>& updates);
+
+	TextureStreamingSettings settings_;
+
+	std::vector<TextureState> textures_;
+	// per material, the indices of all its maps
+	std::vector<std::vector<uint32_t>> materialTextures_;
+	std::vector<DrawData> shapes_;
+
+	std::vector<uint32_t> order_;
+	std::vector<uint8_t> touched_;
+
+	// guards [requested_] and [priority_] which the loader threads read
+	std::mutex mutex_;
+
+	size_t residentBytes_ = 0;
+	uint32_t numResident_ = 0;
+	bool tailsResident_ = false;
+	bool complete_ = false;
+};
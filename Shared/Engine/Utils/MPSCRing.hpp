@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+
+/**
+	Bounded lock-free multi-producer/single-consumer ring (Vyukov's bounded queue with per-cell sequence numbers).
+	Producers claim a cell with one CAS on the shared write position and publish it with a release store of the cell sequence,
+	the consumer never writes anything a producer spins on except the sequence of the cell it just emptied.
+	There is no lock for the render thread to take: an empty ring costs it a single acquire load.
+*/
+template<typename T>
+class MPSCRing
+{
+public:
+	explicit MPSCRing(size_t capacity = 0) { reset(capacity); }
+
+	MPSCRing(const MPSCRing&) = delete;
+	MPSCRing& operator=(const MPSCRing&) = delete;
+
+	/* Not thread-safe, drops whatever the ring holds. [capacity] is rounded up to a power of two */
+	void reset(size_t capacity)
+	{
+		size_t size = 2;
+		while (size < capacity)
+			size <<= 1;
+
+		cells_ = std::make_unique<Cell[]>(size);
+		mask_ = size - 1;
+
+		for (size_t i = 0; i != size; i++)
+			cells_[i].sequence_.store(i, std::memory_order_relaxed);
+
+		writePos_.store(0, std::memory_order_relaxed);
+		readPos_ = 0;
+	}
+
+	size_t capacity() const { return mask_ + 1; }
+
+	/* Producers: false if the ring is full */
+	bool tryPush(T&& item)
+	{
+		size_t pos = writePos_.load(std::memory_order_relaxed);
+		Cell* cell = nullptr;
+
+		for (;;)
+		{
+			cell = &cells_[pos & mask_];
+			const size_t seq = cell->sequence_.load(std::memory_order_acquire);
+			const intptr_t diff = intptr_t(seq) - intptr_t(pos);
+
+			if (diff == 0)
+			{
+				if (writePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+			{
+				// the consumer has not emptied this cell yet
+				return false;
+			}
+			else
+			{
+				pos = writePos_.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->data_ = std::move(item);
+		cell->sequence_.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/* Producers: waits for the consumer if the ring is full */
+	void push(T&& item)
+	{
+		while (!tryPush(std::move(item)))
+			std::this_thread::yield();
+	}
+
+	/* Consumer only */
+	bool tryPop(T& out)
+	{
+		Cell& cell = cells_[readPos_ & mask_];
+		if (cell.sequence_.load(std::memory_order_acquire) != readPos_ + 1)
+			return false;
+
+		out = std::move(cell.data_);
+		cell.data_ = T();
+		cell.sequence_.store(readPos_ + mask_ + 1, std::memory_order_release);
+		readPos_++;
+		return true;
+	}
+
+	/**
+		Consumer only: pops items and passes them to fn(T&&) until the ring is empty, [maxItems] are taken
+		or fn() returns false (the item it got is consumed either way, so budgets are checked after each item).
+		Returns the number of items taken.
+	*/
+	template<typename Fn>
+	size_t drain(Fn&& fn, size_t maxItems = SIZE_MAX)
+	{
+		size_t count = 0;
+		T item;
+
+		while (count < maxItems && tryPop(item))
+		{
+			count++;
+			if (!fn(std::move(item)))
+				break;
+		}
+
+		return count;
+	}
+
+	/* Consumer only, producers may add items right after this returns true */
+	bool empty() const
+	{
+		return cells_[readPos_ & mask_].sequence_.load(std::memory_order_acquire) != readPos_ + 1;
+	}
+
+private:
+	struct alignas(64) Cell
+	{
+		std::atomic<size_t> sequence_;
+		T data_;
+	};
+
+	std::unique_ptr<Cell[]> cells_;
+	size_t mask_ = 0;
+
+	// producers and the consumer work on different cache lines
+	alignas(64) std::atomic<size_t> writePos_{ 0 };
+	alignas(64) size_t readPos_ = 0;
+};
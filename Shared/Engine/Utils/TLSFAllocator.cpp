@@ -0,0 +1,270 @@
+#include <Utils/TLSFAllocator.hpp>
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static uint32_t findFirstSetBit(uint64_t v)
+{
+#if defined(_MSC_VER)
+	unsigned long i;
+	_BitScanForward64(&i, v);
+	return uint32_t(i);
+#else
+	return uint32_t(__builtin_ctzll(v));
+#endif
+}
+
+static uint32_t findLastSetBit(uint64_t v)
+{
+#if defined(_MSC_VER)
+	unsigned long i;
+	_BitScanReverse64(&i, v);
+	return uint32_t(i);
+#else
+	return 63u - uint32_t(__builtin_clzll(v));
+#endif
+}
+
+void TLSFAllocator::getClass(uint64_t size, uint32_t& fl, uint32_t& sl)
+{
+	if (size < SL_COUNT)
+	{
+		fl = 0;
+		sl = uint32_t(size);
+		return;
+	}
+
+	const uint32_t f = findLastSetBit(size);
+	fl = f - SL_LOG2 + 1;
+	sl = uint32_t(size >> (f - SL_LOG2)) - SL_COUNT;
+}
+
+void TLSFAllocator::reset(uint64_t size)
+{
+	ranges_.clear();
+	unusedRanges_.clear();
+
+	flBitmap_ = 0;
+	std::fill(std::begin(slBitmaps_), std::end(slBitmaps_), 0u);
+	for (auto& heads : heads_)
+		std::fill(std::begin(heads), std::end(heads), INVALID_HANDLE);
+
+	size_ = size;
+	used_ = 0;
+	numAllocations_ = 0;
+
+	if (size == 0)
+		return;
+
+	const uint32_t r = newRange();
+	ranges_[r].offset_ = 0;
+	ranges_[r].size_ = size;
+	insertFree(r);
+}
+
+uint32_t TLSFAllocator::newRange()
+{
+	if (!unusedRanges_.empty())
+	{
+		const uint32_t r = unusedRanges_.back();
+		unusedRanges_.pop_back();
+		ranges_[r] = Range();
+		return r;
+	}
+
+	ranges_.emplace_back();
+	return uint32_t(ranges_.size() - 1);
+}
+
+void TLSFAllocator::deleteRange(uint32_t r)
+{
+	ranges_[r] = Range();
+	unusedRanges_.push_back(r);
+}
+
+void TLSFAllocator::insertFree(uint32_t r)
+{
+	uint32_t fl, sl;
+	getClass(ranges_[r].size_, fl, sl);
+
+	Range& range = ranges_[r];
+	range.free_ = true;
+	range.prevFree_ = INVALID_HANDLE;
+	range.nextFree_ = heads_[fl][sl];
+
+	if (range.nextFree_ != INVALID_HANDLE)
+		ranges_[range.nextFree_].prevFree_ = r;
+
+	heads_[fl][sl] = r;
+	slBitmaps_[fl] |= 1u << sl;
+	flBitmap_ |= 1ull << fl;
+}
+
+void TLSFAllocator::removeFree(uint32_t r)
+{
+	uint32_t fl, sl;
+	getClass(ranges_[r].size_, fl, sl);
+
+	Range& range = ranges_[r];
+
+	if (range.prevFree_ != INVALID_HANDLE)
+		ranges_[range.prevFree_].nextFree_ = range.nextFree_;
+	else
+		heads_[fl][sl] = range.nextFree_;
+
+	if (range.nextFree_ != INVALID_HANDLE)
+		ranges_[range.nextFree_].prevFree_ = range.prevFree_;
+
+	range.free_ = false;
+	range.prevFree_ = INVALID_HANDLE;
+	range.nextFree_ = INVALID_HANDLE;
+
+	if (heads_[fl][sl] == INVALID_HANDLE)
+	{
+		slBitmaps_[fl] &= ~(1u << sl);
+		if (slBitmaps_[fl] == 0)
+			flBitmap_ &= ~(1ull << fl);
+	}
+}
+
+void TLSFAllocator::split(uint32_t r, uint64_t size)
+{
+	// newRange() may reallocate [ranges_]
+	const uint32_t n = newRange();
+
+	Range& a = ranges_[r];
+	Range& b = ranges_[n];
+
+	b.offset_ = a.offset_ + size;
+	b.size_ = a.size_ - size;
+	b.prevPhys_ = r;
+	b.nextPhys_ = a.nextPhys_;
+
+	if (a.nextPhys_ != INVALID_HANDLE)
+		ranges_[a.nextPhys_].prevPhys_ = n;
+
+	a.size_ = size;
+	a.nextPhys_ = n;
+}
+
+uint32_t TLSFAllocator::findFree(uint64_t size) const
+{
+	// round up to the next class boundary, so that every range of the class found is large enough
+	if (size >= SL_COUNT)
+		size += (1ull << (findLastSetBit(size) - SL_LOG2)) - 1;
+
+	uint32_t fl, sl;
+	getClass(size, fl, sl);
+
+	if (fl >= FL_COUNT)
+		return INVALID_HANDLE;
+
+	uint32_t slMap = slBitmaps_[fl] & (~0u << sl);
+
+	if (slMap == 0)
+	{
+		const uint64_t flMap = (fl + 1 < 64) ? flBitmap_ & (~0ull << (fl + 1)) : 0;
+		if (flMap == 0)
+			return INVALID_HANDLE;
+
+		fl = findFirstSetBit(flMap);
+		slMap = slBitmaps_[fl];
+	}
+
+	return heads_[fl][findFirstSetBit(slMap)];
+}
+
+bool TLSFAllocator::allocate(uint64_t size, uint64_t alignment, uint64_t& offset, uint32_t& handle)
+{
+	size = std::max<uint64_t>(size, 1);
+	alignment = std::max<uint64_t>(alignment, 1);
+
+	uint32_t r = findFree(size + alignment - 1);
+	if (r == INVALID_HANDLE)
+		return false;
+
+	removeFree(r);
+
+	// the alignment padding stays free in front of the allocation
+	const uint64_t aligned = (ranges_[r].offset_ + alignment - 1) & ~(alignment - 1);
+	const uint64_t padding = aligned - ranges_[r].offset_;
+
+	if (padding > 0)
+	{
+		split(r, padding);
+		const uint32_t front = r;
+		r = ranges_[r].nextPhys_;
+		insertFree(front);
+	}
+
+	if (ranges_[r].size_ > size)
+	{
+		split(r, size);
+		insertFree(ranges_[r].nextPhys_);
+	}
+
+	used_ += size;
+	numAllocations_++;
+
+	offset = ranges_[r].offset_;
+	handle = r;
+	return true;
+}
+
+void TLSFAllocator::free(uint32_t handle)
+{
+	uint32_t r = handle;
+
+	used_ -= ranges_[r].size_;
+	numAllocations_--;
+
+	const uint32_t prev = ranges_[r].prevPhys_;
+	if (prev != INVALID_HANDLE && ranges_[prev].free_)
+	{
+		removeFree(prev);
+
+		ranges_[prev].size_ += ranges_[r].size_;
+		ranges_[prev].nextPhys_ = ranges_[r].nextPhys_;
+		if (ranges_[r].nextPhys_ != INVALID_HANDLE)
+			ranges_[ranges_[r].nextPhys_].prevPhys_ = prev;
+
+		deleteRange(r);
+		r = prev;
+	}
+
+	const uint32_t next = ranges_[r].nextPhys_;
+	if (next != INVALID_HANDLE && ranges_[next].free_)
+	{
+		removeFree(next);
+
+		ranges_[r].size_ += ranges_[next].size_;
+		ranges_[r].nextPhys_ = ranges_[next].nextPhys_;
+		if (ranges_[next].nextPhys_ != INVALID_HANDLE)
+			ranges_[ranges_[next].nextPhys_].prevPhys_ = r;
+
+		deleteRange(next);
+	}
+
+	insertFree(r);
+}
+
+uint64_t TLSFAllocator::getLargestFreeRange() const
+{
+	uint64_t largest = 0;
+	for (const Range& r : ranges_)
+		if (r.free_)
+			largest = std::max(largest, r.size_);
+	return largest;
+}
+
+uint32_t TLSFAllocator::getNumFreeRanges() const
+{
+	uint32_t count = 0;
+	for (const Range& r : ranges_)
+		if (r.free_)
+			count++;
+	return count;
+}
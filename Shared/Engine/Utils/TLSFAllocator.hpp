@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+	Two-level segregated fit allocator of offset ranges inside a fixed-size block (the memory itself lives elsewhere, e.g. in a VkDeviceMemory).
+
+	Free ranges are kept in size classes: the first level is the power of two of the size, the second level splits every
+	power of two into 16 linear steps. Two bitmaps find the smallest non-empty class which surely fits a request in O(1),
+	freed ranges are merged with their free physical neighbours right away.
+*/
+class TLSFAllocator
+{
+public:
+	static constexpr uint32_t INVALID_HANDLE = UINT32_MAX;
+
+	explicit TLSFAllocator(uint64_t size = 0) { reset(size); }
+
+	/* Forget all the allocations, the whole [size] becomes one free range */
+	void reset(uint64_t size);
+
+	/* [alignment] is a power of two. Returns false if no free range fits, [handle] is passed to free() later */
+	bool allocate(uint64_t size, uint64_t alignment, uint64_t& offset, uint32_t& handle);
+
+	void free(uint32_t handle);
+
+	uint64_t getSize() const { return size_; }
+	uint64_t getUsedSize() const { return used_; }
+	uint32_t getNumAllocations() const { return numAllocations_; }
+
+	/* Linear in the number of ranges, meant for statistics only */
+	uint64_t getLargestFreeRange() const;
+	uint32_t getNumFreeRanges() const;
+
+private:
+	static constexpr uint32_t SL_LOG2 = 4;
+	static constexpr uint32_t SL_COUNT = 1u << SL_LOG2;
+	static constexpr uint32_t FL_COUNT = 64 - SL_LOG2 + 1;
+
+	struct Range
+	{
+		uint64_t offset_ = 0;
+		uint64_t size_ = 0;
+		// neighbours in the block (by offset) and in the free list of the size class
+		uint32_t prevPhys_ = INVALID_HANDLE;
+		uint32_t nextPhys_ = INVALID_HANDLE;
+		uint32_t prevFree_ = INVALID_HANDLE;
+		uint32_t nextFree_ = INVALID_HANDLE;
+		bool free_ = false;
+	};
+
+	static void getClass(uint64_t size, uint32_t& fl, uint32_t& sl);
+
+	uint32_t newRange();
+	void deleteRange(uint32_t r);
+
+	void insertFree(uint32_t r);
+	void removeFree(uint32_t r);
+
+	/* Split [size] bytes off the start of [r], the rest becomes a new free range */
+	void split(uint32_t r, uint64_t size);
+	uint32_t findFree(uint64_t size) const;
+
+	std::vector<Range> ranges_;
+	std::vector<uint32_t> unusedRanges_;
+
+	uint64_t flBitmap_ = 0;
+	uint32_t slBitmaps_[FL_COUNT] = {};
+	uint32_t heads_[FL_COUNT][SL_COUNT];
+
+	uint64_t size_ = 0;
+	uint64_t used_ = 0;
+	uint32_t numAllocations_ = 0;
+};
@@ -0,0 +1,216 @@
+#include <Utils/UtilsCulling.hpp>
+#include <Utils/UtilsSIMD.hpp>
+
+#include <taskflow/taskflow.hpp>
+#include <taskflow/algorithm/for_each.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+	constexpr size_t kNumPlanes = 6;
+
+	/* Must be a multiple of 32, so that chunks never share a word of the visibility mask */
+	constexpr size_t kCullingChunkSize = 2048;
+
+	struct CullingParams
+	{
+		glm::vec4 planes[kNumPlanes];
+		glm::vec4 absPlanes[kNumPlanes];
+
+		bool useFrustumBox = false;
+		glm::vec3 frustumMin;
+		glm::vec3 frustumMax;
+	};
+
+	// returns a 4-bit mask of the visible boxes in the group [g * 4, g * 4 + 4)
+	uint32_t cullGroup(CullingBoxes& boxes, const CullingParams& p, size_t g)
+	{
+		const size_t i = g * 4;
+		const uint32_t firstPlane = boxes.lastRejectedPlane_[g];
+
+#if UTILS_SIMD_SSE
+		const __m128 cx = _mm_loadu_ps(&boxes.centerX_[i]);
+		const __m128 cy = _mm_loadu_ps(&boxes.centerY_[i]);
+		const __m128 cz = _mm_loadu_ps(&boxes.centerZ_[i]);
+		const __m128 ex = _mm_loadu_ps(&boxes.extentX_[i]);
+		const __m128 ey = _mm_loadu_ps(&boxes.extentY_[i]);
+		const __m128 ez = _mm_loadu_ps(&boxes.extentZ_[i]);
+
+		__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+		if (p.useFrustumBox)
+		{
+			// separating axis test against the bounding box of the frustum corners
+			const __m128 overlapX = _mm_and_ps(
+				_mm_cmple_ps(_mm_sub_ps(cx, ex), _mm_set1_ps(p.frustumMax.x)),
+				_mm_cmpge_ps(_mm_add_ps(cx, ex), _mm_set1_ps(p.frustumMin.x)));
+			const __m128 overlapY = _mm_and_ps(
+				_mm_cmple_ps(_mm_sub_ps(cy, ey), _mm_set1_ps(p.frustumMax.y)),
+				_mm_cmpge_ps(_mm_add_ps(cy, ey), _mm_set1_ps(p.frustumMin.y)));
+			const __m128 overlapZ = _mm_and_ps(
+				_mm_cmple_ps(_mm_sub_ps(cz, ez), _mm_set1_ps(p.frustumMax.z)),
+				_mm_cmpge_ps(_mm_add_ps(cz, ez), _mm_set1_ps(p.frustumMin.z)));
+			visible = _mm_and_ps(visible, _mm_and_ps(overlapX, _mm_and_ps(overlapY, overlapZ)));
+		}
+
+		// start with the plane which rejected this group last frame (plane coherency)
+		for (uint32_t k = 0; k < kNumPlanes && _mm_movemask_ps(visible); k++)
+		{
+			const uint32_t pi = (firstPlane + k) % kNumPlanes;
+			const glm::vec4& n = p.planes[pi];
+			const glm::vec4& a = p.absPlanes[pi];
+
+			// distance of the center + projected extent, the box is outside if the sum is negative
+			const __m128 d = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(n.x)), _mm_mul_ps(cy, _mm_set1_ps(n.y))),
+				_mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(n.z)), _mm_set1_ps(n.w)));
+			const __m128 r = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(a.x)), _mm_mul_ps(ey, _mm_set1_ps(a.y))),
+				_mm_mul_ps(ez, _mm_set1_ps(a.z)));
+
+			const __m128 inside = _mm_cmpge_ps(_mm_add_ps(d, r), _mm_setzero_ps());
+			const int before = _mm_movemask_ps(visible);
+			visible = _mm_and_ps(visible, inside);
+
+			if (_mm_movemask_ps(visible) != before)
+				boxes.lastRejectedPlane_[g] = (uint8_t)pi;
+		}
+
+		return (uint32_t)_mm_movemask_ps(visible);
+#else
+		uint32_t mask = 0;
+		for (size_t j = 0; j < 4; j++)
+		{
+			const glm::vec3 c(boxes.centerX_[i + j], boxes.centerY_[i + j], boxes.centerZ_[i + j]);
+			const glm::vec3 e(boxes.extentX_[i + j], boxes.extentY_[i + j], boxes.extentZ_[i + j]);
+
+			bool visible = true;
+			if (p.useFrustumBox)
+				visible = glm::all(glm::lessThanEqual(c - e, p.frustumMax)) && glm::all(glm::greaterThanEqual(c + e, p.frustumMin));
+
+			for (uint32_t k = 0; k < kNumPlanes && visible; k++)
+			{
+				const uint32_t pi = (firstPlane + k) % kNumPlanes;
+				const float d = glm::dot(glm::vec3(p.planes[pi]), c) + p.planes[pi].w;
+				const float r = glm::dot(glm::vec3(p.absPlanes[pi]), e);
+				if (d + r < 0.0f)
+				{
+					visible = false;
+					boxes.lastRejectedPlane_[g] = (uint8_t)pi;
+				}
+			}
+
+			mask |= visible ? (1u << j) : 0u;
+		}
+		return mask;
+#endif
+	}
+
+	uint32_t cullRange(CullingBoxes& boxes, const CullingParams& p, size_t firstGroup, size_t lastGroup, std::vector<uint32_t>& visibilityMask)
+	{
+		uint32_t numVisible = 0;
+
+		for (size_t g = firstGroup; g < lastGroup; g++)
+		{
+			uint32_t mask = cullGroup(boxes, p, g);
+			// never report the padding boxes of the last group
+			if (g * 4 + 4 > boxes.size())
+				mask &= (1u << (boxes.size() - g * 4)) - 1u;
+			// 8 groups of 4 boxes per 32-bit word
+			const size_t word = g >> 3;
+			const uint32_t shift = uint32_t(g & 7) * 4;
+			visibilityMask[word] = (visibilityMask[word] & ~(0xFu << shift)) | (mask << shift);
+			numVisible += (uint32_t)((mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1));
+		}
+
+		return numVisible;
+	}
+}
+
+void CullingBoxes::resize(size_t count)
+{
+	const size_t paddedCount = (count + 3) & ~size_t(3);
+
+	// padding boxes are empty and placed far away from everything, so they are always culled
+	const float kFar = std::numeric_limits<float>::max();
+	const float kEmpty = -1.0f;
+
+	centerX_.resize(paddedCount, kFar);
+	centerY_.resize(paddedCount, kFar);
+	centerZ_.resize(paddedCount, kFar);
+	extentX_.resize(paddedCount, kEmpty);
+	extentY_.resize(paddedCount, kEmpty);
+	extentZ_.resize(paddedCount, kEmpty);
+	lastRejectedPlane_.resize(paddedCount / 4, 0);
+
+	for (size_t i = count; i < paddedCount; i++)
+	{
+		centerX_[i] = centerY_[i] = centerZ_[i] = kFar;
+		extentX_[i] = extentY_[i] = extentZ_[i] = kEmpty;
+	}
+
+	count_ = count;
+}
+
+void CullingBoxes::set(size_t i, const BoundingBox& box)
+{
+	const glm::vec3 c = box.getCenter();
+	const glm::vec3 e = 0.5f * box.getSize();
+
+	centerX_[i] = c.x;
+	centerY_[i] = c.y;
+	centerZ_[i] = c.z;
+	extentX_[i] = e.x;
+	extentY_[i] = e.y;
+	extentZ_[i] = e.z;
+}
+
+uint32_t cullBoxes(CullingBoxes& boxes, const glm::vec4* frustumPlanes, const glm::vec4* frustumCorners,
+	std::vector<uint32_t>& visibilityMask, tf::Executor* executor)
+{
+	CullingParams p;
+	for (size_t i = 0; i < kNumPlanes; i++)
+	{
+		p.planes[i] = frustumPlanes[i];
+		p.absPlanes[i] = glm::abs(frustumPlanes[i]);
+	}
+
+	if (frustumCorners)
+	{
+		p.useFrustumBox = true;
+		p.frustumMin = glm::vec3(frustumCorners[0]);
+		p.frustumMax = glm::vec3(frustumCorners[0]);
+		for (int i = 1; i < 8; i++)
+		{
+			p.frustumMin = glm::min(p.frustumMin, glm::vec3(frustumCorners[i]));
+			p.frustumMax = glm::max(p.frustumMax, glm::vec3(frustumCorners[i]));
+		}
+	}
+
+	const size_t numGroups = (boxes.size() + 3) / 4;
+	visibilityMask.assign((boxes.size() + 31) / 32, 0u);
+
+	if (!executor || boxes.size() <= kCullingChunkSize)
+		return cullRange(boxes, p, 0, numGroups, visibilityMask);
+
+	const size_t kGroupsPerChunk = kCullingChunkSize / 4;
+	const uint32_t numChunks = (uint32_t)((numGroups + kGroupsPerChunk - 1) / kGroupsPerChunk);
+
+	std::vector<uint32_t> chunkVisible(numChunks, 0);
+
+	tf::Taskflow taskflow;
+	taskflow.for_each_index(0u, numChunks, 1u, [&](uint32_t chunk)
+	{
+		const size_t first = chunk * kGroupsPerChunk;
+		chunkVisible[chunk] = cullRange(boxes, p, first, std::min(first + kGroupsPerChunk, numGroups), visibilityMask);
+	});
+	executor->run(taskflow).wait();
+
+	uint32_t numVisible = 0;
+	for (uint32_t v : chunkVisible)
+		numVisible += v;
+
+	return numVisible;
+}
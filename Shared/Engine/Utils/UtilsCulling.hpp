@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Utils/UtilsMath.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace tf
+{
+	class Executor;
+}
+
+/**
+	Axis-aligned boxes in center/extent form stored as structure-of-arrays, so 4 boxes can be tested against a plane at once.
+	All arrays are padded to a multiple of 4 with empty boxes far outside of any frustum.
+*/
+struct CullingBoxes
+{
+	std::vector<float> centerX_;
+	std::vector<float> centerY_;
+	std::vector<float> centerZ_;
+	std::vector<float> extentX_;
+	std::vector<float> extentY_;
+	std::vector<float> extentZ_;
+
+	/* Index of the frustum plane which rejected a group of 4 boxes the last time (tested first next time) */
+	std::vector<uint8_t> lastRejectedPlane_;
+
+	size_t count_ = 0;
+
+	size_t size() const { return count_; }
+
+	void resize(size_t count);
+	void set(size_t i, const BoundingBox& box);
+
+	void clear() { resize(0); }
+};
+
+inline bool isVisible(const std::vector<uint32_t>& visibilityMask, size_t i)
+{
+	return (visibilityMask[i >> 5] >> (i & 31)) & 1u;
+}
+
+/**
+	Test all the boxes against the frustum planes (in the getFrustumPlanes() form) and write a bitmask with 1 bit per box.
+	If the frustum corners are given, boxes which are separated from the frustum bounding box are rejected too
+	(the same tests isBoxInFrustum() does). Large lists are split into chunks processed on the [executor] workers.
+	Returns the number of visible boxes.
+*/
+uint32_t cullBoxes(CullingBoxes& boxes, const glm::vec4* frustumPlanes, const glm::vec4* frustumCorners,
+	std::vector<uint32_t>& visibilityMask, tf::Executor* executor = nullptr);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/* Final mix of MurmurHash3 */
+inline uint64_t mix64(uint64_t v)
+{
+	v ^= v >> 33;
+	v *= 0xFF51AFD7ED558CCDull;
+	v ^= v >> 33;
+	v *= 0xC4CEB9FE1A85EC53ull;
+	v ^= v >> 33;
+	return v;
+}
+
+/* Non-cryptographic 64-bit hash used for cache keys, 8 bytes per step so that whole source files can be hashed on every load */
+inline uint64_t hashBytes(const void* bytes, size_t size, uint64_t seed)
+{
+	const uint64_t kMul = 0x9E3779B97F4A7C15ull;
+	const uint8_t* data = static_cast<const uint8_t*>(bytes);
+
+	uint64_t h = seed ^ (uint64_t(size) * kMul);
+	for (; size >= 8; data += 8, size -= 8)
+	{
+		uint64_t v;
+		memcpy(&v, data, 8);
+		h = (h ^ mix64(v)) * kMul;
+	}
+
+	uint64_t tail = 0;
+	memcpy(&tail, data, size);
+	return mix64(h ^ mix64(tail));
+}
@@ -138,21 +138,16 @@ inline bool isBoxInFrustum(glm::vec4* frustumPlanes, glm::vec4* frustumCorners,
 
 inline BoundingBox combineBoxes(const std::vector<BoundingBox>& boxes)
 {
-	std::vector<vec3> allPoints;
-	allPoints.reserve(boxes.size() * 8);
+	BoundingBox result;
+	result.min_ = vec3(std::numeric_limits<float>::max());
+	result.max_ = vec3(std::numeric_limits<float>::lowest());
 
+	// the corners of a box never extend its own min/max, so a direct reduction is enough
 	for (const auto& b : boxes)
 	{
-		allPoints.emplace_back(b.min_.x, b.min_.y, b.min_.z);
-		allPoints.emplace_back(b.min_.x, b.min_.y, b.max_.z);
-		allPoints.emplace_back(b.min_.x, b.max_.y, b.min_.z);
-		allPoints.emplace_back(b.min_.x, b.max_.y, b.max_.z);
-
-		allPoints.emplace_back(b.max_.x, b.min_.y, b.min_.z);
-		allPoints.emplace_back(b.max_.x, b.min_.y, b.max_.z);
-		allPoints.emplace_back(b.max_.x, b.max_.y, b.min_.z);
-		allPoints.emplace_back(b.max_.x, b.max_.y, b.max_.z);
+		result.min_ = glm::min(result.min_, b.min_);
+		result.max_ = glm::max(result.max_, b.max_);
 	}
 
-	return BoundingBox(allPoints.data(), allPoints.size());
+	return result;
 }
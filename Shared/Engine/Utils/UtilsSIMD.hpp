@@ -0,0 +1,109 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+/**
+	SSE helpers for the hot CPU-side loops (scene graph, culling, image processing).
+	Every kernel has a scalar fallback, define UTILS_SIMD_DISABLE to force it.
+*/
+
+#if !defined(UTILS_SIMD_DISABLE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define UTILS_SIMD_SSE 1
+#include <emmintrin.h>
+#else
+#define UTILS_SIMD_SSE 0
+#endif
+
+static_assert(sizeof(glm::mat4) == sizeof(float) * 16, "glm::mat4 is expected to be tightly packed");
+
+/**
+	out = a * b (column-major, same convention as glm)
+	The summation order matches the generic glm implementation, so the result is bit-identical to [a * b]
+	as long as the compiler does not contract the scalar version into FMAs.
+	[out] may alias [a] or [b].
+*/
+inline void multiplyMat4(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+#if UTILS_SIMD_SSE
+	const float* pa = &a[0][0];
+	const float* pb = &b[0][0];
+
+	const __m128 a0 = _mm_loadu_ps(pa + 0);
+	const __m128 a1 = _mm_loadu_ps(pa + 4);
+	const __m128 a2 = _mm_loadu_ps(pa + 8);
+	const __m128 a3 = _mm_loadu_ps(pa + 12);
+
+	__m128 r[4];
+	for (int i = 0; i < 4; i++)
+	{
+		const __m128 col = _mm_loadu_ps(pb + i * 4);
+		const __m128 b0 = _mm_shuffle_ps(col, col, _MM_SHUFFLE(0, 0, 0, 0));
+		const __m128 b1 = _mm_shuffle_ps(col, col, _MM_SHUFFLE(1, 1, 1, 1));
+		const __m128 b2 = _mm_shuffle_ps(col, col, _MM_SHUFFLE(2, 2, 2, 2));
+		const __m128 b3 = _mm_shuffle_ps(col, col, _MM_SHUFFLE(3, 3, 3, 3));
+
+		r[i] = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, b0), _mm_mul_ps(a1, b1)), _mm_mul_ps(a2, b2)), _mm_mul_ps(a3, b3));
+	}
+
+	float* po = &out[0][0];
+	for (int i = 0; i < 4; i++)
+		_mm_storeu_ps(po + i * 4, r[i]);
+#else
+	out = a * b;
+#endif
+}
+
+/**
+	Grow [vmin, vmax] by [count] points which start every [stride] floats (e.g. xyz in an interleaved vertex buffer).
+	The SIMD path reads 4 floats per point, so it is only used for strides >= 4.
+*/
+inline void minMaxStridedPoints(const float* points, size_t count, size_t stride, glm::vec3& vmin, glm::vec3& vmax)
+{
+	if (count == 0)
+		return;
+
+#if UTILS_SIMD_SSE
+	if (stride >= 4)
+	{
+		__m128 mn = _mm_setr_ps(vmin.x, vmin.y, vmin.z, 0.0f);
+		__m128 mx = _mm_setr_ps(vmax.x, vmax.y, vmax.z, 0.0f);
+
+		// two independent accumulators to hide the latency of min/max
+		__m128 mn1 = mn;
+		__m128 mx1 = mx;
+
+		size_t i = 0;
+		for (; i + 1 < count; i += 2)
+		{
+			const __m128 p0 = _mm_loadu_ps(points + i * stride);
+			const __m128 p1 = _mm_loadu_ps(points + (i + 1) * stride);
+			mn = _mm_min_ps(mn, p0);
+			mx = _mm_max_ps(mx, p0);
+			mn1 = _mm_min_ps(mn1, p1);
+			mx1 = _mm_max_ps(mx1, p1);
+		}
+		if (i < count)
+		{
+			const __m128 p = _mm_loadu_ps(points + i * stride);
+			mn = _mm_min_ps(mn, p);
+			mx = _mm_max_ps(mx, p);
+		}
+
+		alignas(16) float resMin[4];
+		alignas(16) float resMax[4];
+		_mm_store_ps(resMin, _mm_min_ps(mn, mn1));
+		_mm_store_ps(resMax, _mm_max_ps(mx, mx1));
+
+		vmin = glm::vec3(resMin[0], resMin[1], resMin[2]);
+		vmax = glm::vec3(resMax[0], resMax[1], resMax[2]);
+		return;
+	}
+#endif
+
+	for (size_t i = 0; i != count; i++)
+	{
+		const float* p = points + i * stride;
+		vmin = glm::min(vmin, glm::vec3(p[0], p[1], p[2]));
+		vmax = glm::max(vmax, glm::vec3(p[0], p[1], p[2]));
+	}
+}
@@ -21,7 +21,12 @@
 #endif
 
 #include <UtilsCubemap.hpp>
+#include <BitmapView.hpp>
 #include <Utils/UtilsMath.hpp>
+#include <Utils/UtilsSIMD.hpp>
+
+#include <taskflow/taskflow.hpp>
+#include <taskflow/algorithm/for_each.hpp>
 
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
@@ -54,7 +59,109 @@ vec2 hammersley2d(uint32_t i, uint32_t N)
 	return vec2(float(i) / float(N), radicalInverse_VdC(i));
 }
 
-void convolveDiffuse(const vec3* data, int srcW, int srcH, int dstW, int dstH, vec3* output, int numMonteCarloSamples)
+namespace
+{
+	/* Directions and radiance of the Monte Carlo samples as SoA arrays, padded with zero directions to a multiple of 4 */
+	struct DiffuseSamples
+	{
+		std::vector<float> dirX, dirY, dirZ;
+		std::vector<float> r, g, b;
+		int count = 0;
+	};
+
+	vec3 equirectDirection(float theta, float phi)
+	{
+		return vec3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
+	}
+
+	// the samples do not depend on the output pixel, so the trigonometry and the texel fetches are done only once
+	DiffuseSamples buildDiffuseSamples(const vec3* scratch, int srcW, int srcH, int numMonteCarloSamples)
+	{
+		DiffuseSamples s;
+		s.count = (numMonteCarloSamples + 3) & ~3;
+		s.dirX.resize(s.count, 0.0f);
+		s.dirY.resize(s.count, 0.0f);
+		s.dirZ.resize(s.count, 0.0f);
+		s.r.resize(s.count, 0.0f);
+		s.g.resize(s.count, 0.0f);
+		s.b.resize(s.count, 0.0f);
+
+		for (int i = 0; i != numMonteCarloSamples; i++)
+		{
+			const vec2 h = hammersley2d(i, numMonteCarloSamples);
+			const int x1 = int(floor(h.x * srcW));
+			const int y1 = int(floor(h.y * srcH));
+			const vec3 V2 = equirectDirection(float(y1) / float(srcH) * Math::PI, float(x1) / float(srcW) * Math::TWOPI);
+			const vec3 c = scratch[y1 * srcW + x1];
+
+			s.dirX[i] = V2.x;
+			s.dirY[i] = V2.y;
+			s.dirZ[i] = V2.z;
+			s.r[i] = c.x;
+			s.g[i] = c.y;
+			s.b[i] = c.z;
+		}
+
+		return s;
+	}
+
+	vec3 convolvePixel(const DiffuseSamples& s, const vec3& V1)
+	{
+#if UTILS_SIMD_SSE
+		const __m128 vx = _mm_set1_ps(V1.x);
+		const __m128 vy = _mm_set1_ps(V1.y);
+		const __m128 vz = _mm_set1_ps(V1.z);
+		const __m128 threshold = _mm_set1_ps(0.01f);
+
+		__m128 r = _mm_setzero_ps();
+		__m128 g = _mm_setzero_ps();
+		__m128 b = _mm_setzero_ps();
+		__m128 w = _mm_setzero_ps();
+
+		for (int i = 0; i != s.count; i += 4)
+		{
+			__m128 D = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(vx, _mm_loadu_ps(&s.dirX[i])),
+				_mm_mul_ps(vy, _mm_loadu_ps(&s.dirY[i]))),
+				_mm_mul_ps(vz, _mm_loadu_ps(&s.dirZ[i])));
+			// samples at grazing angles (and the zero padding) are skipped
+			D = _mm_and_ps(D, _mm_cmpgt_ps(D, threshold));
+
+			r = _mm_add_ps(r, _mm_mul_ps(D, _mm_loadu_ps(&s.r[i])));
+			g = _mm_add_ps(g, _mm_mul_ps(D, _mm_loadu_ps(&s.g[i])));
+			b = _mm_add_ps(b, _mm_mul_ps(D, _mm_loadu_ps(&s.b[i])));
+			w = _mm_add_ps(w, D);
+		}
+
+		alignas(16) float sum[4][4];
+		_mm_store_ps(sum[0], r);
+		_mm_store_ps(sum[1], g);
+		_mm_store_ps(sum[2], b);
+		_mm_store_ps(sum[3], w);
+
+		const vec3 color = vec3(
+			(sum[0][0] + sum[0][1]) + (sum[0][2] + sum[0][3]),
+			(sum[1][0] + sum[1][1]) + (sum[1][2] + sum[1][3]),
+			(sum[2][0] + sum[2][1]) + (sum[2][2] + sum[2][3]));
+		const float weight = (sum[3][0] + sum[3][1]) + (sum[3][2] + sum[3][3]);
+#else
+		vec3 color = vec3(0.0f);
+		float weight = 0.0f;
+		for (int i = 0; i != s.count; i++)
+		{
+			const float D = V1.x * s.dirX[i] + V1.y * s.dirY[i] + V1.z * s.dirZ[i];
+			if (D > 0.01f)
+			{
+				color += vec3(s.r[i], s.g[i], s.b[i]) * D;
+				weight += D;
+			}
+		}
+#endif
+		return color / weight;
+	}
+}
+
+void convolveDiffuse(const vec3* data, int srcW, int srcH, int dstW, int dstH, vec3* output, int numMonteCarloSamples, tf::Executor* executor)
 {
 	// only equirectangular maps are supported
 	assert(srcW == 2 * srcH);
@@ -68,36 +175,126 @@ void convolveDiffuse(const vec3* data, int srcW, int srcH, int dstW, int dstH, v
 		reinterpret_cast<float*>(tmp.data()), dstW, dstH, 0, 3,
 		STBIR_ALPHA_CHANNEL_NONE, 0, STBIR_EDGE_CLAMP, STBIR_FILTER_CUBICBSPLINE, STBIR_COLORSPACE_LINEAR, nullptr);
 
-	const vec3* scratch = tmp.data();
-	srcW = dstW;
-	srcH = dstH;
+	const DiffuseSamples samples = buildDiffuseSamples(tmp.data(), dstW, dstH, numMonteCarloSamples);
+
+	std::vector<float> cosPhi(dstW);
+	std::vector<float> sinPhi(dstW);
+	for (int x = 0; x != dstW; x++)
+	{
+		const float phi1 = float(x) / float(dstW) * Math::TWOPI;
+		cosPhi[x] = cos(phi1);
+		sinPhi[x] = sin(phi1);
+	}
+
+	auto convolveRow = [&](int y)
+	{
+		const float theta1 = float(y) / float(dstH) * Math::PI;
+		const float sinTheta = sin(theta1);
+		const float cosTheta = cos(theta1);
+		for (int x = 0; x != dstW; x++)
+			output[y * dstW + x] = convolvePixel(samples, vec3(sinTheta * cosPhi[x], sinTheta * sinPhi[x], cosTheta));
+	};
+
+	if (!executor)
+	{
+		for (int y = 0; y != dstH; y++)
+			convolveRow(y);
+		return;
+	}
+
+	tf::Taskflow taskflow;
+	taskflow.for_each_index(0, dstH, 1, convolveRow);
+	executor->run(taskflow).wait();
+}
+
+void projectToSH9(const vec3* data, int w, int h, vec3 sh[9])
+{
+	for (int i = 0; i != 9; i++)
+		sh[i] = vec3(0.0f);
+
+	// solid angle of a texel is dPhi * dTheta * sin(theta)
+	const float dPhiTheta = (Math::TWOPI / float(w)) * (Math::PI / float(h));
 
+	std::vector<float> cosPhi(w);
+	std::vector<float> sinPhi(w);
+	for (int x = 0; x != w; x++)
+	{
+		const float phi = (float(x) + 0.5f) / float(w) * Math::TWOPI;
+		cosPhi[x] = cos(phi);
+		sinPhi[x] = sin(phi);
+	}
+
+	for (int y = 0; y != h; y++)
+	{
+		const float theta = (float(y) + 0.5f) / float(h) * Math::PI;
+		const float sinTheta = sin(theta);
+		const float z = cos(theta);
+		const float dOmega = dPhiTheta * sinTheta;
+
+		// accumulate every row separately to keep the precision for large maps
+		vec3 row[9] = {};
+		for (int x = 0; x != w; x++)
+		{
+			const float nx = sinTheta * cosPhi[x];
+			const float ny = sinTheta * sinPhi[x];
+			const vec3 c = data[y * w + x];
+
+			row[0] += c * 0.282095f;
+			row[1] += c * (0.488603f * ny);
+			row[2] += c * (0.488603f * z);
+			row[3] += c * (0.488603f * nx);
+			row[4] += c * (1.092548f * nx * ny);
+			row[5] += c * (1.092548f * ny * z);
+			row[6] += c * (0.315392f * (3.0f * z * z - 1.0f));
+			row[7] += c * (1.092548f * nx * z);
+			row[8] += c * (0.546274f * (nx * nx - ny * ny));
+		}
+
+		for (int i = 0; i != 9; i++)
+			sh[i] += row[i] * dOmega;
+	}
+}
+
+vec3 evaluateIrradianceSH9(const vec3 sh[9], const vec3& n)
+{
+	// Ramamoorthi & Hanrahan, "An Efficient Representation for Irradiance Environment Maps":
+	// convolution with the clamped cosine scales the bands by pi, 2pi/3 and pi/4, the result is divided by pi
+	const float A0 = 1.0f;
+	const float A1 = 2.0f / 3.0f;
+	const float A2 = 1.0f / 4.0f;
+
+	const vec3 E =
+		sh[0] * (A0 * 0.282095f) +
+		sh[1] * (A1 * 0.488603f * n.y) +
+		sh[2] * (A1 * 0.488603f * n.z) +
+		sh[3] * (A1 * 0.488603f * n.x) +
+		sh[4] * (A2 * 1.092548f * n.x * n.y) +
+		sh[5] * (A2 * 1.092548f * n.y * n.z) +
+		sh[6] * (A2 * 0.315392f * (3.0f * n.z * n.z - 1.0f)) +
+		sh[7] * (A2 * 1.092548f * n.x * n.z) +
+		sh[8] * (A2 * 0.546274f * (n.x * n.x - n.y * n.y));
+
+	return glm::max(E, vec3(0.0f));
+}
+
+void convolveDiffuseSH9(const vec3* data, int srcW, int srcH, int dstW, int dstH, vec3* output)
+{
+	// only equirectangular maps are supported
+	assert(srcW == 2 * srcH);
+
+	if (srcW != 2 * srcH) return;
+
+	vec3 sh[9];
+	projectToSH9(data, srcW, srcH, sh);
+
+	// the same output parameterization as convolveDiffuse()
 	for (int y = 0; y != dstH; y++)
 	{
-		printf("Line %i...\n", y);
 		const float theta1 = float(y) / float(dstH) * Math::PI;
 		for (int x = 0; x != dstW; x++)
 		{
 			const float phi1 = float(x) / float(dstW) * Math::TWOPI;
-			const vec3 V1 = vec3(sin(theta1) * cos(phi1), sin(theta1) * sin(phi1), cos(theta1));
-			vec3 color = vec3(0.0f);
-			float weight = 0.0f;
-			for (int i = 0; i != numMonteCarloSamples; i++)
-			{
-				const vec2 h = hammersley2d(i, numMonteCarloSamples);
-				const int x1 = int(floor(h.x * srcW));
-				const int y1 = int(floor(h.y * srcH));
-				const float theta2 = float(y1) / float(srcH) * Math::PI;
-				const float phi2 = float(x1) / float(srcW) * Math::TWOPI;
-				const vec3 V2 = vec3(sin(theta2) * cos(phi2), sin(theta2) * sin(phi2), cos(theta2));
-				const float D = std::max(0.0f, glm::dot(V1, V2));
-				if (D > 0.01f)
-				{
-					color += scratch[y1 * srcW + x1] * D;
-					weight += D;
-				}
-			}
-			output[y * dstW + x] = color / weight;
+			output[y * dstW + x] = evaluateIrradianceSH9(sh, equirectDirection(theta1, phi1));
 		}
 	}
 }
@@ -116,17 +313,9 @@ vec3 faceCoordsToXYZ(int i, int j, int faceID, int faceSize)
 	return vec3();
 }
 
-Bitmap convertEquirectangularMapToVerticalCross(const Bitmap& b)
+template<eBitmapFormat Format, int Channels>
+static void convertEquirectangularMapToVerticalCross(ConstBitmapView<Format, Channels> b, BitmapView<Format, Channels> result, int faceSize)
 {
-	if (b.type_ != eBitmapType_2D) return Bitmap();
-
-	const int faceSize = b.w_ / 4;
-
-	const int w = faceSize * 3;
-	const int h = faceSize * 4;
-
-	Bitmap result(w, h, b.comp_, b.fmt_);
-
 	const ivec2 kFaceOffsets[] =
 	{
 		ivec2(faceSize, faceSize * 3),
@@ -137,8 +326,8 @@ Bitmap convertEquirectangularMapToVerticalCross(const Bitmap& b)
 		ivec2(faceSize, faceSize * 2)
 	};
 
-	const int clampW = b.w_ - 1;
-	const int clampH = b.h_ - 1;
+	const int clampW = b.w() - 1;
+	const int clampH = b.h() - 1;
 
 	for (int face = 0; face != 6; face++)
 	{
@@ -172,6 +361,26 @@ Bitmap convertEquirectangularMapToVerticalCross(const Bitmap& b)
 			}
 		};
 	}
+}
+
+Bitmap convertEquirectangularMapToVerticalCross(const Bitmap& b)
+{
+	if (b.type_ != eBitmapType_2D) return Bitmap();
+
+	const int faceSize = b.w_ / 4;
+
+	const int w = faceSize * 3;
+	const int h = faceSize * 4;
+
+	Bitmap result(w, h, b.comp_, b.fmt_);
+
+	// the pixel accessors are resolved at compile time for the actual format
+	dispatchBitmapFormat(b.fmt_, b.comp_, [&](auto format, auto channels)
+	{
+		convertEquirectangularMapToVerticalCross(
+			ConstBitmapView<decltype(format)::value, decltype(channels)::value>(b),
+			BitmapView<decltype(format)::value, decltype(channels)::value>(result), faceSize);
+	});
 
 	return result;
 }
@@ -257,4 +466,212 @@ Bitmap convertVerticalCrossToCubeMapFaces(const Bitmap& b)
 	}
 
 	return cubemap;
-}
\ No newline at end of file
+}
+namespace
+{
+	/* Where every face of convertVerticalCrossToCubeMapFaces() comes from in the vertical cross: the faceCoordsToXYZ() face and whether both axes are flipped */
+	struct CubeFaceSource
+	{
+		int crossFace;
+		bool flip;
+	};
+
+	constexpr CubeFaceSource kCubeFaceSources[6] =
+	{
+		{ 1, false },
+		{ 3, false },
+		{ 4, true },
+		{ 5, true },
+		{ 0, true },
+		{ 2, false },
+	};
+
+	inline vec4 fetchTexel(const float* p, int comp)
+	{
+		return vec4(p[0], comp > 1 ? p[1] : 0.0f, comp > 2 ? p[2] : 0.0f, comp > 3 ? p[3] : 1.0f);
+	}
+
+	inline void storeTexel(float* p, int comp, const vec4& c)
+	{
+		p[0] = c.x;
+		if (comp > 1) p[1] = c.y;
+		if (comp > 2) p[2] = c.z;
+		if (comp > 3) p[3] = c.w;
+	}
+
+	void convertCubeFaceRow(const float* src, int w, int h, int srcComp, float* dst, int dstComp, int faceSize, int face, int j)
+	{
+		const CubeFaceSource source = kCubeFaceSources[face];
+		const float* srcEnd = src + size_t(w) * h * srcComp;
+
+		const int clampW = w - 1;
+		const int clampH = h - 1;
+
+		float* out = dst + ((size_t(face) * faceSize + j) * faceSize) * dstComp;
+
+		for (int i = 0; i != faceSize; i++, out += dstComp)
+		{
+			const int ci = source.flip ? faceSize - 1 - i : i;
+			const int cj = source.flip ? faceSize - 1 - j : j;
+
+			const vec3 P = faceCoordsToXYZ(ci, cj, source.crossFace, faceSize);
+			const float R = hypot(P.x, P.y);
+			const float theta = atan2(P.y, P.x);
+			const float phi = atan2(P.z, R);
+			//	float point source coordinates
+			const float Uf = float(2.0f * faceSize * (theta + M_PI) / M_PI);
+			const float Vf = float(2.0f * faceSize * (M_PI / 2.0f - phi) / M_PI);
+			// 4-samples for bilinear interpolation
+			const int U1 = clamp(int(floor(Uf)), 0, clampW);
+			const int V1 = clamp(int(floor(Vf)), 0, clampH);
+			const int U2 = clamp(U1 + 1, 0, clampW);
+			const int V2 = clamp(V1 + 1, 0, clampH);
+			// fractional part
+			const float s = Uf - U1;
+			const float t = Vf - V1;
+
+			const float* pA = src + (size_t(V1) * w + U1) * srcComp;
+			const float* pB = src + (size_t(V1) * w + U2) * srcComp;
+			const float* pC = src + (size_t(V2) * w + U1) * srcComp;
+			const float* pD = src + (size_t(V2) * w + U2) * srcComp;
+
+			const float wA = (1 - s) * (1 - t);
+			const float wB = s * (1 - t);
+			const float wC = (1 - s) * t;
+			const float wD = s * t;
+
+#if UTILS_SIMD_SSE
+			// [pD] has the highest address, the last texel of a 3-component image cannot be read with a 4-float load
+			if (srcComp == 4 || (srcComp == 3 && pD + 4 <= srcEnd))
+			{
+				__m128 c = _mm_mul_ps(_mm_loadu_ps(pA), _mm_set1_ps(wA));
+				c = _mm_add_ps(c, _mm_mul_ps(_mm_loadu_ps(pB), _mm_set1_ps(wB)));
+				c = _mm_add_ps(c, _mm_mul_ps(_mm_loadu_ps(pC), _mm_set1_ps(wC)));
+				c = _mm_add_ps(c, _mm_mul_ps(_mm_loadu_ps(pD), _mm_set1_ps(wD)));
+
+				alignas(16) float color[4];
+				_mm_store_ps(color, c);
+				storeTexel(out, dstComp, vec4(color[0], color[1], color[2], srcComp > 3 ? color[3] : 1.0f));
+				continue;
+			}
+#endif
+			const vec4 color =
+				fetchTexel(pA, srcComp) * wA + fetchTexel(pB, srcComp) * wB +
+				fetchTexel(pC, srcComp) * wC + fetchTexel(pD, srcComp) * wD;
+			storeTexel(out, dstComp, color);
+		}
+	}
+}
+
+void convertEquirectangularMapToCubeMapFaces(const float* src, int w, int h, int srcComp, float* dst, int dstComp, tf::Executor* executor)
+{
+	const int faceSize = w / 4;
+	const int numRows = 6 * faceSize;
+
+	auto convertRow = [&](int row)
+	{
+		convertCubeFaceRow(src, w, h, srcComp, dst, dstComp, faceSize, row / faceSize, row % faceSize);
+	};
+
+	if (!executor)
+	{
+		for (int row = 0; row != numRows; row++)
+			convertRow(row);
+		return;
+	}
+
+	tf::Taskflow taskflow;
+	taskflow.for_each_index(0, numRows, 1, convertRow);
+	executor->run(taskflow).wait();
+}
+
+Bitmap convertEquirectangularMapToCubeMapFaces(const Bitmap& b, tf::Executor* executor)
+{
+	if (b.type_ != eBitmapType_2D) return Bitmap();
+
+	if (b.fmt_ != eBitmapFormat_Float)
+		return convertVerticalCrossToCubeMapFaces(convertEquirectangularMapToVerticalCross(b));
+
+	const int faceSize = b.w_ / 4;
+
+	Bitmap cubemap(faceSize, faceSize, 6, b.comp_, b.fmt_);
+	cubemap.type_ = eBitmapType_Cube;
+
+	convertEquirectangularMapToCubeMapFaces(
+		reinterpret_cast<const float*>(b.data_.data()), b.w_, b.h_, b.comp_,
+		reinterpret_cast<float*>(cubemap.data_.data()), cubemap.comp_, executor);
+
+	return cubemap;
+}
+
+uint32_t getCubeMapMipLevels(int faceSize)
+{
+	uint32_t levels = 1;
+	while (faceSize >> levels)
+		levels++;
+	return levels;
+}
+
+size_t getCubeMapMipChainSize(int faceSize, int comp, uint32_t numLevels)
+{
+	size_t size = 0;
+	for (uint32_t i = 0; i != numLevels; i++)
+	{
+		const size_t s = std::max(faceSize >> i, 1);
+		size += 6 * s * s * comp;
+	}
+	return size;
+}
+
+void generateCubeMapMips(float* faces, int faceSize, int comp, uint32_t numLevels, tf::Executor* executor)
+{
+	const float* src = faces;
+	float* dst = faces + 6 * size_t(faceSize) * faceSize * comp;
+
+	int srcSize = faceSize;
+
+	for (uint32_t level = 1; level < numLevels; level++)
+	{
+		const int dstSize = std::max(srcSize >> 1, 1);
+		const int last = srcSize - 1;
+
+		// 2x2 box filter, odd sizes just drop the last row/column
+		auto downsampleRow = [=](int row)
+		{
+			const int face = row / dstSize;
+			const int y = row % dstSize;
+
+			const float* srcFace = src + size_t(face) * srcSize * srcSize * comp;
+			const float* row0 = srcFace + size_t(std::min(2 * y, last)) * srcSize * comp;
+			const float* row1 = srcFace + size_t(std::min(2 * y + 1, last)) * srcSize * comp;
+
+			float* out = dst + (size_t(face) * dstSize + y) * dstSize * comp;
+
+			for (int x = 0; x != dstSize; x++)
+			{
+				const int x0 = std::min(2 * x, last) * comp;
+				const int x1 = std::min(2 * x + 1, last) * comp;
+				for (int c = 0; c != comp; c++)
+					*out++ = 0.25f * ((row0[x0 + c] + row0[x1 + c]) + (row1[x0 + c] + row1[x1 + c]));
+			}
+		};
+
+		const int numRows = 6 * dstSize;
+
+		if (!executor || numRows < 64)
+		{
+			for (int row = 0; row != numRows; row++)
+				downsampleRow(row);
+		}
+		else
+		{
+			tf::Taskflow taskflow;
+			taskflow.for_each_index(0, numRows, 1, downsampleRow);
+			executor->run(taskflow).wait();
+		}
+
+		src = dst;
+		dst += 6 * size_t(dstSize) * dstSize * comp;
+		srcSize = dstSize;
+	}
+}
@@ -4,12 +4,47 @@
 
 #include <Bitmap.hpp>
 
+namespace tf
+{
+	class Executor;
+}
+
 Bitmap convertEquirectangularMapToVerticalCross(const Bitmap& b);
 Bitmap convertVerticalCrossToCubeMapFaces(const Bitmap& b);
 
+/**
+	Convert an equirectangular float map ([srcComp] floats per texel) straight into 6 cube faces of [w] / 4 texels,
+	with the same face order and orientation as convertVerticalCrossToCubeMapFaces(convertEquirectangularMapToVerticalCross()).
+	[dst] receives 6 face-major faces with [dstComp] floats per texel, the missing components are set to 1.
+*/
+void convertEquirectangularMapToCubeMapFaces(const float* src, int w, int h, int srcComp, float* dst, int dstComp, tf::Executor* executor = nullptr);
+
+/* Same as above for float bitmaps, without the vertical cross intermediate */
+Bitmap convertEquirectangularMapToCubeMapFaces(const Bitmap& b, tf::Executor* executor = nullptr);
+
 inline Bitmap convertEquirectangularMapToCubeFaceMap(const Bitmap& b)
 {
-	return convertEquirectangularMapToCubeFaceMap(convertEquirectangularMapToVerticalCross(b));
+	return convertEquirectangularMapToCubeMapFaces(b);
 }
 
-void convolveDiffuse(const glm::vec3* data, int srcW, int srcH, int dstW, int dstH, glm::vec3* output, int numMonteCarloSamples);
\ No newline at end of file
+/* Number of levels down to 1x1 */
+uint32_t getCubeMapMipLevels(int faceSize);
+/* Number of floats in [numLevels] levels of a cube map mip chain */
+size_t getCubeMapMipChainSize(int faceSize, int comp, uint32_t numLevels);
+
+/**
+	Box-filter the mip chain of a float cube map on the CPU. [faces] holds level 0 (6 face-major faces) and has room for
+	getCubeMapMipChainSize() floats, the levels 1..[numLevels - 1] are stored right after it in the same layout.
+*/
+void generateCubeMapMips(float* faces, int faceSize, int comp, uint32_t numLevels, tf::Executor* executor = nullptr);
+
+/* Monte Carlo irradiance convolution of an equirectangular map, rows are distributed over the [executor] workers if provided */
+void convolveDiffuse(const glm::vec3* data, int srcW, int srcH, int dstW, int dstH, glm::vec3* output, int numMonteCarloSamples, tf::Executor* executor = nullptr);
+
+/* Project an equirectangular map onto the first 9 spherical harmonics (bands 0..2) */
+void projectToSH9(const glm::vec3* data, int w, int h, glm::vec3 sh[9]);
+/* Cosine-weighted average radiance around [n] (irradiance / pi), the same quantity convolveDiffuse() computes */
+glm::vec3 evaluateIrradianceSH9(const glm::vec3 sh[9], const glm::vec3& n);
+
+/* Fast approximate version of convolveDiffuse() through the SH9 projection, only low-frequency lighting is preserved */
+void convolveDiffuseSH9(const glm::vec3* data, int srcW, int srcH, int dstW, int dstH, glm::vec3* output);
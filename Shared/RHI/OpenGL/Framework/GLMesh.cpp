@@ -6,8 +6,8 @@
 
 GLIndirectMesh::GLIndirectMesh(const GLSceneData& data)
 	: numIndices_(data.header_.indexDataSize / sizeof(uint32_t))
-	, bufferIndices_(data.header_.indexDataSize, data.meshData_.indexData_.data(), 0)
-	, bufferVertices_(data.header_.vertexDataSize, data.meshData_.vertexData_.data(), 0)
+	, bufferIndices_(data.header_.indexDataSize, data.mappedMeshData_.getIndexData(), 0)
+	, bufferVertices_(data.header_.vertexDataSize, data.mappedMeshData_.getVertexData(), 0)
 	, bufferMaterials_(sizeof(MaterialDescription)* data.materials_.size(), data.materials_.data(), 0)
 	, bufferIndirect_(sizeof(DrawElementsIndirectCommand)* data.shapes_.size() + sizeof(GLsizei), nullptr, GL_DYNAMIC_STORAGE_BIT)
 	, bufferModelMatrices_(sizeof(glm::mat4)* data.shapes_.size(), nullptr, GL_DYNAMIC_STORAGE_BIT)
@@ -103,8 +103,8 @@ template class GLMesh<GLSceneDataLazy>;
 template <class GLSceneDataType>
 GLMesh<GLSceneDataType>::GLMesh(const GLSceneDataType& data)
 	: numIndices_(data.header_.indexDataSize / sizeof(uint32_t))
-	, bufferIndices_(data.header_.indexDataSize, data.meshData_.indexData_.data(), 0)
-	, bufferVertices_(data.header_.vertexDataSize, data.meshData_.vertexData_.data(), 0)
+	, bufferIndices_(data.header_.indexDataSize, data.mappedMeshData_.getIndexData(), 0)
+	, bufferVertices_(data.header_.vertexDataSize, data.mappedMeshData_.getVertexData(), 0)
 	, bufferMaterials_(sizeof(MaterialDescription)* data.materials_.size(), data.materials_.data(), GL_DYNAMIC_STORAGE_BIT)
 	, bufferModelMatrices_(sizeof(glm::mat4)* data.shapes_.size(), nullptr, GL_DYNAMIC_STORAGE_BIT)
 	, bufferIndirect_(data.shapes_.size())
@@ -2,6 +2,8 @@
 
 #include <Filesystem/FilesystemUtilities.hpp>
 
+#include <taskflow/taskflow.hpp>
+
 static uint64_t getTextureHandleBindless(uint64_t idx, const std::vector<GLTexture>& textures)
 {
 	if (idx == INVALID_TEXTURE) return 0;
@@ -14,7 +16,11 @@ GLSceneData::GLSceneData(
 	const char* sceneFile,
 	const char* materialFile)
 {
-	header_ = loadMeshData(meshFile, meshData_);
+	if (!mappedMeshData_.open(meshFile))
+		exit(EXIT_FAILURE);
+	mappedMeshData_.copyDescriptors(meshData_);
+	header_ = mappedMeshData_.getHeader();
+
 	loadScene(sceneFile);
 
 	std::vector<std::string> textureFiles;
@@ -37,7 +43,9 @@ GLSceneData::GLSceneData(
 
 void GLSceneData::loadScene(const char* sceneFile)
 {
-	::loadScene(sceneFile, scene_);
+	// nothing in the OpenGL demos shows the node names
+	if (!::loadScene(sceneFile, scene_, false))
+		exit(EXIT_FAILURE);
 
 	// prepare draw data buffer
 	for(const auto& c : scene_.meshes_)
@@ -58,5 +66,7 @@ void GLSceneData::loadScene(const char* sceneFile)
 	}
 
 	markAsChanged(scene_, 0);
-	recalculateGlobalTransforms(scene_);
+
+	tf::Executor executor;
+	recalculateGlobalTransforms(scene_, executor);
 }
\ No newline at end of file
@@ -17,7 +17,8 @@ public:
 	std::vector<GLTexture> allMaterialTextures_;
 
 	MeshFileHeader header_;
-	MeshData meshData_;
+	MeshData meshData_; // mesh descriptors and bounding boxes only
+	MappedMeshData mappedMeshData_; // index and vertex data are read straight from the mapped file
 
 	Scene scene_;
 	std::vector<MaterialDescription> materials_;
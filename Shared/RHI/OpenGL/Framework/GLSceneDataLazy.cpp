@@ -1,8 +1,8 @@
 #include <RHI/OpenGL/Framework/GLSceneDataLazy.hpp>
 
-#include <taskflow/algorithm/for_each.hpp>
+#include <Scene/AssetConverter.hpp>
 
-#include <stb_image.h>
+#include <taskflow/algorithm/for_each.hpp>
 
 static uint64_t getTextureHandleBindless(uint64_t idx, const std::vector<std::shared_ptr<GLTexture>>& textures)
 {
@@ -16,9 +16,13 @@ GLSceneDataLazy::GLSceneDataLazy(
 	const char* sceneFile,
 	const char* materialFile)
 {
-	header_ = loadMeshData(meshFile, meshData_);
+	if (!mappedMeshData_.open(meshFile))
+		exit(EXIT_FAILURE);
+	mappedMeshData_.copyDescriptors(meshData_);
+	header_ = mappedMeshData_.getHeader();
+
 	loadScene(sceneFile);
-	loadMaterials(materialFile, materialsLoaded_, textureFiles_);
+	loadMaterials(getMaterialFileToLoad(materialFile, &executor_).c_str(), materialsLoaded_, textureFiles_);
 
 	// apply a dummy textures to everything
 	for (const auto& f : textureFiles_) {
@@ -27,41 +31,35 @@ GLSceneDataLazy::GLSceneDataLazy(
 
 	updateMaterials();
 
-	loadedFiles_.reserve(textureFiles_.size());
+	loadedFiles_.reset(textureFiles_.size());
 
 	taskflow_.for_each_index(0u, (uint32_t)textureFiles_.size(), 1u, [this](int idx)
 		{
-			int w, h;
-			const uint8_t* img = stbi_load((FilesystemUtilities::GetResourcesDir() + this->textureFiles_[idx]).c_str(), &w, &h, nullptr, STBI_rgb_alpha);
-			if (img)
-			{
-				std::lock_guard lock(loadedFilesMutex_);
-				loadedFiles_.emplace_back(LoadedImageData{ idx, w, h, img });
-			}
+			TextureLevelsView levels;
+			auto owner = textureCache_.loadLevels(FilesystemUtilities::GetResourcesDir() + this->textureFiles_[idx], levels);
+			if (owner)
+				loadedFiles_.push(LoadedImageData{ idx, levels, owner });
 		});
 
 	executor_.run(taskflow_);
 }
 
-bool GLSceneDataLazy::uploadLoadedTextures()
+bool GLSceneDataLazy::uploadLoadedTextures(size_t byteBudget)
 {
-	LoadedImageData data;
-
-	{
-		std::lock_guard lock(loadedFilesMutex_);
+	size_t uploadedBytes = 0;
 
-		if (loadedFiles_.empty())
-			return false;
-
-		data = loadedFiles_.back();
-
-		loadedFiles_.pop_back();
-	}
+	const size_t numUploaded = loadedFiles_.drain([this, &uploadedBytes, byteBudget](LoadedImageData&& data)
+		{
+			allMaterialTextures_[data.index_] = std::make_shared<GLTexture>(data.levels_);
+			uploadedBytes += data.levels_.getTailSize(0);
 
-	allMaterialTextures_[data.index_] = std::make_shared<GLTexture>(data.w_, data.h_, data.img_);
+			return uploadedBytes < byteBudget;
+		});
 
-	stbi_image_free((void*)data.img_);
+	if (!numUploaded)
+		return false;
 
+	// one material update for the whole batch
 	updateMaterials();
 
 	return true;
@@ -88,7 +86,9 @@ void GLSceneDataLazy::updateMaterials()
 
 void GLSceneDataLazy::loadScene(const char* sceneFile)
 {
-	::loadScene(sceneFile, scene_);
+	// nothing in the OpenGL demos shows the node names
+	if (!::loadScene(sceneFile, scene_, false))
+		exit(EXIT_FAILURE);
 
 	// prepare draw data buffer
 	for(const auto& c : scene_.meshes_)
@@ -110,5 +110,6 @@ void GLSceneDataLazy::loadScene(const char* sceneFile)
 
 	// force recalculation of all global transformations
 	markAsChanged(scene_, 0);
-	recalculateGlobalTransforms(scene_);
+	// the texture loaders are not started yet, all the workers are free
+	recalculateGlobalTransforms(scene_, executor_);
 }
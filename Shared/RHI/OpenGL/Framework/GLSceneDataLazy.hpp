@@ -1,11 +1,11 @@
 #pragma once
 
-#include <mutex>
-
 #include <Scene/Scene.hpp>
 #include <Scene/Mareial.hpp>
 #include <Scene/VtxData.hpp>
 #include <RHI/OpenGL/Framework/GLTexture.hpp>
+#include <TextureCache.hpp>
+#include <Utils/MPSCRing.hpp>
 #include <taskflow/taskflow.hpp>
 
 #include <Filesystem/FilesystemUtilities.hpp>
@@ -21,20 +21,23 @@ public:
 	struct LoadedImageData
 	{
 		int index_ = 0;
-		int w_ = 0;
-		int h_ = 0;
-		const uint8_t* img_ = nullptr;
+		// levels of a .ktx file or a texture cache entry, [levelsOwner_] keeps [levels_] alive
+		TextureLevelsView levels_;
+		std::shared_ptr<const void> levelsOwner_;
 	};
 
 	const std::shared_ptr<GLTexture> dummyTexture_ = std::make_shared<GLTexture>(GL_TEXTURE_2D, (FilesystemUtilities::GetResourcesDir() + "textures/const1.bmp").c_str() );
 
 	std::vector<std::string> textureFiles_;
-	std::vector<LoadedImageData> loadedFiles_;
-	std::mutex loadedFilesMutex_;
+	// loader threads -> render thread, sized for all the textures so the loaders never wait
+	MPSCRing<LoadedImageData> loadedFiles_;
 	std::vector<std::shared_ptr<GLTexture>> allMaterialTextures_;
+	// decoded mip chains of the source images, later runs skip stbi_load() and the mip generation
+	TextureCache textureCache_{ FilesystemUtilities::GetResourcesDir() + "Cache/Textures/" };
 
 	MeshFileHeader header_;
-	MeshData meshData_;
+	MeshData meshData_; // mesh descriptors and bounding boxes only
+	MappedMeshData mappedMeshData_; // index and vertex data are read straight from the mapped file
 
 	Scene scene_;
 	std::vector<MaterialDescription> materialsLoaded_; // materials loaded from scene
@@ -44,7 +47,8 @@ public:
 	tf::Taskflow taskflow_;
 	tf::Executor executor_;
 
-	bool uploadLoadedTextures();
+	/* Upload finished textures until [byteBudget] texel bytes are used (at least one texture), returns true if any was uploaded */
+	bool uploadLoadedTextures(size_t byteBudget = 32u << 20);
 
 private:
 	void loadScene(const char* sceneFile);
@@ -2,6 +2,7 @@
 #include <Bitmap.hpp>
 #include <UtilsCubemap.hpp>
 #include <ImageUtils.hpp>
+#include <TextureCompression.hpp>
 
 #include <glad/gl.h>
 
@@ -18,6 +19,20 @@ int getNumMipMapLevels2D(int w, int h)
     return levels;
 }
 
+static GLenum getCompressedInternalFormat(eCompressedFormat format)
+{
+    switch (format)
+    {
+        case eCompressedFormat_None: return GL_RGBA8;
+        case eCompressedFormat_BC5:  return GL_COMPRESSED_RG_RGTC2;
+        case eCompressedFormat_BC6H: return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+        // the scene shaders use albedo values as they are stored (like the GL_RGBA8 path), so sRGB data is not decoded on sampling
+        case eCompressedFormat_BC7:
+        case eCompressedFormat_BC7_SRGB: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return GL_COMPRESSED_RGBA_BPTC_UNORM;
+}
+
 GLTexture::GLTexture(GLenum type, int width, int height, GLenum internalFormat)
         : type_(type)
 {
@@ -53,6 +68,7 @@ GLTexture::GLTexture(GLenum type, const char *fileName, GLenum clamp)
             int w = 0;
             int h = 0;
             int numMips = 0;
+            bool hasMips = false;
             if(isKTX)
             {
                 gli::texture gliTex = gli::load_ktx(fileName);
@@ -61,9 +77,26 @@ GLTexture::GLTexture(GLenum type, const char *fileName, GLenum clamp)
                 glm::tvec3<GLsizei> extent(gliTex.extent(0));
                 w = extent.x;
                 h = extent.y;
-                numMips = getNumMipMapLevels2D(w, h);
-                glTextureStorage2D(handle_, numMips, format.Internal, w, h);
-                glTextureSubImage2D(handle_, 0, 0, 0, w, h, format.External, format.Type, gliTex.data(0, 0, 0));
+                if (gli::is_compressed(gliTex.format()))
+                {
+                    // compressed files carry their own mip chain, glGenerateTextureMipmap() cannot be used for them
+                    // sRGB albedo is sampled without decoding, see getCompressedInternalFormat()
+                    const GLenum internalFormat = (format.Internal == GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM) ? GL_COMPRESSED_RGBA_BPTC_UNORM : (GLenum)format.Internal;
+                    numMips = (int)gliTex.levels();
+                    hasMips = true;
+                    glTextureStorage2D(handle_, numMips, internalFormat, w, h);
+                    for (int level = 0; level != numMips; level++)
+                    {
+                        const glm::tvec3<GLsizei> levelExtent(gliTex.extent(level));
+                        glCompressedTextureSubImage2D(handle_, level, 0, 0, levelExtent.x, levelExtent.y, internalFormat, (GLsizei)gliTex.size(level), gliTex.data(0, 0, level));
+                    }
+                }
+                else
+                {
+                    numMips = getNumMipMapLevels2D(w, h);
+                    glTextureStorage2D(handle_, numMips, format.Internal, w, h);
+                    glTextureSubImage2D(handle_, 0, 0, 0, w, h, format.External, format.Type, gliTex.data(0, 0, 0));
+                }
             }
             else
             {
@@ -87,7 +120,8 @@ GLTexture::GLTexture(GLenum type, const char *fileName, GLenum clamp)
                 stbi_image_free((void*)img);
                 glBindTextures(1, 1, &handle_);
             }
-            glGenerateTextureMipmap(handle_);
+            if (!hasMips)
+                glGenerateTextureMipmap(handle_);
             glTextureParameteri(handle_, GL_TEXTURE_MAX_LEVEL, numMips - 1);
             glTextureParameteri(handle_, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
             glTextureParameteri(handle_, GL_TEXTURE_MAX_ANISOTROPY, 16);
@@ -98,13 +132,27 @@ GLTexture::GLTexture(GLenum type, const char *fileName, GLenum clamp)
 	        int w, h, comp;
 	        const float* img = stbi_loadf(fileName, &w, &h, &comp, 3);
 	        assert(img);
-	        Bitmap in(w, h, comp, eBitmapFormat_Float, img);
 	        const bool isEquirectangular = w == 2 * h;
-	        Bitmap out = isEquirectangular ? convertEquirectangularMapToVerticalCross(in) : in;
+
+	        // equirectangular maps are converted straight into the faces, the whole mip chain is built in one buffer
+	        const int faceSize = isEquirectangular ? w / 4 : w / 3;
+	        const int numMipmaps = getNumMipMapLevels2D(faceSize, faceSize);
+	        std::vector<float> faces(getCubeMapMipChainSize(faceSize, 3, numMipmaps));
+
+	        if (isEquirectangular)
+	        {
+	            convertEquirectangularMapToCubeMapFaces(img, w, h, 3, faces.data(), 3);
+	        }
+	        else
+	        {
+	            Bitmap in(w, h, 3, eBitmapFormat_Float, img);
+	            Bitmap cubemap = convertVerticalCrossToCubeMapFaces(in);
+	            memcpy(faces.data(), cubemap.data_.data(), cubemap.data_.size());
+	        }
 	        stbi_image_free((void*)img);
-	        Bitmap cubemap = convertVerticalCrossToCubeMapFaces(out);
 
-	        const int numMipmaps = getNumMipMapLevels2D(cubemap.w_, cubemap.h_);
+	        generateCubeMapMips(faces.data(), faceSize, 3, numMipmaps);
+
             glTextureParameteri(handle_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
             glTextureParameteri(handle_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
             glTextureParameteri(handle_, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
@@ -113,16 +161,16 @@ GLTexture::GLTexture(GLenum type, const char *fileName, GLenum clamp)
             glTextureParameteri(handle_, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
             glTextureParameteri(handle_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
             glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
-            glTextureStorage2D(handle_, numMipmaps, GL_RGBA32F, cubemap.w_, cubemap.h_);
-            const uint8_t* data = cubemap.data_.data();
+            glTextureStorage2D(handle_, numMipmaps, GL_RGBA32F, faceSize, faceSize);
+            const float* data = faces.data();
 
-            for(unsigned i = 0; i != 6; i++)
+            for (int level = 0; level != numMipmaps; level++)
             {
-                glTextureSubImage3D(handle_, 0, 0, 0, i, cubemap.w_, cubemap.h_, 1, GL_RGB, GL_FLOAT, data);
-                data += cubemap.w_ * cubemap.h_ * cubemap.comp_ * Bitmap::getBytesPerComponent(cubemap.fmt_);
+                const int size = std::max(faceSize >> level, 1);
+                glTextureSubImage3D(handle_, level, 0, 0, 0, size, size, 6, GL_RGB, GL_FLOAT, data);
+                data += 6 * size * size * 3;
             }
 
-            glGenerateTextureMipmap(handle_);
         	break;
 	    }
 	    default:
@@ -149,6 +197,34 @@ GLTexture::GLTexture(int w, int h, const void *img)
     glMakeTextureHandleResidentARB(handleBindless_);
 }
 
+GLTexture::GLTexture(const TextureLevelsView& tex)
+        : type_(GL_TEXTURE_2D)
+{
+    const GLenum internalFormat = getCompressedInternalFormat(tex.format_);
+    const int numMipMaps = tex.numLevels_;
+
+    // the small RGBA8 levels are tightly packed as well, the previous alignment is restored for the other loaders
+    GLint alignment = 4;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glCreateTextures(type_, 1, &handle_);
+    glTextureStorage2D(handle_, numMipMaps, internalFormat, tex.w_, tex.h_);
+    for (int level = 0; level != numMipMaps; level++)
+    {
+        if (tex.isCompressed())
+            glCompressedTextureSubImage2D(handle_, level, 0, 0, tex.getLevelWidth(level), tex.getLevelHeight(level),
+                internalFormat, (GLsizei)tex.getLevelSize(level), tex.getLevelData(level));
+        else
+            glTextureSubImage2D(handle_, level, 0, 0, tex.getLevelWidth(level), tex.getLevelHeight(level), GL_RGBA, GL_UNSIGNED_BYTE, tex.getLevelData(level));
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    glTextureParameteri(handle_, GL_TEXTURE_MAX_LEVEL, numMipMaps - 1);
+    glTextureParameteri(handle_, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(handle_, GL_TEXTURE_MAX_ANISOTROPY, 16);
+    handleBindless_ = glGetTextureHandleARB(handle_);
+    glMakeTextureHandleResidentARB(handleBindless_);
+}
+
 GLTexture::GLTexture(GLTexture &&other)
         : type_(other.type_)
 		, handle_(other.handle_)
@@ -2,6 +2,8 @@
 
 #include <glad/gl.h>
 
+struct TextureLevelsView;
+
 class GLTexture
 {
 public:
@@ -9,6 +11,8 @@ public:
 	GLTexture(GLenum type, const char* fileName, GLenum clamp);
 	GLTexture(GLenum type, int width, int height, GLenum internalFormat);
 	GLTexture(int w, int h, const void* img);
+	/* All the mip levels are uploaded as they are */
+	explicit GLTexture(const TextureLevelsView& tex);
 	~GLTexture();
 	GLTexture(const GLTexture&) = delete;
 	GLTexture(GLTexture&&);
@@ -23,7 +23,7 @@ CubemapRenderer::CubemapRenderer(VulkanRenderContext& ctx,
 
 	for(size_t i = 0; i != imgCount; i++)
 	{
-		uniforms_[i] = ctx.resources.addUniformBuffer(sizeof(UniformBuffer));
+		uniforms_[i] = ctx.resources.addUniformBuffer(sizeof(UniformBuffer), true);
 		dsInfo.buffers[0].buffer = uniforms_[i];
 
 		descriptorSets_[i] = ctx.resources.addDescriptorSet(descriptorPool_, descriptorSetLayout_);
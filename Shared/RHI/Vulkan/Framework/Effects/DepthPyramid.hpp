@@ -0,0 +1,63 @@
+#pragma once
+
+#include <RHI/Vulkan/Framework/RenderGraph.hpp>
+#include <RHI/Vulkan/Framework/VulkanShaderProcessor.hpp>
+
+#include <algorithm>
+
+const VkFormat DepthPyramidFormat = VK_FORMAT_R32_SFLOAT;
+
+/**
+	Hierarchical depth of [depthTex] for occlusion tests, by a chain of 2x2 max reductions:
+	level 0 is half the size of [depthTex], every next level halves the previous one down to 1x1.
+	A texel holds the farthest depth it covers. The levels are outputs, they keep their contents until the next run.
+*/
+struct DepthPyramid : public RenderGraph
+{
+	DepthPyramid(VulkanRenderContext& ctx, VulkanTexture depthTex)
+		: RenderGraph(ctx)
+	{
+		const RenderGraphResource depth = importTexture("depth", depthTex);
+
+		uint32_t w = std::max(depthTex.width / 2, 1u);
+		uint32_t h = std::max(depthTex.height / 2, 1u);
+
+		for (RenderGraphResource input = depth; ; w = std::max(w / 2, 1u), h = std::max(h / 2, 1u))
+		{
+			const std::string level = std::to_string(levels.size());
+			const RenderGraphResource output = createTexture(("depthPyramid" + level).c_str(),
+				RenderGraphTextureDesc{ w, h, DepthPyramidFormat, VK_FILTER_NEAREST, VK_FILTER_NEAREST });
+
+			addPass(("depthReduce" + level).c_str(), { input }, { output }, [&ctx, input, output](RenderGraph& graph) {
+				return std::make_unique<QuadProcessor>(ctx, DescriptorSetInfo{
+					{}, {fsTextureAttachment(graph.getTexture(input))}},
+					std::vector<VulkanTexture>{ graph.getTexture(output) },
+					(FilesystemUtilities::GetShadersDir() + "Vulkan/MultiRenderer/DepthReduce.frag").c_str());
+			});
+
+			markOutput(output);
+			levels.push_back(output);
+
+			if (w == 1 && h == 1)
+				break;
+
+			input = output;
+		}
+
+		compile();
+	}
+
+	inline uint32_t getNumLevels() const { return (uint32_t)levels.size(); }
+	inline VulkanTexture getLevel(uint32_t level) const { return getTexture(levels[level]); }
+
+	std::vector<VulkanTexture> getLevels() const
+	{
+		std::vector<VulkanTexture> textures;
+		for (RenderGraphResource r : levels)
+			textures.push_back(getTexture(r));
+		return textures;
+	}
+
+private:
+	std::vector<RenderGraphResource> levels;
+};
@@ -2,10 +2,6 @@
 
 #include <RHI/Vulkan/Framework/Effects/LuminanceCalculator.hpp>
 
-#include <RHI/Vulkan/Framework/CompositeRenderer.hpp>
-#include <RHI/Vulkan/Framework/VulkanShaderProcessor.hpp>
-#include <RHI/Vulkan/Framework/Barriers.hpp>
-
 struct HDRUniformBuffer
 {
 	float exposure;
@@ -14,148 +10,67 @@ struct HDRUniformBuffer
 	float adaptationSpeed;
 };
 
-/** Apply bloom to input buffer */
-struct HDRProcessor : public CompositeRenderer
+/**
+	Apply bloom to input buffer.
+	The bright pass, bloom and streaks buffers share memory unless [keepIntermediates] is set (their getters are only valid then).
+*/
+struct HDRProcessor : public RenderGraph
 {
-	HDRProcessor(VulkanRenderContext& ctx, VulkanTexture input, VulkanTexture avgLuminance, BufferAttachment uniformBuffer)
-		: CompositeRenderer(ctx)
-
-		, brightnessTex(ctx.resources.addColorTexture(0, 0, LuminosityFormat, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE))
+	HDRProcessor(VulkanRenderContext& ctx, VulkanTexture input, VulkanTexture avgLuminance, BufferAttachment uniformBuffer, bool keepIntermediates = false)
+		: RenderGraph(ctx)
 
 		, adaptedLuminanceTex1(ctx.resources.addColorTexture(1, 1, LuminosityFormat, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE))
 		, adaptedLuminanceTex2(ctx.resources.addColorTexture(1, 1, LuminosityFormat, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE))
 
-		, bloomX1Tex(ctx.resources.addColorTexture(0, 0, LuminosityFormat, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE))
-		, bloomY1Tex(ctx.resources.addColorTexture(0, 0, LuminosityFormat, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE))
-		, bloomX2Tex(ctx.resources.addColorTexture(0, 0, LuminosityFormat, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE))
-		, bloomY2Tex(ctx.resources.addColorTexture(0, 0, LuminosityFormat, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE))
-
-		, streaks1Tex(ctx.resources.addColorTexture(0, 0, LuminosityFormat, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE))
-		, streaks2Tex(ctx.resources.addColorTexture(0, 0, LuminosityFormat, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE))
-
 		// Output is an 8-bit RGB framebuffer
 		, streaksPatternTex(ctx.resources.loadTexture2D((FilesystemUtilities::GetResourcesDir() + "textures/StreaksRotationPattern.bmp").c_str()))
-
-		, resultTex(ctx.resources.addColorTexture())
-
-		, brightness(ctx, DescriptorSetInfo{
-			{}, {fsTextureAttachment(input)}},
-			{brightnessTex},
-			(FilesystemUtilities::GetShadersDir() + "Vulkan/HDR/BrightPass.frag").c_str())
-
-		, bloomX1(ctx, DescriptorSetInfo{
-		{}, {fsTextureAttachment(brightnessTex)}},
-			{bloomX1Tex},
-			(FilesystemUtilities::GetShadersDir() + "Vulkan/HDR/BloomX.frag").c_str())
-		, bloomY1(ctx, DescriptorSetInfo{
-		{}, {fsTextureAttachment(bloomX1Tex)}},
-			{bloomY1Tex},
-			(FilesystemUtilities::GetShadersDir() + "Vulkan/HDR/BloomY.frag").c_str())
-		, bloomX2(ctx, DescriptorSetInfo{
-			{}, {fsTextureAttachment(bloomY1Tex)} },
-			{ bloomX2Tex },
-			(FilesystemUtilities::GetShadersDir() + "Vulkan/HDR/BloomX.frag").c_str())
-		, bloomY2(ctx, DescriptorSetInfo{
-			{}, {fsTextureAttachment(bloomX2Tex)} },
-			{ bloomY2Tex },
-			(FilesystemUtilities::GetShadersDir() + "Vulkan/HDR/BloomY.frag").c_str())
-
-		, streaks1(ctx, DescriptorSetInfo{
-		{}, {fsTextureAttachment(bloomY2Tex), fsTextureAttachment(streaksPatternTex)}},
-		{streaks1Tex},
-		(FilesystemUtilities::GetShadersDir() + "Vulkan/HDR/Streaks.frag").c_str())
-		, streaks2(ctx, DescriptorSetInfo{
-			{}, {fsTextureAttachment(streaks1Tex), fsTextureAttachment(streaksPatternTex)}},
-			{ streaks2Tex },
-			(FilesystemUtilities::GetShadersDir() + "Vulkan/HDR/Streaks.frag").c_str())
-
-		, adaptationEven(ctx, DescriptorSetInfo{
-			{uniformBuffer}, {fsTextureAttachment(avgLuminance), fsTextureAttachment(adaptedLuminanceTex1)}},
-			{adaptedLuminanceTex2}, (FilesystemUtilities::GetShadersDir() + "Vulkan/HDR/LightAdaptation.frag").c_str())
-		, adaptationOdd(ctx, DescriptorSetInfo{
-			{uniformBuffer}, {fsTextureAttachment(avgLuminance), fsTextureAttachment(adaptedLuminanceTex2)} },
-			{ adaptedLuminanceTex1 }, (FilesystemUtilities::GetShadersDir() + "Vulkan/HDR/LightAdaptation.frag").c_str())
-
-		, adaptation1ToColor(ctx, adaptedLuminanceTex1)
-		, adaptation1ToShader(ctx, adaptedLuminanceTex1)
-
-		, adaptation2ToColor(ctx, adaptedLuminanceTex2)
-		, adaptation2ToShader(ctx, adaptedLuminanceTex2)
-
-		, composerEven(ctx, DescriptorSetInfo{
-			{uniformBuffer}, {fsTextureAttachment(input), fsTextureAttachment(adaptedLuminanceTex2), fsTextureAttachment(streaks2Tex)}},
-			{resultTex}, (FilesystemUtilities::GetShadersDir() + "Vulkan/HDR/HDR.frag").c_str())
-		, composerOdd(ctx, DescriptorSetInfo{
-			{uniformBuffer}, {fsTextureAttachment(input), fsTextureAttachment(adaptedLuminanceTex1), fsTextureAttachment(streaks2Tex)}},
-			{ resultTex }, (FilesystemUtilities::GetShadersDir() + "Vulkan/HDR/HDR.frag").c_str())
-
-		, bloomX1ToColor(ctx, bloomX1Tex)
-		, bloomX1ToShader(ctx, bloomX1Tex)
-		, bloomX2ToColor(ctx, bloomX2Tex)
-		, bloomX2ToShader(ctx, bloomX2Tex)
-
-		, bloomY1ToColor(ctx, bloomY1Tex)
-		, bloomY1ToShader(ctx, bloomY1Tex)
-		, bloomY2ToColor(ctx, bloomY2Tex)
-		, bloomY2ToShader(ctx, bloomY2Tex)
-
-		, streaks1ToColor(ctx, streaks1Tex)
-		, streaks1ToShader(ctx, streaks1Tex)
-		, streaks2ToColor(ctx, streaks2Tex)
-		, streaks2ToShader(ctx, streaks2Tex)
-
-		, brightnessToColor(ctx, brightnessTex)
-		, brightnessToShader(ctx, brightnessTex)
-
-		, resultToColor(ctx, resultTex)
-		, resultToShader(ctx, resultTex)
 	{
-		renderers_.emplace_back(brightnessToColor, false);
-		renderers_.emplace_back(brightness, false);
-		renderers_.emplace_back(brightnessToShader, false);
+		const RenderGraphTextureDesc lumDesc{ 0, 0, LuminosityFormat };
+
+		const RenderGraphResource source = importTexture("input", input);
+		const RenderGraphResource avgLum = importTexture("avgLuminance", avgLuminance);
+		const RenderGraphResource pattern = importTexture("streaksPattern", streaksPatternTex);
 
-		renderers_.emplace_back(bloomX1ToColor, false);
-		renderers_.emplace_back(bloomX1, false);
-		renderers_.emplace_back(bloomX1ToShader, false);
+		// the adapted luminance is carried over to the next frame
+		adaptedLum1 = importTexture("adaptedLuminance1", adaptedLuminanceTex1);
+		adaptedLum2 = importTexture("adaptedLuminance2", adaptedLuminanceTex2);
 
-		renderers_.emplace_back(bloomY1ToColor, false);
-		renderers_.emplace_back(bloomY1, false);
-		renderers_.emplace_back(bloomY1ToShader, false);
+		brightnessTex = createTexture("bloomBright", lumDesc);
+		bloomX1Tex = createTexture("bloomX1", lumDesc);
+		bloomY1Tex = createTexture("bloom1", lumDesc);
+		bloomX2Tex = createTexture("bloomX2", lumDesc);
+		bloomY2Tex = createTexture("bloom2", lumDesc);
+		streaks1Tex = createTexture("bloomStreaks1", lumDesc);
+		streaks2Tex = createTexture("bloomStreaks2", lumDesc);
+		resultTex = createTexture("bloomResult", RenderGraphTextureDesc{ 0, 0, VK_FORMAT_R8G8B8A8_UNORM, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT });
 
-		renderers_.emplace_back(bloomX2ToColor, false);
-		renderers_.emplace_back(bloomX2, false);
-		renderers_.emplace_back(bloomX2ToShader, false);
+		addQuadPass("brightness", { source }, brightnessTex, {}, "Vulkan/HDR/BrightPass.frag");
 
-		renderers_.emplace_back(bloomY2ToColor, false);
-		renderers_.emplace_back(bloomY2, false);
-		renderers_.emplace_back(bloomY2ToShader, false);
+		addQuadPass("bloomX1", { brightnessTex }, bloomX1Tex, {}, "Vulkan/HDR/BloomX.frag");
+		addQuadPass("bloomY1", { bloomX1Tex }, bloomY1Tex, {}, "Vulkan/HDR/BloomY.frag");
+		addQuadPass("bloomX2", { bloomY1Tex }, bloomX2Tex, {}, "Vulkan/HDR/BloomX.frag");
+		addQuadPass("bloomY2", { bloomX2Tex }, bloomY2Tex, {}, "Vulkan/HDR/BloomY.frag");
 
-		renderers_.emplace_back(streaks1ToColor, false);
-		renderers_.emplace_back(streaks1, false);
-		renderers_.emplace_back(streaks1ToShader, false);
+		addQuadPass("streaks1", { bloomY2Tex, pattern }, streaks1Tex, {}, "Vulkan/HDR/Streaks.frag");
+		addQuadPass("streaks2", { streaks1Tex, pattern }, streaks2Tex, {}, "Vulkan/HDR/Streaks.frag");
 
-		renderers_.emplace_back(streaks2ToColor, false);
-		renderers_.emplace_back(streaks2, false);
-		renderers_.emplace_back(streaks2ToShader, false);
+		// Light adaptation and composition ping-pong between the adapted luminances, one pass of each pair runs per frame
+		adaptationEven = addQuadPass("adaptationEven", { avgLum, adaptedLum1 }, adaptedLum2, uniformBuffer, "Vulkan/HDR/LightAdaptation.frag");
+		adaptationOdd = addQuadPass("adaptationOdd", { avgLum, adaptedLum2 }, adaptedLum1, uniformBuffer, "Vulkan/HDR/LightAdaptation.frag");
 
-		renderers_.emplace_back(adaptation2ToColor, false);  // 21
-		renderers_.emplace_back(adaptationEven, false);      // 22
-		renderers_.emplace_back(adaptation2ToShader, false); // 23
+		composerEven = addQuadPass("composerEven", { source, adaptedLum2, streaks2Tex }, resultTex, uniformBuffer, "Vulkan/HDR/HDR.frag");
+		composerOdd = addQuadPass("composerOdd", { source, adaptedLum1, streaks2Tex }, resultTex, uniformBuffer, "Vulkan/HDR/HDR.frag");
 
-		renderers_.emplace_back(adaptation1ToColor, false);  // 24
-		renderers_.emplace_back(adaptationOdd, false);       // 25
-		renderers_.emplace_back(adaptation1ToShader, false); // 26
+		markOutput(resultTex);
 
-		renderers_[21].enabled_ = false; // disable adaptationProcessor at the beginning
-		renderers_[22].enabled_ = false;
-		renderers_[23].enabled_ = false;
+		if (keepIntermediates)
+			for (RenderGraphResource r : { brightnessTex, bloomX1Tex, bloomY1Tex, bloomX2Tex, bloomY2Tex, streaks1Tex, streaks2Tex })
+				markOutput(r);
 
-		renderers_.emplace_back(resultToColor, false); // 27
-		renderers_.emplace_back(composerEven, false);  // 28
-		renderers_.emplace_back(composerOdd, false);   // 29
-		renderers_[29].enabled_ = false; // disable composerOdd at the beginning
+		compile();
 
-		renderers_.emplace_back(resultToShader, false);
+		setPassEnabled(adaptationEven, false); // disable adaptationProcessor at the beginning
+		setPassEnabled(composerOdd, false);    // disable composerOdd at the beginning
 
 		// Convert 32.0 to S5.10 fixed point format (half-float) manually for RGB channels, Set alpha to 1.0
 //		const uint16_t brightPixel[4] = { 0x5400, 0x5400, 0x5400, 0x3C00 }; // 64.0 as initial value
@@ -167,93 +82,72 @@ struct HDRProcessor : public CompositeRenderer
 	void fillCommandBuffer(VkCommandBuffer commandBuffer, size_t currentImage, VkFramebuffer fb1 = VK_NULL_HANDLE, VkRenderPass rp1 = VK_NULL_HANDLE) override
 	{
 		// Call base method
-		CompositeRenderer::fillCommandBuffer(commandBuffer, currentImage, fb1, rp1);
+		RenderGraph::fillCommandBuffer(commandBuffer, currentImage, fb1, rp1);
 		// Swap avgLuminance inputs for adaptation and composer
-		static const std::vector<int> switchIndices{ 21, 22, 23, 24, 25, 26, 28, 29 };
-		for (auto i : switchIndices)
-			renderers_[i].enabled_ = !renderers_[i].enabled_;
+		for (uint32_t pass : { adaptationEven, adaptationOdd, composerEven, composerOdd })
+			setPassEnabled(pass, !isPassEnabled(pass));
 	}
 
-	inline VulkanTexture getBloom1() const { return bloomY1Tex; }
-	inline VulkanTexture getBloom2() const { return bloomY2Tex; }
+	inline VulkanTexture getBloom1() const { return getTexture(bloomY1Tex); }
+	inline VulkanTexture getBloom2() const { return getTexture(bloomY2Tex); }
 
-	inline VulkanTexture getBrightness() const { return brightnessTex; }
+	inline VulkanTexture getBrightness() const { return getTexture(brightnessTex); }
 
-	inline VulkanTexture getStreaks1() const { return streaks1Tex; }
-	inline VulkanTexture getStreaks2() const { return streaks2Tex; }
+	inline VulkanTexture getStreaks1() const { return getTexture(streaks1Tex); }
+	inline VulkanTexture getStreaks2() const { return getTexture(streaks2Tex); }
 
 	inline VulkanTexture getAdaptatedLum1() const { return adaptedLuminanceTex1; }
 	inline VulkanTexture getAdaptatedLum2() const { return adaptedLuminanceTex2; }
 
-	inline VulkanTexture getResult() const { return resultTex; }
+	inline VulkanTexture getResult() const { return getTexture(resultTex); }
 
 private:
+	/* A fullscreen pass of [shaderFile] writing [output], [uniformBuffer] is bound if it has a buffer */
+	uint32_t addQuadPass(const char* name, const std::vector<RenderGraphResource>& inputs, RenderGraphResource output,
+		const BufferAttachment& uniformBuffer, const char* shaderFile)
+	{
+		VulkanRenderContext& ctx = ctx_;
+		const std::string shader = FilesystemUtilities::GetShadersDir() + shaderFile;
+
+		return addPass(name, inputs, { output }, [&ctx, inputs, output, uniformBuffer, shader](RenderGraph& graph) {
+			DescriptorSetInfo dsInfo;
+			if (uniformBuffer.buffer.buffer != VK_NULL_HANDLE)
+				dsInfo.buffers.push_back(uniformBuffer);
+			for (RenderGraphResource r : inputs)
+				dsInfo.textures.push_back(fsTextureAttachment(graph.getTexture(r)));
+
+			return std::make_unique<QuadProcessor>(ctx, dsInfo, std::vector<VulkanTexture>{ graph.getTexture(output) }, shader.c_str());
+		});
+	}
+
+	// The ping-pong texture pair for adapted luminances
+	VulkanTexture adaptedLuminanceTex1, adaptedLuminanceTex2;
+
 	// Static texture with rotation pattern
 	VulkanTexture streaksPatternTex;
 
-	// Texture with values above 1.0
-	VulkanTexture brightnessTex;
+	RenderGraphResource adaptedLum1, adaptedLum2;
 
-	// The ping-pong texture pair for adapted luminances
-	VulkanTexture adaptedLuminanceTex1, adaptedLuminanceTex2;
+	// Texture with values above 1.0
+	RenderGraphResource brightnessTex;
 
 	// First pass of blurring
-	VulkanTexture bloomX1Tex;
-	VulkanTexture bloomY1Tex;
+	RenderGraphResource bloomX1Tex;
+	RenderGraphResource bloomY1Tex;
 
 	// Second pass of blurring
-	VulkanTexture bloomX2Tex;
-	VulkanTexture bloomY2Tex;
+	RenderGraphResource bloomX2Tex;
+	RenderGraphResource bloomY2Tex;
 
-	VulkanTexture streaks1Tex;
-	VulkanTexture streaks2Tex;
+	RenderGraphResource streaks1Tex;
+	RenderGraphResource streaks2Tex;
 
 	// Composed Source + Brightness
-	VulkanTexture resultTex;
-
-	QuadProcessor brightness;
-
-	QuadProcessor bloomX1;
-	QuadProcessor bloomY1;
-	QuadProcessor bloomX2;
-	QuadProcessor bloomY2;
-
-	QuadProcessor streaks1;
-	QuadProcessor streaks2;
+	RenderGraphResource resultTex;
 
 	// Light Adaptation processing
-	QuadProcessor adaptationEven;
-	QuadProcessor adaptationOdd;
-
-	ShaderOptimalToColorBarrier adaptation1ToColor;
-	ColorToShaderOptimalBarrier adaptation1ToShader;
-
-	ShaderOptimalToColorBarrier adaptation2ToColor;
-	ColorToShaderOptimalBarrier adaptation2ToShader;
+	uint32_t adaptationEven, adaptationOdd;
 
 	// Final composition
-	QuadProcessor composerEven;
-	QuadProcessor composerOdd;
-
-	// barriers
-	ShaderOptimalToColorBarrier bloomX1ToColor;
-	ColorToShaderOptimalBarrier bloomX1ToShader;
-	ShaderOptimalToColorBarrier bloomX2ToColor;
-	ColorToShaderOptimalBarrier bloomX2ToShader;
-
-	ShaderOptimalToColorBarrier bloomY1ToColor;
-	ColorToShaderOptimalBarrier bloomY1ToShader;
-	ShaderOptimalToColorBarrier bloomY2ToColor;
-	ColorToShaderOptimalBarrier bloomY2ToShader;
-
-	ShaderOptimalToColorBarrier streaks1ToColor;
-	ColorToShaderOptimalBarrier streaks1ToShader;
-	ShaderOptimalToColorBarrier streaks2ToColor;
-	ColorToShaderOptimalBarrier streaks2ToShader;
-
-	ShaderOptimalToColorBarrier brightnessToColor;
-	ColorToShaderOptimalBarrier brightnessToShader;
-
-	ShaderOptimalToColorBarrier resultToColor;
-	ColorToShaderOptimalBarrier resultToShader;
+	uint32_t composerEven, composerOdd;
 };
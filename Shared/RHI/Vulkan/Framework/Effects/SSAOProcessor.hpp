@@ -1,76 +1,77 @@
 #pragma once
 
-#include <RHI/Vulkan/Framework/CompositeRenderer.hpp>
+#include <RHI/Vulkan/Framework/RenderGraph.hpp>
 #include <RHI/Vulkan/Framework/VulkanShaderProcessor.hpp>
 
-#include <RHI/Vulkan/Framework/Barriers.hpp>
-
 const int SSAOWidth = 0; // smaller SSAO buffer can be used 512
 const int SSAOHeight = 0; // 512;
 
-struct SSAOProcessor : public CompositeRenderer
+/**
+	SSAO of [depthTex], blurred and applied to [colorTex] in [outputTex].
+	The blurred occlusion (getBlurY()) is always kept for display, the raw and the half-blurred
+	buffers share memory with it unless [keepIntermediates] is set (getSSAO() and getBlurX() are only valid then).
+*/
+struct SSAOProcessor : public RenderGraph
 {
-	SSAOProcessor(VulkanRenderContext& ctx, VulkanTexture colorTex, VulkanTexture depthTex, VulkanTexture outputTex)
-		: CompositeRenderer(ctx)
+	SSAOProcessor(VulkanRenderContext& ctx, VulkanTexture colorTex, VulkanTexture depthTex, VulkanTexture outputTex, bool keepIntermediates = false)
+		: RenderGraph(ctx)
 
 		, rotateTex(ctx.resources.loadTexture2D((FilesystemUtilities::GetResourcesDir() + "textures/rot_texture.bmp").c_str()))
-		, SSAOTex(ctx.resources.addColorTexture(SSAOWidth, SSAOHeight))
-		, SSAOBlurXTex(ctx.resources.addColorTexture(SSAOWidth, SSAOHeight))
-		, SSAOBlurYTex(ctx.resources.addColorTexture(SSAOWidth, SSAOHeight))
 
 		, SSAOParamBuffer(mappedUniformBufferAttachment(ctx.resources, &params, VK_SHADER_STAGE_FRAGMENT_BIT))
-
-		, SSAO(ctx, { {SSAOParamBuffer}, {
-			fsTextureAttachment(depthTex),
-			fsTextureAttachment(rotateTex)
-		}}, { SSAOTex }, (FilesystemUtilities::GetShadersDir() + "Vulkan/SSAO/SSAO.frag").c_str())
-		, BlurX(ctx, { {}, {fsTextureAttachment(SSAOTex)} },
-			{ SSAOBlurXTex }, (FilesystemUtilities::GetShadersDir() + "Vulkan/SSAO/SSAOBlurX.frag").c_str())
-		, BlurY(ctx, { {}, {fsTextureAttachment(SSAOBlurXTex)} },
-			{ SSAOBlurYTex }, (FilesystemUtilities::GetShadersDir() + "Vulkan/SSAO/SSAOBlurY.frag").c_str())
-		, SSAOFinal(ctx, { {SSAOParamBuffer}, {
-			fsTextureAttachment(colorTex),
-			fsTextureAttachment(SSAOBlurYTex)
-		}}, { outputTex }, (FilesystemUtilities::GetShadersDir() + "Vulkan/SSAO/SSAOFinal.frag").c_str())
-
-		, ssaoColorToShader(ctx_, SSAOTex)
-		, ssaoShaderToColor(ctx_, SSAOTex)
-
-		, blurXColorToShader(ctx_, SSAOBlurXTex)
-		, blurXShaderToColor(ctx_, SSAOBlurXTex)
-
-		, blurYColorToShader(ctx_, SSAOBlurYTex)
-		, blurYShaderToColor(ctx_, SSAOBlurYTex)
-
-		, finalColorToShader(ctx_, outputTex)
-		, finalShaderToColor(ctx_, outputTex)
 	{
 		setVkImageName(ctx_.vkDev, rotateTex.image.image, "rotateTex");
-		setVkImageName(ctx_.vkDev, SSAOTex.image.image, "SSAO");
-		setVkImageName(ctx_.vkDev, SSAOBlurXTex.image.image, "SSAOBlurX");
-		setVkImageName(ctx_.vkDev, SSAOBlurYTex.image.image, "SSAOBlurY");
-
-		renderers_.emplace_back(ssaoShaderToColor, false);
-		renderers_.emplace_back(blurXShaderToColor, false);
-		renderers_.emplace_back(blurYShaderToColor, false);
-		renderers_.emplace_back(finalShaderToColor, false);
-
-		renderers_.emplace_back(SSAO, false);
-		renderers_.emplace_back(ssaoColorToShader, false);
-
-		renderers_.emplace_back(BlurX, false);
-		renderers_.emplace_back(blurXColorToShader, false);
-
-		renderers_.emplace_back(BlurY, false);
-		renderers_.emplace_back(blurYColorToShader, false);
 
-		renderers_.emplace_back(SSAOFinal, false);
-		renderers_.emplace_back(finalColorToShader, false);
+		const RenderGraphResource color = importTexture("color", colorTex);
+		const RenderGraphResource depth = importTexture("depth", depthTex);
+		const RenderGraphResource output = importTexture("output", outputTex);
+
+		SSAOTex = createTexture("SSAO", RenderGraphTextureDesc{ SSAOWidth, SSAOHeight, VK_FORMAT_R8G8B8A8_UNORM, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT });
+		SSAOBlurXTex = createTexture("SSAOBlurX", RenderGraphTextureDesc{ SSAOWidth, SSAOHeight, VK_FORMAT_R8G8B8A8_UNORM, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT });
+		SSAOBlurYTex = createTexture("SSAOBlurY", RenderGraphTextureDesc{ SSAOWidth, SSAOHeight, VK_FORMAT_R8G8B8A8_UNORM, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT });
+
+		const RenderGraphResource ssao = SSAOTex, blurX = SSAOBlurXTex, blurY = SSAOBlurYTex;
+		const VulkanTexture rotate = rotateTex;
+		const BufferAttachment paramBuffer = SSAOParamBuffer;
+
+		addPass("SSAO", { depth }, { ssao }, [&ctx, depth, ssao, rotate, paramBuffer](RenderGraph& graph) {
+			return std::make_unique<QuadProcessor>(ctx, DescriptorSetInfo{ {paramBuffer}, {
+				fsTextureAttachment(graph.getTexture(depth)),
+				fsTextureAttachment(rotate)
+			}}, std::vector<VulkanTexture>{ graph.getTexture(ssao) }, (FilesystemUtilities::GetShadersDir() + "Vulkan/SSAO/SSAO.frag").c_str());
+		});
+
+		addPass("SSAOBlurX", { ssao }, { blurX }, [&ctx, ssao, blurX](RenderGraph& graph) {
+			return std::make_unique<QuadProcessor>(ctx, DescriptorSetInfo{ {}, {fsTextureAttachment(graph.getTexture(ssao))} },
+				std::vector<VulkanTexture>{ graph.getTexture(blurX) }, (FilesystemUtilities::GetShadersDir() + "Vulkan/SSAO/SSAOBlurX.frag").c_str());
+		});
+
+		addPass("SSAOBlurY", { blurX }, { blurY }, [&ctx, blurX, blurY](RenderGraph& graph) {
+			return std::make_unique<QuadProcessor>(ctx, DescriptorSetInfo{ {}, {fsTextureAttachment(graph.getTexture(blurX))} },
+				std::vector<VulkanTexture>{ graph.getTexture(blurY) }, (FilesystemUtilities::GetShadersDir() + "Vulkan/SSAO/SSAOBlurY.frag").c_str());
+		});
+
+		addPass("SSAOFinal", { color, blurY }, { output }, [&ctx, color, blurY, output, paramBuffer](RenderGraph& graph) {
+			return std::make_unique<QuadProcessor>(ctx, DescriptorSetInfo{ {paramBuffer}, {
+				fsTextureAttachment(graph.getTexture(color)),
+				fsTextureAttachment(graph.getTexture(blurY))
+			}}, std::vector<VulkanTexture>{ graph.getTexture(output) }, (FilesystemUtilities::GetShadersDir() + "Vulkan/SSAO/SSAOFinal.frag").c_str());
+		});
+
+		markOutput(SSAOBlurYTex);
+
+		if (keepIntermediates)
+		{
+			markOutput(SSAOTex);
+			markOutput(SSAOBlurXTex);
+		}
+
+		compile();
 	}
 
-	inline VulkanTexture getSSAO()   const { return SSAOTex; }
-	inline VulkanTexture getBlurX()  const { return SSAOBlurXTex; }
-	inline VulkanTexture getBlurY()  const { return SSAOBlurYTex; }
+	inline VulkanTexture getSSAO()   const { return getTexture(SSAOTex); }
+	inline VulkanTexture getBlurX()  const { return getTexture(SSAOBlurXTex); }
+	inline VulkanTexture getBlurY()  const { return getTexture(SSAOBlurYTex); }
 
 	struct Params
 	{
@@ -85,21 +86,7 @@ struct SSAOProcessor : public CompositeRenderer
 
 private:
 	VulkanTexture rotateTex;
-	VulkanTexture SSAOTex, SSAOBlurXTex, SSAOBlurYTex;
+	RenderGraphResource SSAOTex, SSAOBlurXTex, SSAOBlurYTex;
 
 	BufferAttachment SSAOParamBuffer;
-
-	QuadProcessor SSAO, BlurX, BlurY, SSAOFinal;
-
-	ColorToShaderOptimalBarrier ssaoColorToShader;
-	ShaderOptimalToColorBarrier ssaoShaderToColor;
-
-	ColorToShaderOptimalBarrier blurXColorToShader;
-	ShaderOptimalToColorBarrier blurXShaderToColor;
-
-	ColorToShaderOptimalBarrier blurYColorToShader;
-	ShaderOptimalToColorBarrier blurYShaderToColor;
-
-	ColorToShaderOptimalBarrier finalColorToShader;
-	ShaderOptimalToColorBarrier finalShaderToColor;
 };
@@ -1,7 +1,5 @@
 #include <RHI/Vulkan/Framework/FinalRenderer.hpp>
 
-#include <stb_image.h>
-
 #include <Filesystem/FilesystemUtilities.hpp>
 
 BaseMultiRenderer::BaseMultiRenderer(
@@ -23,7 +21,6 @@ BaseMultiRenderer::BaseMultiRenderer(
 	const uint32_t indirectDataSize = (uint32_t)sceneData_.shapes_.size() * sizeof(VkDrawIndirectCommand);
 
 	const size_t imgCount = ctx.vkDev.swapchainImages.size();
-	uniforms_.resize(imgCount);
 	shape_.resize(imgCount);
 	indirect_.resize(imgCount);
 
@@ -45,7 +42,7 @@ BaseMultiRenderer::BaseMultiRenderer(
 
 	DescriptorSetInfo dsInfo = {
 		{
-			uniformBufferAttachment(VulkanBuffer {},         0, uniformBufferSize, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT),
+			dynamicUniformBufferAttachment(ctx.frameData.getBuffer(), uniformBufferSize, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT),
 			sceneData_.vertexBuffer_,
 			sceneData_.indexBuffer_,
 			storageBufferAttachment(VulkanBuffer {},         0, shapesSize, VK_SHADER_STAGE_VERTEX_BIT),
@@ -64,7 +61,6 @@ BaseMultiRenderer::BaseMultiRenderer(
 
 	for (size_t i = 0; i != imgCount; i++)
 	{
-		uniforms_[i] = ctx.resources.addUniformBuffer(uniformBufferSize);
 		/*indirect_[i] = ctx.resources.addIndirectBuffer(indirectDataSize);
 		updateIndirectBuffers(i);*/
 
@@ -96,13 +92,15 @@ BaseMultiRenderer::BaseMultiRenderer(
 		shape_[i] = ctx.resources.addStorageBuffer(shapesSize);
 		uploadBufferData(ctx.vkDev, shape_[i].memory, 0, sceneData_.shapes_.data(), shapesSize);
 
-		dsInfo.buffers[0].buffer = uniforms_[i];
 		dsInfo.buffers[3].buffer = shape_[i];
 
 		descriptorSets_[i] = ctx.resources.addDescriptorSet(descriptorPool_, descriptorSetLayout_);
 		ctx.resources.updateDescriptorSet(descriptorSets_[i], dsInfo);
 	}
 
+	// the UBO offset, valid until the first updateBuffers()
+	dynamicOffsets_.assign(1, 0);
+
 	initPipeline({ vertShaderFile, fragShaderFile }, pInfo);
 }
 
@@ -121,11 +119,11 @@ void BaseMultiRenderer::fillCommandBuffer(VkCommandBuffer commandBuffer, size_t
 
 void BaseMultiRenderer::updateIndirectBuffers(size_t currentImage, bool* visibility)
 {
-	VkDrawIndirectCommand* data = nullptr;
-	vkMapMemory(ctx_.vkDev.device, indirect_[currentImage].memory, 0, sizeof(VkDrawIndirectCommand), 0, (void**)&data);
-
 	const uint32_t size = (uint32_t)indices_.size(); // (uint32_t)sceneData_.shapes_.size();
 
+	VkDrawIndirectCommand* data = nullptr;
+	vkMapMemory(ctx_.vkDev.device, indirect_[currentImage].memory, 0, size * sizeof(VkDrawIndirectCommand), 0, (void**)&data);
+
 	for (uint32_t i = 0; i != size; i++)
 	{
 		const uint32_t j = sceneData_.shapes_[indices_[i]].meshIndex;
@@ -141,11 +139,11 @@ void BaseMultiRenderer::updateIndirectBuffers(size_t currentImage, bool* visibil
 
 void BaseMultiRenderer::updateIndirectBuffersOptimized(VkDeviceMemory* indirectTransferMemory, bool* visibility)
 {
-	VkDrawIndirectCommand* data = nullptr;
-	vkMapMemory(ctx_.vkDev.device, *indirectTransferMemory, 0, sizeof(VkDrawIndirectCommand), 0, (void**)&data);
-
 	const uint32_t size = (uint32_t)indices_.size(); // (uint32_t)sceneData_.shapes_.size();
 
+	VkDrawIndirectCommand* data = nullptr;
+	vkMapMemory(ctx_.vkDev.device, *indirectTransferMemory, 0, size * sizeof(VkDrawIndirectCommand), 0, (void**)&data);
+
 	for (uint32_t i = 0; i != size; i++)
 	{
 		const uint32_t j = sceneData_.shapes_[indices_[i]].meshIndex;
@@ -166,18 +164,19 @@ FinalMultiRenderer::FinalMultiRenderer(
 	: Renderer(ctx)
 	, shadowColor(ctx_.resources.addColorTexture(ShadowSize, ShadowSize))
 	, shadowDepth(ctx_.resources.addDepthTexture(ShadowSize, ShadowSize))
-	, lightParams(ctx_.resources.addStorageBuffer(sizeof(LightParamsBuffer)))
-	, atomicBuffer(ctx_.resources.addStorageBuffer(sizeof(uint32_t)))
+	, lightParams(ctx_.resources.addStorageBuffer(sizeof(LightParamsBuffer), true))
+	, atomicBuffer(ctx_.resources.addStorageBuffer(sizeof(uint32_t), true))
 	, headsBuffer(ctx_.resources.addLocalDeviceStorageBuffer(ctx.vkDev.framebufferWidth* ctx.vkDev.framebufferHeight * sizeof(uint32_t)))
 	, oitBuffer(ctx_.resources.addLocalDeviceStorageBuffer(ctx.vkDev.framebufferWidth* ctx.vkDev.framebufferHeight * sizeof(TransparentFragment)))
 	, outputColor(ctx_.resources.addColorTexture(0, 0, LuminosityFormat))
 	, sceneData_(sceneData)
-	, opaqueRenderer(ctx, sceneData, getOpaqueIndices(sceneData), 
+	, opaqueRenderer(ctx, sceneData,
 		(FilesystemUtilities::GetShadersDir() + "Vulkan/ShadowMapping/SceneIBL.vert").c_str(),
 		(FilesystemUtilities::GetShadersDir() + "Vulkan/ShadowMapping/SceneIBL.frag").c_str(),
 		outputs, ctx_.resources.addRenderPass(outputs, RenderPassCreateInfo{false, false, eRenderPassBit_Offscreen }),
 		{ storageBufferAttachment(lightParams, 0, sizeof(LightParamsBuffer), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT) },
-		{ fsTextureAttachment(shadowDepth) })
+		{ fsTextureAttachment(shadowDepth) },
+		getOpaqueIndices(sceneData))
 
 	, transparentRenderer(ctx, sceneData, getTransparentIndices(sceneData),
 		(FilesystemUtilities::GetShadersDir() + "Vulkan/ShadowMapping/SceneIBL.vert").c_str(),
@@ -199,7 +198,7 @@ FinalMultiRenderer::FinalMultiRenderer(
 	, colorToAttachment(ctx_, outputs[0])
 	, depthToAttachment(ctx_, outputs[1])
 
-	, whBuffer(ctx_.resources.addUniformBuffer(sizeof(UBO)))
+	, whBuffer(ctx_.resources.addUniformBuffer(sizeof(UBO), true))
 
 	, clearOIT(ctx_, {{
 			uniformBufferAttachment(whBuffer,         0, sizeof(ubo_), VK_SHADER_STAGE_FRAGMENT_BIT),
@@ -279,33 +278,16 @@ void FinalMultiRenderer::updateBuffers(size_t currentImage)
 
 	shadowRenderer.updateBuffers(currentImage);
 
-	uint32_t zeroCount = 0;
-	uploadBufferData(ctx_.vkDev, atomicBuffer.memory, 0, &zeroCount, sizeof(uint32_t));
+	*static_cast<uint32_t*>(atomicBuffer.ptr) = 0;
 
-	uploadBufferData(ctx_.vkDev, whBuffer.memory, 0, &ubo_, sizeof(ubo_));
+	memcpy(whBuffer.ptr, &ubo_, sizeof(ubo_));
 }
 
 bool FinalMultiRenderer::checkLoadedTextures()
 {
-	VKSceneData::LoadedImageData data;
-
-	{
-		std::lock_guard lock(sceneData_.loadedFilesMutex_);
-
-		if (sceneData_.loadedFiles_.empty())
-			return false;
-
-		data = sceneData_.loadedFiles_.back();
-
-		sceneData_.loadedFiles_.pop_back();
-	}
-
-	auto newTexture = ctx_.resources.addRGBATexture(data.w_, data.h_, const_cast<uint8_t*>(data.img_));
-
-	transparentRenderer.updateTexture(data.index_, newTexture, 14);
-	opaqueRenderer.updateTexture(data.index_, newTexture, 11);
-
-	stbi_image_free((void*)data.img_);
-
-	return true;
+	return sceneData_.streamTextures(proj_, view_, [this](uint32_t index, VulkanTexture texture)
+		{
+			transparentRenderer.updateTexture(index, texture, 14);
+			opaqueRenderer.updateTexture(index, texture, 11);
+		});
 }
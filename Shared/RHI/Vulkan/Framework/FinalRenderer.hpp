@@ -39,7 +39,7 @@ struct BaseMultiRenderer : public Renderer
 	void fillCommandBuffer(VkCommandBuffer cmdBuffer, size_t currentImage, VkFramebuffer fb = VK_NULL_HANDLE, VkRenderPass rp = VK_NULL_HANDLE) override;
 
 	void updateBuffers(size_t currentImage) override {
-		updateUniformBuffer((uint32_t)currentImage, 0, sizeof(ubo_), &ubo_);
+		*ctx_.frameData.allocate<UBO>(1, dynamicOffsets_[0]) = ubo_;
 	}
 
 	inline void setMatrices(const glm::mat4& proj, const glm::mat4& view) {
@@ -123,7 +123,9 @@ struct TransparentFragment {
 
 /**
 	This the final variant of the scene rendering class
-	It manages lists of opaque/transparent objects and uses two BaseMultiRenderer instances
+	It manages lists of opaque/transparent objects: the opaque ones are drawn by a MultiRenderer
+	(its pass loads the outputs and leaves them readable, so setOcclusionCulling() can enable occlusion culling; off by default),
+	the transparent ones by a BaseMultiRenderer
 	The transparent objects renderer fills the auxilliary OIT linked list buffer (see VK02_Glass.frag shader)
 	and clears this per-pixel transparent fragment linked list at each frame
 	OIT buffer composition is also performed by this class
@@ -152,13 +154,16 @@ struct FinalMultiRenderer : public Renderer
 	inline void setMatrices(const glm::mat4& proj, const glm::mat4& view) {
 		transparentRenderer.setMatrices(proj, view);
 		opaqueRenderer.setMatrices(proj, view);
+		// for the texture streaming priorities, flipped like BaseMultiRenderer::setMatrices() does
+		proj_ = proj;
+		view_ = view * glm::scale(glm::mat4(1.f), glm::vec3(1.f, -1.f, 1.f));
 	}
 
 	inline void setLightParameters(const glm::mat4& lightProj, const glm::mat4& lightView)
 	{
 		const LightParamsBuffer lightParamsBuffer{ lightProj, lightView, ctx_.vkDev.framebufferWidth, ctx_.vkDev.framebufferHeight };
 
-		uploadBufferData(ctx_.vkDev, lightParams.memory, 0, &lightParamsBuffer, sizeof(LightParamsBuffer));
+		memcpy(lightParams.ptr, &lightParamsBuffer, sizeof(LightParamsBuffer));
 
 		shadowRenderer.setMatrices(lightProj, lightView);
 	}
@@ -171,6 +176,13 @@ struct FinalMultiRenderer : public Renderer
 
 	inline const VKSceneData& getSceneData() const { return sceneData_; }
 
+	inline bool setOcclusionCulling(bool enable) { return opaqueRenderer.setOcclusionCulling(enable); }
+	inline bool isOcclusionCullingEnabled() const { return opaqueRenderer.isOcclusionCullingEnabled(); }
+	inline void setCullingMode(eCullingMode mode) { opaqueRenderer.setCullingMode(mode); }
+	inline eCullingMode getCullingMode() const { return opaqueRenderer.getCullingMode(); }
+	/* The opaque objects only */
+	inline const MultiRenderer::CullingStats& getCullingStats() const { return opaqueRenderer.getCullingStats(); }
+
 	bool checkLoadedTextures();
 
 	VulkanTexture shadowColor;
@@ -190,8 +202,11 @@ struct FinalMultiRenderer : public Renderer
 private:
 	VKSceneData& sceneData_;
 
+	glm::mat4 proj_ = glm::mat4(1.0f);
+	glm::mat4 view_ = glm::mat4(1.0f);
+
 	BaseMultiRenderer transparentRenderer;
-	BaseMultiRenderer opaqueRenderer;
+	MultiRenderer opaqueRenderer;
 
 	BaseMultiRenderer shadowRenderer;
 
@@ -74,8 +74,7 @@ void GuiRenderer::updateBuffers(size_t currentImage)
 	const mat4 inMtx = glm::ortho(L, R, T, B);
 	updateUniformBuffer(currentImage, 0, sizeof(mat4), glm::value_ptr(inMtx));
 
-	void* data = nullptr;
-	vkMapMemory(ctx_.vkDev.device, storages_[currentImage].memory, 0, storages_[currentImage].size, 0, &data);
+	void* data = storages_[currentImage].ptr;
 
 	ImDrawVert* vtx = (ImDrawVert*)data;
 	for (int n = 0; n < drawData->CmdListsCount; n++)
@@ -94,8 +93,6 @@ void GuiRenderer::updateBuffers(size_t currentImage)
 		for (int j = 0; j < cmdList->IdxBuffer.Size; j++)
 			*idx++ = (uint32_t)*src++;
 	}
-
-	vkUnmapMemory(ctx_.vkDev.device, storages_[currentImage].memory);
 }
 
 GuiRenderer::GuiRenderer(VulkanRenderContext& ctx, const std::vector<VulkanTexture>& textures, RenderPass renderPass)
@@ -131,8 +128,8 @@ GuiRenderer::GuiRenderer(VulkanRenderContext& ctx, const std::vector<VulkanTextu
 
 	for (size_t i = 0; i < imgCount; i++)
 	{
-		uniforms_[i] = ctx.resources.addUniformBuffer(sizeof(mat4));
-		storages_[i] = ctx.resources.addStorageBuffer(bufferSize);
+		uniforms_[i] = ctx.resources.addUniformBuffer(sizeof(mat4), true);
+		storages_[i] = ctx.resources.addStorageBuffer(bufferSize, true);
 
 		dsInfo.buffers[0].buffer = uniforms_[i];
 		dsInfo.buffers[1].buffer = storages_[i];
@@ -13,7 +13,7 @@ void InfinitePlaneRenderer::fillCommandBuffer(VkCommandBuffer commandBuffer, siz
 void InfinitePlaneRenderer::updateBuffers(size_t currentImage)
 {
 	const UniformBuffer ubo = { proj_, view_, model_, (float)glfwGetTime() };
-	uploadBufferData(ctx_.vkDev, uniforms_[currentImage].memory, 0, &ubo, sizeof(ubo));
+	updateUniformBuffer((uint32_t)currentImage, 0, sizeof(ubo), &ubo);
 }
 
 InfinitePlaneRenderer::InfinitePlaneRenderer(VulkanRenderContext& ctx,
@@ -35,7 +35,7 @@ InfinitePlaneRenderer::InfinitePlaneRenderer(VulkanRenderContext& ctx,
 
 	for(size_t i = 0; i != imgCount; i++)
 	{
-		uniforms_[i] = ctx.resources.addUniformBuffer(sizeof(UniformBuffer));
+		uniforms_[i] = ctx.resources.addUniformBuffer(sizeof(UniformBuffer), true);
 		dsInfo.buffers[0].buffer = uniforms_[i];
 
 		descriptorSets_[i] = ctx.resources.addDescriptorSet(descriptorPool_, descriptorSetLayout_);
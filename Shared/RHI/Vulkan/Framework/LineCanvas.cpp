@@ -37,8 +37,8 @@ LineCanvas::LineCanvas(VulkanRenderContext& ctx,
 
 	for(size_t i = 0; i < imgCount; i++)
 	{
-		uniforms_[i] = ctx.resources.addUniformBuffer(sizeof(UniformBuffer));
-		storages_[i] = ctx.resources.addStorageBuffer(kMaxLinesDataSize);
+		uniforms_[i] = ctx.resources.addUniformBuffer(sizeof(UniformBuffer), true);
+		storages_[i] = ctx.resources.addStorageBuffer(kMaxLinesDataSize, true);
 
 		dsInfo.buffers[0].buffer = uniforms_[i];
 		dsInfo.buffers[1].buffer = storages_[i];
@@ -57,7 +57,7 @@ void LineCanvas::updateBuffers(size_t currentImage)
 
 	const VkDeviceSize bufferSize = lines_.size() * sizeof(VertexData);
 
-	uploadBufferData(ctx_.vkDev, storages_[currentImage].memory, 0, lines_.data(), bufferSize);
+	memcpy(storages_[currentImage].ptr, lines_.data(), bufferSize);
 
 	const UniformBuffer ubo = {
 		mvp_,
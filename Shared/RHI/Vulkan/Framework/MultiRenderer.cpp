@@ -5,8 +5,30 @@
 #include <stb_image.h>
 
 #include <Filesystem/FilesystemUtilities.hpp>
+#include <RHI/Vulkan/Framework/Barriers.hpp>
+#include <RHI/Vulkan/Framework/Effects/DepthPyramid.hpp>
+#include <Scene/AssetConverter.hpp>
 #include "ImageUtils.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static uint32_t findFirstSetBit(uint32_t v)
+{
+#if defined(_MSC_VER)
+	unsigned long i;
+	_BitScanForward(&i, v);
+	return uint32_t(i);
+#else
+	return uint32_t(__builtin_ctz(v));
+#endif
+}
+
 VKSceneData::VKSceneData(VulkanRenderContext& ctx,
 	const char* meshFile,
 	const char* sceneFile,
@@ -20,12 +42,20 @@ VKSceneData::VKSceneData(VulkanRenderContext& ctx,
 {
 	brdfLUT_ = ctx_.resources.loadKTX((FilesystemUtilities::GetResourcesDir() + "Data/brdfLUT.ktx").c_str());
 
-	loadMaterials(materialFile, materials_, textureFiles_);
+	// the texture loaders are not started yet, [executor_] is free for the texture compression
+	loadMaterials(getMaterialFileToLoad(materialFile, &executor_).c_str(), materials_, textureFiles_);
 
 	std::vector<VulkanTexture> textures;
 	for(const auto& f : textureFiles_)
 	{
-		auto t = asyncLoad ? ctx_.resources.addSolidRGBATexture() : ctx_.resources.loadTexture2D((FilesystemUtilities::GetResourcesDir() + f).c_str());
+		VulkanTexture t;
+		TextureLevelsView levels;
+		if (asyncLoad)
+			t = ctx_.resources.addSolidRGBATexture();
+		else if (textureCache_.loadLevels(FilesystemUtilities::GetResourcesDir() + f, levels))
+			t = ctx_.resources.addMIPTexture(levels);
+		else
+			t = ctx_.resources.loadTexture2D((FilesystemUtilities::GetResourcesDir() + f).c_str());
 		textures.push_back(t);
 #if 0
 		if (t.image.image != nullptr)
@@ -33,24 +63,6 @@ VKSceneData::VKSceneData(VulkanRenderContext& ctx,
 #endif
 	}
 
-	if(asyncLoad)
-	{
-		loadedFiles_.reserve(textureFiles_.size());
-
-		taskflow_.for_each_index(0u, (uint32_t)textureFiles_.size(), 1u, [this](int idx)
-			{
-				int w, h;
-				const uint8_t* img = stbi_load((FilesystemUtilities::GetResourcesDir() + this->textureFiles_[idx]).c_str(), &w, &h, nullptr, STBI_rgb_alpha);
-				if (!img)
-					img = genDefaultCheckboardImage(&w, &h);
-				std::lock_guard lock(loadedFilesMutex_);
-				loadedFiles_.emplace_back(LoadedImageData{idx, w, h, img });
-			}
-		);
-
-		executor_.run(taskflow_);
-	}
-
 	allMaterialTextures = fsTextureArrayAttachment(textures);
 
 	const uint32_t materialsSize = static_cast<uint32_t>(sizeof(MaterialDescription) * materials_.size());
@@ -84,28 +96,135 @@ VKSceneData::VKSceneData(VulkanRenderContext& ctx,
 
 	loadMeshes(meshFile);
 	loadScene(sceneFile);
+
+	// the priorities need the shapes
+	if (asyncLoad)
+		startTextureLoaders();
+}
+
+void VKSceneData::startTextureLoaders()
+{
+	streamer_ = std::make_unique<TextureStreamer>(textureFiles_.size(), materials_, shapes_);
+
+	loadedFiles_.reset(textureFiles_.size());
+	levelsOwners_.resize(textureFiles_.size());
+	isStreamedTexture_.resize(textureFiles_.size(), 0);
+
+	loadStartTime_ = std::chrono::steady_clock::now();
+
+	// every worker keeps taking the most important texture not requested yet
+	const uint32_t numLoaders = std::max(1u, (uint32_t)executor_.num_workers());
+
+	taskflow_.for_each_index(0u, numLoaders, 1u, [this](int)
+		{
+			uint32_t idx = 0;
+			while (streamer_->acquireNextLoad(idx))
+			{
+				TextureLevelsView levels;
+				auto owner = textureCache_.loadLevels(FilesystemUtilities::GetResourcesDir() + this->textureFiles_[idx], levels);
+				if (owner)
+				{
+					loadedFiles_.push(LoadedImageData{ int(idx), levels.w_, levels.h_, nullptr, levels, owner });
+					continue;
+				}
+
+				int w, h;
+				const uint8_t* img = genDefaultCheckboardImage(&w, &h);
+				loadedFiles_.push(LoadedImageData{ int(idx), w, h, img });
+			}
+		}
+	);
+
+	executor_.run(taskflow_);
+}
+
+void VKSceneData::replaceTexture(uint32_t index, VulkanTexture texture, const std::function<void(uint32_t, VulkanTexture)>& updateTexture)
+{
+	updateTexture(index, texture);
+
+	if (isStreamedTexture_[index])
+		retiredTextures_.push_back(RetiredTexture{ allMaterialTextures.textures[index], streamingFrame_ + ctx_.vkDev.swapchainImages.size() + 1 });
+
+	allMaterialTextures.textures[index] = texture;
+	isStreamedTexture_[index] = 1;
+}
+
+bool VKSceneData::streamTextures(const glm::mat4& proj, const glm::mat4& view, const std::function<void(uint32_t index, VulkanTexture texture)>& updateTexture)
+{
+	if (!streamer_)
+		return false;
+
+	streamingFrame_++;
+
+	auto retired = std::remove_if(retiredTextures_.begin(), retiredTextures_.end(), [this](const RetiredTexture& t)
+		{
+			if (t.releaseFrame_ > streamingFrame_)
+				return false;
+			ctx_.resources.releaseTexture(t.texture_);
+			return true;
+		});
+	retiredTextures_.erase(retired, retiredTextures_.end());
+
+	// handing the CPU levels to the streamer is cheap, take everything the loaders have finished since the last frame
+	const size_t numLoaded = loadedFiles_.drain([this, &updateTexture](LoadedImageData&& data)
+		{
+			if (data.levelsOwner_)
+			{
+				levelsOwners_[data.index_] = std::move(data.levelsOwner_);
+				streamer_->setLevels(data.index_, data.levels_);
+				return true;
+			}
+
+			streamer_->setFailed(data.index_);
+			replaceTexture(data.index_, ctx_.resources.addRGBATexture(data.w_, data.h_, const_cast<uint8_t*>(data.img_)), updateTexture);
+			stbi_image_free((void*)data.img_);
+			return true;
+		});
+
+	streamer_->updatePriorities(view, proj[1][1] * float(ctx_.vkDev.framebufferHeight) * 0.5f, shapeTransforms_, meshData_.boxes_);
+	streamer_->planUpdates(streamingUpdates_);
+
+	for (const TextureStreamingUpdate& u : streamingUpdates_)
+		replaceTexture(u.index_, ctx_.resources.addMIPTexture(streamer_->getLevels(u.index_).getMipTail(u.firstLevel_)), updateTexture);
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStartTime_).count();
+
+	if (!reportedTails_ && streamer_->areTailsResident())
+	{
+		printf("Texture streaming: all %u mip tails resident after %.2f s\n", (uint32_t)textureFiles_.size(), seconds);
+		reportedTails_ = true;
+	}
+
+	if (!reportedComplete_ && streamer_->isComplete())
+	{
+		printf("Texture streaming: wanted levels resident after %.2f s, %.1f MB\n", seconds, double(streamer_->getResidentBytes()) / (1024.0 * 1024.0));
+		ctx_.resources.printMemoryStats();
+		reportedComplete_ = true;
+	}
+
+	return numLoaded > 0 || !streamingUpdates_.empty();
 }
 
 void VKSceneData::loadMeshes(const char* meshFile)
 {
-	MeshFileHeader header = loadMeshData(meshFile, meshData_);
+	// upload index/vertex data straight from the mapped file, only the mesh descriptors and boxes are copied
+	MappedMeshData mapping;
+	if (!mapping.open(meshFile))
+		exit(EXIT_FAILURE);
+
+	mapping.copyDescriptors(meshData_);
+
+	const MeshFileHeader& header = mapping.getHeader();
 
 	const uint32_t indexBufferSize = header.indexDataSize;
-	uint32_t vertexBufferSize = header.vertexDataSize;
+	const uint32_t vertexDataSize = header.vertexDataSize;
+	uint32_t vertexBufferSize = vertexDataSize;
 
 	const uint32_t offsetAlignment = getVulkanBufferAlignment(ctx_.vkDev);
 	if((vertexBufferSize & (offsetAlignment - 1)) != 0)
-	{
-		const size_t numFloats = (offsetAlignment - (vertexBufferSize & (offsetAlignment - 1))) / sizeof(float);
-		for (size_t i = 0; i != numFloats; i++)
-			meshData_.vertexData_.push_back(0);
 		vertexBufferSize = (vertexBufferSize + offsetAlignment) & ~(offsetAlignment - 1);
-	}
 
-	//VulkanBuffer storage = ctx_.resources.addStorageBuffer(vertexBufferSize + indexBufferSize);
-	//uploadBufferData(ctx_.vkDev, storage.memory, 0, meshData_.vertexData_.data(), vertexBufferSize);
-	//uploadBufferData(ctx_.vkDev, storage.memory, vertexBufferSize, meshData_.indexData_.data(), indexBufferSize);
-	VulkanBuffer storage = ctx_.resources.addVertexBuffer(indexBufferSize, meshData_.indexData_.data(), vertexBufferSize, meshData_.vertexData_.data());
+	VulkanBuffer storage = ctx_.resources.addVertexBuffer(indexBufferSize, mapping.getIndexData(), vertexDataSize, mapping.getVertexData(), vertexBufferSize - vertexDataSize);
 
 	vertexBuffer_ = BufferAttachment{ {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT}, storage, 0, vertexBufferSize };
 	indexBuffer_ = BufferAttachment{ {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT}, storage, vertexBufferSize, indexBufferSize };
@@ -113,7 +232,9 @@ void VKSceneData::loadMeshes(const char* meshFile)
 
 void VKSceneData::loadScene(const char* sceneFile)
 {
-	::loadScene(sceneFile, scene_);
+	// the scene graph views show the node names
+	if (!::loadScene(sceneFile, scene_))
+		exit(EXIT_FAILURE);
 
 	// prepare draw data buffer
 	for(const auto& c : scene_.meshes_)
@@ -132,11 +253,15 @@ void VKSceneData::loadScene(const char* sceneFile)
 		shapes_.push_back(data);
 	}
 
+	// rewritten whenever the transforms change, mapped once instead of for every upload
 	shapeTransforms_.resize(shapes_.size());
-	transforms_ = ctx_.resources.addStorageBuffer(shapes_.size() * sizeof(glm::mat4));
+	transforms_ = ctx_.resources.addStorageBuffer(shapes_.size() * sizeof(glm::mat4), true);
+	boxes_ = ctx_.resources.addStorageBuffer(shapes_.size() * sizeof(BoundingBox), true);
 
 	recalculateAllTransforms();
 	uploadGlobalTransforms();
+
+	buildSceneBVH(bvh_, scene_, meshData_, shapes_);
 }
 
 void VKSceneData::updateMaterial(int matIdx)
@@ -156,13 +281,50 @@ void VKSceneData::recalculateAllTransforms()
 {
 	// force recalculation of global transformations
 	markAsChanged(scene_, 0);
-	recalculateGlobalTransforms(scene_);
+	recalculateChangedTransforms();
+}
+
+void VKSceneData::recalculateChangedTransforms()
+{
+	// the shapes to refit come from the change lists, which recalculateGlobalTransforms() clears
+	collectChangedShapes(bvh_, scene_);
+	recalculateGlobalTransforms(scene_, transformExecutor_);
+	refitSceneBVH(bvh_, scene_, meshData_, shapes_);
 }
 
 void VKSceneData::uploadGlobalTransforms()
 {
 	convertGlobalToShapeTransforms();
-	uploadBufferData(ctx_.vkDev, transforms_.memory, 0, shapeTransforms_.data(), transforms_.size);
+	memcpy(transforms_.ptr, shapeTransforms_.data(), shapeTransforms_.size() * sizeof(glm::mat4));
+
+	updateCullingBoxes();
+}
+
+void VKSceneData::updateCullingBoxes()
+{
+	shapeBoxes_.resize(shapes_.size());
+	cullingBoxes_.resize(shapes_.size());
+
+	// the hierarchy is built after the first upload
+	const bool refitBVH = (bvh_.shapeBoxes_.size() == shapes_.size());
+
+	for (size_t i = 0; i != shapes_.size(); i++)
+	{
+		shapeBoxes_[i] = meshData_.boxes_[shapes_[i].meshIndex].getTransformed(shapeTransforms_[i]);
+		cullingBoxes_.set(i, shapeBoxes_[i]);
+
+		// global transforms written directly (as the physics demo does) skip recalculateChangedTransforms() and its refit
+		if (refitBVH && !bvh_.isShapeChanged_[i] && (bvh_.shapeBoxes_[i].min_ != shapeBoxes_[i].min_ || bvh_.shapeBoxes_[i].max_ != shapeBoxes_[i].max_))
+		{
+			bvh_.isShapeChanged_[i] = true;
+			bvh_.changedShapes_.push_back((uint32_t)i);
+		}
+	}
+
+	memcpy(boxes_.ptr, shapeBoxes_.data(), shapeBoxes_.size() * sizeof(BoundingBox));
+
+	if (refitBVH)
+		refitSceneBVH(bvh_, scene_, meshData_, shapes_);
 }
 
 MultiRenderer::MultiRenderer(
@@ -173,18 +335,37 @@ MultiRenderer::MultiRenderer(
 	const std::vector<VulkanTexture>& outputs,
 	RenderPass screenRenderPass,
 	const std::vector<BufferAttachment>& auxBuffers,
-	const std::vector<TextureAttachment>& auxTextures)
+	const std::vector<TextureAttachment>& auxTextures,
+	const std::vector<int>& objectIndices)
 	: Renderer(ctx)
 	, sceneData_(sceneData)
+	, outputs_(outputs)
 {
 	const PipelineInfo pInfo = initRenderPass(PipelineInfo{}, outputs, screenRenderPass, ctx.screenRenderPass);
 
-	const uint32_t indirectDataSize = (uint32_t)sceneData_.shapes_.size() * sizeof(VkDrawIndirectCommand);
+	if (objectIndices.empty())
+	{
+		shapeIndices_.resize(sceneData_.shapes_.size());
+		std::iota(shapeIndices_.begin(), shapeIndices_.end(), 0u);
+	}
+	else
+	{
+		shapeIndices_.assign(objectIndices.begin(), objectIndices.end());
+
+		drawMask_.assign((sceneData_.shapes_.size() + 31) / 32, 0u);
+		for (uint32_t shape : shapeIndices_)
+			drawMask_[shape >> 5] |= 1u << (shape & 31);
+	}
+
+	const uint32_t numDraws = (uint32_t)shapeIndices_.size();
+	const uint32_t indirectDataSize = numDraws * sizeof(VkDrawIndirectCommand);
 
 	const size_t imgCount = ctx.vkDev.swapchainImages.size();
-	uniforms_.resize(imgCount);
 	shape_.resize(imgCount);
 	indirect_.resize(imgCount);
+	count_.resize(imgCount);
+	drawCount_.assign(imgCount, numDraws);
+	visibilityMasks_.resize(imgCount);
 
 	descriptorSets_.resize(imgCount);
 
@@ -204,7 +385,7 @@ MultiRenderer::MultiRenderer(
 
 	DescriptorSetInfo dsInfo{};
 	dsInfo.buffers = {
-		uniformBufferAttachment(VulkanBuffer{},			0, uniformBufferSize, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT),
+		dynamicUniformBufferAttachment(ctx.frameData.getBuffer(), uniformBufferSize, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT),
 		sceneData_.vertexBuffer_,
 		sceneData_.indexBuffer_,
 		storageBufferAttachment(VulkanBuffer{},			0, shapesSize, VK_SHADER_STAGE_VERTEX_BIT),
@@ -222,78 +403,651 @@ MultiRenderer::MultiRenderer(
 
 	for(size_t i = 0; i != imgCount; i++)
 	{
-		uniforms_[i] = ctx.resources.addUniformBuffer(uniformBufferSize);
-		indirect_[i] = ctx.resources.addIndirectBuffer(indirectDataSize);
+		indirect_[i] = ctx.resources.addIndirectBuffer(indirectDataSize, true);
 		updateIndirectBuffers(i);
 
 		shape_[i] = ctx.resources.addStorageBuffer(shapesSize);
 		uploadBufferData(ctx.vkDev, shape_[i].memory, 0, sceneData_.shapes_.data(), shapesSize);
 
-		dsInfo.buffers[0].buffer = uniforms_[i];
 		dsInfo.buffers[3].buffer = shape_[i];
 
 		descriptorSets_[i] = ctx.resources.addDescriptorSet(descriptorPool_, descriptorSetLayout_);
 		ctx.resources.updateDescriptorSet(descriptorSets_[i], dsInfo);
 	}
 
+	// the UBO offset, valid until the first updateBuffers()
+	dynamicOffsets_.assign(1, 0);
+
 	initPipeline({ vertShaderFile, fragShaderFile }, pInfo);
+
+	// Frustum culling: the shader copies the commands of the visible draws from allDraws_ to indirect_
+	allDraws_ = ctx.resources.addStorageBuffer(indirectDataSize);
+	uploadBufferData(ctx.vkDev, allDraws_.memory, 0, indirect_[0].ptr, indirectDataSize);
+
+	DescriptorSetInfo cullingInfo{};
+	cullingInfo.buffers = {
+		dynamicUniformBufferAttachment(ctx.frameData.getBuffer(), sizeof(CullingData), VK_SHADER_STAGE_COMPUTE_BIT),
+		storageBufferAttachment(sceneData_.boxes_,	0, (uint32_t)sceneData_.boxes_.size, VK_SHADER_STAGE_COMPUTE_BIT),
+		storageBufferAttachment(allDraws_,			0, indirectDataSize, VK_SHADER_STAGE_COMPUTE_BIT),
+		storageBufferAttachment(VulkanBuffer{},		0, indirectDataSize, VK_SHADER_STAGE_COMPUTE_BIT),
+		storageBufferAttachment(VulkanBuffer{},		0, sizeof(uint32_t), VK_SHADER_STAGE_COMPUTE_BIT)
+	};
+
+	cullingDescriptorSetLayout_ = ctx.resources.addDescriptorSetLayout(cullingInfo);
+	cullingDescriptorPool_ = ctx.resources.addDescriptorPool(cullingInfo, (uint32_t)imgCount);
+	cullingDescriptorSets_.resize(imgCount);
+
+	for (size_t i = 0; i != imgCount; i++)
+	{
+		count_[i] = ctx.resources.addIndirectBuffer(sizeof(uint32_t), true);
+		*static_cast<uint32_t*>(count_[i].ptr) = 0;
+
+		cullingInfo.buffers[3].buffer = indirect_[i];
+		cullingInfo.buffers[4].buffer = count_[i];
+
+		cullingDescriptorSets_[i] = ctx.resources.addDescriptorSet(cullingDescriptorPool_, cullingDescriptorSetLayout_);
+		ctx.resources.updateDescriptorSet(cullingDescriptorSets_[i], cullingInfo);
+	}
+
+	cullingPipelineLayout_ = ctx.resources.addPipelineLayout(cullingDescriptorSetLayout_);
+	cullingPipeline_ = ctx.resources.addComputePipeline(DefaultMeshCullingShader, cullingPipelineLayout_);
+
+	setCullingMode(cullingMode_);
+}
+
+MultiRenderer::~MultiRenderer()
+{
+	if (queryPool_ != VK_NULL_HANDLE)
+		vkDestroyQueryPool(ctx_.vkDev.device, queryPool_, nullptr);
+}
+
+void MultiRenderer::setCullingMode(eCullingMode mode)
+{
+	if ((mode == eCullingMode_GPU || mode == eCullingMode_Verify) && !vkCmdDrawIndirectCountKHR)
+	{
+		printf("MultiRenderer: vkCmdDrawIndirectCountKHR is not available, culling on the CPU\n");
+		mode = eCullingMode_CPU;
+	}
+
+	cullingMode_ = mode;
+
+	// the commands of the other modes are compacted, restore the full lists
+	if (mode == eCullingMode_None)
+		for (size_t i = 0; i != indirect_.size(); i++)
+		{
+			updateIndirectBuffers(i);
+			drawCount_[i] = (uint32_t)shapeIndices_.size();
+		}
+
+	for (auto& mask : visibilityMasks_)
+		mask.clear();
+
+	std::fill(occlusionFrames_.begin(), occlusionFrames_.end(), 0);
+}
+
+bool MultiRenderer::setOcclusionCulling(bool enable)
+{
+	if (!enable || depthPyramid_)
+	{
+		occlusionCulling_ = enable;
+		pyramidValid_ = false;
+		std::fill(occlusionFrames_.begin(), occlusionFrames_.end(), 0);
+		return true;
+	}
+
+	const auto depth = std::find_if(outputs_.begin(), outputs_.end(), [](const VulkanTexture& t) { return isDepthFormat(t.format); });
+	const RenderPassCreateInfo& info = renderPass_.info;
+
+	// the second phase draws over the first one and the pyramid samples the depth
+	if (depth == outputs_.end() || !(info.flags_ & eRenderPassBit_Offscreen) || (info.flags_ & eRenderPassBit_First) || info.clearColor_ || info.clearDepth_)
+	{
+		printf("MultiRenderer: occlusion culling needs offscreen color and depth outputs which the render pass keeps\n");
+		return false;
+	}
+
+	depthPyramid_ = std::make_unique<DepthPyramid>(ctx_, *depth);
+
+	// an internal offscreen pass starts from the layout the first phase and the pyramid leave the outputs in
+	if (!(info.flags_ & eRenderPassBit_OffscreenInternal))
+		for (const VulkanTexture& t : outputs_)
+			if (isDepthFormat(t.format))
+				toAttachment_.push_back(std::make_unique<ShaderOptimalToDepthBarrier>(ctx_, t));
+			else
+				toAttachment_.push_back(std::make_unique<ShaderOptimalToColorBarrier>(ctx_, t));
+
+	const size_t imgCount = indirect_.size();
+	const uint32_t numDraws = (uint32_t)shapeIndices_.size();
+	const uint32_t indirectDataSize = numDraws * sizeof(VkDrawIndirectCommand);
+
+	lateIndirect_.resize(imgCount);
+	lateCount_.resize(imgCount);
+	numOccluded_.resize(imgCount);
+
+	drawStates_ = ctx_.resources.addLocalDeviceStorageBuffer(numDraws * sizeof(uint32_t));
+
+	TextureArrayAttachment pyramidLevels{};
+	pyramidLevels.dInfo.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	pyramidLevels.dInfo.shaderStageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pyramidLevels.textures = depthPyramid_->getLevels();
+
+	DescriptorSetInfo occlusionInfo{};
+	occlusionInfo.buffers = {
+		dynamicUniformBufferAttachment(ctx_.frameData.getBuffer(), sizeof(CullingData), VK_SHADER_STAGE_COMPUTE_BIT),
+		storageBufferAttachment(sceneData_.boxes_,	0, (uint32_t)sceneData_.boxes_.size, VK_SHADER_STAGE_COMPUTE_BIT),
+		storageBufferAttachment(allDraws_,			0, indirectDataSize, VK_SHADER_STAGE_COMPUTE_BIT),
+		storageBufferAttachment(VulkanBuffer{},		0, indirectDataSize, VK_SHADER_STAGE_COMPUTE_BIT),
+		storageBufferAttachment(VulkanBuffer{},		0, sizeof(uint32_t), VK_SHADER_STAGE_COMPUTE_BIT),
+		storageBufferAttachment(drawStates_,		0, numDraws * sizeof(uint32_t), VK_SHADER_STAGE_COMPUTE_BIT),
+		storageBufferAttachment(VulkanBuffer{},		0, sizeof(uint32_t), VK_SHADER_STAGE_COMPUTE_BIT)
+	};
+	occlusionInfo.textureArrays = { pyramidLevels };
+
+	occlusionDescriptorSetLayout_ = ctx_.resources.addDescriptorSetLayout(occlusionInfo);
+	occlusionDescriptorPool_ = ctx_.resources.addDescriptorPool(occlusionInfo, (uint32_t)imgCount * 2);
+	occlusionDescriptorSets_.resize(imgCount * 2);
+
+	for (size_t i = 0; i != imgCount; i++)
+	{
+		// mapped for eCullingMode_Verify
+		lateIndirect_[i] = ctx_.resources.addIndirectBuffer(indirectDataSize, true);
+		lateCount_[i] = ctx_.resources.addIndirectBuffer(sizeof(uint32_t), true);
+		numOccluded_[i] = ctx_.resources.addStorageBuffer(sizeof(uint32_t), true);
+
+		occlusionInfo.buffers[6].buffer = numOccluded_[i];
+
+		// the phases write their own command lists and counters
+		for (size_t phase = 0; phase != 2; phase++)
+		{
+			occlusionInfo.buffers[3].buffer = phase ? lateIndirect_[i] : indirect_[i];
+			occlusionInfo.buffers[4].buffer = phase ? lateCount_[i] : count_[i];
+
+			occlusionDescriptorSets_[i * 2 + phase] = ctx_.resources.addDescriptorSet(occlusionDescriptorPool_, occlusionDescriptorSetLayout_);
+			ctx_.resources.updateDescriptorSet(occlusionDescriptorSets_[i * 2 + phase], occlusionInfo);
+		}
+	}
+
+	occlusionPipelineLayout_ = ctx_.resources.addPipelineLayout(occlusionDescriptorSetLayout_);
+	occlusionPipeline_ = ctx_.resources.addComputePipeline(DefaultMeshOcclusionShader, occlusionPipelineLayout_);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(ctx_.vkDev.physicalDevice, &properties);
+
+	if (properties.limits.timestampComputeAndGraphics)
+	{
+		VkQueryPoolCreateInfo queryPoolInfo{};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = NumTimestamps * (uint32_t)imgCount;
+
+		VK_CHECK(vkCreateQueryPool(ctx_.vkDev.device, &queryPoolInfo, nullptr, &queryPool_));
+		timestampPeriod_ = properties.limits.timestampPeriod;
+	}
+
+	occlusionFrames_.assign(imgCount, 0);
+	occlusionCulling_ = true;
+	pyramidValid_ = false;
+
+	return true;
 }
 
 void MultiRenderer::fillCommandBuffer(VkCommandBuffer commandBuffer, size_t currentImage, VkFramebuffer fb, VkRenderPass rp)
 {
-	beginRenderPass((rp != VK_NULL_HANDLE) ? rp : renderPass_.handle, (fb != VK_NULL_HANDLE) ? fb : framebuffer_, commandBuffer, currentImage);
+	const VkRenderPass renderPass = (rp != VK_NULL_HANDLE) ? rp : renderPass_.handle;
+	const VkFramebuffer framebuffer = (fb != VK_NULL_HANDLE) ? fb : framebuffer_;
+
+	if (useOcclusionCulling())
+	{
+		fillOcclusionCulling(commandBuffer, currentImage, framebuffer, renderPass);
+		return;
+	}
+
+	const uint32_t numDraws = (uint32_t)shapeIndices_.size();
+	const bool gpuCulling = (cullingMode_ == eCullingMode_GPU || cullingMode_ == eCullingMode_Verify);
+
+	if (gpuCulling)
+		dispatchCulling(commandBuffer, cullingPipeline_, cullingPipelineLayout_, cullingDescriptorSets_[currentImage], cullingOffset_);
+
+	beginRenderPass(renderPass, framebuffer, commandBuffer, currentImage);
+
+	if (gpuCulling)
+		vkCmdDrawIndirectCountKHR(commandBuffer, indirect_[currentImage].buffer, 0, count_[currentImage].buffer, 0, numDraws, sizeof(VkDrawIndirectCommand));
+	else
+		vkCmdDrawIndirect(commandBuffer, indirect_[currentImage].buffer, 0, drawCount_[currentImage], sizeof(VkDrawIndirectCommand));
+
+	vkCmdEndRenderPass(commandBuffer);
+}
+
+void MultiRenderer::fillOcclusionCulling(VkCommandBuffer commandBuffer, size_t currentImage, VkFramebuffer fb, VkRenderPass rp)
+{
+	const uint32_t numDraws = (uint32_t)shapeIndices_.size();
+
+	if (queryPool_ != VK_NULL_HANDLE)
+		vkCmdResetQueryPool(commandBuffer, queryPool_, (uint32_t)currentImage * NumTimestamps, NumTimestamps);
+
+	writeTimestamp(commandBuffer, currentImage, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0);
+
+	// First phase: the draws in the frustum which the last frame's depth does not hide
+	dispatchCulling(commandBuffer, occlusionPipeline_, occlusionPipelineLayout_, occlusionDescriptorSets_[currentImage * 2], cullingOffset_);
+	writeTimestamp(commandBuffer, currentImage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 1);
 
-	/* For CountKHR (Vulkan 1.1) we may use indirect rendering with GPU-based object counter */
-	/// vkCmdDrawIndirectCountKHR(commandBuffer, indirectBuffers_[currentImage], 0, countBuffers_[currentImage], 0, shapes.size(), sizeof(VkDrawIndirectCommand));
-	/* For Vulkan 1.0 vkCmdDrawIndirect is enough */
-	vkCmdDrawIndirect(commandBuffer, indirect_[currentImage].buffer, 0, (uint32_t)sceneData_.shapes_.size(), sizeof(VkDrawIndirectCommand));
+	beginRenderPass(rp, fb, commandBuffer, currentImage);
+	vkCmdDrawIndirectCountKHR(commandBuffer, indirect_[currentImage].buffer, 0, count_[currentImage].buffer, 0, numDraws, sizeof(VkDrawIndirectCommand));
+	vkCmdEndRenderPass(commandBuffer);
+	writeTimestamp(commandBuffer, currentImage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 2);
+
+	depthPyramid_->fillCommandBuffer(commandBuffer, currentImage);
+	writeTimestamp(commandBuffer, currentImage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 3);
+
+	// Second phase: the hidden draws against the depth of the first one
+	dispatchCulling(commandBuffer, occlusionPipeline_, occlusionPipelineLayout_, occlusionDescriptorSets_[currentImage * 2 + 1], lateCullingOffset_);
 
+	for (auto& barrier : toAttachment_)
+		barrier->fillCommandBuffer(commandBuffer, currentImage);
+	writeTimestamp(commandBuffer, currentImage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 4);
+
+	beginRenderPass(rp, fb, commandBuffer, currentImage);
+	vkCmdDrawIndirectCountKHR(commandBuffer, lateIndirect_[currentImage].buffer, 0, lateCount_[currentImage].buffer, 0, numDraws, sizeof(VkDrawIndirectCommand));
 	vkCmdEndRenderPass(commandBuffer);
+	writeTimestamp(commandBuffer, currentImage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 5);
+
+	// the depth of the whole frame for the first phase of the next one
+	depthPyramid_->fillCommandBuffer(commandBuffer, currentImage);
+	writeTimestamp(commandBuffer, currentImage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 6);
+}
+
+void MultiRenderer::dispatchCulling(VkCommandBuffer commandBuffer, VkPipeline pipeline, VkPipelineLayout layout, VkDescriptorSet ds, uint32_t offset) const
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 1, &ds, 1, &offset);
+	vkCmdDispatch(commandBuffer, ((uint32_t)shapeIndices_.size() + 63) / 64, 1, 1);
+
+	// the commands are read by the draws, the draw states by the second phase of occlusion culling, the counters by the host
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_HOST_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void MultiRenderer::writeTimestamp(VkCommandBuffer commandBuffer, size_t currentImage, VkPipelineStageFlagBits stage, uint32_t index) const
+{
+	if (queryPool_ != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(commandBuffer, stage, queryPool_, (uint32_t)currentImage * NumTimestamps + index);
 }
 
 void MultiRenderer::updateBuffers(size_t currentImage)
 {
-	updateUniformBuffer((uint32_t)currentImage, 0, sizeof(ubo_), &ubo_);
+	*ctx_.frameData.allocate<UBO>(1, dynamicOffsets_[0]) = ubo_;
+
+	updateCulling(currentImage);
 }
 
-void MultiRenderer::updateIndirectBuffers(size_t currentImage, bool* visibility)
+void MultiRenderer::updateCulling(size_t currentImage)
 {
-	VkDrawIndirectCommand* data = nullptr;
-	vkMapMemory(ctx_.vkDev.device, indirect_[currentImage].memory, 0, sizeof(VkDrawIndirectCommand), 0, (void**)&data);
+	const uint32_t numDraws = (uint32_t)shapeIndices_.size();
 
-	const uint32_t size = (uint32_t)sceneData_.shapes_.size();
+	cullingStats_.numDraws_ = numDraws;
+	cullingStats_.occluded_ = 0;
+	cullingStats_.disoccluded_ = 0;
 
-	for(uint32_t i = 0; i != size; i++)
+	if (cullingMode_ == eCullingMode_None)
 	{
-		const uint32_t j = sceneData_.shapes_[i].meshIndex;
+		numVisibleShapes_ = numDraws;
+		cullingStats_.frustumCulled_ = 0;
+		return;
+	}
 
-		const uint32_t lod = sceneData_.shapes_[i].LOD;
-		data[i].vertexCount = sceneData_.meshData_.meshes_[j].getLODIndicesCount(lod);
-		data[i].instanceCount = visibility ? (visibility[i] ? 1u : 0u) : 1u;
-		data[i].firstVertex = 0;
-		data[i].firstInstance = i;
+	// drawFrame() waits for the device, the results of the last frame of this image are complete
+	if (cullingMode_ == eCullingMode_Verify)
+	{
+		// the depth outputs only hold the last frame
+		if (useOcclusionCulling())
+			verifyOcclusionCulling();
+		else
+			verifyCulling(currentImage);
+	}
+
+	// the same matrix the vertex shader uses, the boxes are in world space
+	const glm::mat4 viewProj = ubo_.proj_ * ubo_.view_;
+
+	CullingData data{};
+	getFrustumPlanes(viewProj, data.frustumPlanes_);
+	getFrustumCorners(viewProj, data.frustumCorners_);
+	data.viewProj_ = viewProj;
+	data.numDraws_ = numDraws;
+
+	if (cullingMode_ == eCullingMode_CPU)
+	{
+		// the hierarchy skips whole groups of culled shapes, only the visible ones are visited below
+		std::vector<uint32_t>& mask = visibilityMasks_[currentImage];
+		cullSceneBVH(sceneData_.bvh_, data.frustumPlanes_, data.frustumCorners_, mask);
+
+		// the draws keep their shape index in firstInstance, the visible ones are packed to the front in shape order
+		VkDrawIndirectCommand* commands = static_cast<VkDrawIndirectCommand*>(indirect_[currentImage].ptr);
+		uint32_t numVisible = 0;
+		for (uint32_t w = 0; w != (uint32_t)mask.size(); w++)
+		{
+			uint32_t bits = drawMask_.empty() ? mask[w] : (mask[w] & drawMask_[w]);
+			for (; bits; bits &= bits - 1)
+			{
+				const uint32_t shape = (w << 5) + findFirstSetBit(bits);
+
+				const uint32_t lod = sceneData_.shapes_[shape].LOD;
+				commands[numVisible].vertexCount = sceneData_.meshData_.meshes_[sceneData_.shapes_[shape].meshIndex].getLODIndicesCount(lod);
+				commands[numVisible].instanceCount = 1;
+				commands[numVisible].firstVertex = 0;
+				commands[numVisible].firstInstance = shape;
+				numVisible++;
+			}
+		}
+
+		drawCount_[currentImage] = numVisible;
+		numVisibleShapes_ = numVisible;
+		cullingStats_.frustumCulled_ = numDraws - numVisible;
+		return;
+	}
+
+	uint32_t* count = static_cast<uint32_t*>(count_[currentImage].ptr);
+
+	if (useOcclusionCulling())
+	{
+		readOcclusionStats(currentImage);
+
+		*static_cast<uint32_t*>(lateCount_[currentImage].ptr) = 0;
+		*static_cast<uint32_t*>(numOccluded_[currentImage].ptr) = 0;
+	}
+	else
+	{
+		numVisibleShapes_ = *count;
+		cullingStats_.frustumCulled_ = numDraws - *count;
+	}
+
+	*count = 0;
+
+	if (cullingMode_ == eCullingMode_Verify)
+		cullBoxes(sceneData_.cullingBoxes_, data.frustumPlanes_, data.frustumCorners_, visibilityMasks_[currentImage]);
+
+	if (!useOcclusionCulling())
+	{
+		*ctx_.frameData.allocate<CullingData>(1, cullingOffset_) = data;
+		return;
+	}
+
+	const uint32_t numLevels = depthPyramid_->getNumLevels();
+
+	data.numPyramidLevels_ = pyramidValid_ ? numLevels : 0;
+	data.phase_ = 0;
+	*ctx_.frameData.allocate<CullingData>(1, cullingOffset_) = data;
+
+	data.numPyramidLevels_ = numLevels;
+	data.phase_ = 1;
+	*ctx_.frameData.allocate<CullingData>(1, lateCullingOffset_) = data;
+
+	// this frame builds the pyramid for the next one
+	pyramidValid_ = true;
+	occlusionFrames_[currentImage] = 1;
+
+	if (cullingMode_ == eCullingMode_Verify)
+	{
+		lastOcclusionImage_ = currentImage;
+		verifyViewProj_ = viewProj;
+		verifyBoxes_ = sceneData_.shapeBoxes_;
 	}
-	vkUnmapMemory(ctx_.vkDev.device, indirect_[currentImage].memory);
 }
 
-bool MultiRenderer::checkLoadedTextures()
+void MultiRenderer::readOcclusionStats(size_t currentImage)
+{
+	if (!occlusionFrames_[currentImage])
+		return;
+
+	const uint32_t numEarly = *static_cast<const uint32_t*>(count_[currentImage].ptr);
+	const uint32_t numLate = *static_cast<const uint32_t*>(lateCount_[currentImage].ptr);
+	const uint32_t numHidden = *static_cast<const uint32_t*>(numOccluded_[currentImage].ptr);
+
+	// the second phase draws a part of the draws hidden in the first one
+	numVisibleShapes_ = numEarly + numLate;
+	cullingStats_.frustumCulled_ = cullingStats_.numDraws_ - numEarly - numHidden;
+	cullingStats_.occluded_ = numHidden - numLate;
+	cullingStats_.disoccluded_ = numLate;
+
+	uint64_t timestamps[NumTimestamps];
+
+	if (queryPool_ == VK_NULL_HANDLE ||
+		vkGetQueryPoolResults(ctx_.vkDev.device, queryPool_, (uint32_t)currentImage * NumTimestamps, NumTimestamps,
+			sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return;
+
+	const auto milliseconds = [this, &timestamps](uint32_t from, uint32_t to) {
+		return float(double(timestamps[to] - timestamps[from]) * timestampPeriod_ * 1e-6);
+	};
+
+	cullingStats_.cullingTime_ = milliseconds(0, 1) + milliseconds(3, 4);
+	cullingStats_.drawTime_ = milliseconds(1, 2) + milliseconds(4, 5);
+	cullingStats_.pyramidTime_ = milliseconds(2, 3) + milliseconds(5, 6);
+}
+
+void MultiRenderer::verifyCulling(size_t currentImage)
+{
+	const std::vector<uint32_t>& cpuMask = visibilityMasks_[currentImage];
+
+	// the image has not been culled on the GPU since the mode changed
+	if (cpuMask.empty())
+		return;
+
+	const uint32_t numDraws = (uint32_t)shapeIndices_.size();
+	const uint32_t gpuCount = std::min(*static_cast<const uint32_t*>(count_[currentImage].ptr), numDraws);
+	const VkDrawIndirectCommand* draws = static_cast<const VkDrawIndirectCommand*>(indirect_[currentImage].ptr);
+
+	gpuVisibilityMask_.assign(cpuMask.size(), 0);
+	for (uint32_t i = 0; i != gpuCount; i++)
+	{
+		const uint32_t shape = draws[i].firstInstance;
+		gpuVisibilityMask_[shape >> 5] |= 1u << (shape & 31);
+	}
+
+	uint32_t cpuCount = 0;
+	uint32_t numDiffering = 0;
+	uint32_t firstDiffering = 0;
+
+	for (uint32_t shape : shapeIndices_)
+	{
+		const bool cpu = isVisible(cpuMask, shape);
+		cpuCount += cpu ? 1 : 0;
+
+		if (cpu != isVisible(gpuVisibilityMask_, shape) && numDiffering++ == 0)
+			firstDiffering = shape;
+	}
+
+	numVerifiedFrames_++;
+
+	if (numDiffering > 0 || cpuCount != gpuCount)
+	{
+		numCullingMismatches_++;
+		printf("Culling mismatch (image %u): GPU %u visible, CPU %u visible, %u shapes differ (first: shape %u)\n",
+			(uint32_t)currentImage, gpuCount, cpuCount, numDiffering, firstDiffering);
+	}
+}
+
+// the depth aspect of [depth] (in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) as values in [0..1], row by row
+static bool downloadDepth(VulkanRenderDevice& vkDev, const VulkanTexture& depth, std::vector<float>& out)
 {
-	VKSceneData::LoadedImageData data;
+	const size_t numTexels = size_t(depth.width) * depth.height;
+	// D32_SFLOAT and the depth aspect of D32_SFLOAT_S8_UINT are floats, D24_UNORM_S8_UINT is packed into the low 24 bits
+	const VkDeviceSize size = numTexels * sizeof(uint32_t);
 
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	if (!createBuffer(vkDev.device, vkDev.physicalDevice, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory))
+		return false;
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = depth.image.image;
+	barrier.subresourceRange = VkImageSubresourceRange{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+	if (hasStencilComponent(depth.format))
+		barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+	VkBufferImageCopy region{};
+	region.imageSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1 };
+	region.imageExtent = VkExtent3D{ depth.width, depth.height, 1 };
+
+	VkCommandBuffer commandBuffer = beginSingleTimeCommands(vkDev);
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+	vkCmdCopyImageToBuffer(commandBuffer, depth.image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, stagingBuffer, 1, &region);
+
+	std::swap(barrier.srcAccessMask, barrier.dstAccessMask);
+	std::swap(barrier.oldLayout, barrier.newLayout);
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+	endSingleTimeCommands(vkDev, commandBuffer);
+
+	std::vector<uint32_t> texels(numTexels);
+	downloadBufferData(vkDev, stagingBufferMemory, 0, texels.data(), size);
+
+	vkDestroyBuffer(vkDev.device, stagingBuffer, nullptr);
+	vkFreeMemory(vkDev.device, stagingBufferMemory, nullptr);
+
+	out.resize(numTexels);
+	if (depth.format == VK_FORMAT_D24_UNORM_S8_UINT)
+		for (size_t i = 0; i != numTexels; i++)
+			out[i] = float(texels[i] & 0xFFFFFF) / float(0xFFFFFF);
+	else
+		memcpy(out.data(), texels.data(), size);
+
+	return true;
+}
+
+// isAABBOccluded() of OcclusionCulling.comp on the full resolution depth: every texel under the screen rectangle of the box is closer
+static bool isBoxHidden(const BoundingBox& box, const glm::mat4& viewProj, const std::vector<float>& depth, uint32_t w, uint32_t h)
+{
+	glm::vec2 minUV(1.0f);
+	glm::vec2 maxUV(0.0f);
+	float minDepth = 1.0f;
+
+	for (int i = 0; i != 8; i++)
 	{
-		std::lock_guard lock(sceneData_.loadedFilesMutex_);
+		const glm::vec4 p = viewProj * glm::vec4(
+			(i & 1) ? box.max_.x : box.min_.x,
+			(i & 2) ? box.max_.y : box.min_.y,
+			(i & 4) ? box.max_.z : box.min_.z, 1.0f);
 
-		if (sceneData_.loadedFiles_.empty())
+		// the box crosses the camera plane
+		if (p.w <= 0.0f)
 			return false;
 
-		data = sceneData_.loadedFiles_.back();
-
-		sceneData_.loadedFiles_.pop_back();
+		const glm::vec3 ndc = glm::vec3(p) / p.w;
+		minUV = glm::min(minUV, glm::vec2(ndc) * 0.5f + 0.5f);
+		maxUV = glm::max(maxUV, glm::vec2(ndc) * 0.5f + 0.5f);
+		minDepth = std::min(minDepth, ndc.z);
 	}
 
-	this->updateTexture(data.index_, ctx_.resources.addRGBATexture(data.w_, data.h_, const_cast<uint8_t*>(data.img_)));
+	minUV = glm::clamp(minUV, glm::vec2(0.0f), glm::vec2(1.0f));
+	maxUV = glm::clamp(maxUV, glm::vec2(0.0f), glm::vec2(1.0f));
+
+	const uint32_t x0 = std::min(uint32_t(minUV.x * w), w - 1);
+	const uint32_t y0 = std::min(uint32_t(minUV.y * h), h - 1);
+	const uint32_t x1 = std::min(uint32_t(maxUV.x * w), w - 1);
+	const uint32_t y1 = std::min(uint32_t(maxUV.y * h), h - 1);
 
-	stbi_image_free((void*)data.img_);
+	for (uint32_t y = y0; y <= y1; y++)
+		for (uint32_t x = x0; x <= x1; x++)
+			if (depth[size_t(y) * w + x] >= minDepth)
+				return false;
 
 	return true;
 }
+
+void MultiRenderer::verifyOcclusionCulling()
+{
+	const size_t image = lastOcclusionImage_;
+
+	// nothing was culled with occlusion culling in this mode yet
+	if (!occlusionFrames_[image] || visibilityMasks_[image].empty() || verifyBoxes_.empty())
+		return;
+
+	// the depth after both phases is closer than (or equal to) both pyramids, whatever they hid it hides as well
+	const auto depth = std::find_if(outputs_.begin(), outputs_.end(), [](const VulkanTexture& t) { return isDepthFormat(t.format); });
+	if (!downloadDepth(ctx_.vkDev, *depth, verifyDepth_))
+		return;
+
+	const std::vector<uint32_t>& cpuMask = visibilityMasks_[image];
+	const uint32_t numDraws = (uint32_t)shapeIndices_.size();
+
+	gpuVisibilityMask_.assign(cpuMask.size(), 0);
+	const auto markDrawn = [this, numDraws](const VulkanBuffer& commands, const VulkanBuffer& count)
+	{
+		const uint32_t numDrawn = std::min(*static_cast<const uint32_t*>(count.ptr), numDraws);
+		const VkDrawIndirectCommand* draws = static_cast<const VkDrawIndirectCommand*>(commands.ptr);
+		for (uint32_t i = 0; i != numDrawn; i++)
+			gpuVisibilityMask_[draws[i].firstInstance >> 5] |= 1u << (draws[i].firstInstance & 31);
+	};
+
+	markDrawn(indirect_[image], count_[image]);
+	markDrawn(lateIndirect_[image], lateCount_[image]);
+
+	uint32_t numMissing = 0;
+	uint32_t firstMissing = 0;
+	uint32_t numOutside = 0;
+
+	for (uint32_t shape : shapeIndices_)
+	{
+		const bool drawn = isVisible(gpuVisibilityMask_, shape);
+
+		if (!isVisible(cpuMask, shape))
+		{
+			numOutside += drawn ? 1 : 0;
+			continue;
+		}
+
+		if (!drawn && !isBoxHidden(verifyBoxes_[shape], verifyViewProj_, verifyDepth_, depth->width, depth->height) && numMissing++ == 0)
+			firstMissing = shape;
+	}
+
+	numVerifiedFrames_++;
+
+	if (numMissing > 0 || numOutside > 0)
+	{
+		numCullingMismatches_++;
+		printf("Occlusion culling mismatch (image %u): %u shapes in the frustum and not hidden by the depth were not drawn (first: shape %u), %u drawn outside of the frustum\n",
+			(uint32_t)image, numMissing, firstMissing, numOutside);
+	}
+}
+
+void MultiRenderer::updateIndirectBuffers(size_t currentImage, bool* visibility)
+{
+	const uint32_t size = (uint32_t)shapeIndices_.size();
+
+	// persistently mapped host-coherent memory, the commands are written in place
+	VkDrawIndirectCommand* data = static_cast<VkDrawIndirectCommand*>(indirect_[currentImage].ptr);
+
+	for(uint32_t i = 0; i != size; i++)
+	{
+		const uint32_t shape = shapeIndices_[i];
+		const uint32_t j = sceneData_.shapes_[shape].meshIndex;
+
+		const uint32_t lod = sceneData_.shapes_[shape].LOD;
+		data[i].vertexCount = sceneData_.meshData_.meshes_[j].getLODIndicesCount(lod);
+		data[i].instanceCount = visibility ? (visibility[shape] ? 1u : 0u) : 1u;
+		data[i].firstVertex = 0;
+		data[i].firstInstance = shape;
+	}
+}
+
+bool MultiRenderer::checkLoadedTextures()
+{
+	return sceneData_.streamTextures(ubo_.proj_, ubo_.view_, [this](uint32_t index, VulkanTexture texture)
+		{
+			this->updateTexture(index, texture);
+		});
+}
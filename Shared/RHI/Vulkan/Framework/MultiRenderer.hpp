@@ -3,12 +3,21 @@
 #include <RHI/Vulkan/Framework/Renderer.hpp>
 #include <Scene/Scene.hpp>
 #include <Scene/Mareial.hpp>
+#include <Scene/SceneBVH.hpp>
 #include <Scene/VtxData.hpp>
+#include <TextureCache.hpp>
+#include <TextureStreamer.hpp>
+#include <Utils/MPSCRing.hpp>
+#include <Utils/UtilsCulling.hpp>
 
 #include <taskflow/taskflow.hpp>
 
 #include "Filesystem/FilesystemUtilities.hpp"
 
+#include <chrono>
+#include <functional>
+#include <memory>
+
 // Container of mesh data, material data and scene nodes with transformations
 struct VKSceneData
 {
@@ -43,12 +52,23 @@ struct VKSceneData
 
 	std::vector<DrawData> shapes_;
 
+	// world space bounds of the shapes, refreshed with the transforms: [cullingBoxes_] for cullBoxes(), [boxes_] for the culling shader
+	std::vector<BoundingBox> shapeBoxes_;
+	CullingBoxes cullingBoxes_;
+	VulkanBuffer boxes_;
+
+	// built once the scene is loaded, refitted to the changed shapes by every upload; eCullingMode_CPU culls with it
+	SceneBVH bvh_;
+
 	void loadScene(const char* sceneFile);
 	void loadMeshes(const char* meshFile);
 
 	void convertGlobalToShapeTransforms();
 	void recalculateAllTransforms();
+	/* Only the nodes passed to markAsChanged() and their subtrees */
+	void recalculateChangedTransforms();
 	void uploadGlobalTransforms();
+	void updateCullingBoxes();
 
 	void updateMaterial(int matIdx);
 
@@ -59,22 +79,75 @@ struct VKSceneData
 		int w_ = 0;
 		int h_ = 0;
 		const uint8_t* img_ = nullptr;
+		// set instead of [img_] for .ktx files and texture cache entries, [levelsOwner_] keeps [levels_] alive
+		TextureLevelsView levels_;
+		std::shared_ptr<const void> levelsOwner_;
 	};
 
 	std::vector<std::string> textureFiles_;
-	std::vector<LoadedImageData> loadedFiles_;
-	std::mutex loadedFilesMutex_;
+	// loader threads -> render thread, sized for all the textures so the loaders never wait
+	MPSCRing<LoadedImageData> loadedFiles_;
+
+	// decoded mip chains of the source images, later runs skip stbi_load() and the mip generation
+	TextureCache textureCache_{ FilesystemUtilities::GetResourcesDir() + "Cache/Textures/" };
+
+	/**
+		Async loading drives a TextureStreamer: loaders pick textures by priority, the render thread uploads mip tails first
+		and refines them within the per-frame budget. [updateTexture] rebinds texture [index] in the renderer descriptor sets.
+		[proj] and [view] are the matrices the scene is rendered with. Call once per frame, returns true if any texture changed.
+	*/
+	bool streamTextures(const glm::mat4& proj, const glm::mat4& view, const std::function<void(uint32_t index, VulkanTexture texture)>& updateTexture);
+
+	std::unique_ptr<TextureStreamer> streamer_;
 
 private:
+	void startTextureLoaders();
+	void replaceTexture(uint32_t index, VulkanTexture texture, const std::function<void(uint32_t, VulkanTexture)>& updateTexture);
+
 	tf::Taskflow taskflow_;
 	tf::Executor executor_;
+	// the texture loaders keep every worker of [executor_] busy until all the textures are loaded
+	tf::Executor transformExecutor_;
+
+	// keep the mapped cache entries alive while the streamer uploads from them
+	std::vector<std::shared_ptr<const void>> levelsOwners_;
+	// textures created by streamTextures(), the initial placeholders are owned by VulkanResources forever
+	std::vector<uint8_t> isStreamedTexture_;
+	std::vector<TextureStreamingUpdate> streamingUpdates_;
+
+	struct RetiredTexture
+	{
+		VulkanTexture texture_;
+		uint64_t releaseFrame_;
+	};
+	// replaced textures stay alive until no frame in flight can sample them
+	std::vector<RetiredTexture> retiredTextures_;
+	uint64_t streamingFrame_ = 0;
+
+	std::chrono::steady_clock::time_point loadStartTime_;
+	bool reportedTails_ = false;
+	bool reportedComplete_ = false;
 };
 
 constexpr const char* DefaultMeshVertexShader = PLATFORM_DIR "/Shaders/Vulkan/MultiRenderer/MultiRenderer.vert";
 constexpr const char* DefaultMeshFragmentShader = PLATFORM_DIR "/Shaders/Vulkan/MultiRenderer/MultiRenderer.frag";
+constexpr const char* DefaultMeshCullingShader = PLATFORM_DIR "/Shaders/Vulkan/MultiRenderer/FrustumCulling.comp";
+constexpr const char* DefaultMeshOcclusionShader = PLATFORM_DIR "/Shaders/Vulkan/MultiRenderer/OcclusionCulling.comp";
+
+/* How MultiRenderer culls the shapes against the view frustum */
+enum eCullingMode : uint8_t
+{
+	eCullingMode_None,		// draw every shape, the instance counts written by updateIndirectBuffers() decide
+	eCullingMode_CPU,		// cullSceneBVH() before the frame, the visible draws are written to the indirect buffer
+	eCullingMode_GPU,		// a compute pass compacts the visible draws, drawn with vkCmdDrawIndirectCountKHR()
+	eCullingMode_Verify,	// GPU culling, the results are read back and compared with cullBoxes() (mismatches are printed and counted)
+};
+
+struct DepthPyramid;
 
 struct MultiRenderer : public Renderer
 {
+	/* [objectIndices] are the shapes of [sceneData] drawn by this renderer, all of them if empty */
 	MultiRenderer(
 		VulkanRenderContext& ctx,
 		VKSceneData& sceneData,
@@ -83,13 +156,62 @@ struct MultiRenderer : public Renderer
 		const std::vector<VulkanTexture>& outputs = std::vector<VulkanTexture>{},
 		RenderPass screenRenderPass = RenderPass(),
 		const std::vector<BufferAttachment>& auxBuffers = std::vector<BufferAttachment>{},
-		const std::vector<TextureAttachment>& auxTextures = std::vector<TextureAttachment>{});
+		const std::vector<TextureAttachment>& auxTextures = std::vector<TextureAttachment>{},
+		const std::vector<int>& objectIndices = std::vector<int>{});
+	~MultiRenderer() override;
 
 	void fillCommandBuffer(VkCommandBuffer commandBuffer, size_t currentImage, VkFramebuffer fb = VK_NULL_HANDLE, VkRenderPass rp = VK_NULL_HANDLE) override;
 	void updateBuffers(size_t currentImage) override;
 
 	void updateIndirectBuffers(size_t currentImage, bool* visibility = nullptr);
 
+	/**
+		GPU and Verify fall back to CPU culling without VK_KHR_draw_indirect_count.
+		Verify is meant for a deterministic driver (lavapipe): any difference is a bug in one of the two paths.
+	*/
+	void setCullingMode(eCullingMode mode);
+	inline eCullingMode getCullingMode() const { return cullingMode_; }
+
+	/**
+		Two-phase occlusion culling on top of eCullingMode_GPU and eCullingMode_Verify (the other modes ignore it).
+		The draws are tested against a depth pyramid of the last frame, the hidden ones are tested again against a pyramid
+		of the draws which passed and the disoccluded ones are drawn by a second render pass. The pyramid of the whole frame
+		is built for the next one.
+		Needs offscreen color and depth outputs and a render pass which loads them and leaves them in
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL (eRenderPassBit_Offscreen without clearing), returns false otherwise.
+		With eRenderPassBit_OffscreenInternal the pass starts from VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL as well,
+		otherwise the outputs go back to the attachment layouts before the second phase.
+		In eCullingMode_Verify every shape in the frustum which the depth of the whole frame does not hide must be drawn by one of the phases.
+		The resources are created by the first call, do it before the frame update (like creating a renderer).
+	*/
+	bool setOcclusionCulling(bool enable);
+	inline bool isOcclusionCullingEnabled() const { return occlusionCulling_; }
+
+	/* Shapes drawn by the last completed frame */
+	inline uint32_t getNumVisibleShapes() const { return numVisibleShapes_; }
+
+	struct CullingStats
+	{
+		uint32_t numDraws_ = 0;
+		uint32_t frustumCulled_ = 0;
+		// hidden after both phases of occlusion culling
+		uint32_t occluded_ = 0;
+		// hidden by the last frame, drawn by the second phase
+		uint32_t disoccluded_ = 0;
+
+		// GPU time in milliseconds (occlusion culling only): both culling dispatches, both render passes, both pyramids
+		float cullingTime_ = 0.0f;
+		float drawTime_ = 0.0f;
+		float pyramidTime_ = 0.0f;
+	};
+
+	/* The last completed frame, the counts are read back in CPU, GPU and occlusion culling */
+	inline const CullingStats& getCullingStats() const { return cullingStats_; }
+
+	/* eCullingMode_Verify: frames whose GPU results were compared with the CPU ones so far, and how many of them differed */
+	inline uint32_t getNumVerifiedFrames() const { return numVerifiedFrames_; }
+	inline uint32_t getNumCullingMismatches() const { return numCullingMismatches_; }
+
 	inline void setMatrices(const glm::mat4& proj, const glm::mat4& view) {
 		const glm::mat4 m1 = glm::scale(glm::mat4(1.f), glm::vec3(1.f, -1.f, 1.f));
 		ubo_.proj_ = proj;
@@ -106,15 +228,106 @@ struct MultiRenderer : public Renderer
 	bool checkLoadedTextures();
 
 private:
+	struct CullingData
+	{
+		vec4 frustumPlanes_[6];
+		vec4 frustumCorners_[8];
+		mat4 viewProj_;
+		uint32_t numDraws_;
+		uint32_t numPyramidLevels_;
+		// occlusion culling: 0 - test against the last frame, 1 - test the hidden draws again
+		uint32_t phase_;
+		uint32_t padding_;
+	};
+
+	void updateCulling(size_t currentImage);
+	void verifyCulling(size_t currentImage);
+	void verifyOcclusionCulling();
+	void readOcclusionStats(size_t currentImage);
+
+	void fillOcclusionCulling(VkCommandBuffer commandBuffer, size_t currentImage, VkFramebuffer fb, VkRenderPass rp);
+	void dispatchCulling(VkCommandBuffer commandBuffer, VkPipeline pipeline, VkPipelineLayout layout, VkDescriptorSet ds, uint32_t offset) const;
+	void writeTimestamp(VkCommandBuffer commandBuffer, size_t currentImage, VkPipelineStageFlagBits stage, uint32_t index) const;
+
+	inline bool useOcclusionCulling() const { return occlusionCulling_ && (cullingMode_ == eCullingMode_GPU || cullingMode_ == eCullingMode_Verify); }
+
 	VKSceneData& sceneData_;
 
+	// the shape of each draw
+	std::vector<uint32_t> shapeIndices_;
+	// the same shapes, 1 bit per shape of the scene (empty if all the shapes are drawn)
+	std::vector<uint32_t> drawMask_;
+
+	std::vector<VulkanTexture> outputs_;
+
 	std::vector<VulkanBuffer> indirect_;
 	std::vector<VulkanBuffer> shape_;
 
+	eCullingMode cullingMode_ = eCullingMode_GPU;
+
+	// the commands for all the draws, copied to indirect_ when visible
+	VulkanBuffer allDraws_;
+	// number of visible draws written by the culling shader, per image
+	std::vector<VulkanBuffer> count_;
+	// number of draws in indirect_ without GPU culling, per image
+	std::vector<uint32_t> drawCount_;
+	// cullBoxes() results, per image (kept until the GPU results of the image are verified)
+	std::vector<std::vector<uint32_t>> visibilityMasks_;
+	std::vector<uint32_t> gpuVisibilityMask_;
+	uint32_t numVisibleShapes_ = 0;
+	CullingStats cullingStats_;
+
+	VkDescriptorSetLayout cullingDescriptorSetLayout_ = VK_NULL_HANDLE;
+	VkDescriptorPool cullingDescriptorPool_ = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> cullingDescriptorSets_;
+	VkPipelineLayout cullingPipelineLayout_ = VK_NULL_HANDLE;
+	VkPipeline cullingPipeline_ = VK_NULL_HANDLE;
+	// the CullingData offset in the frame data
+	uint32_t cullingOffset_ = 0;
+
+	/* Occlusion culling */
+	bool occlusionCulling_ = false;
+	std::unique_ptr<DepthPyramid> depthPyramid_;
+	// the pyramid holds the depth of an earlier frame (the first frame tests nothing against it)
+	bool pyramidValid_ = false;
+	// the outputs go back to the attachment layouts for the second phase
+	std::vector<std::unique_ptr<Renderer>> toAttachment_;
+
+	// the draws of the second phase, per image
+	std::vector<VulkanBuffer> lateIndirect_;
+	std::vector<VulkanBuffer> lateCount_;
+	// draws hidden in the first phase, per image
+	std::vector<VulkanBuffer> numOccluded_;
+	// the result of the first phase for each draw
+	VulkanBuffer drawStates_;
+	// occlusion culling was recorded for the image since it was enabled, its counters and timestamps can be read
+	std::vector<uint8_t> occlusionFrames_;
+
+	// eCullingMode_Verify: the image culled by the last update, its camera and shape bounds, and the depth it was drawn with
+	size_t lastOcclusionImage_ = 0;
+	glm::mat4 verifyViewProj_ = glm::mat4(1.0f);
+	std::vector<BoundingBox> verifyBoxes_;
+	std::vector<float> verifyDepth_;
+	uint32_t numVerifiedFrames_ = 0;
+	uint32_t numCullingMismatches_ = 0;
+
+	VkDescriptorSetLayout occlusionDescriptorSetLayout_ = VK_NULL_HANDLE;
+	VkDescriptorPool occlusionDescriptorPool_ = VK_NULL_HANDLE;
+	// two per image: the first and the second phase
+	std::vector<VkDescriptorSet> occlusionDescriptorSets_;
+	VkPipelineLayout occlusionPipelineLayout_ = VK_NULL_HANDLE;
+	VkPipeline occlusionPipeline_ = VK_NULL_HANDLE;
+	uint32_t lateCullingOffset_ = 0;
+
+	static constexpr uint32_t NumTimestamps = 7;
+	// NumTimestamps per image, VK_NULL_HANDLE if the graphics queue has no timestamps
+	VkQueryPool queryPool_ = VK_NULL_HANDLE;
+	float timestampPeriod_ = 0.0f;
+
 	struct UBO
 	{
 		mat4 proj_;
 		mat4 view_;
 		vec4 cameraPos_;
 	} ubo_;
-};
\ No newline at end of file
+};
@@ -29,7 +29,7 @@ void QuadRenderer::fillCommandBuffer(VkCommandBuffer commandBuffer, size_t curre
 void QuadRenderer::updateBuffers(size_t currentImage)
 {
 	if (!quads_.empty())
-		uploadBufferData(ctx_.vkDev, storages_[currentImage].memory, 0, quads_.data(), quads_.size() * sizeof(VertexData));
+		memcpy(storages_[currentImage].ptr, quads_.data(), quads_.size() * sizeof(VertexData));
 }
 
 QuadRenderer::QuadRenderer(VulkanRenderContext& ctx,
@@ -55,7 +55,7 @@ QuadRenderer::QuadRenderer(VulkanRenderContext& ctx,
 
 	for(size_t i = 0; i < imgCount; i++)
 	{
-		storages_[i] = ctx.resources.addStorageBuffer(vertexBufferSize);
+		storages_[i] = ctx.resources.addStorageBuffer(vertexBufferSize, true);
 		dsInfo.buffers[0].buffer = storages_[i];
 		descriptorSets_[i] = ctx.resources.addDescriptorSet(descriptorPool_, descriptorSetLayout_);
 		ctx.resources.updateDescriptorSet(descriptorSets_[i], dsInfo);
@@ -0,0 +1,650 @@
+#include <RHI/Vulkan/Framework/RenderGraph.hpp>
+
+#include <algorithm>
+
+static constexpr VkAccessFlags kWriteAccess =
+	VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+	VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+// buffers can be fetched as vertices/indices/indirect commands or bound to any shader, including the compute dispatches of a pass
+static constexpr VkPipelineStageFlags kBufferStages =
+	VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+	VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+static VkImageAspectFlags getAspectMask(VkFormat format)
+{
+	if (!isDepthFormat(format))
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+
+	return VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencilComponent(format) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+}
+
+static VkImageLayout getAttachmentLayout(VkFormat format)
+{
+	return isDepthFormat(format) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+}
+
+RenderGraph::RenderGraph(VulkanRenderContext& ctx)
+	: Renderer(ctx)
+{}
+
+RenderGraph::~RenderGraph()
+{
+	// the pass renderers only reference objects owned by VulkanResources
+	for (Resource& res : resources_)
+	{
+		if (res.imported || res.isBuffer || res.texture.image.image == VK_NULL_HANDLE)
+			continue;
+
+		vkDestroySampler(ctx_.vkDev.device, res.texture.sampler, nullptr);
+		vkDestroyImageView(ctx_.vkDev.device, res.texture.image.imageView, nullptr);
+		vkDestroyImage(ctx_.vkDev.device, res.texture.image.image, nullptr);
+	}
+
+	for (AliasSlot& slot : slots_)
+		ctx_.resources.freeMemory(slot.allocation);
+}
+
+RenderGraphResource RenderGraph::createTexture(const char* name, const RenderGraphTextureDesc& desc)
+{
+	Resource res;
+	res.name = name;
+	res.desc = desc;
+
+	resources_.push_back(res);
+	return RenderGraphResource(resources_.size() - 1);
+}
+
+RenderGraphResource RenderGraph::importTexture(const char* name, const VulkanTexture& tex, VkImageLayout layout)
+{
+	Resource res;
+	res.name = name;
+	res.imported = true;
+	res.texture = tex;
+	res.importedLayout = layout;
+
+	resources_.push_back(res);
+	return RenderGraphResource(resources_.size() - 1);
+}
+
+RenderGraphResource RenderGraph::importBuffer(const char* name, const VulkanBuffer& buffer)
+{
+	Resource res;
+	res.name = name;
+	res.isBuffer = true;
+	res.imported = true;
+	res.buffer = buffer;
+
+	resources_.push_back(res);
+	return RenderGraphResource(resources_.size() - 1);
+}
+
+uint32_t RenderGraph::addPass(const char* name, const std::vector<RenderGraphResource>& reads, const std::vector<RenderGraphResource>& writes, PassFactory factory)
+{
+	// a texture cannot be sampled and rendered to at the same time, buffers may be updated in place (counters, indirect commands)
+	for (RenderGraphResource r : writes)
+		if (!resources_[r].isBuffer && std::find(reads.begin(), reads.end(), r) != reads.end())
+		{
+			printf("Render graph pass '%s' reads and writes texture '%s'\n", name, resources_[r].name.c_str());
+			exit(EXIT_FAILURE);
+		}
+
+	Pass pass;
+	pass.name = name;
+	pass.reads = reads;
+	pass.writes = writes;
+	pass.factory = std::move(factory);
+
+	passes_.push_back(std::move(pass));
+	return uint32_t(passes_.size() - 1);
+}
+
+void RenderGraph::markOutput(RenderGraphResource res)
+{
+	resources_[res].output = true;
+}
+
+void RenderGraph::compile()
+{
+	if (compiled_)
+	{
+		printf("Render graph is already compiled\n");
+		exit(EXIT_FAILURE);
+	}
+
+	cullPasses();
+	buildGroups();
+	computeLifetimes();
+	createTransients();
+	createPassRenderers();
+	buildBarriers();
+
+	compiled_ = true;
+
+	printStats();
+}
+
+void RenderGraph::cullPasses()
+{
+	// imported resources are visible outside the graph, so are the marked transients
+	std::vector<bool> needed(resources_.size());
+	for (size_t i = 0; i < resources_.size(); i++)
+		needed[i] = resources_[i].imported || resources_[i].output;
+
+	for (auto p = passes_.rbegin(); p != passes_.rend(); ++p)
+	{
+		p->live = std::any_of(p->writes.begin(), p->writes.end(), [&needed](RenderGraphResource r) { return needed[r]; });
+
+		if (p->live)
+			for (RenderGraphResource r : p->reads)
+				needed[r] = true;
+	}
+}
+
+void RenderGraph::buildGroups()
+{
+	// the last group which read/wrote each resource
+	std::vector<uint32_t> readIn(resources_.size(), NO_GROUP);
+	std::vector<uint32_t> writtenIn(resources_.size(), NO_GROUP);
+
+	for (uint32_t i = 0; i < passes_.size(); i++)
+	{
+		Pass& pass = passes_[i];
+		if (!pass.live)
+			continue;
+
+		const uint32_t current = groups_.empty() ? NO_GROUP : uint32_t(groups_.size() - 1);
+
+		// RAW, WAW and WAR hazards need a barrier between the passes
+		bool hazard = groups_.empty();
+		for (RenderGraphResource r : pass.reads)
+			hazard |= (writtenIn[r] == current);
+		for (RenderGraphResource r : pass.writes)
+			hazard |= (writtenIn[r] == current) || (readIn[r] == current);
+
+		if (hazard)
+			groups_.emplace_back();
+
+		pass.group = uint32_t(groups_.size() - 1);
+		groups_.back().passes.push_back(i);
+
+		for (RenderGraphResource r : pass.reads)
+			readIn[r] = pass.group;
+		for (RenderGraphResource r : pass.writes)
+			writtenIn[r] = pass.group;
+	}
+}
+
+void RenderGraph::computeLifetimes()
+{
+	for (const Pass& pass : passes_)
+	{
+		if (!pass.live)
+			continue;
+
+		for (RenderGraphResource r : pass.reads)
+		{
+			Resource& res = resources_[r];
+			if (!res.imported && res.firstGroup == NO_GROUP)
+			{
+				printf("Render graph pass '%s' reads '%s' before any pass writes it\n", pass.name.c_str(), res.name.c_str());
+				exit(EXIT_FAILURE);
+			}
+
+			res.firstGroup = std::min(res.firstGroup, pass.group);
+			res.lastGroup = std::max(res.lastGroup, pass.group);
+		}
+
+		for (RenderGraphResource r : pass.writes)
+		{
+			Resource& res = resources_[r];
+			res.firstGroup = std::min(res.firstGroup, pass.group);
+			res.lastGroup = std::max(res.lastGroup, pass.group);
+		}
+	}
+
+	for (Resource& res : resources_)
+	{
+		if (res.imported || !res.output)
+			continue;
+
+		if (res.firstGroup == NO_GROUP)
+		{
+			printf("Render graph output '%s' is never written\n", res.name.c_str());
+			exit(EXIT_FAILURE);
+		}
+
+		// read after the graph, nothing may reuse its memory
+		res.lastGroup = uint32_t(groups_.size());
+	}
+}
+
+void RenderGraph::createTransients()
+{
+	VkDevice device = ctx_.vkDev.device;
+
+	std::vector<RenderGraphResource> transients;
+
+	for (uint32_t i = 0; i < resources_.size(); i++)
+	{
+		Resource& res = resources_[i];
+
+		// culled transients are never created
+		if (res.imported || res.firstGroup == NO_GROUP)
+			continue;
+
+		VulkanTexture& tex = res.texture;
+		tex.width = res.desc.width ? res.desc.width : ctx_.vkDev.framebufferWidth;
+		tex.height = res.desc.height ? res.desc.height : ctx_.vkDev.framebufferHeight;
+		tex.depth = 1;
+		tex.format = res.desc.format;
+		tex.desiredLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = tex.format;
+		imageInfo.extent = VkExtent3D{ tex.width, tex.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT |
+			(isDepthFormat(tex.format) ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VK_CHECK(vkCreateImage(device, &imageInfo, nullptr, &tex.image.image));
+		setVkImageName(ctx_.vkDev, tex.image.image, res.name.c_str());
+
+		// prefersDedicatedAllocation is ignored on purpose: sharing the memory saves more than the driver gains from a dedicated one
+		vkGetImageMemoryRequirements(device, tex.image.image, &res.requirements);
+
+		transients.push_back(i);
+	}
+
+	// first fit, largest first: the smaller textures fill the slots of the larger ones
+	std::stable_sort(transients.begin(), transients.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+		return resources_[a].requirements.size > resources_[b].requirements.size;
+	});
+
+	for (RenderGraphResource r : transients)
+	{
+		const Resource& res = resources_[r];
+
+		auto slot = std::find_if(slots_.begin(), slots_.end(), [this, &res](const AliasSlot& s) {
+			if ((s.requirements.memoryTypeBits & res.requirements.memoryTypeBits) == 0)
+				return false;
+
+			// the lifetimes must not even touch: the previous texture is read in the group before the next one is written
+			return std::all_of(s.resources.begin(), s.resources.end(), [this, &res](RenderGraphResource o) {
+				return (resources_[o].lastGroup < res.firstGroup) || (res.lastGroup < resources_[o].firstGroup);
+			});
+		});
+
+		if (slot == slots_.end())
+		{
+			slots_.emplace_back();
+			slots_.back().requirements = res.requirements;
+			slots_.back().resources.push_back(r);
+			continue;
+		}
+
+		slot->requirements.size = std::max(slot->requirements.size, res.requirements.size);
+		slot->requirements.alignment = std::max(slot->requirements.alignment, res.requirements.alignment);
+		slot->requirements.memoryTypeBits &= res.requirements.memoryTypeBits;
+		slot->resources.push_back(r);
+	}
+
+	for (AliasSlot& slot : slots_)
+	{
+		if (!ctx_.resources.allocateImageMemory(slot.requirements, slot.allocation))
+		{
+			printf("Cannot allocate render graph memory\n");
+			exit(EXIT_FAILURE);
+		}
+
+		std::sort(slot.resources.begin(), slot.resources.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+			return resources_[a].firstGroup < resources_[b].firstGroup;
+		});
+
+		for (size_t i = 0; i < slot.resources.size(); i++)
+		{
+			Resource& res = resources_[slot.resources[i]];
+			VulkanTexture& tex = res.texture;
+
+			res.aliasPrev = (i > 0) ? int32_t(slot.resources[i - 1]) : -1;
+
+			VK_CHECK(vkBindImageMemory(device, tex.image.image, slot.allocation.memory, slot.allocation.offset));
+			tex.image.imageMemory = slot.allocation.memory;
+
+			createImageView(device, tex.image.image, tex.format, getAspectMask(tex.format) & ~VK_IMAGE_ASPECT_STENCIL_BIT, &tex.image.imageView);
+
+			const bool samplerCreated = isDepthFormat(tex.format) ?
+				createDepthSampler(device, &tex.sampler) :
+				createTextureSampler(device, &tex.sampler, res.desc.minFilter, res.desc.maxFilter, res.desc.addressMode);
+
+			if (!samplerCreated)
+			{
+				printf("Cannot create a sampler for '%s'\n", res.name.c_str());
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+}
+
+void RenderGraph::createPassRenderers()
+{
+	for (Pass& pass : passes_)
+	{
+		if (!pass.live)
+			continue;
+
+		pass.renderer = pass.factory(*this);
+		if (!pass.renderer)
+		{
+			printf("Render graph pass '%s' has no renderer\n", pass.name.c_str());
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+RenderGraph::AccessState RenderGraph::getReadState(const Resource& res) const
+{
+	if (res.isBuffer)
+		return AccessState{ VK_IMAGE_LAYOUT_UNDEFINED, kBufferStages,
+			VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
+			VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT };
+
+	return AccessState{ VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+}
+
+RenderGraph::AccessState RenderGraph::getWriteState(const Resource& res, const Pass& pass) const
+{
+	if (res.isBuffer)
+		return AccessState{ VK_IMAGE_LAYOUT_UNDEFINED, kBufferStages, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT };
+
+	const VkFormat format = res.texture.format;
+	const RenderPassCreateInfo& info = pass.renderer->renderPass_.info;
+
+	// the initial layout of the attachment, see createColorAndDepthRenderPass()
+	const bool loadsFromShaderLayout = (info.flags_ & eRenderPassBit_OffscreenInternal) &&
+		!(isDepthFormat(format) ? info.clearDepth_ : (info.flags_ & eRenderPassBit_First) != 0);
+
+	const VkImageLayout layout = loadsFromShaderLayout ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : getAttachmentLayout(format);
+
+	if (isDepthFormat(format))
+		return AccessState{ layout,
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT };
+
+	return AccessState{ layout,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT };
+}
+
+VkImageLayout RenderGraph::getLayoutAfter(const Resource& res, const Pass& pass) const
+{
+	return (pass.renderer->renderPass_.info.flags_ & eRenderPassBit_Offscreen) ?
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : getAttachmentLayout(res.texture.format);
+}
+
+void RenderGraph::buildBarriers()
+{
+	std::vector<AccessState> states(resources_.size());
+
+	// whatever ran before the graph may still write the imported resources
+	for (size_t i = 0; i < resources_.size(); i++)
+		if (resources_[i].imported)
+			states[i] = AccessState{ resources_[i].importedLayout, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_WRITE_BIT };
+
+	std::vector<AccessState> required(resources_.size());
+	std::vector<RenderGraphResource> used;
+
+	for (uint32_t g = 0; g < groups_.size(); g++)
+	{
+		Group& group = groups_[g];
+
+		used.clear();
+		auto require = [&required, &used](RenderGraphResource r, const AccessState& state)
+		{
+			if (std::find(used.begin(), used.end(), r) == used.end())
+			{
+				used.push_back(r);
+				required[r] = state;
+				return;
+			}
+
+			// several passes of the group read it, or a pass updates a buffer in place
+			required[r].stages |= state.stages;
+			required[r].access |= state.access;
+		};
+
+		for (uint32_t p : group.passes)
+		{
+			const Pass& pass = passes_[p];
+
+			for (RenderGraphResource r : pass.reads)
+				require(r, getReadState(resources_[r]));
+			for (RenderGraphResource r : pass.writes)
+				require(r, getWriteState(resources_[r], pass));
+		}
+
+		for (RenderGraphResource r : used)
+		{
+			const Resource& res = resources_[r];
+			AccessState from = states[r];
+
+			// the first use in the frame discards the contents, the memory may still be used by the previous texture of the slot
+			if (!res.imported && res.firstGroup == g)
+			{
+				from.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+				if (res.aliasPrev >= 0)
+				{
+					from.stages = states[res.aliasPrev].stages;
+					from.access = states[res.aliasPrev].access;
+				}
+				else
+				{
+					// the last texture of the slot in the previous frame, or the readers of an output
+					from.stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+					from.access = 0;
+				}
+			}
+
+			addBarrier(group.barriers, res, from, required[r]);
+			states[r] = required[r];
+		}
+
+		for (uint32_t p : group.passes)
+		{
+			const Pass& pass = passes_[p];
+			for (RenderGraphResource r : pass.writes)
+				if (!resources_[r].isBuffer)
+					states[r].layout = getLayoutAfter(resources_[r], pass);
+		}
+	}
+
+	for (size_t i = 0; i < resources_.size(); i++)
+	{
+		const Resource& res = resources_[i];
+		if (res.firstGroup == NO_GROUP)
+			continue;
+
+		if (res.imported)
+			addBarrier(finalBarriers_, res, states[i],
+				AccessState{ res.importedLayout, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT });
+		else if (res.output)
+			addBarrier(finalBarriers_, res, states[i],
+				AccessState{ VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT });
+	}
+}
+
+void RenderGraph::addBarrier(BarrierBatch& batch, const Resource& res, const AccessState& from, const AccessState& to) const
+{
+	const bool hazard = ((from.access | to.access) & kWriteAccess) != 0;
+	const bool transition = !res.isBuffer && (from.layout != to.layout);
+
+	if (!hazard && !transition)
+		return;
+
+	batch.srcStages |= from.stages;
+	batch.dstStages |= to.stages;
+
+	// only writes have to be made available, a write after read just waits for the stages
+	if (res.isBuffer)
+	{
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = from.access & kWriteAccess;
+		barrier.dstAccessMask = to.access;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = res.buffer.buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+
+		batch.buffers.push_back(barrier);
+		return;
+	}
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = from.access & kWriteAccess;
+	barrier.dstAccessMask = to.access;
+	barrier.oldLayout = from.layout;
+	barrier.newLayout = to.layout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = res.texture.image.image;
+	barrier.subresourceRange = VkImageSubresourceRange{ getAspectMask(res.texture.format), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+
+	batch.images.push_back(barrier);
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch) const
+{
+	if (batch.images.empty() && batch.buffers.empty())
+		return;
+
+	vkCmdPipelineBarrier(commandBuffer,
+		batch.srcStages ? batch.srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, batch.dstStages, 0,
+		0, nullptr,
+		(uint32_t)batch.buffers.size(), batch.buffers.data(),
+		(uint32_t)batch.images.size(), batch.images.data());
+}
+
+void RenderGraph::setPassEnabled(uint32_t pass, bool enabled)
+{
+	Pass& p = passes_[pass];
+
+	if (p.renderer)
+		for (RenderGraphResource r : p.writes)
+		{
+			const Resource& res = resources_[r];
+			if (!res.isBuffer && getWriteState(res, p).layout != getLayoutAfter(res, p))
+			{
+				printf("Render graph pass '%s' changes the layout of '%s' and cannot be skipped\n", p.name.c_str(), res.name.c_str());
+				exit(EXIT_FAILURE);
+			}
+		}
+
+	p.enabled = enabled;
+}
+
+const VulkanTexture& RenderGraph::getTexture(RenderGraphResource res) const
+{
+	const Resource& r = resources_[res];
+	if (r.isBuffer || r.texture.image.image == VK_NULL_HANDLE)
+	{
+		printf("Render graph texture '%s' does not exist (not compiled yet or culled)\n", r.name.c_str());
+		exit(EXIT_FAILURE);
+	}
+
+	return r.texture;
+}
+
+const VulkanBuffer& RenderGraph::getBuffer(RenderGraphResource res) const
+{
+	const Resource& r = resources_[res];
+	if (!r.isBuffer)
+	{
+		printf("Render graph resource '%s' is not a buffer\n", r.name.c_str());
+		exit(EXIT_FAILURE);
+	}
+
+	return r.buffer;
+}
+
+void RenderGraph::fillCommandBuffer(VkCommandBuffer commandBuffer, size_t currentImage, VkFramebuffer fb1, VkRenderPass rp1)
+{
+	for (const Group& group : groups_)
+	{
+		recordBarriers(commandBuffer, group.barriers);
+
+		for (uint32_t p : group.passes)
+		{
+			const Pass& pass = passes_[p];
+			if (!pass.enabled)
+				continue;
+
+			Renderer& r = *pass.renderer;
+
+			const VkRenderPass rp = (r.renderPass_.handle != VK_NULL_HANDLE) ? r.renderPass_.handle : rp1;
+			const VkFramebuffer fb = (r.framebuffer_ != VK_NULL_HANDLE) ? r.framebuffer_ : fb1;
+
+			r.fillCommandBuffer(commandBuffer, currentImage, fb, rp);
+		}
+	}
+
+	recordBarriers(commandBuffer, finalBarriers_);
+}
+
+void RenderGraph::updateBuffers(size_t currentImage)
+{
+	for (Pass& pass : passes_)
+		if (pass.renderer)
+			pass.renderer->updateBuffers(currentImage);
+}
+
+void RenderGraph::printStats() const
+{
+	uint32_t numLive = 0;
+	for (const Pass& pass : passes_)
+		numLive += pass.live ? 1 : 0;
+
+	uint32_t numBarriers = uint32_t(finalBarriers_.images.size() + finalBarriers_.buffers.size());
+	uint32_t numBatches = numBarriers ? 1 : 0;
+	for (const Group& group : groups_)
+	{
+		const uint32_t n = uint32_t(group.barriers.images.size() + group.barriers.buffers.size());
+		numBarriers += n;
+		numBatches += n ? 1 : 0;
+	}
+
+	uint32_t numTransients = 0;
+	VkDeviceSize transientBytes = 0;
+	for (const Resource& res : resources_)
+		if (!res.imported && res.firstGroup != NO_GROUP)
+		{
+			numTransients++;
+			transientBytes += res.requirements.size;
+		}
+
+	VkDeviceSize slotBytes = 0;
+	for (const AliasSlot& slot : slots_)
+		slotBytes += slot.requirements.size;
+
+	printf("Render graph: %u of %u passes in %u groups, %u barriers in %u batches\n",
+		numLive, (uint32_t)passes_.size(), (uint32_t)groups_.size(), numBarriers, numBatches);
+	printf("  %u transient textures in %u memory ranges: %.2f MiB instead of %.2f MiB\n",
+		numTransients, (uint32_t)slots_.size(), double(slotBytes) / (1024.0 * 1024.0), double(transientBytes) / (1024.0 * 1024.0));
+
+	for (const Pass& pass : passes_)
+		if (!pass.live)
+			printf("  culled pass '%s'\n", pass.name.c_str());
+
+	fflush(stdout);
+}
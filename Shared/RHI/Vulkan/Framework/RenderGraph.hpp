@@ -0,0 +1,170 @@
+#pragma once
+
+#include <RHI/Vulkan/Framework/Renderer.hpp>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+/* Index of a texture or buffer declared in a RenderGraph */
+using RenderGraphResource = uint32_t;
+
+/* A texture the graph creates and owns, 0 for width/height means the framebuffer size */
+struct RenderGraphTextureDesc
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+	VkFilter minFilter = VK_FILTER_LINEAR;
+	VkFilter maxFilter = VK_FILTER_LINEAR;
+	VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+};
+
+/**
+	A chain of offscreen passes described by the textures and buffers each of them reads and writes.
+
+	compile() turns the description into a fixed schedule:
+	- passes whose results are never used (nothing reads their transient outputs) are culled,
+	- consecutive passes without read/write hazards between them form a group, all the barriers a group needs are issued
+	  by one vkCmdPipelineBarrier() call before it,
+	- layouts and access masks are tracked through the schedule, so the passes contain no barriers of their own,
+	- transient textures which are never alive in the same group share memory.
+
+	A pass is any Renderer, created by its factory once the textures exist (getTexture() is valid inside the factory).
+	Its render pass decides the layout of the written attachments after it (see eRenderPassBit_Offscreen).
+	Imported textures are left in the layout they were imported with; transients marked as outputs end up in
+	VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL and keep their contents until the graph runs again, the rest are undefined outside the graph.
+*/
+struct RenderGraph : public Renderer
+{
+	using PassFactory = std::function<std::unique_ptr<Renderer>(RenderGraph& graph)>;
+
+	explicit RenderGraph(VulkanRenderContext& ctx);
+	~RenderGraph() override;
+
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	RenderGraphResource createTexture(const char* name, const RenderGraphTextureDesc& desc);
+
+	/* [layout] is the layout of the texture when the graph starts and after it is done */
+	RenderGraphResource importTexture(const char* name, const VulkanTexture& tex, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	RenderGraphResource importBuffer(const char* name, const VulkanBuffer& buffer);
+
+	/* Passes run in the order they are added. Returns the pass index for setPassEnabled() */
+	uint32_t addPass(const char* name, const std::vector<RenderGraphResource>& reads, const std::vector<RenderGraphResource>& writes, PassFactory factory);
+
+	/* The transient is read after the graph (e.g. displayed by the app): its pass is kept and its memory is not reused */
+	void markOutput(RenderGraphResource res);
+
+	void compile();
+
+	/**
+		Skip a pass without changing the schedule (ping-pong passes, debug toggles).
+		Only for passes whose render pass keeps the attachment layouts, otherwise the barriers after it would be wrong.
+	*/
+	void setPassEnabled(uint32_t pass, bool enabled);
+	inline bool isPassEnabled(uint32_t pass) const { return passes_[pass].enabled; }
+
+	const VulkanTexture& getTexture(RenderGraphResource res) const;
+	const VulkanBuffer& getBuffer(RenderGraphResource res) const;
+
+	void fillCommandBuffer(VkCommandBuffer commandBuffer, size_t currentImage, VkFramebuffer fb1 = VK_NULL_HANDLE, VkRenderPass rp1 = VK_NULL_HANDLE) override;
+
+	void updateBuffers(size_t currentImage) override;
+
+	/* Culled passes, groups, barriers and the transient memory with and without aliasing */
+	void printStats() const;
+
+private:
+	static constexpr uint32_t NO_GROUP = UINT32_MAX;
+
+	struct AccessState
+	{
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags stages = 0;
+		VkAccessFlags access = 0;
+	};
+
+	struct Resource
+	{
+		std::string name;
+		bool isBuffer = false;
+		bool imported = false;
+		bool output = false;
+
+		RenderGraphTextureDesc desc;
+		VulkanTexture texture{};
+		VulkanBuffer buffer{};
+		VkImageLayout importedLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		// groups of the first and the last use (transients)
+		uint32_t firstGroup = NO_GROUP;
+		uint32_t lastGroup = 0;
+
+		// the transient which used the memory before this one in the frame, -1 for the first one
+		int32_t aliasPrev = -1;
+		VkMemoryRequirements requirements{};
+	};
+
+	struct Pass
+	{
+		std::string name;
+		std::vector<RenderGraphResource> reads;
+		std::vector<RenderGraphResource> writes;
+		PassFactory factory;
+
+		std::unique_ptr<Renderer> renderer;
+
+		bool live = false;
+		bool enabled = true;
+		uint32_t group = NO_GROUP;
+	};
+
+	struct BarrierBatch
+	{
+		VkPipelineStageFlags srcStages = 0;
+		VkPipelineStageFlags dstStages = 0;
+		std::vector<VkImageMemoryBarrier> images;
+		std::vector<VkBufferMemoryBarrier> buffers;
+	};
+
+	struct Group
+	{
+		std::vector<uint32_t> passes;
+		BarrierBatch barriers;
+	};
+
+	/* Memory shared by transients with disjoint lifetimes */
+	struct AliasSlot
+	{
+		VulkanAllocation allocation;
+		VkMemoryRequirements requirements{};
+		std::vector<RenderGraphResource> resources;
+	};
+
+	void cullPasses();
+	void buildGroups();
+	void computeLifetimes();
+	void createTransients();
+	void createPassRenderers();
+	void buildBarriers();
+
+	AccessState getReadState(const Resource& res) const;
+	AccessState getWriteState(const Resource& res, const Pass& pass) const;
+	VkImageLayout getLayoutAfter(const Resource& res, const Pass& pass) const;
+
+	void addBarrier(BarrierBatch& batch, const Resource& res, const AccessState& from, const AccessState& to) const;
+	void recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch) const;
+
+	std::vector<Resource> resources_;
+	std::vector<Pass> passes_;
+
+	std::vector<Group> groups_;
+	BarrierBatch finalBarriers_;
+
+	std::vector<AliasSlot> slots_;
+
+	bool compiled_ = false;
+};
@@ -10,18 +10,25 @@ struct Renderer
 	, ctx_(c)
 	{}
 
+	virtual ~Renderer() = default;
+
 	virtual void fillCommandBuffer(VkCommandBuffer commandBuffer, size_t currentImage, VkFramebuffer fb = VK_NULL_HANDLE, VkRenderPass rp = VK_NULL_HANDLE) = 0;
 	virtual void updateBuffers(size_t currentImage) {}
 
 	inline void updateUniformBuffer(uint32_t currentImage, const uint32_t offset, const uint32_t size, const void* data)
 	{
-		uploadBufferData(ctx_.vkDev, uniforms_[currentImage].memory, offset, data, size);
+		// the framework renderers create their uniform buffers mapped, so nothing is mapped and unmapped per frame
+		if (uniforms_[currentImage].ptr)
+			memcpy(static_cast<uint8_t*>(uniforms_[currentImage].ptr) + offset, data, size);
+		else
+			uploadBufferData(ctx_.vkDev, uniforms_[currentImage].memory, offset, data, size);
 	}
 
 	void initPipeline(const std::vector<const char*>& shaders, const PipelineInfo& pInfo, uint32_t vtxConstSize = 0, uint32_t fragConstSize = 0)
 	{
 		pipelineLayout_ = ctx_.resources.addPipelineLayout(descriptorSetLayout_, vtxConstSize, fragConstSize);
-		graphicsPipeline_ = ctx_.resources.addPipeline(renderPass_.handle, pipelineLayout_, shaders, pInfo);
+		// created together with the pipelines of the other renderers before the first frame, see VulkanResources::flushPipelines()
+		ctx_.resources.requestPipeline(&graphicsPipeline_, renderPass_.handle, pipelineLayout_, shaders, pInfo);
 	}
 
 	PipelineInfo initRenderPass(const PipelineInfo& pInfo, const std::vector<VulkanTexture>& outputs,
@@ -71,7 +78,8 @@ struct Renderer
 			renderPass_.info.clearColor_ ? &clearValues[0] : (renderPass_.info.clearDepth_ ? &clearValues[1] : nullptr));
 
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline_);
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout_, 0, 1, &descriptorSets_[currentImage], 0, nullptr);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout_, 0, 1, &descriptorSets_[currentImage],
+			(uint32_t)dynamicOffsets_.size(), dynamicOffsets_.empty() ? nullptr : dynamicOffsets_.data());
 	}
 
 	VkFramebuffer framebuffer_ = nullptr;
@@ -100,4 +108,7 @@ protected:
 	VkPipeline graphicsPipeline_ = nullptr;
 
 	std::vector<VulkanBuffer> uniforms_;
+
+	// offsets of the dynamic buffer descriptors (in binding order) for the frame being recorded, see VulkanFrameAllocator
+	std::vector<uint32_t> dynamicOffsets_;
 };
\ No newline at end of file
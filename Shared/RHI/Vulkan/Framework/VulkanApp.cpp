@@ -55,8 +55,15 @@ GLFWwindow* initVulkanApp(int width, int height, Resolution* resolution)
 
 bool drawFrame(VulkanRenderDevice& vkDev, const std::function<void(uint32_t)>& updateBuffersFunc, const std::function<void(VkCommandBuffer, uint32_t)>& composeFrameFunc)
 {
+    // a headless device renders to its offscreen images in turn and presents nothing
+    const bool headless = (vkDev.swapchain == VK_NULL_HANDLE);
+
     uint32_t imageIndex = 0;
-    VkResult result = vkAcquireNextImageKHR(vkDev.device, vkDev.swapchain, 0, vkDev.semaphore, VK_NULL_HANDLE, &imageIndex);
+    VkResult result = VK_SUCCESS;
+    if (headless)
+        imageIndex = vkDev.nextImage++ % (uint32_t)vkDev.swapchainImages.size();
+    else
+        result = vkAcquireNextImageKHR(vkDev.device, vkDev.swapchain, 0, vkDev.semaphore, VK_NULL_HANDLE, &imageIndex);
     VK_CHECK(vkResetCommandPool(vkDev.device, vkDev.commandPool, 0));
 
     if (result != VK_SUCCESS) return false;
@@ -82,16 +89,22 @@ bool drawFrame(VulkanRenderDevice& vkDev, const std::function<void(uint32_t)>& u
     VkSubmitInfo si{};
     si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     si.pNext = nullptr;
-    si.waitSemaphoreCount = 1;
+    si.waitSemaphoreCount = headless ? 0 : 1;
     si.pWaitSemaphores = &vkDev.semaphore;
     si.pWaitDstStageMask = waitStages;
     si.commandBufferCount = 1;
     si.pCommandBuffers = &vkDev.commandBuffers[imageIndex];
-    si.signalSemaphoreCount = 1;
+    si.signalSemaphoreCount = headless ? 0 : 1;
     si.pSignalSemaphores = &vkDev.renderSemaphore;
 
     VK_CHECK(vkQueueSubmit(vkDev.graphicsQueue, 1, &si, nullptr));
 
+    if (headless)
+    {
+        VK_CHECK(vkDeviceWaitIdle(vkDev.device));
+        return true;
+    }
+
     VkPresentInfoKHR pi{};
     pi.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     pi.pNext = nullptr;
@@ -109,6 +122,14 @@ bool drawFrame(VulkanRenderDevice& vkDev, const std::function<void(uint32_t)>& u
 
 void VulkanRenderContext::updateBuffers(uint32_t imageIndex)
 {
+    // pipelines requested by renderers created since the last frame
+    resources.flushPipelines();
+
+    // textures created while building this frame are uploaded by one batch submitted ahead of the frame
+    resources.submitUploads();
+
+    frameData.beginFrame(imageIndex);
+
     for (auto& r : onScreenRenderers_)
         if (r.enabled_)
             r.renderer_.updateBuffers(imageIndex);
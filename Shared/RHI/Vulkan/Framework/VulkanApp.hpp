@@ -21,6 +21,7 @@
 #include <RHI/Vulkan/UtilsVulkan.hpp>
 
 #include <RHI/Vulkan/Framework/VulkanResources.hpp>
+#include <RHI/Vulkan/Framework/VulkanFrameAllocator.hpp>
 
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
@@ -58,10 +59,13 @@ struct VulkanRenderContext
     VulkanRenderDevice vkDev;
     VulkanContextCreator ctxCreator;
     VulkanResources resources;
+    // per-frame uniforms and draw data, rewound for each swapchain image in updateBuffers()
+    VulkanFrameAllocator frameData;
 
     VulkanRenderContext(void* window, uint32_t screenWidth, uint32_t screenHeight, const VulkanContextFeatures& ctxFeatures = VulkanContextFeatures())
 	    : ctxCreator(vk, vkDev, window, screenWidth, screenHeight, ctxFeatures)
 		, resources(vkDev)
+		, frameData(vkDev, resources)
 		, depthTexture(resources.addDepthTexture(vkDev.framebufferWidth, vkDev.framebufferHeight, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL))
 		, screenRenderPass(resources.addFullScreenPass())
 		, screenRenderPass_NoDepth(resources.addFullScreenPass(false))
@@ -0,0 +1,41 @@
+#include <RHI/Vulkan/Framework/VulkanFrameAllocator.hpp>
+
+#include <algorithm>
+
+VulkanFrameAllocator::VulkanFrameAllocator(VulkanRenderDevice& vkDev, VulkanResources& resources, VkDeviceSize frameSize)
+{
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(vkDev.physicalDevice, &props);
+
+	// the offsets are used for uniform and storage bindings alike
+	alignment_ = std::max<VkDeviceSize>({ 16, props.limits.minUniformBufferOffsetAlignment, props.limits.minStorageBufferOffsetAlignment });
+	frameSize_ = (frameSize + alignment_ - 1) & ~(alignment_ - 1);
+
+	const VkDeviceSize numFrames = std::max<VkDeviceSize>(vkDev.swapchainImages.size(), 1);
+
+	buffer_ = resources.addBuffer(frameSize_ * numFrames,
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+}
+
+void VulkanFrameAllocator::beginFrame(uint32_t imageIndex)
+{
+	frameStart_ = frameSize_ * imageIndex;
+	top_ = frameStart_;
+}
+
+void* VulkanFrameAllocator::allocate(VkDeviceSize size, uint32_t& offset)
+{
+	const VkDeviceSize start = (top_ + alignment_ - 1) & ~(alignment_ - 1);
+
+	if (start + size > frameStart_ + frameSize_)
+	{
+		printf("Frame data does not fit into %u bytes per frame\n", (uint32_t)frameSize_);
+		exit(EXIT_FAILURE);
+	}
+
+	top_ = start + size;
+	offset = (uint32_t)start;
+
+	return static_cast<uint8_t*>(buffer_.ptr) + start;
+}
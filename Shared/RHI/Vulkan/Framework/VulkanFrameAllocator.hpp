@@ -0,0 +1,40 @@
+#pragma once
+
+#include <RHI/Vulkan/Framework/VulkanResources.hpp>
+
+/**
+	Linear allocator for the data rewritten every frame (uniforms, indirect commands, per-draw data).
+
+	One persistently mapped, host-coherent buffer is split into a region per swapchain image. beginFrame() rewinds the region
+	of the image being prepared: the command buffer of that image is re-recorded at the same time, so the GPU is done with
+	the previous contents. Renderers write straight into the returned pointers and bind the buffer with the returned offset,
+	as a dynamic offset (UNIFORM_BUFFER_DYNAMIC/STORAGE_BUFFER_DYNAMIC descriptors) or as the offset of an indirect draw.
+*/
+struct VulkanFrameAllocator
+{
+	VulkanFrameAllocator(VulkanRenderDevice& vkDev, VulkanResources& resources, VkDeviceSize frameSize = 4u << 20);
+
+	/* Called by VulkanRenderContext::updateBuffers() before any renderer writes its frame data */
+	void beginFrame(uint32_t imageIndex);
+
+	/* [size] bytes in the current frame region, aligned for any kind of buffer binding. [offset] is relative to getBuffer() */
+	void* allocate(VkDeviceSize size, uint32_t& offset);
+
+	template<typename T>
+	inline T* allocate(size_t count, uint32_t& offset) { return static_cast<T*>(allocate(count * sizeof(T), offset)); }
+
+	inline const VulkanBuffer& getBuffer() const { return buffer_; }
+	inline VkDeviceSize getFrameSize() const { return frameSize_; }
+
+	/* Bytes taken from the current region so far */
+	inline VkDeviceSize getFrameUsage() const { return top_ - frameStart_; }
+
+private:
+	VulkanBuffer buffer_;
+
+	VkDeviceSize frameSize_;
+	VkDeviceSize alignment_ = 256;
+
+	VkDeviceSize frameStart_ = 0;
+	VkDeviceSize top_ = 0;
+};
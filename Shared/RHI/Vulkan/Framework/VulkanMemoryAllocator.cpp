@@ -0,0 +1,369 @@
+#include <RHI/Vulkan/Framework/VulkanMemoryAllocator.hpp>
+
+#include <algorithm>
+
+VulkanMemoryAllocator::VulkanMemoryAllocator(VulkanRenderDevice& vkDev, VkDeviceSize blockSize)
+	: vkDev_(vkDev)
+	, blockSize_(blockSize)
+{
+	vkGetPhysicalDeviceMemoryProperties(vkDev_.physicalDevice, &memoryProperties_);
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(vkDev_.physicalDevice, &props);
+	nonCoherentAtomSize_ = std::max<VkDeviceSize>(props.limits.nonCoherentAtomSize, 1);
+	maxAllocationCount_ = props.limits.maxMemoryAllocationCount;
+
+	pools_.resize(memoryProperties_.memoryTypeCount * 2);
+	for (uint32_t i = 0; i != (uint32_t)pools_.size(); i++)
+	{
+		pools_[i].memoryType = i / 2;
+		pools_[i].isImage = (i & 1) != 0;
+	}
+}
+
+VulkanMemoryAllocator::~VulkanMemoryAllocator()
+{
+	for (Pool& pool : pools_)
+		for (Block& block : pool.blocks)
+			if (block.memory != VK_NULL_HANDLE)
+				vkFreeMemory(vkDev_.device, block.memory, nullptr);
+}
+
+VkDeviceSize VulkanMemoryAllocator::getBlockSize(uint32_t memoryType) const
+{
+	// small heaps (e.g. the 256 MB of device-local host-visible memory) are not taken by a few blocks
+	const VkDeviceSize heapSize = memoryProperties_.memoryHeaps[memoryProperties_.memoryTypes[memoryType].heapIndex].size;
+	return std::min(blockSize_, std::max<VkDeviceSize>(heapSize / 8, 1u << 20));
+}
+
+bool VulkanMemoryAllocator::allocateMemory(VkDeviceSize size, uint32_t memoryType, const void* pNext, VkDeviceMemory& memory)
+{
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.pNext = pNext;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	if (vkAllocateMemory(vkDev_.device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+		return false;
+
+	numDeviceAllocations_++;
+	return true;
+}
+
+bool VulkanMemoryAllocator::allocateFromBlock(Block& block, bool linear, VkDeviceSize size, VkDeviceSize alignment, VulkanAllocation& out)
+{
+	if (block.memory == VK_NULL_HANDLE)
+		return false;
+
+	if (linear)
+	{
+		const VkDeviceSize offset = (block.top + alignment - 1) & ~(alignment - 1);
+		if (offset + size > block.size)
+			return false;
+
+		block.top = offset + size;
+		block.numAllocations++;
+
+		out.offset = offset;
+		out.handle = 0;
+	}
+	else
+	{
+		uint64_t offset = 0;
+		if (!block.tlsf.allocate(size, alignment, offset, out.handle))
+			return false;
+
+		out.offset = offset;
+	}
+
+	out.memory = block.memory;
+	out.size = size;
+	return true;
+}
+
+bool VulkanMemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool isImage, bool dedicated, VulkanAllocation& out)
+{
+	return allocate(requirements, properties, isImage, dedicated, nullptr, out);
+}
+
+bool VulkanMemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool isImage, bool dedicated,
+	const VkMemoryDedicatedAllocateInfo* dedicatedInfo, VulkanAllocation& out)
+{
+	const uint32_t memoryType = findMemoryType(vkDev_.physicalDevice, requirements.memoryTypeBits, properties);
+	if (memoryType == 0xFFFFFFFF)
+		return false;
+
+	out = VulkanAllocation{};
+
+	const VkDeviceSize blockSize = getBlockSize(memoryType);
+
+	if (!dedicated && requirements.size <= blockSize / 2)
+	{
+		VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+		// sub-ranges of non-coherent memory are flushed in whole atoms, which must not overlap a neighbour
+		const VkMemoryPropertyFlags flags = memoryProperties_.memoryTypes[memoryType].propertyFlags;
+		if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+			alignment = std::max(alignment, nonCoherentAtomSize_);
+
+		const uint32_t poolIndex = memoryType * 2 + (isImage ? 1 : 0);
+		Pool& pool = pools_[poolIndex];
+		const bool linear = !isImage;
+
+		const VkDeviceSize size = (requirements.size + alignment - 1) & ~(alignment - 1);
+
+		out.pool = poolIndex;
+
+		for (uint32_t i = 0; i != (uint32_t)pool.blocks.size(); i++)
+		{
+			if (allocateFromBlock(pool.blocks[i], linear, size, alignment, out))
+			{
+				out.block = i;
+				return true;
+			}
+		}
+
+		// reuse the slot of a released block, the indices of the others stay valid
+		uint32_t slot = 0;
+		while (slot != (uint32_t)pool.blocks.size() && pool.blocks[slot].memory != VK_NULL_HANDLE)
+			slot++;
+
+		Block block;
+		if (allocateMemory(blockSize, memoryType, nullptr, block.memory))
+		{
+			block.size = blockSize;
+			if (!linear)
+				block.tlsf.reset(blockSize);
+
+			if (slot == (uint32_t)pool.blocks.size())
+				pool.blocks.push_back(std::move(block));
+			else
+				pool.blocks[slot] = std::move(block);
+
+			if (allocateFromBlock(pool.blocks[slot], linear, size, alignment, out))
+			{
+				out.block = slot;
+				return true;
+			}
+		}
+
+		// out of memory for a whole block, the resource alone may still fit
+	}
+
+	if (!allocateMemory(requirements.size, memoryType, dedicatedInfo, out.memory))
+		return false;
+
+	out.offset = 0;
+	out.size = requirements.size;
+	out.pool = memoryType * 2 + (isImage ? 1 : 0);
+	out.block = DEDICATED_BLOCK;
+
+	numDedicated_++;
+	dedicatedBytes_ += requirements.size;
+
+	return true;
+}
+
+void VulkanMemoryAllocator::free(VulkanAllocation& allocation)
+{
+	if (allocation.memory == VK_NULL_HANDLE)
+		return;
+
+	if (allocation.block == DEDICATED_BLOCK)
+	{
+		vkFreeMemory(vkDev_.device, allocation.memory, nullptr);
+		numDeviceAllocations_--;
+		numDedicated_--;
+		dedicatedBytes_ -= allocation.size;
+		allocation = VulkanAllocation{};
+		return;
+	}
+
+	Pool& pool = pools_[allocation.pool];
+	Block& block = pool.blocks[allocation.block];
+
+	bool empty = false;
+
+	if (pool.isImage)
+	{
+		block.tlsf.free(allocation.handle);
+		empty = (block.tlsf.getNumAllocations() == 0);
+	}
+	else
+	{
+		block.numAllocations--;
+		empty = (block.numAllocations == 0);
+		if (empty)
+			block.top = 0;
+	}
+
+	// keep one empty block per pool, so a texture replaced by another one does not free and allocate a whole block
+	if (empty)
+	{
+		const bool hasOtherEmptyBlock = std::any_of(pool.blocks.begin(), pool.blocks.end(), [&block, &pool](const Block& b)
+			{
+				return &b != &block && b.memory != VK_NULL_HANDLE &&
+					(pool.isImage ? b.tlsf.getNumAllocations() == 0 : b.numAllocations == 0);
+			});
+
+		if (hasOtherEmptyBlock)
+		{
+			vkFreeMemory(vkDev_.device, block.memory, nullptr);
+			numDeviceAllocations_--;
+			block = Block();
+		}
+	}
+
+	allocation = VulkanAllocation{};
+}
+
+bool VulkanMemoryAllocator::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VulkanAllocation& allocation, bool dedicated)
+{
+	// the same sharing mode as createSharedBuffer(): buffers are used by the graphics and the compute queues
+	const uint32_t familyCount = static_cast<uint32_t>(vkDev_.deviceQueueIndices.size());
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.pNext = nullptr;
+	bufferInfo.flags = 0;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = (familyCount > 1) ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+	bufferInfo.queueFamilyIndexCount = (familyCount > 1) ? familyCount : 0;
+	bufferInfo.pQueueFamilyIndices = (familyCount > 1) ? vkDev_.deviceQueueIndices.data() : nullptr;
+
+	VK_CHECK(vkCreateBuffer(vkDev_.device, &bufferInfo, nullptr, &buffer));
+
+	VkBufferMemoryRequirementsInfo2 requirementsInfo{};
+	requirementsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+	requirementsInfo.buffer = buffer;
+
+	VkMemoryDedicatedRequirements dedicatedRequirements{};
+	dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+	VkMemoryRequirements2 requirements{};
+	requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+	requirements.pNext = &dedicatedRequirements;
+
+	vkGetBufferMemoryRequirements2(vkDev_.device, &requirementsInfo, &requirements);
+
+	VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+	dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+	dedicatedInfo.buffer = buffer;
+
+	const bool wantsDedicated = dedicated || dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+
+	if (!allocate(requirements.memoryRequirements, properties, false, wantsDedicated, &dedicatedInfo, allocation))
+	{
+		vkDestroyBuffer(vkDev_.device, buffer, nullptr);
+		buffer = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VK_CHECK(vkBindBufferMemory(vkDev_.device, buffer, allocation.memory, allocation.offset));
+	return true;
+}
+
+bool VulkanMemoryAllocator::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
+	VkImage& image, VulkanAllocation& allocation, VkImageCreateFlags flags, uint32_t mipLevels)
+{
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.pNext = nullptr;
+	imageInfo.flags = flags;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = format;
+	imageInfo.extent = VkExtent3D{ width, height, 1 };
+	imageInfo.mipLevels = mipLevels;
+	imageInfo.arrayLayers = (uint32_t)((flags == VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT) ? 6 : 1);
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = tiling;
+	imageInfo.usage = usage;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.queueFamilyIndexCount = 0;
+	imageInfo.pQueueFamilyIndices = nullptr;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VK_CHECK(vkCreateImage(vkDev_.device, &imageInfo, nullptr, &image));
+
+	VkImageMemoryRequirementsInfo2 requirementsInfo{};
+	requirementsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+	requirementsInfo.image = image;
+
+	VkMemoryDedicatedRequirements dedicatedRequirements{};
+	dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+	VkMemoryRequirements2 requirements{};
+	requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+	requirements.pNext = &dedicatedRequirements;
+
+	vkGetImageMemoryRequirements2(vkDev_.device, &requirementsInfo, &requirements);
+
+	VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+	dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+	dedicatedInfo.image = image;
+
+	// render targets are usually the ones the driver wants alone (compression metadata and the like)
+	const bool wantsDedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+
+	if (!allocate(requirements.memoryRequirements, properties, tiling == VK_IMAGE_TILING_OPTIMAL, wantsDedicated, &dedicatedInfo, allocation))
+	{
+		vkDestroyImage(vkDev_.device, image, nullptr);
+		image = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VK_CHECK(vkBindImageMemory(vkDev_.device, image, allocation.memory, allocation.offset));
+	return true;
+}
+
+void VulkanMemoryAllocator::printStats() const
+{
+	printf("Vulkan memory: %u device allocations (limit %u), %u dedicated (%.1f MB)\n",
+		numDeviceAllocations_, maxAllocationCount_, numDedicated_, double(dedicatedBytes_) / (1024.0 * 1024.0));
+
+	for (const Pool& pool : pools_)
+	{
+		uint32_t numBlocks = 0;
+		uint32_t numAllocations = 0;
+		uint32_t numFreeRanges = 0;
+		VkDeviceSize blockBytes = 0;
+		VkDeviceSize usedBytes = 0;
+		VkDeviceSize largestFree = 0;
+
+		for (const Block& block : pool.blocks)
+		{
+			if (block.memory == VK_NULL_HANDLE)
+				continue;
+
+			numBlocks++;
+			blockBytes += block.size;
+
+			if (pool.isImage)
+			{
+				numAllocations += block.tlsf.getNumAllocations();
+				numFreeRanges += block.tlsf.getNumFreeRanges();
+				usedBytes += block.tlsf.getUsedSize();
+				largestFree = std::max<VkDeviceSize>(largestFree, block.tlsf.getLargestFreeRange());
+			}
+			else
+			{
+				numAllocations += block.numAllocations;
+				numFreeRanges += (block.top < block.size) ? 1 : 0;
+				usedBytes += block.top;
+				largestFree = std::max(largestFree, block.size - block.top);
+			}
+		}
+
+		if (numBlocks == 0)
+			continue;
+
+		const VkMemoryType& type = memoryProperties_.memoryTypes[pool.memoryType];
+
+		printf("  type %u (heap %u, flags 0x%x) %s: %u blocks, %.1f of %.1f MB used by %u allocations, %u free ranges, largest %.1f MB\n",
+			pool.memoryType, type.heapIndex, (uint32_t)type.propertyFlags, pool.isImage ? "images " : "buffers",
+			numBlocks, double(usedBytes) / (1024.0 * 1024.0), double(blockBytes) / (1024.0 * 1024.0),
+			numAllocations, numFreeRanges, double(largestFree) / (1024.0 * 1024.0));
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <RHI/Vulkan/UtilsVulkan.hpp>
+#include <Utils/TLSFAllocator.hpp>
+
+#include <vector>
+
+/* A range of device memory owned by VulkanMemoryAllocator, resources are bound at [memory] + [offset] */
+struct VulkanAllocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+
+	// pool and block the range comes from, DEDICATED_BLOCK if [memory] belongs to this allocation alone
+	uint32_t pool = 0;
+	uint32_t block = 0;
+	// TLSF range inside the block (unused by linear blocks and dedicated allocations)
+	uint32_t handle = 0;
+};
+
+/**
+	Sub-allocates buffers and images from large per-memory-type blocks instead of calling vkAllocateMemory for each of them,
+	which is slow and runs into maxMemoryAllocationCount on large scenes.
+
+	Every memory type has two pools: one for buffers and linear-tiling images, one for optimal-tiling images,
+	so neighbouring resources in a block never violate bufferImageGranularity.
+	Buffer blocks are linear (a bump pointer, the space is reused once every allocation of the block is freed):
+	VulkanResources never frees buffers one by one. Image blocks use a TLSF allocator, streamed textures come and go all the time.
+	Resources the driver prefers to keep alone, and the ones larger than half a block, get a dedicated VkDeviceMemory.
+*/
+class VulkanMemoryAllocator
+{
+public:
+	static constexpr uint32_t DEDICATED_BLOCK = UINT32_MAX;
+
+	explicit VulkanMemoryAllocator(VulkanRenderDevice& vkDev, VkDeviceSize blockSize = 64u << 20);
+	~VulkanMemoryAllocator();
+
+	VulkanMemoryAllocator(const VulkanMemoryAllocator&) = delete;
+	VulkanMemoryAllocator& operator=(const VulkanMemoryAllocator&) = delete;
+
+	/* [isImage] is true for optimal-tiling images. Returns false if neither a block nor a dedicated allocation could be made */
+	bool allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool isImage, bool dedicated, VulkanAllocation& out);
+
+	void free(VulkanAllocation& allocation);
+
+	/**
+		The same as the createBuffer()/createSharedBuffer() and createImage() functions from UtilsVulkan, the memory is bound at the allocation offset.
+		[dedicated] forces a VkDeviceMemory of its own, e.g. for buffers which are mapped with vkMapMemory() at offset 0 by their users.
+	*/
+	bool createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VulkanAllocation& allocation, bool dedicated = false);
+
+	bool createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
+		VkImage& image, VulkanAllocation& allocation, VkImageCreateFlags flags = 0, uint32_t mipLevels = 1);
+
+	/* Per pool: blocks, allocated and used bytes, fragmentation; plus the dedicated allocations and the total vkAllocateMemory count */
+	void printStats() const;
+
+private:
+	struct Block
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+
+		TLSFAllocator tlsf;
+
+		// linear blocks only
+		VkDeviceSize top = 0;
+		uint32_t numAllocations = 0;
+	};
+
+	struct Pool
+	{
+		uint32_t memoryType = 0;
+		bool isImage = false;
+		std::vector<Block> blocks;
+	};
+
+	/* [dedicatedInfo] names the resource a dedicated allocation is made for */
+	bool allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool isImage, bool dedicated,
+		const VkMemoryDedicatedAllocateInfo* dedicatedInfo, VulkanAllocation& out);
+
+	bool allocateMemory(VkDeviceSize size, uint32_t memoryType, const void* pNext, VkDeviceMemory& memory);
+	bool allocateFromBlock(Block& block, bool linear, VkDeviceSize size, VkDeviceSize alignment, VulkanAllocation& out);
+	VkDeviceSize getBlockSize(uint32_t memoryType) const;
+
+	VulkanRenderDevice& vkDev_;
+
+	VkPhysicalDeviceMemoryProperties memoryProperties_;
+	VkDeviceSize nonCoherentAtomSize_ = 1;
+	uint32_t maxAllocationCount_ = 0;
+
+	VkDeviceSize blockSize_;
+
+	// [memoryType * 2 + isImage]
+	std::vector<Pool> pools_;
+
+	uint32_t numDeviceAllocations_ = 0;
+	uint32_t numDedicated_ = 0;
+	VkDeviceSize dedicatedBytes_ = 0;
+};
@@ -0,0 +1,101 @@
+#include <RHI/Vulkan/Framework/VulkanPipelineCache.hpp>
+#include <Filesystem/ChunkFile.hpp>
+
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+namespace
+{
+	constexpr const uint32_t kPipelineCacheFileType = MakeChunkId('P', 'S', 'O', 'C');
+
+	constexpr const uint32_t kPipelineCacheSectionDriver = MakeChunkId('P', 'C', 'D', 'V');
+	constexpr const uint32_t kPipelineCacheSectionData = MakeChunkId('P', 'C', 'D', 'T');
+
+	/* Layout of VK_PIPELINE_CACHE_HEADER_VERSION_ONE at the start of the blob returned by vkGetPipelineCacheData() */
+	struct PipelineCacheHeader
+	{
+		uint32_t headerSize;
+		uint32_t headerVersion;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	};
+
+	static_assert(sizeof(PipelineCacheHeader) == 16 + VK_UUID_SIZE);
+
+	bool isCompatible(const uint8_t* data, size_t size, const VkPhysicalDeviceProperties& props)
+	{
+		if (size < sizeof(PipelineCacheHeader))
+			return false;
+
+		PipelineCacheHeader header;
+		memcpy(&header, data, sizeof(header));
+
+		return header.headerSize >= sizeof(PipelineCacheHeader) && header.headerSize <= size &&
+			header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			header.vendorID == props.vendorID && header.deviceID == props.deviceID &&
+			memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+}
+
+VulkanPipelineCache::VulkanPipelineCache(VulkanRenderDevice& vkDev, const std::string& fileName)
+	: vkDev_(vkDev)
+	, fileName_(fileName)
+{
+	vkGetPhysicalDeviceProperties(vkDev.physicalDevice, &props_);
+
+	ChunkFileReader file;
+	const uint8_t* data = nullptr;
+	size_t dataSize = 0;
+
+	if (std::filesystem::exists(fileName_) && file.Open(fileName_, kPipelineCacheFileType))
+	{
+		size_t driverSize = 0;
+		const uint8_t* driver = file.GetSectionData(kPipelineCacheSectionDriver, driverSize);
+		data = file.GetSectionData(kPipelineCacheSectionData, dataSize);
+
+		const bool sameDriver = driver && driverSize == sizeof(uint32_t) && memcmp(driver, &props_.driverVersion, sizeof(uint32_t)) == 0;
+
+		if (!data || !sameDriver || !isCompatible(data, dataSize, props_))
+		{
+			printf("Discarding pipeline cache '%s' made for another device or driver\n", fileName_.c_str());
+			data = nullptr;
+			dataSize = 0;
+		}
+	}
+
+	VkPipelineCacheCreateInfo ci{};
+	ci.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	ci.initialDataSize = dataSize;
+	ci.pInitialData = data;
+
+	VK_CHECK(vkCreatePipelineCache(vkDev_.device, &ci, nullptr, &cache_));
+}
+
+VulkanPipelineCache::~VulkanPipelineCache()
+{
+	save();
+	vkDestroyPipelineCache(vkDev_.device, cache_, nullptr);
+}
+
+bool VulkanPipelineCache::save() const
+{
+	size_t size = 0;
+	if (vkGetPipelineCacheData(vkDev_.device, cache_, &size, nullptr) != VK_SUCCESS || size == 0)
+		return false;
+
+	std::vector<uint8_t> data(size);
+	if (vkGetPipelineCacheData(vkDev_.device, cache_, &size, data.data()) != VK_SUCCESS)
+		return false;
+	data.resize(size);
+
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(fileName_).parent_path(), ec);
+
+	ChunkFileWriter writer(kPipelineCacheFileType);
+	writer.AddSection(kPipelineCacheSectionDriver, &props_.driverVersion, sizeof(uint32_t));
+	writer.AddArray(kPipelineCacheSectionData, data);
+
+	return writer.SaveAtomically(fileName_);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <RHI/Vulkan/UtilsVulkan.hpp>
+
+#include <string>
+
+/**
+	VkPipelineCache of the device, loaded from [fileName] on creation and written back on destruction.
+	The blob is only handed to the driver if its header names the same vendor, device and pipelineCacheUUID
+	(and the driver version stored next to it matches): data from another GPU or driver is dropped instead of relying on the driver to reject it.
+	The cache is internally synchronized, pipelines may be created with it from several threads at once.
+*/
+struct VulkanPipelineCache
+{
+	VulkanPipelineCache(VulkanRenderDevice& vkDev, const std::string& fileName);
+	~VulkanPipelineCache();
+
+	VulkanPipelineCache(const VulkanPipelineCache&) = delete;
+	VulkanPipelineCache& operator=(const VulkanPipelineCache&) = delete;
+
+	inline VkPipelineCache get() const { return cache_; }
+
+	/* Write the current contents to disk, also done by the destructor */
+	bool save() const;
+
+private:
+	VulkanRenderDevice& vkDev_;
+	std::string fileName_;
+
+	VkPhysicalDeviceProperties props_;
+	VkPipelineCache cache_ = VK_NULL_HANDLE;
+};
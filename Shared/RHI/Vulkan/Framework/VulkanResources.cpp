@@ -9,27 +9,32 @@
 
 #include <imgui.h>
 
+#include <stb_image.h>
+
 #include <gli/gli.hpp>
 #include <gli/texture2d.hpp>
 #include <gli/load_ktx.hpp>
 
+#include <TextureCompression.hpp>
+
+#include <taskflow/taskflow.hpp>
+#include <taskflow/algorithm/for_each.hpp>
+
+#include <algorithm>
+#include <chrono>
+
 glslang_stage_t glslangShaderStageFromFileName(const char* fileName);
 
 VulkanResources::~VulkanResources()
 {
+    // nothing may be destroyed while the pending uploads still copy into it
+    uploads.flush();
+
     for(auto& t : allTextures)
-    {
-        destroyVulkanImage(vkDev.device, t.image);
-        vkDestroySampler(vkDev.device, t.sampler, nullptr);
-    }
+        destroyTexture(t);
 
     for(auto& b : allBuffers)
-    {
-        if (b.ptr != nullptr)
-            vkUnmapMemory(vkDev.device, b.memory);
-        vkDestroyBuffer(vkDev.device, b.buffer, nullptr);
-        vkFreeMemory(vkDev.device, b.memory, nullptr);
-    }
+        destroyBuffer(b);
 
     for (auto& fb : allFramebuffers)
         vkDestroyFramebuffer(vkDev.device, fb, nullptr);
@@ -86,9 +91,10 @@ VulkanTexture VulkanResources::loadKTX(const char* fileName)
     ktx.width = extent.x;
     ktx.height = extent.y;
     ktx.depth = 4;
+    ktx.format = VK_FORMAT_R16G16_SFLOAT;
 
-    if (!createTextureImageFromData(vkDev, ktx.image.image, ktx.image.imageMemory,
-        (uint8_t*)gliTex.data(0, 0, 0), ktx.width, ktx.height, VK_FORMAT_R16G16_SFLOAT))
+    const size_t levelOffsets[] = { 0, size_t(ktx.width) * ktx.height * 4 };
+    if (!createTextureLevels(ktx, gliTex.data(0, 0, 0), levelOffsets, 1))
     {
         printf("ModelRenderer: failed to load BRDF LUT texture \n");
         exit(EXIT_FAILURE);
@@ -104,17 +110,36 @@ VulkanTexture VulkanResources::loadKTX(const char* fileName)
 
 VulkanTexture VulkanResources::loadTexture2D(const char* fileName)
 {
+    if (isCompressedTextureFile(fileName))
+    {
+        CompressedTexture compressed;
+        if (!loadCompressedTexture(fileName, compressed))
+        {
+            printf("Cannot load %s compressed texture file\n", fileName);
+            exit(EXIT_FAILURE);
+        }
+        return addMIPTexture(compressed);
+    }
+
+    int texWidth = 0, texHeight = 0, texChannels = 0;
+    stbi_uc* pixels = stbi_load(fileName, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+
     VulkanTexture tex;
-    if(!createTextureImage(vkDev, fileName, tex.image.image, tex.image.imageMemory, &tex.width, &tex.height))
+    tex.width = (uint32_t)texWidth;
+    tex.height = (uint32_t)texHeight;
+    tex.depth = 1;
+    tex.format = VK_FORMAT_R8G8B8A8_UNORM;
+
+    const size_t levelOffsets[] = { 0, size_t(texWidth) * texHeight * 4 };
+    if(!pixels || !createTextureLevels(tex, pixels, levelOffsets, 1))
     {
         printf("Cannot load %s 2D texture file\n", fileName);
         exit(EXIT_FAILURE);
     }
 
-    VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
-    transitionImageLayout(vkDev, tex.image.image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    stbi_image_free(pixels);
 
-    if(!createImageView(vkDev.device, tex.image.image, format, VK_IMAGE_ASPECT_COLOR_BIT, &tex.image.imageView))
+    if(!createImageView(vkDev.device, tex.image.image, tex.format, VK_IMAGE_ASPECT_COLOR_BIT, &tex.image.imageView))
     {
         printf("Cannot create image view for 2d texture (%s)\n", fileName);
         exit(EXIT_FAILURE);
@@ -132,15 +157,13 @@ VulkanTexture VulkanResources::addRGBATexture(int texWidth, int texHeight, void*
     tex.height = texHeight;
     tex.depth = 1;
     tex.format = VK_FORMAT_R8G8B8A8_UNORM;
-    if(!createTextureImageFromData(vkDev, tex.image.image, tex.image.imageMemory,
-        data, texWidth, texHeight, tex.format))
+    const size_t levelOffsets[] = { 0, size_t(texWidth) * texHeight * 4 };
+    if(!createTextureLevels(tex, data, levelOffsets, 1))
     {
         printf("Cannot create solid texture\n");
         exit(EXIT_FAILURE);
     }
 
-    transitionImageLayout(vkDev, tex.image.image, tex.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
     if(!createImageView(vkDev.device, tex.image.image, tex.format, VK_IMAGE_ASPECT_COLOR_BIT, &tex.image.imageView))
     {
         printf("Cannot create image view for 2d texture\n");
@@ -152,6 +175,126 @@ VulkanTexture VulkanResources::addRGBATexture(int texWidth, int texHeight, void*
     return tex;
 }
 
+static VkFormat getMIPTextureFormat(eCompressedFormat format)
+{
+    switch (format)
+    {
+        case eCompressedFormat_None: return VK_FORMAT_R8G8B8A8_UNORM;
+        case eCompressedFormat_BC5:  return VK_FORMAT_BC5_UNORM_BLOCK;
+        case eCompressedFormat_BC6H: return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+        // the scene shaders use albedo values as they are stored (like the R8G8B8A8_UNORM path), so sRGB data is not decoded on sampling
+        case eCompressedFormat_BC7:
+        case eCompressedFormat_BC7_SRGB: return VK_FORMAT_BC7_UNORM_BLOCK;
+    }
+    return VK_FORMAT_BC7_UNORM_BLOCK;
+}
+
+VulkanTexture VulkanResources::addMIPTexture(const TextureLevelsView& levels)
+{
+    const uint32_t mipLevels = (uint32_t)levels.numLevels_;
+
+    VulkanTexture tex;
+    tex.width = levels.w_;
+    tex.height = levels.h_;
+    tex.depth = 1;
+    tex.format = getMIPTextureFormat(levels.format_);
+    if (!createTextureLevels(tex, levels.data_, levels.levelOffsets_, mipLevels))
+    {
+        printf("Cannot create MIP texture\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (!createImageView(vkDev.device, tex.image.image, tex.format, VK_IMAGE_ASPECT_COLOR_BIT, &tex.image.imageView, VK_IMAGE_VIEW_TYPE_2D, 1, mipLevels))
+    {
+        printf("Cannot create image view for MIP texture\n");
+        exit(EXIT_FAILURE);
+    }
+
+    createTextureSampler(vkDev.device, &tex.sampler, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT, float(mipLevels));
+    allTextures.push_back(tex);
+    return tex;
+}
+
+bool VulkanResources::allocateImage(VulkanTexture& tex, VkImageUsageFlags usage, uint32_t mipLevels)
+{
+    VulkanAllocation allocation;
+    if (!allocator.createImage(tex.width, tex.height, tex.format, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        tex.image.image, allocation, 0, mipLevels))
+        return false;
+
+    tex.image.imageMemory = allocation.memory;
+    imageAllocations[tex.image.image] = allocation;
+    return true;
+}
+
+bool VulkanResources::createTextureLevels(VulkanTexture& tex, const void* data, const size_t* levelOffsets, uint32_t mipLevels)
+{
+    if (!allocateImage(tex, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, mipLevels))
+        return false;
+
+    if (uploads.uploadImage(tex.image.image, tex.format, tex.width, tex.height, 1, data, levelOffsets, mipLevels))
+        return true;
+
+    // larger than the whole ring, upload it on its own
+    auto it = imageAllocations.find(tex.image.image);
+    vkDestroyImage(vkDev.device, tex.image.image, nullptr);
+    allocator.free(it->second);
+    imageAllocations.erase(it);
+
+    return createMIPTextureImageFromLevels(vkDev, tex.image.image, tex.image.imageMemory,
+        data, levelOffsets, mipLevels, tex.width, tex.height, tex.format);
+}
+
+void VulkanResources::destroyTexture(VulkanTexture& tex)
+{
+    vkDestroyImageView(vkDev.device, tex.image.imageView, nullptr);
+    vkDestroyImage(vkDev.device, tex.image.image, nullptr);
+
+    auto it = imageAllocations.find(tex.image.image);
+    if (it != imageAllocations.end())
+    {
+        allocator.free(it->second);
+        imageAllocations.erase(it);
+    }
+    else
+    {
+        vkFreeMemory(vkDev.device, tex.image.imageMemory, nullptr);
+    }
+
+    vkDestroySampler(vkDev.device, tex.sampler, nullptr);
+}
+
+void VulkanResources::destroyBuffer(VulkanBuffer& buffer)
+{
+    if (buffer.ptr != nullptr)
+        vkUnmapMemory(vkDev.device, buffer.memory);
+
+    vkDestroyBuffer(vkDev.device, buffer.buffer, nullptr);
+
+    auto it = bufferAllocations.find(buffer.buffer);
+    if (it != bufferAllocations.end())
+    {
+        allocator.free(it->second);
+        bufferAllocations.erase(it);
+    }
+    else
+    {
+        vkFreeMemory(vkDev.device, buffer.memory, nullptr);
+    }
+}
+
+void VulkanResources::releaseTexture(const VulkanTexture& tex)
+{
+    auto it = std::find_if(allTextures.begin(), allTextures.end(),
+        [&tex](const VulkanTexture& t) { return t.image.image == tex.image.image; });
+
+    if (it == allTextures.end())
+        return;
+
+    destroyTexture(*it);
+    allTextures.erase(it);
+}
+
 VulkanTexture VulkanResources::addSolidRGBATexture(uint32_t color)
 {
     VulkanTexture tex;
@@ -159,15 +302,13 @@ VulkanTexture VulkanResources::addSolidRGBATexture(uint32_t color)
     tex.height = 1;
     tex.depth = 1;
     tex.format = VK_FORMAT_R8G8B8A8_UNORM;
-    if(!createTextureImageFromData(vkDev, tex.image.image, tex.image.imageMemory,
-        &color, 1, 1, tex.format))
+    const size_t levelOffsets[] = { 0, sizeof(color) };
+    if(!createTextureLevels(tex, &color, levelOffsets, 1))
     {
         printf("Cannot create solid texture\n");
         exit(EXIT_FAILURE);
     }
 
-    transitionImageLayout(vkDev, tex.image.image, tex.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
     if(!createImageView(vkDev.device, tex.image.image, tex.format, VK_IMAGE_ASPECT_COLOR_BIT, &tex.image.imageView))
     {
         printf("Cannot create image view for solid texture\n");
@@ -191,9 +332,8 @@ VulkanTexture VulkanResources::addColorTexture(int texWidth, int texHeight, VkFo
     res.depth = 1;
     res.format = colorFormat;
 
-    if(!createOffscreenImage(vkDev,
-        res.image.image, res.image.imageMemory,
-        w, h, colorFormat, 1, 0))
+    // the same usage as createOffscreenImage()
+    if(!allocateImage(res, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT))
     {
         printf("Cannot create color texture\n");
         exit(EXIT_FAILURE);
@@ -221,9 +361,8 @@ VulkanTexture VulkanResources::addDepthTexture(int texWidth, int texHeight, VkIm
     depth.depth = 1;
     depth.format = depthFormat;
 
-    if(!createImage(vkDev.device, vkDev.physicalDevice, w, h, depthFormat,
-        VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depth.image.image, depth.image.imageMemory))
+    // transfer source for the readback of MultiRenderer's eCullingMode_Verify
+    if(!allocateImage(depth, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT))
     {
         printf("Cannot create depth texture\n");
         exit(EXIT_FAILURE);
@@ -250,27 +389,64 @@ VulkanBuffer VulkanResources::addBuffer(VkDeviceSize size, VkBufferUsageFlags us
     buffer.memory = VK_NULL_HANDLE;
     buffer.ptr = nullptr;
 
-    if (!createSharedBuffer(vkDev, size, usage, properties, buffer.buffer, buffer.memory))
+    // host-visible buffers keep a VkDeviceMemory of their own: their users map [memory] from offset 0
+    const bool dedicated = (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+
+    VulkanAllocation allocation;
+    if (!allocator.createBuffer(size, usage, properties, buffer.buffer, allocation, dedicated))
     {
         printf("Cannot allocate buffer\n");
         exit(EXIT_FAILURE);
     }
-    else
-    {
-        buffer.size = size;
-        allBuffers.push_back(buffer);
-    }
+
+    buffer.size = size;
+    buffer.memory = allocation.memory;
+    bufferAllocations[buffer.buffer] = allocation;
 
     if (createMapping)
         vkMapMemory(vkDev.device, buffer.memory, 0, VK_WHOLE_SIZE, 0, &buffer.ptr);
 
+    allBuffers.push_back(buffer);
+
     return buffer;
 }
 
-VulkanBuffer VulkanResources::addVertexBuffer(uint32_t indexBufferSize, const void* indexData, uint32_t vertexBufferSize, const void* vertexData)
+VulkanBuffer VulkanResources::addVertexBuffer(uint32_t indexBufferSize, const void* indexData, uint32_t vertexBufferSize, const void* vertexData, uint32_t vertexPaddingSize)
 {
-    VulkanBuffer result;
-    result.size = allocateVertexBuffer(vkDev, &result.buffer, &result.memory, vertexBufferSize, vertexData, indexBufferSize, indexData);
+    const VkDeviceSize bufferSize = VkDeviceSize(vertexBufferSize) + vertexPaddingSize + indexBufferSize;
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(vkDev.device, vkDev.physicalDevice, bufferSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        stagingBuffer, stagingBufferMemory);
+
+    void* data;
+    vkMapMemory(vkDev.device, stagingBufferMemory, 0, bufferSize, 0, &data);
+    memcpy(data, vertexData, vertexBufferSize);
+    memset((unsigned char*)data + vertexBufferSize, 0, vertexPaddingSize);
+    memcpy((unsigned char*)data + vertexBufferSize + vertexPaddingSize, indexData, indexBufferSize);
+    vkUnmapMemory(vkDev.device, stagingBufferMemory);
+
+    VulkanBuffer result{};
+    VulkanAllocation allocation;
+    if (!allocator.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, result.buffer, allocation))
+    {
+        printf("Cannot allocate vertex buffer\n");
+        exit(EXIT_FAILURE);
+    }
+
+    copyBuffer(vkDev, stagingBuffer, result.buffer, bufferSize);
+
+    vkDestroyBuffer(vkDev.device, stagingBuffer, nullptr);
+    vkFreeMemory(vkDev.device, stagingBufferMemory, nullptr);
+
+    result.size = bufferSize;
+    result.memory = allocation.memory;
+    result.ptr = nullptr;
+    bufferAllocations[result.buffer] = allocation;
+
     allBuffers.push_back(result);
     return result;
 }
@@ -279,6 +455,8 @@ VkDescriptorPool VulkanResources::addDescriptorPool(const DescriptorSetInfo& dsI
 {
     uint32_t uniformBufferCount = 0;
     uint32_t storageBufferCount = 0;
+    uint32_t dynamicUniformBufferCount = 0;
+    uint32_t dynamicStorageBufferCount = 0;
     uint32_t samplerCount = static_cast<uint32_t>(dsInfo.textures.size());
 
     for (const auto& ta : dsInfo.textureArrays)
@@ -290,6 +468,10 @@ VkDescriptorPool VulkanResources::addDescriptorPool(const DescriptorSetInfo& dsI
             uniformBufferCount++;
         if (b.dInfo.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
             storageBufferCount++;
+        if (b.dInfo.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
+            dynamicUniformBufferCount++;
+        if (b.dInfo.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC)
+            dynamicStorageBufferCount++;
     }
 
     std::vector<VkDescriptorPoolSize> poolSizes;
@@ -302,6 +484,12 @@ VkDescriptorPool VulkanResources::addDescriptorPool(const DescriptorSetInfo& dsI
     if (storageBufferCount)
         poolSizes.push_back(VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, dSetCount * storageBufferCount });
 
+    if (dynamicUniformBufferCount)
+        poolSizes.push_back(VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, dSetCount * dynamicUniformBufferCount });
+
+    if (dynamicStorageBufferCount)
+        poolSizes.push_back(VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, dSetCount * dynamicStorageBufferCount });
+
     if (samplerCount)
         poolSizes.push_back(VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, dSetCount * samplerCount });
 
@@ -325,168 +513,195 @@ VkDescriptorPool VulkanResources::addDescriptorPool(const DescriptorSetInfo& dsI
     return descriptorPool;
 }
 
-bool VulkanResources::createGraphicsPipeline(
-    VulkanRenderDevice& vkDev,
-    VkRenderPass renderPass, VkPipelineLayout pipelineLayout,
-    const std::vector<const char*>& shaderFiles,
-    VkPipeline* pipeline,
-    VkPrimitiveTopology topology,
-    bool useDepth,
-    bool useBlending,
-    bool dynamicScissorState,
-    int32_t customWidth,
-    int32_t customHeight,
-    uint32_t numPatchControlPoints)
+namespace
 {
-    std::vector<ShaderModule> localShaderModules;
-    std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
-
-    shaderStages.resize(shaderFiles.size());
-    localShaderModules.resize(shaderFiles.size());
+    /* Every create info of one graphics pipeline, [pipelineInfo] points into the other members so the object never moves after init() */
+    struct GraphicsPipelineState
+    {
+        std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+        VkViewport viewport{};
+        VkRect2D scissor{};
+        VkPipelineViewportStateCreateInfo viewportState{};
+        VkPipelineRasterizationStateCreateInfo rasterizer{};
+        VkPipelineMultisampleStateCreateInfo multisampling{};
+        VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+        VkPipelineColorBlendStateCreateInfo colorBlending{};
+        VkPipelineDepthStencilStateCreateInfo depthStencil{};
+        VkDynamicState dynamicStateElt = VK_DYNAMIC_STATE_SCISSOR;
+        VkPipelineDynamicStateCreateInfo dynamicState{};
+        VkPipelineTessellationStateCreateInfo tessellationState{};
+
+        VkGraphicsPipelineCreateInfo pipelineInfo{};
+
+        void init(const VulkanRenderDevice& vkDev, VkRenderPass renderPass, VkPipelineLayout pipelineLayout, const PipelineInfo& params)
+        {
+            const uint32_t customWidth = params.width;
+            const uint32_t customHeight = params.height;
+
+            vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+            inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+            /* The only difference from createGraphicsPipeline() */
+            inputAssembly.topology = params.topology;
+            inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+            viewport.x = 0.0f;
+            viewport.y = 0.0f;
+            viewport.width = static_cast<float>(customWidth > 0 ? customWidth : vkDev.framebufferWidth);
+            viewport.height = static_cast<float>(customHeight > 0 ? customHeight : vkDev.framebufferHeight);
+            viewport.minDepth = 0.0f;
+            viewport.maxDepth = 1.0f;
+
+            scissor.offset = { 0, 0 };
+            scissor.extent = { customWidth > 0 ? customWidth : vkDev.framebufferWidth, customHeight > 0 ? customHeight : vkDev.framebufferHeight };
+
+            viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+            viewportState.viewportCount = 1;
+            viewportState.pViewports = &viewport;
+            viewportState.scissorCount = 1;
+            viewportState.pScissors = &scissor;
+
+            rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+            rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+            rasterizer.cullMode = VK_CULL_MODE_NONE;
+            rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+            rasterizer.lineWidth = 1.0f;
+
+            multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+            multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+            multisampling.sampleShadingEnable = VK_FALSE;
+            multisampling.minSampleShading = 1.0f;
+
+            colorBlendAttachment.blendEnable = VK_TRUE;
+            colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+            colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+            colorBlendAttachment.srcAlphaBlendFactor = params.useBlending ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+            colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+            colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+            colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+            colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+            colorBlending.logicOpEnable = VK_FALSE;
+            colorBlending.logicOp = VK_LOGIC_OP_COPY;
+            colorBlending.attachmentCount = 1;
+            colorBlending.pAttachments = &colorBlendAttachment;
+            colorBlending.blendConstants[0] = 0.0f;
+            colorBlending.blendConstants[1] = 0.0f;
+            colorBlending.blendConstants[2] = 0.0f;
+            colorBlending.blendConstants[3] = 0.0f;
+
+            depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+            depthStencil.depthTestEnable = static_cast<VkBool32>(params.useDepth ? VK_TRUE : VK_FALSE);
+            depthStencil.depthWriteEnable = static_cast<VkBool32>(params.useDepth ? VK_TRUE : VK_FALSE);
+            depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+            depthStencil.depthBoundsTestEnable = VK_FALSE;
+            depthStencil.minDepthBounds = 0.0f;
+            depthStencil.maxDepthBounds = 1.0f;
+
+            dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+            dynamicState.pNext = nullptr;
+            dynamicState.flags = 0;
+            dynamicState.dynamicStateCount = 1;
+            dynamicState.pDynamicStates = &dynamicStateElt;
+
+            tessellationState.sType = VK_STRUCTURE_TYPE_PIPELINE_TESSELLATION_STATE_CREATE_INFO;
+            tessellationState.pNext = nullptr;
+            tessellationState.flags = 0;
+            tessellationState.patchControlPoints = params.patchControlPoints;
+
+            pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+            pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+            pipelineInfo.pStages = shaderStages.data();
+            pipelineInfo.pVertexInputState = &vertexInputInfo;
+            pipelineInfo.pInputAssemblyState = &inputAssembly;
+            pipelineInfo.pTessellationState = (params.topology == VK_PRIMITIVE_TOPOLOGY_PATCH_LIST) ? &tessellationState : nullptr;
+            pipelineInfo.pViewportState = &viewportState;
+            pipelineInfo.pRasterizationState = &rasterizer;
+            pipelineInfo.pMultisampleState = &multisampling;
+            pipelineInfo.pDepthStencilState = params.useDepth ? &depthStencil : nullptr;
+            pipelineInfo.pColorBlendState = &colorBlending;
+            pipelineInfo.pDynamicState = params.dynamicScissorState ? &dynamicState : nullptr;
+            pipelineInfo.layout = pipelineLayout;
+            pipelineInfo.renderPass = renderPass;
+            pipelineInfo.subpass = 0;
+            pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+            pipelineInfo.basePipelineIndex = -1;
+        }
+    };
 
-    for (size_t i = 0; i < shaderFiles.size(); i++)
+    /* Shared by shader compilation and pipeline creation */
+    tf::Executor& getWorkers()
     {
-        const char* file = shaderFiles[i];
+        static tf::Executor executor;
+        return executor;
+    }
+}
 
-        auto idx = shaderMap.find(file);
+void VulkanResources::createGraphicsPipelines(const PipelineRequest* requests, uint32_t count)
+{
+    std::vector<GraphicsPipelineState> states(count);
+    std::vector<VkGraphicsPipelineCreateInfo> createInfos(count);
+    std::vector<VkPipeline> pipelines(count, VK_NULL_HANDLE);
 
-        if(idx != shaderMap.end())
-        {
-            // printf("Already compiled file (%s)\n", file);
-            localShaderModules[i] = shaderModules[idx->second];
-        }
-        else
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const PipelineRequest& r = requests[i];
+        GraphicsPipelineState& state = states[i];
+
+        // only reads [shaderMap], the modules were created by precompileShaders()
+        state.shaderStages.resize(r.shaderFiles.size());
+        for (size_t j = 0; j < r.shaderFiles.size(); j++)
         {
-            VK_CHECK(createShaderModule(vkDev.device, &localShaderModules[i], file));
-            shaderModules.push_back(localShaderModules[i]);
-            shaderMap[std::string(file)] = (int)shaderModules.size() - 1;
+            const std::string& file = r.shaderFiles[j];
+            VkShaderStageFlagBits stage = glslangShaderStageToVulkan(glslangShaderStageFromFileName(file.c_str()));
+
+            state.shaderStages[j] = shaderStageInfo(stage, shaderModules[shaderMap.find(file)->second], "main");
         }
 
-        VkShaderStageFlagBits stage = glslangShaderStageToVulkan(glslangShaderStageFromFileName(file));
-
-        shaderStages[i] = shaderStageInfo(stage, localShaderModules[i], "main");
-    }
-
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    /* The only difference from createGraphicsPipeline() */
-    inputAssembly.topology = topology;
-    inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(customWidth > 0 ? customWidth : vkDev.framebufferWidth);
-    viewport.height = static_cast<float>(customHeight > 0 ? customHeight : vkDev.framebufferHeight);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = { customWidth > 0 ? customWidth : vkDev.framebufferWidth, customHeight > 0 ? customHeight : vkDev.framebufferHeight };
-
-    VkPipelineViewportStateCreateInfo viewportState{};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
-    viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
-
-    VkPipelineRasterizationStateCreateInfo rasterizer{};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer.cullMode = VK_CULL_MODE_NONE;
-    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-    rasterizer.lineWidth = 1.0f;
-
-    VkPipelineMultisampleStateCreateInfo multisampling{};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.minSampleShading = 1.0f;
-
-    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.blendEnable = VK_TRUE;
-    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-    colorBlendAttachment.srcAlphaBlendFactor = useBlending ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
-    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-
-    VkPipelineColorBlendStateCreateInfo colorBlending{};
-    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable = VK_FALSE;
-    colorBlending.logicOp = VK_LOGIC_OP_COPY;
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
-    colorBlending.blendConstants[0] = 0.0f;
-    colorBlending.blendConstants[1] = 0.0f;
-    colorBlending.blendConstants[2] = 0.0f;
-    colorBlending.blendConstants[3] = 0.0f;
-
-    VkPipelineDepthStencilStateCreateInfo depthStencil{};
-    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencil.depthTestEnable = static_cast<VkBool32>(useDepth ? VK_TRUE : VK_FALSE);
-    depthStencil.depthWriteEnable = static_cast<VkBool32>(useDepth ? VK_TRUE : VK_FALSE);
-    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-    depthStencil.depthBoundsTestEnable = VK_FALSE;
-    depthStencil.minDepthBounds = 0.0f;
-    depthStencil.maxDepthBounds = 1.0f;
-
-    VkDynamicState dynamicStateElt = VK_DYNAMIC_STATE_SCISSOR;
-
-    VkPipelineDynamicStateCreateInfo dynamicState{};
-    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicState.pNext = nullptr;
-    dynamicState.flags = 0;
-    dynamicState.dynamicStateCount = 1;
-    dynamicState.pDynamicStates = &dynamicStateElt;
-
-    VkPipelineTessellationStateCreateInfo tessellationState{};
-    tessellationState.sType = VK_STRUCTURE_TYPE_PIPELINE_TESSELLATION_STATE_CREATE_INFO;
-    tessellationState.pNext = nullptr;
-    tessellationState.flags = 0;
-    tessellationState.patchControlPoints = numPatchControlPoints;
-
-    VkGraphicsPipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
-    pipelineInfo.pStages = shaderStages.data();
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pTessellationState = (topology = VK_PRIMITIVE_TOPOLOGY_PATCH_LIST) ? &tessellationState : nullptr;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = useDepth ? &depthStencil : nullptr;
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = dynamicScissorState ? &dynamicState : nullptr;
-    pipelineInfo.layout = pipelineLayout;
-    pipelineInfo.renderPass = renderPass;
-    pipelineInfo.subpass = 0;
-    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-    pipelineInfo.basePipelineIndex = -1;
-
-    VK_CHECK(vkCreateGraphicsPipelines(vkDev.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, pipeline));
+        state.init(vkDev, r.renderPass, r.pipelineLayout, r.params);
+        createInfos[i] = state.pipelineInfo;
+    }
 
-    return true;
+    VK_CHECK(vkCreateGraphicsPipelines(vkDev.device, pipelineCache.get(), count, createInfos.data(), nullptr, pipelines.data()));
+
+    for (uint32_t i = 0; i < count; i++)
+        *requests[i].pipeline = pipelines[i];
 }
 
 VkPipeline VulkanResources::addPipeline(VkRenderPass renderPass, VkPipelineLayout pipelineLayout,
     const std::vector<const char*>& shaderFiles, const PipelineInfo& pipelineParams)
 {
-    VkPipeline pipeline;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+
+    const PipelineRequest request = { &pipeline, renderPass, pipelineLayout, std::vector<std::string>(shaderFiles.begin(), shaderFiles.end()), pipelineParams };
+
+    precompileShaders(shaderFiles);
+    createGraphicsPipelines(&request, 1);
+
+    allPipelines.push_back(pipeline);
+    return pipeline;
+}
+
+void VulkanResources::requestPipeline(VkPipeline* pipeline, VkRenderPass renderPass, VkPipelineLayout pipelineLayout,
+    const std::vector<const char*>& shaderFiles, const PipelineInfo& pipelineParams)
+{
+    *pipeline = VK_NULL_HANDLE;
+    pendingPipelines.push_back({ pipeline, renderPass, pipelineLayout, std::vector<std::string>(shaderFiles.begin(), shaderFiles.end()), pipelineParams });
+}
 
-    if(!this->createGraphicsPipeline(vkDev, renderPass, pipelineLayout, shaderFiles,
-        &pipeline, pipelineParams.topology, pipelineParams.useDepth, pipelineParams.useBlending, pipelineParams.dynamicScissorState,
-        pipelineParams.width, pipelineParams.height, pipelineParams.patchControlPoints))
+VkPipeline VulkanResources::addComputePipeline(const char* shaderFile, VkPipelineLayout pipelineLayout)
+{
+    VkPipeline pipeline = VK_NULL_HANDLE;
+
+    precompileShaders({ shaderFile });
+
+    if (createComputePipeline(vkDev.device, shaderModules[shaderMap[shaderFile]].shaderModule, pipelineLayout, &pipeline, pipelineCache.get()) != VK_SUCCESS)
     {
-        printf("Cannot create graphics pipeline\n");
+        printf("Cannot create compute pipeline\n");
         exit(EXIT_FAILURE);
     }
 
@@ -494,6 +709,92 @@ VkPipeline VulkanResources::addPipeline(VkRenderPass renderPass, VkPipelineLayou
     return pipeline;
 }
 
+void VulkanResources::flushPipelines()
+{
+    if (pendingPipelines.empty())
+        return;
+
+    const auto startTime = std::chrono::steady_clock::now();
+
+    std::vector<const char*> files;
+    for (const auto& r : pendingPipelines)
+        for (const auto& f : r.shaderFiles)
+            files.push_back(f.c_str());
+
+    precompileShaders(files);
+
+    const auto shadersTime = std::chrono::steady_clock::now();
+
+    // one vkCreateGraphicsPipelines() call per worker, the driver compiles the pipelines of different calls concurrently
+    const uint32_t numPipelines = (uint32_t)pendingPipelines.size();
+    const uint32_t numBatches = std::max(1u, std::min(numPipelines, (uint32_t)getWorkers().num_workers()));
+    const uint32_t batchSize = (numPipelines + numBatches - 1) / numBatches;
+
+    tf::Taskflow taskflow;
+    taskflow.for_each_index(0u, numPipelines, batchSize, [this, numPipelines, batchSize](uint32_t first)
+    {
+        createGraphicsPipelines(&pendingPipelines[first], std::min(batchSize, numPipelines - first));
+    });
+    getWorkers().run(taskflow).wait();
+
+    for (const auto& r : pendingPipelines)
+        allPipelines.push_back(*r.pipeline);
+
+    pendingPipelines.clear();
+
+    const auto endTime = std::chrono::steady_clock::now();
+    printf("Created %u pipelines in %u batches: %.1f ms (shaders %.1f ms, pipelines %.1f ms)\n", numPipelines, (numPipelines + batchSize - 1) / batchSize,
+        std::chrono::duration<double, std::milli>(endTime - startTime).count(),
+        std::chrono::duration<double, std::milli>(shadersTime - startTime).count(),
+        std::chrono::duration<double, std::milli>(endTime - shadersTime).count());
+
+    // the pipelines created for the first frame are the ones worth keeping even if the app does not exit cleanly
+    pipelineCache.save();
+}
+
+void VulkanResources::precompileShaders(const std::vector<const char*>& shaderFiles)
+{
+    std::vector<std::string> files;
+
+    for (const char* file : shaderFiles)
+        if (shaderMap.find(file) == shaderMap.end() && std::find(files.begin(), files.end(), file) == files.end())
+            files.push_back(file);
+
+    if (files.empty())
+        return;
+
+    std::vector<ShaderModule> modules(files.size());
+
+    if (files.size() == 1)
+    {
+        compileShaderFile(files[0].c_str(), modules[0]);
+    }
+    else
+    {
+        // on a warm cache the tasks only read the sources and the SPIR-V entries
+        tf::Taskflow taskflow;
+        taskflow.for_each_index(size_t(0), files.size(), size_t(1), [&files, &modules](size_t i)
+        {
+            compileShaderFile(files[i].c_str(), modules[i]);
+        });
+        getWorkers().run(taskflow).wait();
+    }
+
+    // the shader modules are created on the calling thread
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        if (modules[i].SPIRV.empty())
+        {
+            printf("Cannot compile shader '%s'\n", files[i].c_str());
+            exit(EXIT_FAILURE);
+        }
+
+        VK_CHECK(createShaderModuleFromSPIRV(vkDev.device, &modules[i]));
+        shaderModules.push_back(modules[i]);
+        shaderMap[files[i]] = (uint32_t)shaderModules.size() - 1;
+    }
+}
+
 VkDescriptorSetLayout VulkanResources::addDescriptorSetLayout(const DescriptorSetInfo& dsInfo)
 {
     VkDescriptorSetLayout descriptorSetLayout;
@@ -776,7 +1077,13 @@ VulkanTexture VulkanResources::createFontTexture(const char* fontFile)
     int texWidth = 1, texHeight = 1;
     io.Fonts->GetTexDataAsRGBA32(&pixels, &texWidth, &texHeight);
 
-    if (!pixels || !createTextureImageFromData(vkDev, res.image.image, res.image.imageMemory, pixels, texWidth, texHeight, VK_FORMAT_R8G8B8A8_UNORM))
+    res.width = (uint32_t)texWidth;
+    res.height = (uint32_t)texHeight;
+    res.depth = 1;
+    res.format = VK_FORMAT_R8G8B8A8_UNORM;
+
+    const size_t levelOffsets[] = { 0, size_t(texWidth) * texHeight * 4 };
+    if (!pixels || !createTextureLevels(res, pixels, levelOffsets, 1))
     {
         printf("Failed to load texture\n"); fflush(stdout);
         return res;
@@ -1,11 +1,17 @@
 #pragma once
 
 #include <RHI/Vulkan/UtilsVulkan.hpp>
+#include <Filesystem/FilesystemUtilities.hpp>
+#include <RHI/Vulkan/Framework/VulkanMemoryAllocator.hpp>
+#include <RHI/Vulkan/Framework/VulkanPipelineCache.hpp>
+#include <RHI/Vulkan/Framework/VulkanUploadRing.hpp>
 #include <volk.h>
 
 #include <map>
 #include <string>
 
+struct TextureLevelsView;
+
 /**
     For more or less abstract descriptor set setup we need to describe individual items ("bindings").
     These are buffers, textures (samplers, but we call them "textures" here) and arrays of textures.
@@ -86,6 +92,12 @@ inline BufferAttachment storageBufferAttachment(VulkanBuffer buffer, uint32_t of
     return makeBufferAttachment(buffer, offset, size, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, shaderStageFlags);
 }
 
+/* [size] bytes at the offset passed to vkCmdBindDescriptorSets() every frame (see VulkanFrameAllocator) */
+inline BufferAttachment dynamicUniformBufferAttachment(VulkanBuffer buffer, uint32_t size, VkShaderStageFlags shaderStageFlags)
+{
+    return makeBufferAttachment(buffer, 0, size, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, shaderStageFlags);
+}
+
 /** An aggregate structure with all the data for descriptor set (or descriptor set layout) allocation */
 struct DescriptorSetInfo
 {
@@ -132,7 +144,9 @@ struct PipelineInfo
 */
 struct VulkanResources
 {
-    VulkanResources(VulkanRenderDevice& vkDev) : vkDev(vkDev){}
+    VulkanResources(VulkanRenderDevice& vkDev)
+        : vkDev(vkDev), allocator(vkDev), uploads(vkDev)
+        , pipelineCache(vkDev, FilesystemUtilities::GetResourcesDir() + "Cache/Pipelines/pipelines.bin") {}
     ~VulkanResources();
 
     VulkanTexture loadTexture2D(const char* filename);
@@ -150,10 +164,30 @@ struct VulkanResources
 
     VulkanTexture addDepthTexture(int texWidth = 0, int texHeight = 0, VkImageLayout layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
 
+    /* The texel data of addSolidRGBATexture(), addRGBATexture() and addMIPTexture() goes through [uploads]: the copies are batched and submitted by submitUploads() */
     VulkanTexture addSolidRGBATexture(uint32_t color = 0xFFFFFFFF);
 
     VulkanTexture addRGBATexture(int texWidth, int texHeight, void* data);
 
+    /* All the mip levels are uploaded as they are (block-compressed or RGBA8) */
+    VulkanTexture addMIPTexture(const TextureLevelsView& tex);
+
+    /* Called once per frame by VulkanRenderContext::updateBuffers(), before the frame command buffer is submitted */
+    inline void submitUploads() { uploads.submit(); }
+
+    /* Destroy a texture before the destructor does it, the caller makes sure no frame in flight still samples it */
+    void releaseTexture(const VulkanTexture& tex);
+
+    inline void printMemoryStats() const { allocator.printStats(); }
+
+    /* Device memory for optimal-tiling images the caller creates and binds itself (e.g. the aliased textures of RenderGraph) */
+    inline bool allocateImageMemory(const VkMemoryRequirements& requirements, VulkanAllocation& allocation)
+    {
+        return allocator.allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true, false, allocation);
+    }
+
+    inline void freeMemory(VulkanAllocation& allocation) { allocator.free(allocation); }
+
     VulkanBuffer addBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool createMapping = false);
 
     inline VulkanBuffer addUniformBuffer(VkDeviceSize bufferSize, bool createMapping = false)
@@ -163,7 +197,7 @@ struct VulkanResources
     }
 
     inline VulkanBuffer addIndirectBuffer(VkDeviceSize bufferSize, bool createMapping = false) {
-        return addBuffer(bufferSize, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, // | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        return addBuffer(bufferSize, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, // written by culling shaders
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, createMapping); /* for debugging we make it host-visible */
     }
 
@@ -179,8 +213,8 @@ struct VulkanResources
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, createMapping); /* for debugging we make it host-visible */
     }
 
-    /* Allocate and upload vertex & index buffer pair */
-    VulkanBuffer addVertexBuffer(uint32_t indexBufferSize, const void* indexData, uint32_t vertexBufferSize, const void* vertexData);
+    /* Allocate and upload vertex & index buffer pair (the index block starts after [vertexPaddingSize] zero bytes following the vertices) */
+    VulkanBuffer addVertexBuffer(uint32_t indexBufferSize, const void* indexData, uint32_t vertexBufferSize, const void* vertexData, uint32_t vertexPaddingSize = 0);
 
     VkFramebuffer addFramebuffer(RenderPass renderPass, const std::vector<VulkanTexture>& images);
 
@@ -200,6 +234,24 @@ struct VulkanResources
         0, 0, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
         true, false, false });
 
+    /**
+        Queue the creation of a graphics pipeline, [*pipeline] is set by flushPipelines().
+        The renderers request their pipelines while the app is constructed, so all of them are created at once before the first frame.
+    */
+    void requestPipeline(VkPipeline* pipeline, VkRenderPass renderPass, VkPipelineLayout pipelineLayout,
+        const std::vector<const char*>& shaderFiles, const PipelineInfo& pipelineParams);
+
+    VkPipeline addComputePipeline(const char* shaderFile, VkPipelineLayout pipelineLayout);
+
+    /* Compile the shaders and create the requested pipelines in parallel batches, called by VulkanRenderContext::updateBuffers() */
+    void flushPipelines();
+
+    /**
+        Load or compile the shader modules of [shaderFiles] which are not loaded yet, the compilation runs on a thread pool.
+        addPipeline() does it for the stages of one pipeline, apps can pass all their shaders up front to compile a cold cache in parallel.
+    */
+    void precompileShaders(const std::vector<const char*>& shaderFiles);
+
     /* Calculate the descriptor pool size from the list of buffers and textures */
     VkDescriptorPool addDescriptorPool(const DescriptorSetInfo& dsInfo, uint32_t dSetCount = 1);
 
@@ -224,6 +276,23 @@ struct VulkanResources
 private:
     VulkanRenderDevice& vkDev;
 
+    /* Textures and buffers are sub-allocated from large blocks, see VulkanMemoryAllocator */
+    VulkanMemoryAllocator allocator;
+    std::map<VkImage, VulkanAllocation> imageAllocations;
+    std::map<VkBuffer, VulkanAllocation> bufferAllocations;
+
+    VulkanUploadRing uploads;
+
+    /* Create the device-local image of [tex] (size and format set by the caller) */
+    bool allocateImage(VulkanTexture& tex, VkImageUsageFlags usage, uint32_t mipLevels = 1);
+
+    /* Create the image of [tex] and queue the upload of its levels */
+    bool createTextureLevels(VulkanTexture& tex, const void* data, const size_t* levelOffsets, uint32_t mipLevels);
+
+    /* Images and buffers which did not come from [allocator] (e.g. cube maps) own their memory */
+    void destroyTexture(VulkanTexture& tex);
+    void destroyBuffer(VulkanBuffer& buffer);
+
     std::vector<VulkanTexture> allTextures;
     std::vector<VulkanBuffer> allBuffers;
 
@@ -239,18 +308,22 @@ private:
     std::vector<ShaderModule> shaderModules;
     std::map<std::string, uint32_t> shaderMap;
 
-    bool createGraphicsPipeline(
-        VulkanRenderDevice& vkDev,
-        VkRenderPass renderPass, VkPipelineLayout pipelineLayout,
-        const std::vector<const char*>& shaderFiles,
-        VkPipeline* pipeline,
-        VkPrimitiveTopology topology,
-        bool useDepth,
-        bool useBlending,
-        bool dynamicScissorState,
-        int32_t customWidth,
-        int32_t customHeight,
-        uint32_t numPatchControlPoints);
+    /* Persistent across runs, used for every pipeline created here */
+    VulkanPipelineCache pipelineCache;
+
+    struct PipelineRequest
+    {
+        VkPipeline* pipeline;
+        VkRenderPass renderPass;
+        VkPipelineLayout pipelineLayout;
+        std::vector<std::string> shaderFiles;
+        PipelineInfo params;
+    };
+
+    std::vector<PipelineRequest> pendingPipelines;
+
+    /* One vkCreateGraphicsPipelines() call for [count] requests, the shader modules must be loaded. Safe to call from several threads at once */
+    void createGraphicsPipelines(const PipelineRequest* requests, uint32_t count);
 };
 
 /* Create a uniform buffer mapped to a CPU location and initialize the buffer with default values */
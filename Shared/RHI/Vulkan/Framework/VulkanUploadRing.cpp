@@ -0,0 +1,205 @@
+#include <RHI/Vulkan/Framework/VulkanUploadRing.hpp>
+#include <TextureCompression.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+VulkanUploadRing::VulkanUploadRing(VulkanRenderDevice& vkDev, VkDeviceSize size, uint32_t numBatches)
+	: vkDev_(vkDev)
+	, size_(size)
+{
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(vkDev_.physicalDevice, &props);
+
+	// 16 covers the texel blocks of every format we upload (4 bytes for RGBA8, 16 bytes for BCn)
+	alignment_ = std::max<VkDeviceSize>(16, props.limits.optimalBufferCopyOffsetAlignment);
+	size_ = (size_ + alignment_ - 1) & ~(alignment_ - 1);
+
+	if (!createBuffer(vkDev_.device, vkDev_.physicalDevice, size_, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer_, memory_))
+	{
+		printf("Cannot create upload ring buffer\n");
+		exit(EXIT_FAILURE);
+	}
+
+	VK_CHECK(vkMapMemory(vkDev_.device, memory_, 0, size_, 0, (void**)&mapped_));
+
+	VkCommandPoolCreateInfo cpi{};
+	cpi.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	cpi.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	cpi.queueFamilyIndex = vkDev_.graphicsFamily;
+	VK_CHECK(vkCreateCommandPool(vkDev_.device, &cpi, nullptr, &commandPool_));
+
+	batches_.resize(std::max(numBatches, 1u));
+
+	for (Batch& b : batches_)
+	{
+		VkCommandBufferAllocateInfo ai{};
+		ai.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		ai.commandPool = commandPool_;
+		ai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		ai.commandBufferCount = 1;
+		VK_CHECK(vkAllocateCommandBuffers(vkDev_.device, &ai, &b.commandBuffer));
+
+		VkFenceCreateInfo fi{};
+		fi.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		VK_CHECK(vkCreateFence(vkDev_.device, &fi, nullptr, &b.fence));
+	}
+}
+
+VulkanUploadRing::~VulkanUploadRing()
+{
+	flush();
+
+	for (Batch& b : batches_)
+		vkDestroyFence(vkDev_.device, b.fence, nullptr);
+
+	vkDestroyCommandPool(vkDev_.device, commandPool_, nullptr);
+
+	vkUnmapMemory(vkDev_.device, memory_);
+	vkDestroyBuffer(vkDev_.device, buffer_, nullptr);
+	vkFreeMemory(vkDev_.device, memory_, nullptr);
+}
+
+void VulkanUploadRing::reclaim(bool waitForOldest)
+{
+	while (batches_[oldest_].inFlight)
+	{
+		Batch& b = batches_[oldest_];
+
+		if (waitForOldest)
+		{
+			VK_CHECK(vkWaitForFences(vkDev_.device, 1, &b.fence, VK_TRUE, UINT64_MAX));
+			waitForOldest = false;
+		}
+		else if (vkGetFenceStatus(vkDev_.device, b.fence) != VK_SUCCESS)
+		{
+			break;
+		}
+
+		VK_CHECK(vkResetFences(vkDev_.device, 1, &b.fence));
+		b.inFlight = false;
+		tail_ = b.end;
+		oldest_ = (oldest_ + 1) % (uint32_t)batches_.size();
+	}
+}
+
+bool VulkanUploadRing::allocate(VkDeviceSize size, VkDeviceSize& offset)
+{
+	if (size > size_)
+		return false;
+
+	for (;;)
+	{
+		VkDeviceSize pos = (head_ + alignment_ - 1) & ~(alignment_ - 1);
+
+		// never split one allocation across the end of the buffer
+		if (pos % size_ + size > size_)
+			pos += size_ - pos % size_;
+
+		if (pos + size - tail_ <= size_)
+		{
+			head_ = pos + size;
+			offset = pos % size_;
+			return true;
+		}
+
+		// the space is owned by the batches in flight or by the one being recorded
+		if (batches_[oldest_].inFlight)
+			reclaim(true);
+		else if (recording_)
+			submit();
+		else
+			return false;
+	}
+}
+
+void VulkanUploadRing::beginBatch()
+{
+	// every command buffer is in flight, the oldest one is [current_]
+	if (batches_[current_].inFlight)
+		reclaim(true);
+
+	Batch& b = batches_[current_];
+
+	VK_CHECK(vkResetCommandBuffer(b.commandBuffer, 0));
+
+	VkCommandBufferBeginInfo bi{};
+	bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	VK_CHECK(vkBeginCommandBuffer(b.commandBuffer, &bi));
+
+	recording_ = true;
+}
+
+bool VulkanUploadRing::uploadImage(VkImage image, VkFormat format, uint32_t width, uint32_t height, uint32_t layerCount,
+	const void* data, const size_t* levelOffsets, uint32_t mipLevels)
+{
+	const VkDeviceSize dataSize = levelOffsets[mipLevels] - levelOffsets[0];
+
+	VkDeviceSize offset = 0;
+	if (!allocate(dataSize, offset))
+		return false;
+
+	packLevels(data, levelOffsets, (int)mipLevels, mapped_ + offset);
+
+	// allocate() may have submitted the previous batch
+	if (!recording_)
+		beginBatch();
+
+	regions_.resize(mipLevels);
+	for (uint32_t i = 0; i != mipLevels; i++)
+	{
+		VkBufferImageCopy& region = regions_[i];
+		region = VkBufferImageCopy{};
+		region.bufferOffset = offset + levelOffsets[i] - levelOffsets[0];
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = i;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = layerCount;
+		region.imageOffset = VkOffset3D{ 0, 0, 0 };
+		region.imageExtent = VkExtent3D{ std::max(width >> i, 1u), std::max(height >> i, 1u), 1 };
+	}
+
+	VkCommandBuffer cmd = batches_[current_].commandBuffer;
+
+	transitionImageLayoutCmd(cmd, image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layerCount, mipLevels);
+	vkCmdCopyBufferToImage(cmd, buffer_, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions_.size(), regions_.data());
+	transitionImageLayoutCmd(cmd, image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, layerCount, mipLevels);
+
+	return true;
+}
+
+void VulkanUploadRing::submit()
+{
+	if (!recording_)
+	{
+		reclaim(false);
+		return;
+	}
+
+	Batch& b = batches_[current_];
+
+	VK_CHECK(vkEndCommandBuffer(b.commandBuffer));
+
+	VkSubmitInfo si{};
+	si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	si.commandBufferCount = 1;
+	si.pCommandBuffers = &b.commandBuffer;
+	VK_CHECK(vkQueueSubmit(vkDev_.graphicsQueue, 1, &si, b.fence));
+
+	b.end = head_;
+	b.inFlight = true;
+	recording_ = false;
+	current_ = (current_ + 1) % (uint32_t)batches_.size();
+
+	reclaim(false);
+}
+
+void VulkanUploadRing::flush()
+{
+	submit();
+
+	while (batches_[oldest_].inFlight)
+		reclaim(true);
+}
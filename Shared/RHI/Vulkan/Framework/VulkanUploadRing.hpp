@@ -0,0 +1,75 @@
+#pragma once
+
+#include <RHI/Vulkan/UtilsVulkan.hpp>
+
+#include <vector>
+
+/**
+	Persistent, permanently mapped staging buffer used as a ring for texture uploads.
+
+	uploadImage() copies the texel data into the ring and records the layout transitions and buffer-to-image copies
+	into the command buffer of the current batch, submit() sends the whole batch to the graphics queue at once with a fence.
+	The ring space of a batch is reclaimed as soon as its fence is signaled, so nothing waits for the queue to go idle
+	unless the ring runs full. Images are ready for sampling (SHADER_READ_ONLY_OPTIMAL) by any command buffer
+	submitted to the graphics queue after the batch.
+*/
+struct VulkanUploadRing
+{
+	explicit VulkanUploadRing(VulkanRenderDevice& vkDev, VkDeviceSize size = 64u << 20, uint32_t numBatches = 4);
+	~VulkanUploadRing();
+
+	VulkanUploadRing(const VulkanUploadRing&) = delete;
+	VulkanUploadRing& operator=(const VulkanUploadRing&) = delete;
+
+	/**
+		Upload all [mipLevels] of [layerCount] layers, [data] holds level [i] of every layer in [levelOffsets[i], levelOffsets[i + 1])
+		(levelOffsets[0] may be non-zero). The image goes from UNDEFINED to SHADER_READ_ONLY_OPTIMAL.
+		Returns false if the data does not fit into the ring at all, the caller has to upload it some other way.
+	*/
+	bool uploadImage(VkImage image, VkFormat format, uint32_t width, uint32_t height, uint32_t layerCount,
+		const void* data, const size_t* levelOffsets, uint32_t mipLevels);
+
+	/* Submit the recorded batch (if any), called once per frame before the frame command buffer is submitted */
+	void submit();
+
+	/* Submit and wait for every batch */
+	void flush();
+
+	VkDeviceSize getSize() const { return size_; }
+
+private:
+	struct Batch
+	{
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+		// ring position after the last byte this batch uses
+		VkDeviceSize end = 0;
+		bool inFlight = false;
+	};
+
+	/* Offset in the staging buffer, or false if the space is not available even after waiting for every batch */
+	bool allocate(VkDeviceSize size, VkDeviceSize& offset);
+	void reclaim(bool waitForOldest);
+	void beginBatch();
+
+	VulkanRenderDevice& vkDev_;
+
+	VkBuffer buffer_ = VK_NULL_HANDLE;
+	VkDeviceMemory memory_ = VK_NULL_HANDLE;
+	uint8_t* mapped_ = nullptr;
+	VkDeviceSize size_ = 0;
+	VkDeviceSize alignment_ = 16;
+
+	// monotonically growing positions, the offset in the buffer is [position % size_]
+	VkDeviceSize head_ = 0;
+	VkDeviceSize tail_ = 0;
+
+	VkCommandPool commandPool_ = VK_NULL_HANDLE;
+	std::vector<Batch> batches_;
+	// batch being recorded, batches are submitted and reclaimed in order
+	uint32_t current_ = 0;
+	uint32_t oldest_ = 0;
+	bool recording_ = false;
+
+	std::vector<VkBufferImageCopy> regions_;
+};
@@ -0,0 +1,86 @@
+#include <RHI/Vulkan/ShaderCache.hpp>
+#include <Filesystem/ChunkFile.hpp>
+
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+namespace
+{
+	constexpr const uint32_t kShaderCacheFileType = MakeChunkId('S', 'P', 'V', 'C');
+
+	constexpr const uint32_t kShaderCacheSectionHeader = MakeChunkId('S', 'P', 'H', 'D');
+	constexpr const uint32_t kShaderCacheSectionCode = MakeChunkId('S', 'P', 'V', ' ');
+
+	/* Bump when the entry layout changes */
+	constexpr const uint32_t kShaderCacheVersion = 1;
+
+	constexpr const uint32_t kSPIRVMagic = 0x07230203;
+
+	struct ShaderCacheHeader
+	{
+		uint64_t key;
+		uint32_t version;
+		uint32_t numWords;
+	};
+}
+
+ShaderCache::ShaderCache(const std::string& cacheDir)
+	: cacheDir_(cacheDir)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(cacheDir_, ec);
+	if (ec)
+		printf("Cannot create shader cache directory '%s'\n", cacheDir_.c_str());
+}
+
+std::string ShaderCache::getEntryFileName(uint64_t key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016" PRIx64 ".spv", key);
+	return (std::filesystem::path(cacheDir_) / name).string();
+}
+
+bool ShaderCache::load(uint64_t key, std::vector<unsigned int>& outSPIRV) const
+{
+	const std::string fileName = getEntryFileName(key);
+	if (!std::filesystem::exists(fileName))
+		return false;
+
+	ChunkFileReader file;
+	if (!file.Open(fileName, kShaderCacheFileType))
+		return false;
+
+	// both sections are checksummed, the entries are small
+	size_t headerSize = 0;
+	const uint8_t* header = file.GetSectionData(kShaderCacheSectionHeader, headerSize);
+	if (!header || headerSize != sizeof(ShaderCacheHeader))
+		return false;
+
+	const ShaderCacheHeader* h = reinterpret_cast<const ShaderCacheHeader*>(header);
+	if (h->key != key || h->version != kShaderCacheVersion || h->numWords == 0)
+		return false;
+
+	if (!file.ReadArray(kShaderCacheSectionCode, outSPIRV) || outSPIRV.size() != h->numWords || outSPIRV[0] != kSPIRVMagic)
+	{
+		outSPIRV.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool ShaderCache::save(uint64_t key, const std::vector<unsigned int>& SPIRV) const
+{
+	if (SPIRV.empty())
+		return false;
+
+	const ShaderCacheHeader header = { key, kShaderCacheVersion, uint32_t(SPIRV.size()) };
+
+	ChunkFileWriter writer(kShaderCacheFileType);
+	writer.AddSection(kShaderCacheSectionHeader, &header, sizeof(header));
+	writer.AddArray(kShaderCacheSectionCode, SPIRV);
+
+	return writer.SaveAtomically(getEntryFileName(key));
+}
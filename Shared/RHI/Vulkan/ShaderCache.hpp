@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+	On-disk cache of compiled SPIR-V binaries.
+	Entries are named after a 64-bit key which the caller computes from the #include-expanded shader source, the stage and the compiler
+	options (see compileShaderFile()): an edited shader or include file, or a change of compiler settings, simply misses the cache.
+	Truncated, corrupted and outdated entries fail validation in load() and are rewritten by the next save().
+	load() and save() may be called from several threads and processes at once, entries are written to a temporary file and renamed.
+*/
+class ShaderCache
+{
+public:
+	explicit ShaderCache(const std::string& cacheDir);
+
+	bool load(uint64_t key, std::vector<unsigned int>& outSPIRV) const;
+	bool save(uint64_t key, const std::vector<unsigned int>& SPIRV) const;
+
+	std::string getEntryFileName(uint64_t key) const;
+
+private:
+	std::string cacheDir_;
+};
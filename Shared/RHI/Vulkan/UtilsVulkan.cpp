@@ -1,6 +1,7 @@
 #include <RHI/Vulkan/UtilsVulkan.hpp>
 #include <RHI/Vulkan/Renderers/VulkanRendererBase.hpp>
 #include <Bitmap.hpp>
+#include <TextureCompression.hpp>
 #include <UtilsCubemap.hpp>
 #include <EasyProfilerWrapper.hpp>
 
@@ -11,7 +12,10 @@
 #include "stb_image.h"
 #include "stb_image_resize.h"
 
+#include <RHI/Vulkan/ShaderCache.hpp>
+#include <Filesystem/FilesystemUtilities.hpp>
 #include <Utils/Utils.hpp>
+#include <Utils/UtilsHash.hpp>
 
 #include <assimp/scene.h>
 #include <assimp/cimport.h>
@@ -20,6 +24,9 @@
 
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
+
+#include <atomic>
+
 using glm::mat4;
 using glm::vec3;
 using glm::vec4;
@@ -45,6 +52,13 @@ void CHECK(bool check, const char* fileName, int lineNumber)
     }
 }
 
+static std::atomic<uint32_t> validationErrorCount{0};
+
+uint32_t getValidationErrorCount()
+{
+    return validationErrorCount;
+}
+
 static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanDebugCallback(
         VkDebugUtilsMessageSeverityFlagBitsEXT Severity,
         VkDebugUtilsMessageTypeFlagsEXT Type,
@@ -52,6 +66,10 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanDebugCallback(
         void* UserData
 )
 {
+    // the report callback prints the same messages, only this one counts them
+    if (Severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+        validationErrorCount++;
+
     printf("Validation layer: %s\n", CallbackData->pMessage);
     return VK_FALSE;
 }
@@ -154,9 +172,14 @@ glslang_stage_t glslangShaderStageFromFileName(const char* fileName)
     return GLSLANG_STAGE_VERTEX;
 }
 
-static size_t compileShader(glslang_stage_t stage, const char* shaderSource, ShaderModule& shaderModule)
+static constexpr int kShaderLinkMessages = GLSLANG_MSG_SPV_RULES_BIT | GLSLANG_MSG_VULKAN_RULES_BIT;
+
+/* Bump when the glslang version or anything else that changes the generated code without changing the compiler input is updated */
+static constexpr uint64_t kShaderCompilerVersion = 1;
+
+static glslang_input_t shaderCompilerInput(glslang_stage_t stage, const char* shaderSource)
 {
-    const glslang_input_t input{
+    return glslang_input_t{
             GLSLANG_SOURCE_GLSL,
             stage,
             GLSLANG_CLIENT_VULKAN,
@@ -171,6 +194,31 @@ static size_t compileShader(glslang_stage_t stage, const char* shaderSource, Sha
             GLSLANG_MSG_DEFAULT_BIT,
             (const glslang_resource_t*)glslang_default_resource()
     };
+}
+
+/* The SPIR-V cache key: everything the generated code depends on */
+static uint64_t shaderCacheKey(const std::string& shaderSource, const glslang_input_t& input)
+{
+    const int64_t options[] = {
+        input.language, input.stage, input.client, input.client_version, input.target_language, input.target_language_version,
+        input.default_version, input.default_profile, input.force_default_version_and_profile, input.forward_compatible,
+        input.messages, kShaderLinkMessages
+    };
+
+    uint64_t key = hashBytes(options, sizeof(options), kShaderCompilerVersion);
+    key = hashBytes(input.resource, sizeof(glslang_resource_t), key);
+    return hashBytes(shaderSource.data(), shaderSource.size(), key);
+}
+
+static const ShaderCache& getShaderCache()
+{
+    static const ShaderCache cache(FilesystemUtilities::GetResourcesDir() + "Cache/Shaders/");
+    return cache;
+}
+
+static size_t compileShader(const glslang_input_t& input, ShaderModule& shaderModule)
+{
+    const glslang_stage_t stage = input.stage;
 
     glslang_shader_t* shader = glslang_shader_create(&input);
 
@@ -195,7 +243,7 @@ static size_t compileShader(glslang_stage_t stage, const char* shaderSource, Sha
     glslang_program_t* program = glslang_program_create();
     glslang_program_add_shader(program, shader);
 
-    if(!glslang_program_link(program, GLSLANG_MSG_SPV_RULES_BIT | GLSLANG_MSG_VULKAN_RULES_BIT))
+    if(!glslang_program_link(program, kShaderLinkMessages))
     {
         fprintf(stderr, "GLSL linking failed\n");
         fprintf(stderr, "\n%s", glslang_program_get_info_log(program));
@@ -222,10 +270,20 @@ static size_t compileShader(glslang_stage_t stage, const char* shaderSource, Sha
 
 size_t compileShaderFile(const char* file, ShaderModule& shaderModule)
 {
-    if (auto shaderSource = readShaderFile(file); !shaderSource.empty())
-        return compileShader(glslangShaderStageFromFileName(file), shaderSource.c_str(), shaderModule);
+    const std::string shaderSource = readShaderFile(file);
+    if (shaderSource.empty())
+        return 0;
 
-    return 0;
+    const glslang_input_t input = shaderCompilerInput(glslangShaderStageFromFileName(file), shaderSource.c_str());
+    const uint64_t key = shaderCacheKey(shaderSource, input);
+
+    if (getShaderCache().load(key, shaderModule.SPIRV))
+        return shaderModule.SPIRV.size();
+
+    if (compileShader(input, shaderModule) > 0)
+        getShaderCache().save(key, shaderModule.SPIRV);
+
+    return shaderModule.SPIRV.size();
 }
 
 VkResult createShaderModule(VkDevice device, ShaderModule* shader, const char* fileName)
@@ -233,6 +291,11 @@ VkResult createShaderModule(VkDevice device, ShaderModule* shader, const char* f
     if (compileShaderFile(fileName, *shader) < 1)
         return VK_NOT_READY;
 
+    return createShaderModuleFromSPIRV(device, shader);
+}
+
+VkResult createShaderModuleFromSPIRV(VkDevice device, ShaderModule* shader)
+{
     VkShaderModuleCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
     createInfo.codeSize = shader->SPIRV.size() * sizeof(unsigned int);
@@ -813,6 +876,29 @@ bool initVulkanRenderDevice2(VulkanInstance& vk, VulkanRenderDevice& vkDev, uint
     return true;
 }
 
+/* Offscreen images in the format of the swapchain images stand in for them on a headless device */
+static size_t createHeadlessSwapchainImages(VulkanRenderDevice& vkDev, uint32_t width, uint32_t height)
+{
+    const uint32_t imageCount = 3;
+
+    vkDev.swapchainImages.resize(imageCount);
+    vkDev.swapchainImageViews.resize(imageCount);
+    vkDev.swapchainImageMemory.resize(imageCount);
+
+    for (uint32_t i = 0; i != imageCount; i++)
+    {
+        if (!createImage(vkDev.device, vkDev.physicalDevice, width, height, VK_FORMAT_B8G8R8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                vkDev.swapchainImages[i], vkDev.swapchainImageMemory[i]))
+            exit(EXIT_FAILURE);
+
+        if (!createImageView(vkDev.device, vkDev.swapchainImages[i], VK_FORMAT_B8G8R8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, &vkDev.swapchainImageViews[i]))
+            exit(EXIT_FAILURE);
+    }
+
+    return imageCount;
+}
+
 bool initVulkanRenderDevice2WithCompute(VulkanInstance& vk, VulkanRenderDevice& vkDev, uint32_t width, uint32_t height,
                                         std::function<bool(VkPhysicalDevice)> selector, VkPhysicalDeviceFeatures2 deviceFeatures2, bool supportScreenshots)
 {
@@ -834,13 +920,24 @@ bool initVulkanRenderDevice2WithCompute(VulkanInstance& vk, VulkanRenderDevice&
     if (vkDev.computeQueue == nullptr)
         exit(EXIT_FAILURE);
 
-    VkBool32 presentSupported = 0;
-    vkGetPhysicalDeviceSurfaceSupportKHR(vkDev.physicalDevice, vkDev.graphicsFamily, vk.surface, &presentSupported);
-    if (!presentSupported)
-        exit(EXIT_FAILURE);
+    size_t imageCount = 0;
+
+    if (vk.surface != VK_NULL_HANDLE)
+    {
+        VkBool32 presentSupported = 0;
+        vkGetPhysicalDeviceSurfaceSupportKHR(vkDev.physicalDevice, vkDev.graphicsFamily, vk.surface, &presentSupported);
+        if (!presentSupported)
+            exit(EXIT_FAILURE);
+
+        VK_CHECK(createSwapchain(vkDev.device, vkDev.physicalDevice, vk.surface, vkDev.graphicsFamily, width, height, &vkDev.swapchain, supportScreenshots));
+        imageCount = createSwapchainImages(vkDev.device, vkDev.swapchain, vkDev.swapchainImages, vkDev.swapchainImageViews);
+    }
+    else
+    {
+        vkDev.swapchain = VK_NULL_HANDLE;
+        imageCount = createHeadlessSwapchainImages(vkDev, width, height);
+    }
 
-    VK_CHECK(createSwapchain(vkDev.device, vkDev.physicalDevice, vk.surface, vkDev.graphicsFamily, width, height, &vkDev.swapchain, supportScreenshots));
-    const size_t imageCount = createSwapchainImages(vkDev.device, vkDev.swapchain, vkDev.swapchainImages, vkDev.swapchainImageViews);
     vkDev.commandBuffers.resize(imageCount);
 
     VK_CHECK(createSemaphore(vkDev.device, &vkDev.semaphore));
@@ -887,6 +984,14 @@ bool initVulkanRenderDevice2WithCompute(VulkanInstance& vk, VulkanRenderDevice&
     return true;
 }
 
+static bool isDeviceSuitableHeadless(VkPhysicalDevice device)
+{
+    VkPhysicalDeviceFeatures deviceFeatures;
+    vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
+
+    return deviceFeatures.multiDrawIndirect && deviceFeatures.drawIndirectFirstInstance && deviceFeatures.shaderInt64;
+}
+
 /* Combined initialization: all required rendering extensions for chapters 6,7,8,9 etc. with compute queue */
 bool initVulkanRenderDevice3(VulkanInstance& vk, VulkanRenderDevice& vkDev, uint32_t width, uint32_t height, const VulkanContextFeatures& ctxFeatures)
 {
@@ -917,7 +1022,10 @@ bool initVulkanRenderDevice3(VulkanInstance& vk, VulkanRenderDevice& vkDev, uint
     deviceFeatures2.pNext = &physicalDeviceDescriptorIndexingFeatures;
     deviceFeatures2.features = deviceFeatures;  /*  */
 
-    return initVulkanRenderDevice2WithCompute(vk, vkDev, width, height, isDeviceSuitable, deviceFeatures2, ctxFeatures.supportsScreenshots_);
+    // a headless device may be a CPU implementation (lavapipe), it only needs the features above
+    const auto selector = (vk.surface != VK_NULL_HANDLE) ? isDeviceSuitable : isDeviceSuitableHeadless;
+
+    return initVulkanRenderDevice2WithCompute(vk, vkDev, width, height, selector, deviceFeatures2, ctxFeatures.supportsScreenshots_);
 }
 
 void destroyVulkanRenderDevice(VulkanRenderDevice& vkDev)
@@ -925,6 +1033,12 @@ void destroyVulkanRenderDevice(VulkanRenderDevice& vkDev)
     for (size_t i = 0; i < vkDev.swapchainImages.size(); i++)
         vkDestroyImageView(vkDev.device, vkDev.swapchainImageViews[i], nullptr);
 
+    for (size_t i = 0; i < vkDev.swapchainImageMemory.size(); i++)
+    {
+        vkDestroyImage(vkDev.device, vkDev.swapchainImages[i], nullptr);
+        vkFreeMemory(vkDev.device, vkDev.swapchainImageMemory[i], nullptr);
+    }
+
     vkDestroySwapchainKHR(vkDev.device, vkDev.swapchain, nullptr);
 
     vkDestroyCommandPool(vkDev.device, vkDev.commandPool, nullptr);
@@ -950,7 +1064,7 @@ void destroyVulkanInstance(VulkanInstance& vk)
     vkDestroyInstance(vk.instance, nullptr);
 }
 
-bool createTextureSampler(VkDevice device, VkSampler* sampler, VkFilter minFilter, VkFilter magFilter, VkSamplerAddressMode addressMode)
+bool createTextureSampler(VkDevice device, VkSampler* sampler, VkFilter minFilter, VkFilter magFilter, VkSamplerAddressMode addressMode, float maxLod)
 {
     VkSamplerCreateInfo samplerInfo{};
     samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -968,7 +1082,7 @@ bool createTextureSampler(VkDevice device, VkSampler* sampler, VkFilter minFilte
     samplerInfo.compareEnable = VK_FALSE;
     samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
     samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f;
+    samplerInfo.maxLod = maxLod;
     samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
     samplerInfo.unnormalizedCoordinates = VK_FALSE;
 
@@ -2156,6 +2270,59 @@ bool createMIPTextureImageFromData(VulkanRenderDevice& vkDev,
 }
 
 
+bool createMIPTextureImageFromLevels(VulkanRenderDevice& vkDev,
+                                     VkImage& textureImage, VkDeviceMemory& textureImageMemory,
+                                     const void* mipData, const size_t* levelOffsets, uint32_t mipLevels, uint32_t texWidth, uint32_t texHeight,
+                                     VkFormat texFormat)
+{
+    if (!createImage(vkDev.device, vkDev.physicalDevice,
+                     texWidth, texHeight, texFormat,
+                     VK_IMAGE_TILING_OPTIMAL,
+                     VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                     textureImage, textureImageMemory, 0, mipLevels))
+        return false;
+
+    // [levelOffsets] may start anywhere in [mipData] (a mip tail of a bigger texture)
+    const VkDeviceSize imageSize = levelOffsets[mipLevels] - levelOffsets[0];
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(vkDev.device, vkDev.physicalDevice, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+    void* mappedData = nullptr;
+    vkMapMemory(vkDev.device, stagingBufferMemory, 0, imageSize, 0, &mappedData);
+    packLevels(mipData, levelOffsets, (int)mipLevels, static_cast<uint8_t*>(mappedData));
+    vkUnmapMemory(vkDev.device, stagingBufferMemory);
+
+    // level sizes come from the file, so the copies do not depend on bytesPerTexFormat() (which is undefined for block formats)
+    std::vector<VkBufferImageCopy> regions(mipLevels);
+    for (uint32_t i = 0; i < mipLevels; i++)
+    {
+        VkBufferImageCopy& region = regions[i];
+        region = VkBufferImageCopy{};
+        region.bufferOffset = levelOffsets[i] - levelOffsets[0];
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = i;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = VkOffset3D{ 0, 0, 0 };
+        region.imageExtent = VkExtent3D{ std::max(texWidth >> i, 1u), std::max(texHeight >> i, 1u), 1 };
+    }
+
+    transitionImageLayout(vkDev, textureImage, texFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, mipLevels);
+
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands(vkDev);
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(), regions.data());
+    endSingleTimeCommands(vkDev, commandBuffer);
+
+    transitionImageLayout(vkDev, textureImage, texFormat, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1, mipLevels);
+
+    vkDestroyBuffer(vkDev.device, stagingBuffer, nullptr);
+    vkFreeMemory(vkDev.device, stagingBufferMemory, nullptr);
+
+    return true;
+}
+
 bool createTextureImageFromData(VulkanRenderDevice& vkDev,
                                 VkImage& textureImage, VkDeviceMemory& textureImageMemory,
                                 void* imageData, uint32_t texWidth, uint32_t texHeight,
@@ -2169,18 +2336,6 @@ bool createTextureImageFromData(VulkanRenderDevice& vkDev,
     return updateTextureImage(vkDev, textureImage, textureImageMemory, texWidth, texHeight, texFormat, layerCount, imageData);
 }
 
-static void float24to32(int w, int h, const float* img24, float* img32)
-{
-    const int numPixels = w * h;
-    for (int i = 0; i != numPixels; i++)
-    {
-        *img32++ = *img24++;
-        *img32++ = *img24++;
-        *img32++ = *img24++;
-        *img32++ = 1.0f;
-    }
-}
-
 bool createMIPTextureImage(VulkanRenderDevice& vkDev, const char* filename, uint32_t mipLevels, VkImage& textureImage, VkDeviceMemory& textureImageMemory, uint32_t* width, uint32_t* height)
 {
     int texWidth, texHeight, texChannels;
@@ -2252,9 +2407,9 @@ bool createTextureImage(VulkanRenderDevice& vkDev, const char* filename, VkImage
     return result;
 }
 
-size_t allocateVertexBuffer(VulkanRenderDevice& vkDev, VkBuffer* storageBuffer, VkDeviceMemory* storageBufferMemory, size_t vertexDataSize, const void* vertexData, size_t indexDataSize, const void* indexData)
+size_t allocateVertexBuffer(VulkanRenderDevice& vkDev, VkBuffer* storageBuffer, VkDeviceMemory* storageBufferMemory, size_t vertexDataSize, const void* vertexData, size_t indexDataSize, const void* indexData, size_t vertexPaddingSize)
 {
-    VkDeviceSize bufferSize = vertexDataSize + indexDataSize;
+    VkDeviceSize bufferSize = vertexDataSize + vertexPaddingSize + indexDataSize;
 
     VkBuffer stagingBuffer;
     VkDeviceMemory stagingBufferMemory;
@@ -2265,7 +2420,8 @@ size_t allocateVertexBuffer(VulkanRenderDevice& vkDev, VkBuffer* storageBuffer,
     void* data;
     vkMapMemory(vkDev.device, stagingBufferMemory, 0, bufferSize, 0, &data);
     memcpy(data, vertexData, vertexDataSize);
-    memcpy((unsigned char*)data + vertexDataSize, indexData, indexDataSize);
+    memset((unsigned char*)data + vertexDataSize, 0, vertexPaddingSize);
+    memcpy((unsigned char*)data + vertexDataSize + vertexPaddingSize, indexData, indexDataSize);
     vkUnmapMemory(vkDev.device, stagingBufferMemory);
 
     createBuffer(vkDev.device, vkDev.physicalDevice, bufferSize,
@@ -2376,63 +2532,13 @@ bool createMIPCubeTextureImage(VulkanRenderDevice& vkDev, const char* filename,
         return false;
     }
 
-    uint32_t imageSize = texWidth * texHeight * 4;
-    uint32_t mipSize = imageSize * 6;
+    // the faces are converted straight from the equirectangular map and box-filtered down on the CPU,
+    // no per-level equirectangular resize and vertical cross intermediates
+    const uint32_t faceSize = texWidth / 4;
+    std::vector<float> mipCube(getCubeMapMipChainSize(faceSize, 4, mipLevels));
 
-    uint32_t w = texWidth, h = texHeight;
-    for (uint32_t i = 1; i < mipLevels; i++)
-    {
-        imageSize = w * h * 4;
-        w >>= 1;
-        h >>= 1;
-        mipSize += imageSize;
-    }
-
-    std::vector<float> mipData(mipSize);
-    float* src = mipData.data();
-    float* dst = mipData.data();
-
-    w = texWidth;
-    h = texHeight;
-    float24to32(w, h, img, dst);
-
-    for (uint32_t i = 1; i < mipLevels; i++)
-    {
-        imageSize = w * h * 4;
-        dst += w * h * 4;
-        stbir_resize_float_generic(
-                src, w, h, 0, dst, w / 2, h / 2, 0, 4,
-                STBIR_ALPHA_CHANNEL_NONE, 0, STBIR_EDGE_CLAMP, STBIR_FILTER_CUBICBSPLINE, STBIR_COLORSPACE_LINEAR, nullptr);
-
-        w >>= 1;
-        h >>= 1;
-        src = dst;
-    }
-
-    src = mipData.data();
-    dst = mipData.data();
-
-    std::vector<float> mipCube(mipSize * 6);
-    float* mip = mipCube.data();
-
-    w = texWidth;
-    h = texHeight;
-    uint32_t faceSize = w / 4;
-    for (uint32_t i = 0; i < mipLevels; i++)
-    {
-        Bitmap in(w, h, 4, eBitmapFormat_Float, src);
-        Bitmap out = convertEquirectangularMapToVerticalCross(in);
-        Bitmap cube = convertVerticalCrossToCubeMapFaces(out);
-
-        imageSize = faceSize * faceSize * 4;
-
-        memcpy(mip, cube.data_.data(), 6 * imageSize * sizeof(float));
-        mip += imageSize * 6;
-
-        src += w * h * 4;
-        w >>= 1;
-        h >>= 1;
-    }
+    convertEquirectangularMapToCubeMapFaces(img, texWidth, texHeight, 3, mipCube.data(), 4);
+    generateCubeMapMips(mipCube.data(), faceSize, 4, mipLevels);
 
     stbi_image_free((void*)img);
 
@@ -2453,9 +2559,6 @@ bool createCubeTextureImage(VulkanRenderDevice& vkDev, const char* filename, VkI
 {
     int w, h, comp;
     const float* img = stbi_loadf(filename, &w, &h, &comp, 3);
-    std::vector<float> img32(w * h * 4);
-
-    float24to32(w, h, img, img32.data());
 
     if(!img)
     {
@@ -2463,12 +2566,11 @@ bool createCubeTextureImage(VulkanRenderDevice& vkDev, const char* filename, VkI
         return false;
     }
 
-    stbi_image_free((void*)img);
-
-    Bitmap in(w, h, 4, eBitmapFormat_Float, img32.data());
-    Bitmap out = convertEquirectangularMapToVerticalCross(in);
+    const uint32_t faceSize = w / 4;
+    std::vector<float> cube(getCubeMapMipChainSize(faceSize, 4, 1));
+    convertEquirectangularMapToCubeMapFaces(img, w, h, 3, cube.data(), 4);
 
-    Bitmap cube = convertVerticalCrossToCubeMapFaces(out);
+    stbi_image_free((void*)img);
 
     if(width && height)
     {
@@ -2477,7 +2579,7 @@ bool createCubeTextureImage(VulkanRenderDevice& vkDev, const char* filename, VkI
     }
 
     return createTextureImageFromData(vkDev, textureImage, textureImageMemory,
-                                      cube.data_.data(), cube.w_, cube.h_,
+                                      cube.data(), faceSize, faceSize,
                                       VK_FORMAT_R32G32B32A32_SFLOAT,
                                       6, VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT);
 }
@@ -2529,7 +2631,7 @@ bool executeComputeShader(VulkanRenderDevice& vkDev,
     return true;
 }
 
-VkResult createComputePipeline(VkDevice device, VkShaderModule computeShader, VkPipelineLayout pipelineLayout, VkPipeline* pipeline)
+VkResult createComputePipeline(VkDevice device, VkShaderModule computeShader, VkPipelineLayout pipelineLayout, VkPipeline* pipeline, VkPipelineCache pipelineCache)
 {
     // ShaderStageInfo, just like in graphics pipeline, but with a single COMPUTE stage
     VkPipelineShaderStageCreateInfo shaderStageCreateInfo{};
@@ -2551,8 +2653,8 @@ VkResult createComputePipeline(VkDevice device, VkShaderModule computeShader, Vk
     computePipelineCreateInfo.basePipelineHandle = 0;
     computePipelineCreateInfo.basePipelineIndex = 0;
 
-    /* no caching, single pipeline creation*/
-    return vkCreateComputePipelines(device, 0, 1, &computePipelineCreateInfo, nullptr, pipeline);
+    /* single pipeline creation */
+    return vkCreateComputePipelines(device, pipelineCache, 1, &computePipelineCreateInfo, nullptr, pipeline);
 }
 
 /* Default DS layout for In/Out buffer pair */
@@ -2582,7 +2684,8 @@ VulkanContextCreator::VulkanContextCreator(VulkanInstance& vk, VulkanRenderDevic
     if (!setupDebugCallbacks(vk.instance, &vk.messenger, &vk.reportCallback))
         exit(EXIT_FAILURE);
 
-    if (!glfwCreateWindowSurface(vk.instance, (GLFWwindow*) window, nullptr, &vk.surface))
+    vk.surface = VK_NULL_HANDLE;
+    if (window && glfwCreateWindowSurface(vk.instance, (GLFWwindow*) window, nullptr, &vk.surface) != VK_SUCCESS)
         exit(EXIT_FAILURE);
 
     if (!initVulkanRenderDevice3(vk, dev, screenWidth, screenHeight, ctxFeatures))
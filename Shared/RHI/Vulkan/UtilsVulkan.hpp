@@ -43,6 +43,11 @@ struct VulkanRenderDevice final
 	std::vector<VkImage> swapchainImages;
 	std::vector<VkImageView> swapchainImageViews;
 
+	// headless device (no window, [swapchain] is VK_NULL_HANDLE): the swapchain images are offscreen images it owns,
+	// drawFrame() renders to them in turn
+	std::vector<VkDeviceMemory> swapchainImageMemory;
+	uint32_t nextImage = 0;
+
 	VkCommandPool commandPool;
 	std::vector<VkCommandBuffer> commandBuffers;
 
@@ -75,6 +80,7 @@ struct VulkanContextCreator
 {
     VulkanContextCreator() = default;
 
+	/* Without a [window] the device is headless: any device with graphics and compute queues (lavapipe too), no surface, no presentation */
 	VulkanContextCreator(VulkanInstance& vk, VulkanRenderDevice& dev, void* window, int screenWidth, int screenHeight, const VulkanContextFeatures& ctxFeatures = VulkanContextFeatures());
     ~VulkanContextCreator();
 
@@ -131,10 +137,17 @@ void CHECK(bool check, const char* fileName, int lineNumber);
 
 bool setupDebugCallbacks(VkInstance instance, VkDebugUtilsMessengerEXT* messenger, VkDebugReportCallbackEXT* reportCallback);
 
+/* Errors reported by the validation layers so far (debug builds only), the headless tests fail on any */
+uint32_t getValidationErrorCount();
+
 VkResult createShaderModule(VkDevice device, ShaderModule* shader, const char* fileName);
 
+/* Compiled SPIR-V is cached on disk, see ShaderCache. Thread-safe once glslang_initialize_process() has been called */
 size_t compileShaderFile(const char* file, ShaderModule& shaderModule);
 
+/* Create the VkShaderModule of already compiled [shader->SPIRV] */
+VkResult createShaderModuleFromSPIRV(VkDevice device, ShaderModule* shader);
+
 inline VkPipelineShaderStageCreateInfo shaderStageInfo(VkShaderStageFlagBits shaderStage, ShaderModule& module, const char* entryPoint)
 {
 	VkPipelineShaderStageCreateInfo createInfo{};
@@ -203,7 +216,8 @@ size_t createSwapchainImages(VkDevice device, VkSwapchainKHR swapchain, std::vec
 
 VkResult createSemaphore(VkDevice device, VkSemaphore* outSemaphore);
 
-bool createTextureSampler(VkDevice device, VkSampler* sampler, VkFilter minFilter = VK_FILTER_LINEAR, VkFilter magFilter = VK_FILTER_LINEAR, VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT);
+/* [maxLod] > 0 for textures with mip levels */
+bool createTextureSampler(VkDevice device, VkSampler* sampler, VkFilter minFilter = VK_FILTER_LINEAR, VkFilter magFilter = VK_FILTER_LINEAR, VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT, float maxLod = 0.0f);
 
 bool createDescriptorPool(VulkanRenderDevice& vkDev, uint32_t uniformBufferCount, uint32_t storageBufferCount, uint32_t samplerCount, VkDescriptorPool* descriptorPool);
 
@@ -242,7 +256,7 @@ bool createGraphicsPipeline(
 	int32_t customHeight = -1,
 	uint32_t numPatchControlPoints = 0);
 
-VkResult createComputePipeline(VkDevice device, VkShaderModule computeShader, VkPipelineLayout pipelineLayout, VkPipeline* pipeline);
+VkResult createComputePipeline(VkDevice device, VkShaderModule computeShader, VkPipelineLayout pipelineLayout, VkPipeline* pipeline, VkPipelineCache pipelineCache = VK_NULL_HANDLE);
 
 bool createSharedBuffer(VulkanRenderDevice& vkDev, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
 
@@ -304,6 +318,7 @@ void transitionImageLayoutCmd(VkCommandBuffer commandBuffer, VkImage image, VkFo
 
 bool initVulkanRenderDevice(VulkanInstance& vk, VulkanRenderDevice& vkDev, uint32_t width, uint32_t height, std::function<bool(VkPhysicalDevice)> selector, VkPhysicalDeviceFeatures deviceFeatures);
 bool initVulkanRenderDevice2(VulkanInstance& vk, VulkanRenderDevice& vkDev, uint32_t width, uint32_t height, std::function<bool(VkPhysicalDevice)> selector, VkPhysicalDeviceFeatures2 deviceFeatures2);
+/* Headless if [vk.surface] is VK_NULL_HANDLE (see VulkanContextCreator) */
 bool initVulkanRenderDevice3(VulkanInstance& vk, VulkanRenderDevice& vkDev, uint32_t width, uint32_t height, const VulkanContextFeatures& ctxFeatures = VulkanContextFeatures());
 void destroyVulkanRenderDevice(VulkanRenderDevice& vkDev);
 void destroyVulkanInstance(VulkanInstance& vk);
@@ -349,6 +364,12 @@ bool createMIPTextureImageFromData(VulkanRenderDevice& vkDev,
 	VkFormat texFormat,
 	uint32_t layerCount = 1, VkImageCreateFlags flags = 0);
 
+/* [mipData] holds all the levels one after another, level [i] occupies [levelOffsets[i], levelOffsets[i + 1]) (levelOffsets[0] may be non-zero). Works for block-compressed formats as well */
+bool createMIPTextureImageFromLevels(VulkanRenderDevice& vkDev,
+	VkImage& textureImage, VkDeviceMemory& textureImageMemory,
+	const void* mipData, const size_t* levelOffsets, uint32_t mipLevels, uint32_t texWidth, uint32_t texHeight,
+	VkFormat texFormat);
+
 bool createTextureImage(VulkanRenderDevice& vkDev, const char* filename, VkImage& textureImage, VkDeviceMemory& textureImageMemory, uint32_t* outTexWidth = nullptr, uint32_t* outTexHeight = nullptr);
 
 bool createMIPTextureImage(VulkanRenderDevice& vkDev, const char* filename, uint32_t mipLevels, VkImage& textureImage, VkDeviceMemory& textureImageMemory, uint32_t* width = nullptr, uint32_t* height = nullptr);
@@ -357,7 +378,8 @@ bool createCubeTextureImage(VulkanRenderDevice& vkDev, const char* filename, VkI
 
 bool createMIPCubeTextureImage(VulkanRenderDevice& vkDev, const char* filename, uint32_t mipLevels, VkImage& textureImage, VkDeviceMemory& textureImageMemory, uint32_t* width = nullptr, uint32_t* height = nullptr);
 
-size_t allocateVertexBuffer(VulkanRenderDevice& vkDev, VkBuffer* storageBuffer, VkDeviceMemory* storageBufferMemory, size_t vertexDataSize, const void* vertexData, size_t indexDataSize, const void* indexData);
+/* [vertexPaddingSize] zero bytes are inserted between vertex and index data (to align the index block offset) */
+size_t allocateVertexBuffer(VulkanRenderDevice& vkDev, VkBuffer* storageBuffer, VkDeviceMemory* storageBufferMemory, size_t vertexDataSize, const void* vertexData, size_t indexDataSize, const void* indexData, size_t vertexPaddingSize = 0);
 
 bool createTexturedVertexBuffer(VulkanRenderDevice& vkDev, const char* filename, VkBuffer* storageBuffer, VkDeviceMemory* storageBufferMemory, size_t* vertexBufferSize, size_t* indexBufferSize);
 
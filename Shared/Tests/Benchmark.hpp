@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+
+/**
+	Runs [f] [iterations] times after one warm-up run and returns the best time in milliseconds.
+	The best run is the least disturbed by the OS, the caches stay as warm as they are in a frame loop.
+*/
+template <typename F>
+double measureMs(F&& f, int iterations = 10)
+{
+	f();
+
+	double best = 1e30;
+	for (int i = 0; i < iterations; i++)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		f();
+		const auto end = std::chrono::high_resolution_clock::now();
+
+		const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+		if (ms < best)
+			best = ms;
+	}
+
+	return best;
+}
+
+inline void printBenchmark(const char* name, double baselineMs, double optimizedMs)
+{
+	printf("%-40s %10.3f ms -> %10.3f ms (x%.2f)\n", name, baselineMs, optimizedMs, optimizedMs > 0.0 ? baselineMs / optimizedMs : 0.0);
+}
+
+/* Keeps the optimizer from dropping the benchmarked work */
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+	static volatile const void* sink;
+	sink = &value;
+}
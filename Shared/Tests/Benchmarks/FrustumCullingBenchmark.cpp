@@ -0,0 +1,84 @@
+/**
+	CPU frustum culling of a Bistro-sized shape list (30k boxes): isBoxInFrustum() for every box against
+	cullBoxes() on one thread and on an executor. The camera sweeps around the scene over several frames,
+	so the plane coherency of cullBoxes() sees the same kind of frame-to-frame changes as in the demos.
+	All the versions must give the same visibility.
+*/
+#include <Benchmark.hpp>
+
+#include <Utils/UtilsCulling.hpp>
+
+#include <glm/ext.hpp>
+#include <taskflow/taskflow.hpp>
+
+#include <random>
+
+static const uint32_t kNumBoxes = 30000;
+static const int kNumFrames = 16;
+
+struct Frame
+{
+	glm::vec4 planes[6];
+	glm::vec4 corners[8];
+};
+
+int main()
+{
+	std::mt19937 rng(3);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.1f, 4.0f);
+
+	std::vector<BoundingBox> boxes(kNumBoxes);
+	CullingBoxes cullingBoxes;
+	cullingBoxes.resize(kNumBoxes);
+
+	for (uint32_t i = 0; i != kNumBoxes; i++)
+	{
+		const glm::vec3 p(position(rng), 0.1f * position(rng), position(rng));
+		boxes[i] = BoundingBox(p, p + glm::vec3(size(rng), size(rng), size(rng)));
+		cullingBoxes.set(i, boxes[i]);
+	}
+
+	std::vector<Frame> frames(kNumFrames);
+	const glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 150.0f);
+	for (int i = 0; i != kNumFrames; i++)
+	{
+		const float angle = 6.2831853f * float(i) / float(kNumFrames);
+		const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 5.0f, 0.0f), glm::vec3(std::cos(angle), 5.0f, std::sin(angle)), glm::vec3(0.0f, 1.0f, 0.0f));
+		getFrustumPlanes(proj * view, frames[i].planes);
+		getFrustumCorners(proj * view, frames[i].corners);
+	}
+
+	std::vector<std::vector<bool>> expected(kNumFrames, std::vector<bool>(kNumBoxes));
+	const double scalar = measureMs([&]() {
+		for (int f = 0; f != kNumFrames; f++)
+			for (uint32_t i = 0; i != kNumBoxes; i++)
+				expected[f][i] = isBoxInFrustum(frames[f].planes, frames[f].corners, boxes[i]);
+	});
+
+	std::vector<std::vector<uint32_t>> masks(kNumFrames);
+	const double batched = measureMs([&]() {
+		for (int f = 0; f != kNumFrames; f++)
+			cullBoxes(cullingBoxes, frames[f].planes, frames[f].corners, masks[f]);
+	});
+
+	std::vector<std::vector<uint32_t>> parallelMasks(kNumFrames);
+	tf::Executor executor;
+	const double parallel = measureMs([&]() {
+		for (int f = 0; f != kNumFrames; f++)
+			cullBoxes(cullingBoxes, frames[f].planes, frames[f].corners, parallelMasks[f], &executor);
+	});
+
+	printBenchmark("cullBoxes, 30k boxes x 16 frames", scalar, batched);
+	printBenchmark("cullBoxes + executor", scalar, parallel);
+
+	for (int f = 0; f != kNumFrames; f++)
+		for (uint32_t i = 0; i != kNumBoxes; i++)
+			if (isVisible(masks[f], i) != expected[f][i] || isVisible(parallelMasks[f], i) != expected[f][i])
+			{
+				printf("Box %u in frame %d differs from isBoxInFrustum()\n", i, f);
+				return 1;
+			}
+
+	return 0;
+}
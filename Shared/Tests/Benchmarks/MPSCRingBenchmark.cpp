@@ -0,0 +1,127 @@
+/**
+	MPSCRing under contention: 16 or more loader threads push small items (an index and a shared owner, as the texture loaders do)
+	while the render thread drains them, against the mutex-guarded vector the loaders used before, which the consumer swaps out.
+	The ring is sized for all the items as in the scene loaders, and once more with a small ring so producers wait for the consumer.
+	Every version must deliver every item exactly once.
+*/
+#include <Benchmark.hpp>
+
+#include <Utils/MPSCRing.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const uint32_t kItemsPerThread = 20000;
+static const int kIterations = 5;
+
+struct Item
+{
+	uint32_t index_ = 0;
+	std::shared_ptr<const void> owner_;
+};
+
+template <typename Producer, typename Consumer>
+static void runThreads(uint32_t numThreads, Producer&& produce, Consumer&& consume)
+{
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads);
+	for (uint32_t t = 0; t != numThreads; t++)
+		threads.emplace_back([&produce, t]() { produce(t); });
+
+	consume();
+
+	for (auto& t : threads)
+		t.join();
+}
+
+int main()
+{
+	const uint32_t numThreads = std::max(16u, std::thread::hardware_concurrency());
+	const uint32_t numItems = numThreads * kItemsPerThread;
+	const auto owner = std::make_shared<int>(0);
+
+	printf("%u producer threads, %u items each\n", numThreads, kItemsPerThread);
+
+	std::vector<uint8_t> received(numItems);
+	auto receive = [&received](const Item& item) { received[item.index_]++; };
+
+	auto checkReceived = [&received](const char* name)
+	{
+		// measureMs() makes one warm-up run
+		const bool ok = std::all_of(received.begin(), received.end(), [](uint8_t count) { return count == kIterations + 1; });
+		if (!ok)
+			printf("%s lost or duplicated items\n", name);
+		std::fill(received.begin(), received.end(), 0);
+		return ok;
+	};
+
+	// 1) the previous loaders: a vector under a mutex, the consumer swaps it out whenever it looks
+	std::vector<Item> shared;
+	std::mutex mutex;
+	const double locked = measureMs([&]() {
+		runThreads(numThreads,
+			[&](uint32_t t) {
+				for (uint32_t i = 0; i != kItemsPerThread; i++)
+				{
+					std::lock_guard lock(mutex);
+					shared.push_back(Item{ t * kItemsPerThread + i, owner });
+				}
+			},
+			[&]() {
+				std::vector<Item> batch;
+				for (uint32_t done = 0; done != numItems;)
+				{
+					{
+						std::lock_guard lock(mutex);
+						batch.swap(shared);
+					}
+					if (batch.empty())
+						std::this_thread::yield();
+					for (const Item& item : batch)
+						receive(item);
+					done += (uint32_t)batch.size();
+					batch.clear();
+				}
+			});
+	}, kIterations);
+	if (!checkReceived("mutex"))
+		return 1;
+
+	// 2) the ring sized for everything, producers never wait
+	auto ringRun = [&](MPSCRing<Item>& ring) {
+		runThreads(numThreads,
+			[&](uint32_t t) {
+				for (uint32_t i = 0; i != kItemsPerThread; i++)
+					ring.push(Item{ t * kItemsPerThread + i, owner });
+			},
+			[&]() {
+				for (uint32_t done = 0; done != numItems;)
+				{
+					// the render thread only looks once per frame, it does not spin on an empty ring
+					const size_t count = ring.drain([&](Item&& item) { receive(item); return true; });
+					if (!count)
+						std::this_thread::yield();
+					done += (uint32_t)count;
+				}
+			});
+	};
+
+	MPSCRing<Item> ring(numItems);
+	const double lockFree = measureMs([&]() { ringRun(ring); }, kIterations);
+	if (!checkReceived("MPSCRing"))
+		return 1;
+
+	// 3) a small ring, producers spin on full cells while the consumer catches up
+	MPSCRing<Item> smallRing(1024);
+	const double lockFreeSmall = measureMs([&]() { ringRun(smallRing); }, kIterations);
+	if (!checkReceived("MPSCRing, 1024 cells"))
+		return 1;
+
+	printBenchmark("mutex + vector -> MPSCRing", locked, lockFree);
+	printBenchmark("mutex + vector -> MPSCRing, 1024 cells", locked, lockFreeSmall);
+
+	return 0;
+}
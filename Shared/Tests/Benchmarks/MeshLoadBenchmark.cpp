@@ -0,0 +1,173 @@
+/**
+	Loading a .meshes file into memory ready for the GPU upload: loadMeshData() copies every block
+	into std::vector's, MappedMeshData maps the file and copies only the mesh descriptors.
+	Both read every index and vertex once afterwards, as the upload does.
+
+	Usage: MeshLoadBenchmark [file.meshes] (a synthetic 100 MB file is written to the temp directory if omitted)
+	Warm: the file is in the page cache after the warm-up run, so this measures the copies and not the disk.
+	Cold: the cached pages of the file are dropped before every run, as on the first start of the application.
+*/
+#include <Benchmark.hpp>
+
+#include <Scene/VtxData.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <numeric>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static const int kColdIterations = 5;
+
+// Returns false if the pages cannot be dropped on this system
+static bool dropFromPageCache(const std::string& fileName)
+{
+#ifdef _WIN32
+	// opening the file without buffering flushes and purges its cached pages, if no one else has it open
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	CloseHandle(file);
+	return true;
+#else
+	const int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	// dirty pages (the file may have just been written) are not dropped
+	fsync(fd);
+	const bool dropped = (posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0);
+	close(fd);
+	return dropped;
+#endif
+}
+
+/* The best of [iterations] runs, each reading the file from the disk; a negative value if the cache cannot be dropped */
+template <typename F>
+static double measureColdMs(const std::string& fileName, F&& f, int iterations = kColdIterations)
+{
+	double best = 1e30;
+	for (int i = 0; i < iterations; i++)
+	{
+		if (!dropFromPageCache(fileName))
+			return -1.0;
+
+		const auto start = std::chrono::high_resolution_clock::now();
+		f();
+		const auto end = std::chrono::high_resolution_clock::now();
+
+		best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	return best;
+}
+
+static void writeSyntheticMeshFile(const std::string& fileName)
+{
+	const uint32_t numMeshes = 4096;
+	const uint32_t verticesPerMesh = 1024;
+	const uint32_t indicesPerMesh = 3 * 2048;
+
+	MeshData m;
+	m.meshes_.resize(numMeshes);
+	m.boxes_.resize(numMeshes);
+	m.indexData_.resize(size_t(numMeshes) * indicesPerMesh);
+	m.vertexData_.resize(size_t(numMeshes) * verticesPerMesh * kDefaultVertexStride);
+
+	for (uint32_t i = 0; i != numMeshes; i++)
+	{
+		Mesh& mesh = m.meshes_[i];
+		mesh.lodCount = 1;
+		mesh.streamCount = 1;
+		mesh.indexOffset = i * indicesPerMesh;
+		mesh.vertexOffset = i * verticesPerMesh;
+		mesh.vertexCount = verticesPerMesh;
+		mesh.lodOffset[0] = 0;
+		mesh.lodOffset[1] = indicesPerMesh;
+		mesh.streamElementSize[0] = kDefaultVertexStride * sizeof(float);
+
+		for (uint32_t j = 0; j != indicesPerMesh; j++)
+			m.indexData_[mesh.indexOffset + j] = (j * 7) % verticesPerMesh;
+	}
+
+	for (size_t i = 0; i != m.vertexData_.size(); i++)
+		m.vertexData_[i] = float(i % 1000) * 0.001f;
+
+	saveMeshData(fileName.c_str(), m);
+}
+
+template <typename T>
+static uint64_t checksum(const T* data, size_t count)
+{
+	uint64_t sum = 0;
+	const uint32_t* words = reinterpret_cast<const uint32_t*>(data);
+	for (size_t i = 0; i != count * sizeof(T) / sizeof(uint32_t); i++)
+		sum += words[i];
+	return sum;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string fileName;
+
+	if (argc > 1)
+		fileName = argv[1];
+	else
+	{
+		fileName = (std::filesystem::temp_directory_path() / "MeshLoadBenchmark.meshes").string();
+		writeSyntheticMeshFile(fileName);
+	}
+
+	uint64_t copiedSum = 0;
+	uint64_t mappedSum = 0;
+
+	auto loadCopied = [&]() {
+		MeshData m;
+		loadMeshData(fileName.c_str(), m);
+		copiedSum = checksum(m.indexData_.data(), m.indexData_.size()) + checksum(m.vertexData_.data(), m.vertexData_.size());
+		doNotOptimize(m.meshes_.size());
+	};
+
+	auto loadMapped = [&]() {
+		MappedMeshData mapping(fileName.c_str());
+		MeshData m;
+		mapping.copyDescriptors(m);
+		mappedSum = checksum(mapping.getIndexData(), mapping.getIndexCount()) + checksum(mapping.getVertexData(), mapping.getVertexCount());
+		doNotOptimize(m.meshes_.size());
+	};
+
+	const double copiedCold = measureColdMs(fileName, loadCopied);
+	const double mappedCold = measureColdMs(fileName, loadMapped);
+
+	const double copied = measureMs(loadCopied);
+	const double mapped = measureMs(loadMapped);
+
+	printf("%s\n", fileName.c_str());
+	printBenchmark("loadMeshData -> MappedMeshData, warm", copied, mapped);
+	if (copiedCold >= 0.0 && mappedCold >= 0.0)
+		printBenchmark("loadMeshData -> MappedMeshData, cold", copiedCold, mappedCold);
+	else
+		printf("The file cannot be dropped from the page cache, no cold measurement\n");
+
+	if (copiedSum != mappedSum)
+	{
+		printf("The loaders disagree on the contents\n");
+		return 1;
+	}
+
+	if (argc <= 1)
+		std::filesystem::remove(fileName);
+
+	return 0;
+}
@@ -0,0 +1,103 @@
+/**
+	markAsChanged() for a frame of node edits on a large scene: the previous version allocated a std::vector
+	stack on every call, the current one walks the subtree over the hierarchy links.
+	Both must queue the same nodes on the same levels.
+*/
+#include <Benchmark.hpp>
+
+#include <Scene/Scene.hpp>
+
+#include <algorithm>
+#include <random>
+
+// the previous implementation, kept as the baseline
+static void markAsChangedWithStack(Scene& scene, int node)
+{
+	if (scene.isNodeChanged_.size() < scene.hierarchy_.size())
+		scene.isNodeChanged_.resize(scene.hierarchy_.size(), false);
+
+	std::vector<int> stack;
+	stack.push_back(node);
+
+	while (!stack.empty())
+	{
+		const int n = stack.back();
+		stack.pop_back();
+
+		if (scene.isNodeChanged_[n])
+			continue;
+
+		const int level = scene.hierarchy_[n].level_;
+		if (level >= MAX_NODE_LEVEL)
+			continue;
+
+		scene.isNodeChanged_[n] = true;
+		scene.changedAtThisFrame_[level].push_back(n);
+
+		for (int s = scene.hierarchy_[n].firstChild_; s != -1; s = scene.hierarchy_[s].nextSibling_)
+			stack.push_back(s);
+	}
+}
+
+static void resetChanges(Scene& scene)
+{
+	for (auto& level : scene.changedAtThisFrame_)
+	{
+		for (const int n : level)
+			scene.isNodeChanged_[n] = false;
+		level.clear();
+	}
+}
+
+int main()
+{
+	std::mt19937 rng(7);
+
+	// a bushy scene: most edited nodes are leaves or small subtrees, as in an editor or a physics update
+	Scene scene;
+	addNode(scene, -1, 0);
+	for (int i = 1; i != 500000; i++)
+	{
+		const int parent = std::uniform_int_distribution<int>(std::max(0, i / 8 - 1000), i / 8)(rng);
+		addNode(scene, parent, scene.hierarchy_[parent].level_ + 1);
+	}
+
+	std::vector<int> edits(20000);
+	for (int& n : edits)
+		n = std::uniform_int_distribution<int>(0, (int)scene.hierarchy_.size() - 1)(rng);
+
+	std::vector<int> expected[MAX_NODE_LEVEL];
+
+	const double withStack = measureMs([&]() {
+		resetChanges(scene);
+		for (const int n : edits)
+			markAsChangedWithStack(scene, n);
+	});
+
+	for (int i = 0; i != MAX_NODE_LEVEL; i++)
+	{
+		expected[i] = scene.changedAtThisFrame_[i];
+		std::sort(expected[i].begin(), expected[i].end());
+	}
+
+	const double walk = measureMs([&]() {
+		resetChanges(scene);
+		for (const int n : edits)
+			markAsChanged(scene, n);
+	});
+
+	printBenchmark("markAsChanged, 20k edits", withStack, walk);
+
+	for (int i = 0; i != MAX_NODE_LEVEL; i++)
+	{
+		std::vector<int> queued = scene.changedAtThisFrame_[i];
+		std::sort(queued.begin(), queued.end());
+		if (queued != expected[i])
+		{
+			printf("Level %d differs from the baseline\n", i);
+			return 1;
+		}
+	}
+
+	return 0;
+}
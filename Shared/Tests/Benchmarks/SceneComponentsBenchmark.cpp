@@ -0,0 +1,219 @@
+/**
+	Node component storage: std::unordered_map (the previous Scene::meshes_, materialForNode_ and nameForNode_)
+	against NodeComponentMap on the two hot paths, building the shapes_ draw list as the renderers do
+	and merging four 25k-node scenes into one 100k-node scene as mergeScenes() does.
+	Both versions must produce the same draw list and the same merged components.
+*/
+#include <Benchmark.hpp>
+
+#include <Scene/Scene.hpp>
+#include <Scene/VtxData.hpp>
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+
+using LegacyMap = std::unordered_map<uint32_t, uint32_t>;
+
+struct LegacyComponents
+{
+	std::vector<glm::mat4> localTransform_;
+	std::vector<glm::mat4> globalTransform_;
+	std::vector<Hierarchy> hierarchy_;
+
+	LegacyMap meshes_;
+	LegacyMap materialForNode_;
+	LegacyMap nameForNode_;
+};
+
+static const uint32_t kNumMeshes = 2048;
+static const uint32_t kNumMaterials = 256;
+
+static void makeScene(Scene& scene, LegacyComponents& legacy, int nodeCount, std::mt19937& rng)
+{
+	addNode(scene, -1, 0);
+	for (int i = 1; i != nodeCount; i++)
+	{
+		const int parent = std::uniform_int_distribution<int>(0, i - 1)(rng);
+		addNode(scene, parent, scene.hierarchy_[parent].level_ + 1);
+	}
+
+	// nodes are visited in a random order, as the Assimp importer adds them depth-first
+	std::vector<uint32_t> order(nodeCount);
+	for (int i = 0; i != nodeCount; i++)
+		order[i] = i;
+	std::shuffle(order.begin(), order.end(), rng);
+
+	for (const uint32_t n : order)
+	{
+		// about a half of the nodes are meshes, the rest are transform groups
+		if (rng() % 2)
+		{
+			const uint32_t mesh = rng() % kNumMeshes;
+			const uint32_t material = rng() % kNumMaterials;
+			scene.meshes_[n] = legacy.meshes_[n] = mesh;
+			scene.materialForNode_[n] = legacy.materialForNode_[n] = material;
+		}
+
+		scene.nameForNode_[n] = legacy.nameForNode_[n] = (uint32_t)scene.names_.size();
+		scene.names_.push_back("");
+	}
+
+	scene.materialNames_.resize(kNumMaterials);
+}
+
+template <typename Map>
+static void buildShapes(const Map& meshes, const Map& materialForNode, const std::vector<Mesh>& meshDescriptors, std::vector<DrawData>& shapes)
+{
+	shapes.clear();
+	for (const auto& c : meshes)
+	{
+		auto material = materialForNode.find(c.first);
+		if (material == materialForNode.end())
+			continue;
+
+		DrawData data{};
+		data.meshIndex = c.second;
+		data.materialIndex = material->second;
+		data.indexOffset = meshDescriptors[c.second].indexOffset;
+		data.vertexOffset = meshDescriptors[c.second].vertexOffset;
+		data.transformIndex = c.first;
+		shapes.push_back(data);
+	}
+}
+
+// the previous mergeMaps() from Scene.cpp
+static void mergeLegacyMaps(LegacyMap& m, const LegacyMap& otherMap, int indexOffset, int itemOffset)
+{
+	for (const auto& i : otherMap)
+		m[i.first + indexOffset] = i.second + itemOffset;
+}
+
+static bool operator<(const DrawData& a, const DrawData& b)
+{
+	return a.transformIndex < b.transformIndex;
+}
+
+static bool sameDrawData(const DrawData& a, const DrawData& b)
+{
+	return a.meshIndex == b.meshIndex && a.materialIndex == b.materialIndex && a.indexOffset == b.indexOffset &&
+		a.vertexOffset == b.vertexOffset && a.transformIndex == b.transformIndex;
+}
+
+static bool sameComponents(const LegacyMap& legacy, const NodeComponentMap& m)
+{
+	if (legacy.size() != m.size())
+		return false;
+
+	for (const auto& i : legacy)
+		if (!m.count(i.first) || m.at(i.first) != i.second)
+			return false;
+
+	return true;
+}
+
+int main()
+{
+	std::mt19937 rng(5);
+
+	const int kScenes = 4;
+	const int kNodesPerScene = 25000;
+
+	std::vector<Scene> scenes(kScenes);
+	std::vector<LegacyComponents> legacy(kScenes);
+	for (int i = 0; i != kScenes; i++)
+		makeScene(scenes[i], legacy[i], kNodesPerScene, rng);
+
+	std::vector<Mesh> meshDescriptors(kNumMeshes);
+	for (uint32_t i = 0; i != kNumMeshes; i++)
+	{
+		meshDescriptors[i].indexOffset = i * 3072;
+		meshDescriptors[i].vertexOffset = i * 1024;
+	}
+
+	// 1) shapes_
+	std::vector<DrawData> legacyShapes, shapes;
+	legacyShapes.reserve(kNodesPerScene);
+	shapes.reserve(kNodesPerScene);
+
+	const double legacyBuild = measureMs([&]() {
+		buildShapes(legacy[0].meshes_, legacy[0].materialForNode_, meshDescriptors, legacyShapes);
+	});
+	const double build = measureMs([&]() {
+		buildShapes(scenes[0].meshes_, scenes[0].materialForNode_, meshDescriptors, shapes);
+	});
+
+	printBenchmark("shapes_, 25k nodes", legacyBuild, build);
+
+	std::sort(legacyShapes.begin(), legacyShapes.end());
+	std::sort(shapes.begin(), shapes.end());
+	if (legacyShapes.size() != shapes.size() || !std::equal(shapes.begin(), shapes.end(), legacyShapes.begin(), sameDrawData))
+	{
+		printf("The draw lists differ\n");
+		return 1;
+	}
+
+	// 2) the previous serial mergeScenes() with std::unordered_map components
+	LegacyComponents legacyMerged;
+	const double legacyMerge = measureMs([&]() {
+		legacyMerged = LegacyComponents();
+		legacyMerged.hierarchy_ = { { -1, 1, -1, -1, 0 } };
+		legacyMerged.localTransform_.push_back(glm::mat4(1.0f));
+		legacyMerged.globalTransform_.push_back(glm::mat4(1.0f));
+		legacyMerged.nameForNode_[0] = 0;
+
+		int offs = 1;
+		int meshOffs = 0;
+		int materialOffs = 0;
+		int nameOffs = 1;
+		for (int i = 0; i != kScenes; i++)
+		{
+			const Scene& s = scenes[i];
+			legacyMerged.localTransform_.insert(legacyMerged.localTransform_.end(), s.localTransform_.begin(), s.localTransform_.end());
+			legacyMerged.globalTransform_.insert(legacyMerged.globalTransform_.end(), s.globalTransform_.begin(), s.globalTransform_.end());
+
+			for (Hierarchy h : s.hierarchy_)
+			{
+				h.parent_ += (h.parent_ > -1) ? offs : 0;
+				h.firstChild_ += (h.firstChild_ > -1) ? offs : 0;
+				h.nextSibling_ += (h.nextSibling_ > -1) ? offs : 0;
+				h.lastSibling_ += (h.lastSibling_ > -1) ? offs : 0;
+				h.level_++;
+				legacyMerged.hierarchy_.push_back(h);
+			}
+
+			mergeLegacyMaps(legacyMerged.meshes_, legacy[i].meshes_, offs, meshOffs);
+			mergeLegacyMaps(legacyMerged.materialForNode_, legacy[i].materialForNode_, offs, materialOffs);
+			mergeLegacyMaps(legacyMerged.nameForNode_, legacy[i].nameForNode_, offs, nameOffs);
+
+			offs += (int)scenes[i].hierarchy_.size();
+			meshOffs += kNumMeshes;
+			materialOffs += (int)scenes[i].materialNames_.size();
+			nameOffs += (int)scenes[i].names_.size();
+		}
+	});
+
+	std::vector<Scene*> scenePtrs;
+	for (Scene& s : scenes)
+		scenePtrs.push_back(&s);
+	const std::vector<uint32_t> meshCounts(kScenes, kNumMeshes);
+
+	Scene merged;
+	const double merge = measureMs([&]() {
+		merged = Scene();
+		mergeScenes(merged, scenePtrs, {}, meshCounts);
+	});
+
+	printBenchmark("mergeScenes, 4 x 25k nodes", legacyMerge, merge);
+
+	if (merged.hierarchy_.size() != legacyMerged.hierarchy_.size() ||
+		!sameComponents(legacyMerged.meshes_, merged.meshes_) ||
+		!sameComponents(legacyMerged.materialForNode_, merged.materialForNode_) ||
+		!sameComponents(legacyMerged.nameForNode_, merged.nameForNode_))
+	{
+		printf("The merged components differ\n");
+		return 1;
+	}
+
+	return 0;
+}
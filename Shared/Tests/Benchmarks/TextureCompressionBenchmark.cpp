@@ -0,0 +1,194 @@
+/**
+	What compressMaterialTextures() buys the scene loaders: disk size, GPU memory and the CPU side of the texture loading.
+	The previous loaders decoded every image with stb_image into RGBA8 (the GL one then generated the mips on the GPU),
+	the compressed path reads the BC levels from the .ktx files as they are.
+
+	Usage: TextureCompressionBenchmark [file.materials] (texture names are relative to the resources directory, as in the loaders)
+	Without arguments a material list with synthetic 1024x1024 albedo, normal and roughness maps is written to the temp directory.
+	The .ktx files are written next to the source images, the material list itself is not modified.
+*/
+#include <Benchmark.hpp>
+
+#include <Filesystem/FilesystemUtilities.hpp>
+#include <Scene/AssetConverter.hpp>
+#include <Scene/Mareial.hpp>
+#include <TextureCache.hpp>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include <taskflow/taskflow.hpp>
+
+#include <cmath>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+static const int kSyntheticSize = 1024;
+static const int kSyntheticMaterials = 4;
+
+static void writeSyntheticImage(const std::string& fileName, int seed, bool isNormalMap)
+{
+	std::vector<uint8_t> rgba(size_t(kSyntheticSize) * kSyntheticSize * 4);
+
+	for (int y = 0; y != kSyntheticSize; y++)
+		for (int x = 0; x != kSyntheticSize; x++)
+		{
+			// smooth gradients with some high-frequency detail, photos compress somewhere in between
+			const float u = float(x) / kSyntheticSize;
+			const float v = float(y) / kSyntheticSize;
+			const float detail = 0.5f + 0.5f * std::sin(float(x * 13 + y * 7 + seed * 31) * 0.37f) * std::cos(float(x * 3 - y * 11) * 0.23f);
+
+			uint8_t* p = &rgba[(size_t(y) * kSyntheticSize + x) * 4];
+			if (isNormalMap)
+			{
+				const float nx = 0.3f * std::sin(u * 40.0f + seed) * detail;
+				const float ny = 0.3f * std::cos(v * 40.0f - seed) * detail;
+				const float nz = std::sqrt(std::max(0.0f, 1.0f - nx * nx - ny * ny));
+				p[0] = uint8_t(127.5f + 127.5f * nx);
+				p[1] = uint8_t(127.5f + 127.5f * ny);
+				p[2] = uint8_t(127.5f + 127.5f * nz);
+			}
+			else
+			{
+				p[0] = uint8_t(255.0f * (0.6f * u + 0.4f * detail));
+				p[1] = uint8_t(255.0f * (0.6f * v + 0.4f * detail));
+				p[2] = uint8_t(255.0f * (0.3f + 0.4f * detail));
+			}
+			p[3] = 255;
+		}
+
+	stbi_write_png(fileName.c_str(), kSyntheticSize, kSyntheticSize, 4, rgba.data(), kSyntheticSize * 4);
+}
+
+// returns the name of the material list, [textureRoot] receives the directory the texture names are relative to
+static std::string writeSyntheticMaterials(std::string& textureRoot)
+{
+	const std::filesystem::path dir = std::filesystem::temp_directory_path() / "TextureCompressionBenchmark";
+	std::filesystem::create_directories(dir);
+	textureRoot = dir.string() + "/";
+
+	std::vector<MaterialDescription> materials(kSyntheticMaterials);
+	std::vector<std::string> files;
+
+	for (int i = 0; i != kSyntheticMaterials; i++)
+	{
+		const char* kinds[] = { "albedo", "normal", "roughness" };
+		for (int k = 0; k != 3; k++)
+		{
+			const std::string name = std::string(kinds[k]) + std::to_string(i) + ".png";
+			if (!std::filesystem::exists(dir / name))
+				writeSyntheticImage((dir / name).string(), i * 3 + k, k == 1);
+			files.push_back(name);
+		}
+
+		materials[i].albedoMap_ = i * 3 + 0;
+		materials[i].normalMap_ = i * 3 + 1;
+		materials[i].metallicRoughnessMap_ = i * 3 + 2;
+	}
+
+	const std::string materialFile = (dir / "synthetic.materials").string();
+	saveMaterials(materialFile.c_str(), materials, files);
+	return materialFile;
+}
+
+static size_t getFileSize(const std::string& fileName)
+{
+	std::error_code ec;
+	const uintmax_t size = std::filesystem::file_size(fileName, ec);
+	return ec ? 0 : size_t(size);
+}
+
+int main(int argc, char** argv)
+{
+	std::string textureRoot = FilesystemUtilities::GetResourcesDir();
+	const std::string materialFile = argc > 1 ? std::string(argv[1]) : writeSyntheticMaterials(textureRoot);
+
+	std::vector<MaterialDescription> materials;
+	std::vector<std::string> sourceFiles;
+	loadMaterials(materialFile.c_str(), materials, sourceFiles);
+
+	// the encoding is a one-off cost of the conversion, up-to-date .ktx files are reused on the next runs
+	const std::string compressedFile = std::filesystem::path(materialFile).replace_extension(".ktx.materials").string();
+	tf::Executor executor;
+	const auto start = std::chrono::high_resolution_clock::now();
+	if (!compressMaterialTextures(materialFile.c_str(), compressedFile.c_str(), textureRoot, &executor))
+		printf("Some textures could not be compressed, they are left out of the comparison\n");
+	const auto end = std::chrono::high_resolution_clock::now();
+	printf("Compression of %u textures: %.1f s\n", (uint32_t)sourceFiles.size(), std::chrono::duration<double>(end - start).count());
+
+	std::vector<std::string> compressedFiles;
+	loadMaterials(compressedFile.c_str(), materials, compressedFiles);
+
+	std::vector<std::string> sources;
+	std::vector<std::string> ktxFiles;
+	for (size_t i = 0; i != sourceFiles.size(); i++)
+		if (compressedFiles[i] != sourceFiles[i])
+		{
+			sources.push_back(textureRoot + sourceFiles[i]);
+			ktxFiles.push_back(textureRoot + compressedFiles[i]);
+		}
+
+	if (sources.empty())
+	{
+		printf("Nothing to compare\n");
+		return 1;
+	}
+
+	// 1) sizes
+	size_t sourceBytes = 0;
+	size_t ktxBytes = 0;
+	size_t rgbaBytes = 0;
+	size_t compressedBytes = 0;
+
+	TextureCache cache(std::filesystem::temp_directory_path().string());
+	for (size_t i = 0; i != sources.size(); i++)
+	{
+		sourceBytes += getFileSize(sources[i]);
+		ktxBytes += getFileSize(ktxFiles[i]);
+
+		TextureLevelsView levels;
+		auto owner = cache.loadLevels(ktxFiles[i], levels);
+		if (!owner)
+			continue;
+
+		compressedBytes += levels.getTailSize(0);
+
+		// RGBA8 with the full mip chain, as the GL loader allocated it
+		for (int l = 0; l != levels.numLevels_; l++)
+			rgbaBytes += size_t(levels.getLevelWidth(l)) * levels.getLevelHeight(l) * 4;
+	}
+
+	printf("%u textures: files %.1f MB -> %.1f MB, GPU memory %.1f MB -> %.1f MB\n", (uint32_t)sources.size(),
+		sourceBytes / 1048576.0, ktxBytes / 1048576.0, rgbaBytes / 1048576.0, compressedBytes / 1048576.0);
+
+	// 2) CPU load time on one thread, the files are in the page cache after the warm-up run
+	size_t checksum = 0;
+	const double decodeMs = measureMs([&]() {
+		for (const auto& f : sources)
+		{
+			int w = 0, h = 0, comp = 0;
+			stbi_uc* img = stbi_load(f.c_str(), &w, &h, &comp, STBI_rgb_alpha);
+			if (img)
+				checksum += img[0] + size_t(w) * h;
+			stbi_image_free(img);
+		}
+	}, 3);
+
+	const double ktxMs = measureMs([&]() {
+		for (const auto& f : ktxFiles)
+		{
+			TextureLevelsView levels;
+			auto owner = cache.loadLevels(f, levels);
+			if (owner)
+				checksum += levels.getLevelData(0)[0] + size_t(levels.w_) * levels.h_;
+		}
+	}, 3);
+
+	doNotOptimize(checksum);
+	printBenchmark("load, stb_image -> .ktx levels", decodeMs, ktxMs);
+
+	return 0;
+}
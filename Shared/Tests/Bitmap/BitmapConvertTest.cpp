@@ -0,0 +1,69 @@
+/**
+	convertRowF32ToU8(): truncation to [0..255] with NaN mapped to 0, the same results from the SSE blocks and the scalar tail.
+	Every special value is placed both in the 16-wide part and in the tail of the row.
+*/
+#include <Tests.hpp>
+
+#include <BitmapView.hpp>
+
+#include <limits>
+#include <vector>
+
+struct Conversion
+{
+	float value;
+	uint8_t expected;
+};
+
+int main()
+{
+	const float inf = std::numeric_limits<float>::infinity();
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+
+	const Conversion conversions[] = {
+		{ 0.0f, 0 },
+		{ -0.0f, 0 },
+		{ 1.0f, 255 },
+		{ 0.5f, 127 },
+		{ 1.0f / 255.0f, 1 },
+		{ 0.999f, 254 },
+		{ -0.5f, 0 },
+		{ 2.0f, 255 },
+		{ 1e10f, 255 },
+		{ -1e10f, 0 },
+		{ inf, 255 },
+		{ -inf, 0 },
+		{ nan, 0 },
+		{ -nan, 0 },
+		{ std::numeric_limits<float>::denorm_min(), 0 },
+	};
+
+	const size_t numConversions = sizeof(conversions) / sizeof(conversions[0]);
+
+	// one full 16-wide block followed by a tail of the same values
+	const size_t count = 16 + numConversions;
+
+	for (size_t shift = 0; shift != numConversions; shift++)
+	{
+		std::vector<float> src(count);
+		std::vector<uint8_t> expected(count);
+		for (size_t i = 0; i != count; i++)
+		{
+			const Conversion& c = conversions[(i + shift) % numConversions];
+			src[i] = c.value;
+			expected[i] = c.expected;
+		}
+
+		std::vector<uint8_t> dst(count, 0xCD);
+		convertRowF32ToU8(src.data(), dst.data(), count);
+
+		for (size_t i = 0; i != count; i++)
+			if (dst[i] != expected[i])
+			{
+				printf("%g -> %u, expected %u (position %zu)\n", src[i], dst[i], expected[i], i);
+				CHECK(dst[i] == expected[i]);
+			}
+	}
+
+	return testResult();
+}
@@ -0,0 +1,90 @@
+/**
+	SH9 irradiance against the brute-force convolution on a small equirectangular environment.
+	The radiance is a polynomial of degree 2 in the direction, which bands 0..2 represent exactly,
+	so projectToSH9() + evaluateIrradianceSH9() must match the analytic cosine convolution up to the quadrature error.
+	convolveDiffuseSH9() must match it as well. convolveDiffuse() draws its samples uniformly in (theta, phi) and is biased
+	towards the poles (about 7% on average, up to 13% for this map, more samples do not help), so the SH9 result only has to
+	agree with it within that bias.
+*/
+#include <Tests.hpp>
+
+#include <UtilsCubemap.hpp>
+
+#include <algorithm>
+#include <vector>
+
+static const int kSrcW = 64;
+static const int kSrcH = 32;
+static const int kNumSamples = 4096;
+
+static const float kPi = 3.14159265358979f;
+
+static glm::vec3 direction(float theta, float phi)
+{
+	return glm::vec3(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+}
+
+// a bright sky above, a dimmer colored ground below and a band-2 variation around the horizon
+static glm::vec3 radiance(const glm::vec3& d)
+{
+	return glm::vec3(1.0f) + glm::vec3(0.6f, 0.5f, 0.3f) * d.z + glm::vec3(0.3f, -0.2f, 0.1f) * (d.x * d.y);
+}
+
+// the cosine lobe scales the bands by 1, 2/3 and 1/4 (irradiance / pi)
+static glm::vec3 exactIrradiance(const glm::vec3& n)
+{
+	return glm::vec3(1.0f) + glm::vec3(0.6f, 0.5f, 0.3f) * (n.z * 2.0f / 3.0f) + glm::vec3(0.3f, -0.2f, 0.1f) * (n.x * n.y * 0.25f);
+}
+
+int main()
+{
+	// texel centers, as projectToSH9() integrates them
+	std::vector<glm::vec3> env(kSrcW * kSrcH);
+	for (int y = 0; y != kSrcH; y++)
+		for (int x = 0; x != kSrcW; x++)
+			env[y * kSrcW + x] = radiance(direction((y + 0.5f) / kSrcH * kPi, (x + 0.5f) / kSrcW * 2.0f * kPi));
+
+	// 1) the projection itself
+	glm::vec3 sh[9];
+	projectToSH9(env.data(), kSrcW, kSrcH, sh);
+
+	for (int t = 0; t != 17; t++)
+		for (int p = 0; p != 16; p++)
+		{
+			const glm::vec3 n = direction(t / 16.0f * kPi, p / 16.0f * 2.0f * kPi);
+			const glm::vec3 e = evaluateIrradianceSH9(sh, n);
+			const glm::vec3 expected = exactIrradiance(n);
+			for (int c = 0; c != 3; c++)
+				CHECK_NEAR(e[c], expected[c], 0.01f);
+		}
+
+	// 2) the whole SH9 path against the brute-force convolution, at the same output resolution
+	std::vector<glm::vec3> bruteForce(kSrcW * kSrcH);
+	std::vector<glm::vec3> approximated(kSrcW * kSrcH);
+	convolveDiffuse(env.data(), kSrcW, kSrcH, kSrcW, kSrcH, bruteForce.data(), kNumSamples);
+	convolveDiffuseSH9(env.data(), kSrcW, kSrcH, kSrcW, kSrcH, approximated.data());
+
+	float maxError = 0.0f;
+	float maxBruteForceError = 0.0f;
+	for (int y = 0; y != kSrcH; y++)
+		for (int x = 0; x != kSrcW; x++)
+		{
+			// the output texels of both functions are at the texel corners
+			const glm::vec3 expected = exactIrradiance(direction(float(y) / kSrcH * kPi, float(x) / kSrcW * 2.0f * kPi));
+			const size_t i = y * kSrcW + x;
+			for (int c = 0; c != 3; c++)
+			{
+				const float error = std::fabs(approximated[i][c] - bruteForce[i][c]);
+				const float bruteForceError = std::fabs(bruteForce[i][c] - expected[c]);
+				CHECK_NEAR(approximated[i][c], expected[c], 0.01f);
+				CHECK(error < 0.15f);
+
+				maxError = std::max(maxError, error);
+				maxBruteForceError = std::max(maxBruteForceError, bruteForceError);
+			}
+		}
+
+	printf("SH9 vs convolveDiffuse(): max difference %.4f, convolveDiffuse() vs exact: max error %.4f\n", maxError, maxBruteForceError);
+
+	return testResult();
+}
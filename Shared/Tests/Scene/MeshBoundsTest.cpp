@@ -0,0 +1,149 @@
+/**
+	recalculateBoundingBoxes(): the boxes must enclose exactly the vertices referenced by every mesh.
+	mergeMeshData() must move the vertex range of every copied mesh with its vertices, so that the range scan stays exact,
+	and mergeScene() must give the merged mesh a range covering all the merged vertices.
+*/
+#include <Tests.hpp>
+
+#include <Scene/MergeUtil.hpp>
+#include <Scene/VtxData.hpp>
+
+#include <cstring>
+#include <random>
+
+// [numMeshes] meshes with [verticesPerMesh] vertices each, every vertex is referenced by LOD 0
+static MeshData makeMeshData(uint32_t numMeshes, uint32_t verticesPerMesh, std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+
+	MeshData m;
+	for (uint32_t i = 0; i != numMeshes; i++)
+	{
+		Mesh mesh;
+		mesh.indexOffset = (uint32_t)m.indexData_.size();
+		mesh.vertexOffset = i * verticesPerMesh;
+		mesh.vertexCount = verticesPerMesh;
+		mesh.lodOffset[0] = 0;
+		mesh.lodOffset[1] = 3 * verticesPerMesh;
+		mesh.streamElementSize[0] = kDefaultVertexStride * sizeof(float);
+		m.meshes_.push_back(mesh);
+
+		// indices are local to the mesh, as in the converted files
+		for (uint32_t j = 0; j != 3 * verticesPerMesh; j++)
+			m.indexData_.push_back((j * 7) % verticesPerMesh);
+	}
+
+	m.vertexData_.resize(size_t(numMeshes) * verticesPerMesh * kDefaultVertexStride);
+	for (float& f : m.vertexData_)
+		f = value(rng);
+
+	return m;
+}
+
+// brute force: every index of LOD 0, with the vertex offset applied the same way the renderers do
+static BoundingBox referencedBox(const MeshData& m, const Mesh& mesh)
+{
+	glm::vec3 vmin(std::numeric_limits<float>::max());
+	glm::vec3 vmax(std::numeric_limits<float>::lowest());
+
+	for (uint32_t i = 0; i != mesh.getLODIndicesCount(0); i++)
+	{
+		const float* v = &m.vertexData_[size_t(m.indexData_[mesh.indexOffset + i] + mesh.vertexOffset) * kDefaultVertexStride];
+		vmin = glm::min(vmin, glm::vec3(v[0], v[1], v[2]));
+		vmax = glm::max(vmax, glm::vec3(v[0], v[1], v[2]));
+	}
+
+	return BoundingBox(vmin, vmax);
+}
+
+static void checkBoxes(const MeshData& m)
+{
+	CHECK(m.boxes_.size() == m.meshes_.size());
+
+	for (size_t i = 0; i != m.meshes_.size(); i++)
+	{
+		const BoundingBox expected = referencedBox(m, m.meshes_[i]);
+		for (int c = 0; c != 3; c++)
+		{
+			CHECK(m.boxes_[i].min_[c] == expected.min_[c]);
+			CHECK(m.boxes_[i].max_[c] == expected.max_[c]);
+		}
+	}
+}
+
+// the vertex range of every merged mesh holds the same vertices as the range of its source
+static void checkRanges(const MeshData& merged, const std::vector<const MeshData*>& sources)
+{
+	size_t i = 0;
+	for (const MeshData* src : sources)
+		for (const Mesh& mesh : src->meshes_)
+		{
+			const Mesh& copy = merged.meshes_[i++];
+			CHECK(copy.vertexCount == mesh.vertexCount);
+			CHECK((size_t(copy.vertexOffset) + copy.vertexCount) * kDefaultVertexStride <= merged.vertexData_.size());
+			CHECK(memcmp(&merged.vertexData_[size_t(copy.vertexOffset) * kDefaultVertexStride], &src->vertexData_[size_t(mesh.vertexOffset) * kDefaultVertexStride],
+				size_t(mesh.vertexCount) * kDefaultVertexStride * sizeof(float)) == 0);
+		}
+}
+
+int main()
+{
+	std::mt19937 rng(11);
+
+	MeshData a = makeMeshData(5, 100, rng);
+	MeshData b = makeMeshData(7, 64, rng);
+
+	// fresh data: the range scan, then the index walk of meshes without a vertex count
+	recalculateBoundingBoxes(a);
+	checkBoxes(a);
+
+	MeshData noCounts = a;
+	for (Mesh& mesh : noCounts.meshes_)
+		mesh.vertexCount = 0;
+	recalculateBoundingBoxes(noCounts);
+	checkBoxes(noCounts);
+
+	// the merged meshes keep local indices, their vertex ranges move with the vertices
+	MeshData merged;
+	mergeMeshData(merged, { &a, &b });
+	checkRanges(merged, { &a, &b });
+	recalculateBoundingBoxes(merged);
+	checkBoxes(merged);
+
+	// one node per mesh, every other one with the material to merge
+	Scene scene;
+	addNode(scene, -1, 0);
+	scene.materialNames_ = { "kept", "merged" };
+	for (uint32_t i = 0; i != (uint32_t)merged.meshes_.size(); i++)
+	{
+		const int node = addNode(scene, 0, 1);
+		scene.meshes_[node] = i;
+		scene.materialForNode_[node] = i & 1;
+	}
+
+	std::vector<MaterialDescription> materials(scene.materialNames_.size());
+	mergeScene(scene, merged, materials, "merged");
+	CHECK(materials.size() == 2);
+	CHECK(merged.meshes_.size() == (a.meshes_.size() + b.meshes_.size() + 1) / 2 + 1);
+	recalculateBoundingBoxes(merged);
+
+	// the range of the merged mesh also spans the kept meshes in between: its box encloses the referenced vertices
+	const BoundingBox& box = merged.boxes_.back();
+	const BoundingBox referenced = referencedBox(merged, merged.meshes_.back());
+	for (int c = 0; c != 3; c++)
+	{
+		CHECK(box.min_[c] <= referenced.min_[c]);
+		CHECK(box.max_[c] >= referenced.max_[c]);
+	}
+	for (size_t i = 0; i + 1 != merged.meshes_.size(); i++)
+	{
+		const BoundingBox expected = referencedBox(merged, merged.meshes_[i]);
+		for (int c = 0; c != 3; c++)
+		{
+			CHECK(merged.boxes_[i].min_[c] == expected.min_[c]);
+			CHECK(merged.boxes_[i].max_[c] == expected.max_[c]);
+		}
+	}
+
+	return testResult();
+}
@@ -0,0 +1,151 @@
+/**
+	raycastSceneBVH() against a brute-force test of every shape box, on the built hierarchy and after
+	moving some scene nodes and refitting it the way VKSceneData::recalculateChangedTransforms() does.
+*/
+#include <Tests.hpp>
+
+#include <Scene/SceneBVH.hpp>
+
+#include <algorithm>
+#include <random>
+
+static const int kNumNodes = 3000;
+static const int kNumRays = 2000;
+
+struct SceneSetup
+{
+	Scene scene;
+	MeshData meshData;
+	std::vector<DrawData> shapes;
+};
+
+static void setTranslation(Scene& scene, int node, const glm::vec3& t)
+{
+	scene.localTransform_[node][3] = glm::vec4(t, 1.0f);
+}
+
+static void makeScene(SceneSetup& s, std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> offset(-20.0f, 20.0f);
+	std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+	for (int i = 0; i != 64; i++)
+	{
+		const glm::vec3 p(offset(rng) * 0.05f, offset(rng) * 0.05f, offset(rng) * 0.05f);
+		s.meshData.boxes_.push_back(BoundingBox(p, p + glm::vec3(size(rng), size(rng), size(rng))));
+	}
+
+	addNode(s.scene, -1, 0);
+	for (int i = 1; i != kNumNodes; i++)
+	{
+		int parent = std::uniform_int_distribution<int>(0, i - 1)(rng);
+		while (s.scene.hierarchy_[parent].level_ >= 8)
+			parent = s.scene.hierarchy_[parent].parent_;
+		const int node = addNode(s.scene, parent, s.scene.hierarchy_[parent].level_ + 1);
+		setTranslation(s.scene, node, glm::vec3(offset(rng), offset(rng), offset(rng)) * 0.2f);
+
+		// some nodes are groups without shapes, some have several shapes
+		for (uint32_t k = rng() % 3; k != 0; k--)
+		{
+			DrawData d{};
+			d.meshIndex = rng() % (uint32_t)s.meshData.boxes_.size();
+			d.transformIndex = (uint32_t)node;
+			s.shapes.push_back(d);
+		}
+	}
+
+	markAsChanged(s.scene, 0);
+	recalculateGlobalTransforms(s.scene);
+}
+
+// the distance to the entry point of the nearest shape box, or -1 if nothing is hit
+static float bruteForceRaycast(const SceneSetup& s, const glm::vec3& origin, const glm::vec3& dir)
+{
+	float best = -1.0f;
+
+	for (const DrawData& d : s.shapes)
+	{
+		const BoundingBox box = s.meshData.boxes_[d.meshIndex].getTransformed(s.scene.globalTransform_[d.transformIndex]);
+
+		float tEnter = 0.0f;
+		float tExit = std::numeric_limits<float>::max();
+		for (int c = 0; c != 3; c++)
+		{
+			const float t1 = (box.min_[c] - origin[c]) / dir[c];
+			const float t2 = (box.max_[c] - origin[c]) / dir[c];
+			tEnter = std::max(tEnter, std::min(t1, t2));
+			tExit = std::min(tExit, std::max(t1, t2));
+		}
+
+		if (tEnter <= tExit && (best < 0.0f || tEnter < best))
+			best = tEnter;
+	}
+
+	return best;
+}
+
+static void checkRays(const SceneBVH& bvh, const SceneSetup& s, std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+	int numHits = 0;
+	for (int i = 0; i != kNumRays; i++)
+	{
+		const glm::vec3 origin = glm::vec3(value(rng), value(rng), value(rng)) * 30.0f;
+		const glm::vec3 dir = glm::normalize(glm::vec3(value(rng), value(rng), value(rng)));
+
+		const float expected = bruteForceRaycast(s, origin, dir);
+
+		uint32_t shape = ~0u;
+		float t = -1.0f;
+		const bool hit = raycastSceneBVH(bvh, origin, dir, shape, t);
+
+		CHECK(hit == (expected >= 0.0f));
+		if (!hit || expected < 0.0f)
+			continue;
+
+		numHits++;
+		CHECK_NEAR(t, expected, 1e-4f * std::max(1.0f, expected));
+		CHECK(shape < s.shapes.size());
+	}
+
+	// the rays must actually exercise the traversal
+	CHECK(numHits > kNumRays / 10);
+}
+
+int main()
+{
+	std::mt19937 rng(17);
+
+	SceneSetup s;
+	makeScene(s, rng);
+
+	SceneBVH bvh;
+	buildSceneBVH(bvh, s.scene, s.meshData, s.shapes);
+	checkRays(bvh, s, rng);
+
+	// move some subtrees far from where they were when the hierarchy was built
+	std::uniform_real_distribution<float> offset(-40.0f, 40.0f);
+	for (int i = 0; i != 40; i++)
+	{
+		const int node = std::uniform_int_distribution<int>(1, kNumNodes - 1)(rng);
+		setTranslation(s.scene, node, glm::vec3(offset(rng), offset(rng), offset(rng)));
+		markAsChanged(s.scene, node);
+	}
+
+	collectChangedShapes(bvh, s.scene);
+	recalculateGlobalTransforms(s.scene);
+	refitSceneBVH(bvh, s.scene, s.meshData, s.shapes);
+
+	CHECK(bvh.changedShapes_.empty());
+	for (size_t i = 0; i != s.shapes.size(); i++)
+	{
+		const BoundingBox box = s.meshData.boxes_[s.shapes[i].meshIndex].getTransformed(s.scene.globalTransform_[s.shapes[i].transformIndex]);
+		for (int c = 0; c != 3; c++)
+			CHECK(bvh.shapeBoxes_[i].min_[c] == box.min_[c] && bvh.shapeBoxes_[i].max_[c] == box.max_[c]);
+	}
+
+	checkRays(bvh, s, rng);
+
+	return testResult();
+}
@@ -0,0 +1,227 @@
+/**
+	deleteSceneNodes(): on random hierarchies the linear-time version must leave the same hierarchy_ links, transforms and components
+	as the previous algorithm (kept below), preserve the levels of the remaining nodes (the previous one reset them to 0)
+	and keep every child list consistent with the parent links. With a material remap table the unused material names are removed.
+*/
+#include <Tests.hpp>
+
+#include <Scene/Scene.hpp>
+#include <Utils/Utils.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+/* The previous deleteSceneNodes() and its helpers */
+
+static void legacyAddUniqueIdx(std::vector<uint32_t>& v, uint32_t index)
+{
+	if (!std::binary_search(v.begin(), v.end(), index))
+		v.push_back(index);
+}
+
+static void legacyCollectNodesToDelete(const Scene& scene, int node, std::vector<uint32_t>& nodes)
+{
+	for (int n = scene.hierarchy_[node].firstChild_; n != -1; n = scene.hierarchy_[n].nextSibling_)
+	{
+		legacyAddUniqueIdx(nodes, n);
+		legacyCollectNodesToDelete(scene, n, nodes);
+	}
+}
+
+static int legacyFindLastNonDeletedItem(const Scene& scene, const std::vector<int>& newIndices, int node)
+{
+	if (node == -1)
+		return -1;
+
+	return (newIndices[node] == -1) ?
+		legacyFindLastNonDeletedItem(scene, newIndices, scene.hierarchy_[node].nextSibling_) :
+		newIndices[node];
+}
+
+static void legacyShiftMapIndices(NodeComponentMap& items, const std::vector<int>& newIndices)
+{
+	NodeComponentMap newItems;
+	newItems.reserve(items.size(), newIndices.size());
+	for (const auto& m : items)
+	{
+		const int newIndex = newIndices[m.first];
+		if (newIndex != -1)
+			newItems[newIndex] = m.second;
+	}
+	items = std::move(newItems);
+}
+
+static void legacyDeleteSceneNodes(Scene& scene, const std::vector<uint32_t>& nodesToDelete)
+{
+	// the previous loop appended to the vector it iterated over, and eraseSelected() needs a sorted selection:
+	// both are done the well-defined way here
+	auto indicesToDelete = nodesToDelete;
+	for (size_t i = 0; i != nodesToDelete.size(); i++)
+		legacyCollectNodesToDelete(scene, nodesToDelete[i], indicesToDelete);
+	std::sort(indicesToDelete.begin(), indicesToDelete.end());
+	indicesToDelete.erase(std::unique(indicesToDelete.begin(), indicesToDelete.end()), indicesToDelete.end());
+
+	std::vector<int> nodes(scene.hierarchy_.size());
+	std::iota(nodes.begin(), nodes.end(), 0);
+
+	const size_t oldSize = nodes.size();
+	eraseSelected(nodes, indicesToDelete);
+
+	std::vector<int> newIndices(oldSize, -1);
+	for (int i = 0; i < (int)nodes.size(); i++)
+		newIndices[nodes[i]] = i;
+
+	auto nodeMover = [&scene, &newIndices](Hierarchy& h)
+	{
+		return Hierarchy{
+			(h.parent_ != -1) ? newIndices[h.parent_] : -1,
+			legacyFindLastNonDeletedItem(scene, newIndices, h.firstChild_),
+			legacyFindLastNonDeletedItem(scene, newIndices, h.nextSibling_),
+			legacyFindLastNonDeletedItem(scene, newIndices, h.lastSibling_) };
+	};
+	std::transform(scene.hierarchy_.begin(), scene.hierarchy_.end(), scene.hierarchy_.begin(), nodeMover);
+
+	eraseSelected(scene.hierarchy_, indicesToDelete);
+	eraseSelected(scene.localTransform_, indicesToDelete);
+	eraseSelected(scene.globalTransform_, indicesToDelete);
+
+	legacyShiftMapIndices(scene.meshes_, newIndices);
+	legacyShiftMapIndices(scene.materialForNode_, newIndices);
+	legacyShiftMapIndices(scene.nameForNode_, newIndices);
+}
+
+// the original index of every node is kept in its local transform, so the remaining nodes can be matched after the deletion
+static Scene makeRandomScene(uint32_t numNodes, uint32_t numMaterials, std::mt19937& rng)
+{
+	Scene scene;
+	addNode(scene, -1, 0);
+
+	for (uint32_t i = 1; i != numNodes; i++)
+	{
+		// deep chains and wide levels
+		const int parent = (rng() % 4) ? std::uniform_int_distribution<int>(0, (int)i - 1)(rng) : (int)i - 1;
+		addNode(scene, parent, scene.hierarchy_[parent].level_ + 1);
+	}
+
+	for (uint32_t i = 0; i != numMaterials; i++)
+		scene.materialNames_.push_back("material" + std::to_string(i));
+
+	for (uint32_t i = 0; i != numNodes; i++)
+	{
+		scene.localTransform_[i][3][0] = float(i);
+		scene.globalTransform_[i][3][1] = float(i);
+
+		if (rng() % 2)
+			scene.meshes_[i] = rng() % 100;
+		if (rng() % 2)
+			scene.materialForNode_[i] = rng() % numMaterials;
+		if (rng() % 3)
+		{
+			scene.nameForNode_[i] = (uint32_t)scene.names_.size();
+			scene.names_.push_back("node" + std::to_string(i));
+		}
+	}
+
+	return scene;
+}
+
+static bool sameComponent(const NodeComponentMap& a, const NodeComponentMap& b, uint32_t node)
+{
+	const auto ia = a.find(node);
+	const auto ib = b.find(node);
+	if ((ia == a.end()) || (ib == b.end()))
+		return (ia == a.end()) == (ib == b.end());
+	return ia->second == ib->second;
+}
+
+static std::string getMaterialName(const Scene& scene, uint32_t node)
+{
+	const auto m = scene.materialForNode_.find(node);
+	return (m != scene.materialForNode_.end()) ? scene.materialNames_[m->second] : std::string();
+}
+
+static void checkDeletion(const Scene& original, const std::vector<uint32_t>& nodesToDelete)
+{
+	Scene expected = original;
+	legacyDeleteSceneNodes(expected, nodesToDelete);
+
+	Scene scene = original;
+	std::vector<int> materialRemap;
+	deleteSceneNodes(scene, nodesToDelete, &materialRemap);
+
+	const size_t size = expected.hierarchy_.size();
+	CHECK(scene.hierarchy_.size() == size);
+	CHECK(scene.localTransform_.size() == size && scene.globalTransform_.size() == size);
+	if (scene.hierarchy_.size() != size)
+		return;
+
+	std::vector<int> numChildren(size, 0);
+	for (uint32_t i = 0; i != size; i++)
+	{
+		const Hierarchy& h = scene.hierarchy_[i];
+		const Hierarchy& e = expected.hierarchy_[i];
+		CHECK(h.parent_ == e.parent_ && h.firstChild_ == e.firstChild_ && h.nextSibling_ == e.nextSibling_ && h.lastSibling_ == e.lastSibling_);
+
+		const uint32_t oldIndex = (uint32_t)scene.localTransform_[i][3][0];
+		CHECK(scene.localTransform_[i] == expected.localTransform_[i]);
+		CHECK(scene.globalTransform_[i] == expected.globalTransform_[i]);
+		CHECK(h.level_ == original.hierarchy_[oldIndex].level_);
+		if (h.parent_ != -1)
+		{
+			CHECK(h.level_ == scene.hierarchy_[h.parent_].level_ + 1);
+			numChildren[h.parent_]++;
+		}
+
+		CHECK(sameComponent(scene.meshes_, expected.meshes_, i));
+		CHECK(getNodeName(scene, i) == getNodeName(expected, i));
+		CHECK(getMaterialName(scene, i) == getMaterialName(expected, i));
+	}
+
+	// every node is reached exactly once from the first child of its parent
+	for (uint32_t i = 0; i != size; i++)
+	{
+		int count = 0;
+		for (int c = scene.hierarchy_[i].firstChild_; c != -1 && count <= numChildren[i]; c = scene.hierarchy_[c].nextSibling_, count++)
+			CHECK(scene.hierarchy_[c].parent_ == (int)i);
+		CHECK(count == numChildren[i]);
+	}
+
+	// only the names and materials still referenced are left, the remap table renumbers the old materials the same way
+	CHECK(scene.names_.size() == scene.nameForNode_.size());
+	CHECK(materialRemap.size() == original.materialNames_.size());
+	std::vector<bool> used(scene.materialNames_.size(), false);
+	for (const auto& m : scene.materialForNode_)
+		used[m.second] = true;
+	CHECK(std::all_of(used.begin(), used.end(), [](bool u) { return u; }));
+	for (size_t i = 0; i != materialRemap.size(); i++)
+		if (materialRemap[i] != -1)
+			CHECK(scene.materialNames_[materialRemap[i]] == original.materialNames_[i]);
+}
+
+int main()
+{
+	std::mt19937 rng(5);
+
+	for (int iteration = 0; iteration != 200; iteration++)
+	{
+		const uint32_t numNodes = 2 + rng() % 300;
+		const Scene scene = makeRandomScene(numNodes, 1 + rng() % 20, rng);
+
+		// unsorted, with duplicates and with nodes below other deleted nodes
+		std::vector<uint32_t> nodesToDelete(1 + rng() % 8);
+		for (uint32_t& n : nodesToDelete)
+			n = 1 + rng() % (numNodes - 1);
+
+		checkDeletion(scene, nodesToDelete);
+	}
+
+	// a leaf, a single subtree and the whole scene
+	std::mt19937 small(9);
+	const Scene scene = makeRandomScene(50, 4, small);
+	checkDeletion(scene, { 49 });
+	checkDeletion(scene, { (uint32_t)scene.hierarchy_[0].firstChild_ });
+	checkDeletion(scene, { 0 });
+
+	return testResult();
+}
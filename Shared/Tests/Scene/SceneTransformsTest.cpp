@@ -0,0 +1,111 @@
+/**
+	recalculateGlobalTransforms(): the parallel version must give bit-identical transforms and leave
+	the change lists in the same state as the serial one, for a full update and for a partial one.
+*/
+#include <Tests.hpp>
+
+#include <Scene/Scene.hpp>
+
+#include <taskflow/taskflow.hpp>
+
+#include <cstring>
+#include <random>
+
+static Scene makeRandomScene(uint32_t numNodes, int maxLevel, std::mt19937& rng)
+{
+	Scene scene;
+	addNode(scene, -1, 0);
+
+	std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+	for (uint32_t i = 1; i != numNodes; i++)
+	{
+		// wide levels, so that the parallel version splits them into several batches
+		int parent = std::uniform_int_distribution<int>(0, (int)scene.hierarchy_.size() - 1)(rng);
+		while (scene.hierarchy_[parent].level_ >= maxLevel)
+			parent = scene.hierarchy_[parent].parent_;
+
+		const int node = addNode(scene, parent, scene.hierarchy_[parent].level_ + 1);
+
+		scene.localTransform_[node] =
+			glm::translate(glm::mat4(1.0f), glm::vec3(value(rng), value(rng), value(rng))) *
+			glm::rotate(glm::mat4(1.0f), value(rng) * 3.0f, glm::normalize(glm::vec3(value(rng), value(rng), 1.0f))) *
+			glm::scale(glm::mat4(1.0f), glm::vec3(1.0f + 0.1f * value(rng)));
+	}
+
+	return scene;
+}
+
+static bool sameTransforms(const Scene& a, const Scene& b)
+{
+	return a.globalTransform_.size() == b.globalTransform_.size() &&
+		memcmp(a.globalTransform_.data(), b.globalTransform_.data(), a.globalTransform_.size() * sizeof(glm::mat4)) == 0;
+}
+
+static bool noPendingChanges(const Scene& scene)
+{
+	for (int i = 0; i != MAX_NODE_LEVEL; i++)
+		if (!scene.changedAtThisFrame_[i].empty())
+			return false;
+
+	for (size_t i = 0; i != scene.isNodeChanged_.size(); i++)
+		if (scene.isNodeChanged_[i])
+			return false;
+
+	return true;
+}
+
+int main()
+{
+	std::mt19937 rng(12345);
+	tf::Executor executor(4);
+
+	Scene serial = makeRandomScene(50000, 12, rng);
+	Scene parallel = serial;
+
+	// full update
+	markAsChanged(serial, 0);
+	recalculateGlobalTransforms(serial);
+
+	markAsChanged(parallel, 0);
+	recalculateGlobalTransforms(parallel, executor);
+
+	CHECK(sameTransforms(serial, parallel));
+	CHECK(noPendingChanges(serial));
+	CHECK(noPendingChanges(parallel));
+
+	// partial update: move a few subtrees, the rest of the scene keeps its transforms
+	std::uniform_int_distribution<int> node(1, (int)serial.hierarchy_.size() - 1);
+	for (int i = 0; i != 200; i++)
+	{
+		const int n = node(rng);
+		const glm::mat4 local = glm::translate(serial.localTransform_[n], glm::vec3(0.5f, -0.25f, 1.0f));
+
+		serial.localTransform_[n] = local;
+		parallel.localTransform_[n] = local;
+
+		markAsChanged(serial, n);
+		markAsChanged(parallel, n);
+	}
+
+	recalculateGlobalTransforms(serial);
+	recalculateGlobalTransforms(parallel, executor);
+
+	CHECK(sameTransforms(serial, parallel));
+	CHECK(noPendingChanges(serial));
+	CHECK(noPendingChanges(parallel));
+
+	// a single small subtree is updated on the calling thread, the change lists must end up the same
+	const int moved = node(rng);
+	serial.localTransform_[moved] = parallel.localTransform_[moved] = glm::scale(serial.localTransform_[moved], glm::vec3(2.0f));
+	markAsChanged(serial, moved);
+	markAsChanged(parallel, moved);
+
+	recalculateGlobalTransforms(serial);
+	recalculateGlobalTransforms(parallel, executor);
+
+	CHECK(sameTransforms(serial, parallel));
+	CHECK(noPendingChanges(parallel));
+
+	return testResult();
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+
+/**
+	Minimal checks for the engine tests: a failed check is printed and counted, the test keeps running
+	and main() returns testResult() so that ctest sees the failure.
+*/
+
+inline int& testFailures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			testFailures()++; \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(a, b, eps) \
+	do { \
+		const double checkA_ = double(a); \
+		const double checkB_ = double(b); \
+		if (!(std::fabs(checkA_ - checkB_) <= double(eps))) { \
+			printf("%s:%d: CHECK_NEAR(%s, %s) failed: %g vs %g\n", __FILE__, __LINE__, #a, #b, checkA_, checkB_); \
+			testFailures()++; \
+		} \
+	} while (0)
+
+inline int testResult()
+{
+	if (testFailures() > 0)
+		printf("%d check(s) failed\n", testFailures());
+	else
+		printf("All checks passed\n");
+
+	return testFailures() > 0 ? 1 : 0;
+}
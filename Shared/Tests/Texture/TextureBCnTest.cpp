@@ -0,0 +1,370 @@
+/**
+	compressBlockBC7(), compressBlockBC5() and compressBlockBC6H() decoded by the small reference decoders below, written from the
+	D3D11 block layouts: BC7 mode 6, both BC4 palettes of BC5 (the 8-value one and the 6-value one solid blocks fall into)
+	and BC6H mode 11. Solid blocks must come back within the endpoint precision, gradients within half a palette step.
+	Gradients whose first pixel is nearer the second endpoint need the anchor index fix-up: the anchor has only 3 bits,
+	a wrong one shifts all the following indices.
+*/
+#include <Tests.hpp>
+
+#include <Bitmap.hpp>
+#include <TextureCompression.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+static const int kWeights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct BitReader
+{
+	const uint8_t* data_;
+	uint32_t pos_ = 0;
+
+	uint32_t read(int numBits)
+	{
+		uint32_t value = 0;
+		for (int i = 0; i != numBits; i++, pos_++)
+			value |= uint32_t((data_[pos_ >> 3] >> (pos_ & 7)) & 1) << i;
+		return value;
+	}
+};
+
+// the first index of a one-subset block has an implicit zero MSB
+static void readIndices4(BitReader& r, uint8_t* indices)
+{
+	indices[0] = uint8_t(r.read(3));
+	for (int i = 1; i != 16; i++)
+		indices[i] = uint8_t(r.read(4));
+}
+
+/* Returns the mode of a BC7 block: the number of zero bits before the first set bit (8 is reserved) */
+static int getBC7Mode(const uint8_t* block)
+{
+	int mode = 0;
+	while (mode != 8 && !((block[0] >> mode) & 1))
+		mode++;
+	return mode;
+}
+
+/* BC7 mode 6: 7.7.7.7 endpoints with a unique p-bit each, 4-bit indices. Returns false for the other modes */
+static bool decodeBC7(const uint8_t* block, uint8_t* rgba, uint8_t* anchorIndex = nullptr)
+{
+	if (getBC7Mode(block) != 6)
+		return false;
+
+	BitReader r{ block };
+	r.read(7);
+
+	int e[2][4];
+	for (int c = 0; c != 4; c++)
+	{
+		e[0][c] = int(r.read(7)) << 1;
+		e[1][c] = int(r.read(7)) << 1;
+	}
+	const int p0 = int(r.read(1));
+	const int p1 = int(r.read(1));
+	for (int c = 0; c != 4; c++)
+	{
+		e[0][c] |= p0;
+		e[1][c] |= p1;
+	}
+
+	uint8_t indices[16];
+	readIndices4(r, indices);
+	if (anchorIndex)
+		*anchorIndex = indices[0];
+
+	for (int i = 0; i != 16; i++)
+		for (int c = 0; c != 4; c++)
+			rgba[i * 4 + c] = uint8_t(((64 - kWeights4[indices[i]]) * e[0][c] + kWeights4[indices[i]] * e[1][c] + 32) >> 6);
+
+	return r.pos_ == 128;
+}
+
+/* One BC4 block: 8 interpolated values if red0 > red1, otherwise 6 and the constants 0 and 255 */
+static void decodeBC4(const uint8_t* block, uint8_t* values)
+{
+	const int r0 = block[0];
+	const int r1 = block[1];
+
+	int palette[8] = { r0, r1 };
+	if (r0 > r1)
+	{
+		for (int k = 2; k != 8; k++)
+			palette[k] = int(std::lround((float(8 - k) * r0 + float(k - 1) * r1) / 7.0f));
+	}
+	else
+	{
+		for (int k = 2; k != 6; k++)
+			palette[k] = int(std::lround((float(6 - k) * r0 + float(k - 1) * r1) / 5.0f));
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	BitReader r{ block, 16 };
+	for (int i = 0; i != 16; i++)
+		values[i] = uint8_t(palette[r.read(3)]);
+}
+
+static void decodeBC5(const uint8_t* block, uint8_t* rg)
+{
+	uint8_t values[2][16];
+	decodeBC4(block, values[0]);
+	decodeBC4(block + 8, values[1]);
+	for (int i = 0; i != 16; i++)
+	{
+		rg[i * 2 + 0] = values[0][i];
+		rg[i * 2 + 1] = values[1][i];
+	}
+}
+
+static int unquantizeBC6H(int q)
+{
+	if (q == 0)
+		return 0;
+	if (q == 1023)
+		return 0xFFFF;
+	return ((q << 16) + 0x8000) >> 10;
+}
+
+/* BC6H mode 11 (unsigned): 10-bit endpoints, 4-bit indices. Writes half-float bit patterns, returns false for the other modes */
+static bool decodeBC6H(const uint8_t* block, uint16_t* rgb, uint8_t* anchorIndex = nullptr)
+{
+	BitReader r{ block };
+	if (r.read(5) != 0x03)
+		return false;
+
+	int e[2][3];
+	for (int c = 0; c != 3; c++)
+		e[0][c] = unquantizeBC6H(int(r.read(10)));
+	for (int c = 0; c != 3; c++)
+		e[1][c] = unquantizeBC6H(int(r.read(10)));
+
+	uint8_t indices[16];
+	readIndices4(r, indices);
+	if (anchorIndex)
+		*anchorIndex = indices[0];
+
+	for (int i = 0; i != 16; i++)
+		for (int c = 0; c != 3; c++)
+		{
+			const int v = ((64 - kWeights4[indices[i]]) * e[0][c] + kWeights4[indices[i]] * e[1][c] + 32) >> 6;
+			rgb[i * 3 + c] = uint16_t((v * 31) >> 6);
+		}
+
+	return r.pos_ == 128;
+}
+
+// the first pixel at the start, at the end and in the upper half of the ramp, the last two need the fix-up
+static int getRampPosition(int i, int shape)
+{
+	switch (shape)
+	{
+	case 0: return i;
+	case 1: return 15 - i;
+	default: return (i + 11) & 15;
+	}
+}
+
+static const char* kRampNames[3] = { "rising", "falling", "rotated" };
+
+// the largest gap between the 4-bit weights is 5/64 of the endpoint distance
+static int getHalfPaletteStep(int range)
+{
+	return (range * 5 + 127) / 128;
+}
+
+/* Largest per-channel difference between the block and its BC7 encoding */
+static int getBC7Error(const uint8_t* rgba, uint8_t* anchorIndex = nullptr)
+{
+	uint8_t block[16];
+	compressBlockBC7(rgba, block);
+
+	uint8_t decoded[16 * 4];
+	if (!decodeBC7(block, decoded, anchorIndex))
+	{
+		printf("BC7 block in mode %d\n", getBC7Mode(block));
+		return 256;
+	}
+
+	int maxErr = 0;
+	for (int i = 0; i != 16 * 4; i++)
+		maxErr = std::max(maxErr, std::abs(int(decoded[i]) - int(rgba[i])));
+	return maxErr;
+}
+
+static void checkBC7()
+{
+	// solid blocks: a gray one has 7-bit endpoints and p-bits for every value, the p-bit is shared by the channels of an endpoint
+	// so other colors can be one off
+	for (int v = 0; v != 256; v++)
+	{
+		uint8_t rgba[16 * 4];
+		for (int i = 0; i != 16 * 4; i++)
+			rgba[i] = uint8_t(v);
+		CHECK(getBC7Error(rgba) == 0);
+
+		for (int i = 0; i != 16; i++)
+		{
+			rgba[i * 4 + 1] = uint8_t(255 - v);
+			rgba[i * 4 + 2] = uint8_t(v * 7);
+			rgba[i * 4 + 3] = uint8_t(v / 2 + 64);
+		}
+		CHECK(getBC7Error(rgba) <= 1);
+	}
+
+	// gradients along the block: half a palette step and the endpoint rounding
+	for (int range = 15; range <= 255; range += 16)
+		for (int shape = 0; shape != 3; shape++)
+		{
+			uint8_t rgba[16 * 4];
+			for (int i = 0; i != 16; i++)
+			{
+				const int t = getRampPosition(i, shape) * range / 15;
+				rgba[i * 4 + 0] = uint8_t(t);
+				rgba[i * 4 + 1] = uint8_t(range - t);
+				rgba[i * 4 + 2] = uint8_t(128);
+				rgba[i * 4 + 3] = uint8_t(255 - t / 2);
+			}
+
+			uint8_t anchorIndex = 0xFF;
+			const int err = getBC7Error(rgba, &anchorIndex);
+			if (err > getHalfPaletteStep(range) + 1)
+			{
+				printf("BC7 gradient of range %d (%s): error %d\n", range, kRampNames[shape], err);
+				CHECK(false);
+			}
+			CHECK(anchorIndex < 8);
+		}
+}
+
+static void checkBC5()
+{
+	// solid blocks: red0 == red1 selects the 6-value palette, index 0 is the value itself
+	for (int v = 0; v != 256; v++)
+	{
+		uint8_t rgba[16 * 4] = {};
+		for (int i = 0; i != 16; i++)
+		{
+			rgba[i * 4 + 0] = uint8_t(v);
+			rgba[i * 4 + 1] = uint8_t(255 - v);
+		}
+
+		uint8_t block[16];
+		compressBlockBC5(rgba, block);
+		uint8_t rg[16 * 2];
+		decodeBC5(block, rg);
+		for (int i = 0; i != 16; i++)
+			CHECK(rg[i * 2 + 0] == v && rg[i * 2 + 1] == 255 - v);
+	}
+
+	// gradients and noise: the nearest of 8 values evenly spaced between the extremes of each channel
+	std::mt19937 rng(3);
+	for (int test = 0; test != 512; test++)
+	{
+		uint8_t rgba[16 * 4] = {};
+		const int lo = int(rng() % 200);
+		const int hi = lo + 1 + int(rng() % (255 - lo));
+		for (int i = 0; i != 16; i++)
+		{
+			rgba[i * 4 + 0] = uint8_t(lo + (hi - lo) * ((test & 1) ? 15 - i : i) / 15);
+			rgba[i * 4 + 1] = uint8_t(lo + int(rng() % (hi - lo + 1)));
+		}
+
+		uint8_t block[16];
+		compressBlockBC5(rgba, block);
+		uint8_t rg[16 * 2];
+		decodeBC5(block, rg);
+
+		for (int ch = 0; ch != 2; ch++)
+		{
+			int chLo = 255, chHi = 0;
+			for (int i = 0; i != 16; i++)
+			{
+				chLo = std::min(chLo, int(rgba[i * 4 + ch]));
+				chHi = std::max(chHi, int(rgba[i * 4 + ch]));
+			}
+			// half a palette step, and the rounding of the decoded palette
+			const float bound = float(chHi - chLo) / 14.0f + 1.0f;
+			for (int i = 0; i != 16; i++)
+				CHECK(std::abs(int(rg[i * 2 + ch]) - int(rgba[i * 4 + ch])) <= bound);
+		}
+	}
+}
+
+/* Largest difference of the half-float bit patterns (the encoder fits in this space) between the block and its BC6H encoding */
+static int getBC6HError(const float* rgb, uint8_t* anchorIndex = nullptr)
+{
+	uint8_t block[16];
+	compressBlockBC6H(rgb, block);
+
+	uint16_t decoded[16 * 3];
+	if (!decodeBC6H(block, decoded, anchorIndex))
+	{
+		printf("BC6H block in an unexpected mode\n");
+		return 0x10000;
+	}
+
+	int maxErr = 0;
+	for (int i = 0; i != 16 * 3; i++)
+		maxErr = std::max(maxErr, std::abs(int(decoded[i]) - int(floatToHalf(std::clamp(rgb[i], 0.0f, 65504.0f)))));
+	return maxErr;
+}
+
+static void checkBC6H()
+{
+	// solid blocks: one 10-bit endpoint step is 31 in the half-float bit patterns, the nearest one is off by half of it at most
+	const int kMaxSolidError = 16;
+	for (float v : { 0.0f, 1e-4f, 0.01f, 0.18f, 0.5f, 1.0f, 3.3f, 17.0f, 250.0f, 1000.0f, 60000.0f, -1.0f })
+	{
+		float rgb[16 * 3];
+		for (int i = 0; i != 16; i++)
+		{
+			rgb[i * 3 + 0] = v;
+			rgb[i * 3 + 1] = v * 0.5f;
+			rgb[i * 3 + 2] = v * 0.25f;
+		}
+
+		const int err = getBC6HError(rgb);
+		if (err > kMaxSolidError)
+		{
+			printf("BC6H solid block of %f: error %d\n", v, err);
+			CHECK(false);
+		}
+	}
+
+	// exponential ramps (linear in the bit patterns): half a palette step of the widest channel and the endpoint precision
+	for (float scale : { 0.05f, 1.0f, 20.0f, 800.0f })
+		for (int shape = 0; shape != 3; shape++)
+		{
+			float rgb[16 * 3];
+			for (int i = 0; i != 16; i++)
+			{
+				const float t = float(getRampPosition(i, shape)) / 15.0f;
+				rgb[i * 3 + 0] = scale * std::exp2(4.0f * t);
+				rgb[i * 3 + 1] = scale * std::exp2(2.0f * t);
+				rgb[i * 3 + 2] = scale;
+			}
+
+			const int range = int(floatToHalf(scale * 16.0f)) - int(floatToHalf(scale));
+			uint8_t anchorIndex = 0xFF;
+			const int err = getBC6HError(rgb, &anchorIndex);
+			if (err > getHalfPaletteStep(range) + kMaxSolidError)
+			{
+				printf("BC6H ramp of scale %f (%s): error %d\n", scale, kRampNames[shape], err);
+				CHECK(false);
+			}
+			CHECK(anchorIndex < 8);
+		}
+}
+
+int main()
+{
+	checkBC7();
+	checkBC5();
+	checkBC6H();
+
+	return testResult();
+}
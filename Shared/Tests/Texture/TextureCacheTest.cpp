@@ -0,0 +1,172 @@
+/**
+	TextureCache entries that pass the chunk file checks but do not describe their payload (an older layout,
+	levels that do not match the dimensions, a shortened data section) must be rejected by CachedTexture::open()
+	and re-encoded by TextureCache::load(), which then leaves a valid entry behind.
+*/
+#include <Tests.hpp>
+
+#include <TextureCache.hpp>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+static const int kW = 37;
+static const int kH = 23;
+
+// the entry layout written by TextureCache.cpp
+static const uint32_t kFileType = MakeChunkId('T', 'X', 'C', 'E');
+static const uint32_t kSectionHeader = MakeChunkId('T', 'X', 'H', 'D');
+static const uint32_t kSectionLevels = MakeChunkId('T', 'X', 'L', 'V');
+static const uint32_t kSectionData = MakeChunkId('T', 'X', 'D', 'T');
+
+struct EntryHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint32_t format;
+	int32_t w;
+	int32_t h;
+	int32_t numLevels;
+};
+
+struct Entry
+{
+	EntryHeader header;
+	std::vector<size_t> offsets;
+	std::vector<uint8_t> data;
+};
+
+static std::string writeSourceImage(const std::filesystem::path& dir)
+{
+	// binary PPM, stb_image reads it without any other dependency
+	const std::string fileName = (dir / "source.ppm").string();
+	std::ofstream f(fileName, std::ios::binary);
+	f << "P6\n" << kW << " " << kH << "\n255\n";
+	for (int y = 0; y != kH; y++)
+		for (int x = 0; x != kW; x++)
+		{
+			const char rgb[3] = { char(x * 7), char(y * 11), char((x ^ y) * 5) };
+			f.write(rgb, 3);
+		}
+	return fileName;
+}
+
+static bool readEntry(const std::string& fileName, Entry& out)
+{
+	ChunkFileReader reader;
+	if (!reader.Open(fileName, kFileType))
+		return false;
+
+	size_t headerSize = 0, levelsSize = 0, dataSize = 0;
+	const uint8_t* header = reader.GetSectionData(kSectionHeader, headerSize);
+	const uint8_t* levels = reader.GetSectionData(kSectionLevels, levelsSize);
+	const uint8_t* data = reader.GetSectionData(kSectionData, dataSize);
+	if (!header || !levels || !data || headerSize != sizeof(EntryHeader))
+		return false;
+
+	memcpy(&out.header, header, sizeof(EntryHeader));
+	out.offsets.resize(levelsSize / sizeof(size_t));
+	memcpy(out.offsets.data(), levels, levelsSize);
+	out.data.assign(data, data + dataSize);
+	return true;
+}
+
+// a well-formed chunk file with valid checksums, only the contents are wrong
+static void writeEntry(const std::string& fileName, const Entry& entry)
+{
+	ChunkFileWriter writer(kFileType);
+	writer.AddSection(kSectionHeader, &entry.header, sizeof(entry.header));
+	writer.AddArray(kSectionLevels, entry.offsets);
+	writer.AddArray(kSectionData, entry.data);
+	CHECK(writer.SaveAtomically(fileName));
+}
+
+static bool sameLevels(const TextureLevelsView& a, const TextureLevelsView& b)
+{
+	if (a.format_ != b.format_ || a.w_ != b.w_ || a.h_ != b.h_ || a.numLevels_ != b.numLevels_)
+		return false;
+	for (int l = 0; l != a.numLevels_; l++)
+		if (a.getLevelSize(l) != b.getLevelSize(l) || memcmp(a.getLevelData(l), b.getLevelData(l), a.getLevelSize(l)) != 0)
+			return false;
+	return true;
+}
+
+int main()
+{
+	const std::filesystem::path dir = std::filesystem::temp_directory_path() / "TextureCacheTest";
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+
+	const std::string sourceFile = writeSourceImage(dir);
+
+	TextureImportSettings settings;
+	settings.format_ = eCompressedFormat_None;
+
+	std::vector<uint8_t> sourceData;
+	{
+		std::ifstream f(sourceFile, std::ios::binary);
+		sourceData.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+	}
+
+	TextureCache cache((dir / "Cache").string());
+	const uint64_t key = TextureCache::computeKey(sourceData.data(), sourceData.size(), settings);
+	const std::string entryName = cache.getEntryFileName(key);
+
+	// 1) a fresh entry is written and mapped
+	auto reference = cache.load(sourceFile, settings);
+	CHECK(reference != nullptr);
+	if (!reference)
+		return testResult();
+
+	CHECK(reference->getLevels().w_ == kW && reference->getLevels().h_ == kH);
+
+	Entry valid;
+	CHECK(readEntry(entryName, valid));
+
+	CachedTexture opened;
+	CHECK(opened.open(entryName, key));
+	CHECK(!opened.open(entryName, key + 1));
+
+	// 2) inconsistent entries
+	auto corrupt = [&](const char* name, auto&& modify)
+	{
+		Entry e = valid;
+		modify(e);
+		writeEntry(entryName, e);
+
+		CachedTexture tex;
+		if (tex.open(entryName, key))
+		{
+			printf("The entry with %s was accepted\n", name);
+			CHECK(false);
+		}
+
+		auto reloaded = cache.load(sourceFile, settings);
+		CHECK(reloaded != nullptr);
+		if (reloaded)
+			CHECK(sameLevels(reloaded->getLevels(), reference->getLevels()));
+
+		// the re-encoded entry replaced the broken one
+		CachedTexture rewritten;
+		CHECK(rewritten.open(entryName, key));
+	};
+
+	corrupt("a wrong magic", [](Entry& e) { e.header.magic = 0; });
+	corrupt("an older version", [](Entry& e) { e.header.version -= 1; });
+	corrupt("an unknown format", [](Entry& e) { e.header.format = 100; });
+	corrupt("a zero width", [](Entry& e) { e.header.w = 0; });
+	corrupt("levels larger than the dimensions", [](Entry& e) { e.header.w /= 2; });
+	corrupt("a shortened data section", [](Entry& e) { e.data.resize(e.data.size() - 4); });
+	corrupt("decreasing level offsets", [](Entry& e) { std::swap(e.offsets[1], e.offsets[2]); });
+	corrupt("a missing level", [](Entry& e) { e.offsets.pop_back(); });
+
+	std::filesystem::remove_all(dir);
+
+	return testResult();
+}
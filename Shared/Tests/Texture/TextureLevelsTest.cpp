@@ -0,0 +1,70 @@
+/**
+	packLevels() on mip tails: the streaming loaders upload levels [firstLevel, numLevels) of a texture first, so the level
+	offsets start in the middle of the data. The staging copy must hold exactly the bytes of those levels, each one at
+	levelOffsets[i] - levelOffsets[0] where the buffer-to-image copies read it.
+*/
+#include <Tests.hpp>
+
+#include <TextureCompression.hpp>
+
+#include <cstring>
+#include <vector>
+
+static void checkTails(const CompressedTexture& tex)
+{
+	const TextureLevelsView levels(tex);
+
+	for (int first = 0; first != levels.numLevels_; first++)
+	{
+		const TextureLevelsView tail = levels.getMipTail(first);
+
+		// guard bytes after the packed levels must stay untouched
+		std::vector<uint8_t> staging(levels.getTailSize(0) + 16, 0xCD);
+		const size_t size = packLevels(tail.data_, tail.levelOffsets_, tail.numLevels_, staging.data());
+
+		CHECK(size == levels.getTailSize(first));
+		for (size_t i = size; i != staging.size(); i++)
+			CHECK(staging[i] == 0xCD);
+
+		for (int l = 0; l != tail.numLevels_; l++)
+		{
+			const size_t offset = tail.levelOffsets_[l] - tail.levelOffsets_[0];
+			CHECK(tail.getLevelSize(l) == tex.getLevelSize(first + l));
+			CHECK(offset + tail.getLevelSize(l) <= size);
+			if (memcmp(staging.data() + offset, tex.getLevelData(first + l), tex.getLevelSize(first + l)) != 0)
+			{
+				printf("Level %d of the tail starting at level %d differs\n", l, first);
+				CHECK(false);
+			}
+		}
+	}
+}
+
+int main()
+{
+	// a pattern different in every byte of every level, so that any shift of the source shows up
+	CompressedTexture tex;
+	tex.format_ = eCompressedFormat_None;
+	tex.w_ = 64;
+	tex.h_ = 16;
+	tex.levelOffsets_.push_back(0);
+	for (int l = 0; l != 7; l++)
+		tex.levelOffsets_.push_back(tex.levelOffsets_.back() + getCompressedLevelSize(tex.format_, tex.getLevelWidth(l), tex.getLevelHeight(l)));
+	tex.data_.resize(tex.levelOffsets_.back());
+	for (size_t i = 0; i != tex.data_.size(); i++)
+		tex.data_[i] = uint8_t(i * 31 + (i >> 8));
+
+	checkTails(tex);
+
+	// the same through the encoder, block-compressed levels have a minimum size of one block
+	std::vector<uint8_t> rgba(32 * 8 * 4);
+	for (size_t i = 0; i != rgba.size(); i++)
+		rgba[i] = uint8_t(i * 7);
+	CompressedTexture bc7;
+	compressTexture(rgba.data(), 32, 8, eCompressedFormat_BC7, bc7);
+	CHECK(bc7.getNumLevels() == 6);
+
+	checkTails(bc7);
+
+	return testResult();
+}
@@ -0,0 +1,267 @@
+/**
+	MultiRenderer in eCullingMode_Verify on a headless device: a grid of cubes around the camera, some of them behind a wall,
+	rendered while the camera turns and moves. Every frame the GPU culling results of an earlier frame are read back and compared
+	with cullBoxes() (and with the depth of the frame for occlusion culling), the test fails on any mismatch or validation error.
+	The CPU culling mode, which uses the scene BVH, must keep the same shapes as cullBoxes().
+	The mesh, scene and material files are written by the engine to a temporary directory.
+*/
+#include <RHI/Vulkan/Framework/MultiRenderer.hpp>
+#include <RHI/Vulkan/Framework/Barriers.hpp>
+
+// after the Vulkan headers: Tests.hpp defines CHECK() as a macro, UtilsVulkan.hpp declares a CHECK() function
+#include <Tests.hpp>
+
+// UtilsVulkan.cpp loads images with stb_image, the application defines it in one of its sources
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <gli/gli.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+static const uint32_t kW = 256;
+static const uint32_t kH = 192;
+static const uint32_t kNumFrames = 24;
+
+static const int kGridSize = 9;
+
+// the offscreen outputs are cleared by a pass of their own, MultiRenderer loads them
+struct ClearOutputs : public Renderer
+{
+	ClearOutputs(VulkanRenderContext& ctx, const std::vector<VulkanTexture>& outputs)
+		: Renderer(ctx)
+	{
+		initRenderPass(PipelineInfo{}, outputs, ctx.resources.addRenderPass(outputs, RenderPassCreateInfo{ true, true, eRenderPassBit_First | eRenderPassBit_Offscreen }));
+	}
+
+	void fillCommandBuffer(VkCommandBuffer commandBuffer, size_t currentImage, VkFramebuffer fb = VK_NULL_HANDLE, VkRenderPass rp = VK_NULL_HANDLE) override
+	{
+		VkClearValue clearValues[2]{};
+		clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+		clearValues[1].depthStencil = { 1.0f, 0 };
+
+		ctx_.beginRenderPass(commandBuffer, renderPass_.handle, currentImage, VkRect2D{ { 0, 0 }, { processingWidth, processingHeight } }, framebuffer_, 2, clearValues);
+		vkCmdEndRenderPass(commandBuffer);
+	}
+};
+
+// a unit cube centered at the origin, one material, no textures used
+static void writeMeshFile(const std::string& fileName)
+{
+	MeshData m;
+
+	for (int face = 0; face != 6; face++)
+	{
+		const int axis = face / 2;
+		const float sign = (face & 1) ? -1.0f : 1.0f;
+
+		glm::vec3 n(0.0f);
+		n[axis] = sign;
+		glm::vec3 u(0.0f);
+		u[(axis + 1) % 3] = 1.0f;
+		const glm::vec3 v = glm::cross(n, u);
+
+		const uint32_t base = (uint32_t)m.vertexData_.size() / kDefaultVertexStride;
+		for (int c = 0; c != 4; c++)
+		{
+			const glm::vec3 p = 0.5f * (n + ((c & 1) ? u : -u) + ((c & 2) ? v : -v));
+			const float vertex[kDefaultVertexStride] = { p.x, p.y, p.z, float(c & 1), float(c >> 1), n.x, n.y, n.z };
+			m.vertexData_.insert(m.vertexData_.end(), vertex, vertex + kDefaultVertexStride);
+		}
+
+		const uint32_t quad[6] = { 0, 1, 3, 0, 3, 2 };
+		for (uint32_t i : quad)
+			m.indexData_.push_back(base + i);
+	}
+
+	Mesh mesh;
+	mesh.streamCount = 1;
+	mesh.vertexCount = (uint32_t)m.vertexData_.size() / kDefaultVertexStride;
+	mesh.lodOffset[1] = (uint32_t)m.indexData_.size();
+	mesh.streamElementSize[0] = kDefaultVertexStride * sizeof(float);
+	m.meshes_.push_back(mesh);
+
+	recalculateBoundingBoxes(m);
+	saveMeshData(fileName.c_str(), m);
+}
+
+static int addCube(Scene& scene, const glm::vec3& pos, const glm::vec3& size)
+{
+	const int node = addNode(scene, 0, 1);
+	scene.localTransform_[node] = glm::scale(glm::translate(glm::mat4(1.0f), pos), size);
+	scene.meshes_[node] = 0;
+	scene.materialForNode_[node] = 0;
+	return node;
+}
+
+// cubes in front of the camera (a wall hides the middle of the grid) and behind it, which the frustum culls
+static void writeSceneFile(const std::string& fileName)
+{
+	Scene scene;
+	addNode(scene, -1, 0);
+
+	for (int y = 0; y != kGridSize; y++)
+		for (int x = 0; x != kGridSize; x++)
+		{
+			const glm::vec3 p(float(x - kGridSize / 2) * 3.0f, float(y - kGridSize / 2) * 3.0f, 0.0f);
+			addCube(scene, p + glm::vec3(0.0f, 0.0f, -25.0f), glm::vec3(1.0f));
+			addCube(scene, p + glm::vec3(0.0f, 0.0f, 20.0f), glm::vec3(1.0f));
+		}
+
+	addCube(scene, glm::vec3(0.0f, 0.0f, -8.0f), glm::vec3(5.0f, 5.0f, 0.5f));
+
+	saveScene(fileName.c_str(), scene);
+}
+
+// a black equirectangular Radiance HDR image without run-length encoding, stb_image reads it as a float image
+static void writeEnvMapFile(const std::string& fileName)
+{
+	const int w = 32;
+	const int h = 16;
+
+	std::ofstream f(fileName, std::ios::binary);
+	f << "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " << h << " +X " << w << "\n";
+	const std::vector<char> rgbe(size_t(w) * h * 4, 0);
+	f.write(rgbe.data(), rgbe.size());
+}
+
+int main()
+{
+	const std::filesystem::path dir = std::filesystem::temp_directory_path() / "MultiRendererCullingTest";
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+
+	const std::string meshFile = (dir / "cubes.meshes").string();
+	const std::string sceneFile = (dir / "cubes.scene").string();
+	const std::string materialFile = (dir / "cubes.materials").string();
+	const std::string envMapFile = (dir / "black.hdr").string();
+
+	writeMeshFile(meshFile);
+	writeSceneFile(sceneFile);
+	writeEnvMapFile(envMapFile);
+	// the texture array needs an entry, the missing file is replaced by a checkerboard
+	saveMaterials(materialFile.c_str(), { MaterialDescription{} }, { "MultiRendererCullingTest/missing.png" });
+
+	// VKSceneData loads the BRDF LUT from the resources, which are not part of the repository
+	const std::filesystem::path brdfLUT = FilesystemUtilities::GetResourcesDir() + "Data/brdfLUT.ktx";
+	const bool writeLUT = !std::filesystem::exists(brdfLUT);
+	if (writeLUT)
+	{
+		std::filesystem::create_directories(brdfLUT.parent_path());
+		gli::texture2d lut(gli::FORMAT_RG16_SFLOAT_PACK16, gli::extent2d(4, 4), 1);
+		memset(lut.data(), 0, lut.size());
+		CHECK(gli::save_ktx(lut, brdfLUT.string()));
+	}
+
+	glslang_initialize_process();
+	volkInitialize();
+
+	{
+		VulkanRenderContext ctx(nullptr, kW, kH);
+
+		VulkanTexture color = ctx.resources.addColorTexture(kW, kH);
+		VulkanTexture depth = ctx.resources.addDepthTexture(kW, kH, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		// the shaders sample an environment and its irradiance, both black
+		VulkanTexture envMap = ctx.resources.loadCubemap(envMapFile.c_str());
+
+		VKSceneData sceneData(ctx, meshFile.c_str(), sceneFile.c_str(), materialFile.c_str(), envMap, envMap, true);
+
+		ClearOutputs clear(ctx, { color, depth });
+		ShaderOptimalToColorBarrier colorToAttachment(ctx, color);
+		ShaderOptimalToDepthBarrier depthToAttachment(ctx, depth);
+		MultiRenderer renderer(ctx, sceneData, DefaultMeshVertexShader, DefaultMeshFragmentShader, { color, depth },
+			ctx.resources.addRenderPass({ color, depth }, RenderPassCreateInfo{ false, false, eRenderPassBit_Offscreen }));
+
+		ctx.onScreenRenderers_.emplace_back(clear, false);
+		ctx.onScreenRenderers_.emplace_back(colorToAttachment, false);
+		ctx.onScreenRenderers_.emplace_back(depthToAttachment, false);
+		ctx.onScreenRenderers_.emplace_back(renderer);
+
+		renderer.setCullingMode(eCullingMode_Verify);
+		CHECK(renderer.getCullingMode() == eCullingMode_Verify);
+
+		const glm::mat4 proj = glm::perspective(glm::radians(60.0f), float(kW) / float(kH), 0.1f, 100.0f);
+
+		// the camera turns from one side of the grid to the other and back, the wall hides different cubes in every frame
+		uint32_t maxFrustumCulled = 0;
+		uint32_t maxOccluded = 0;
+		auto renderFrames = [&]()
+		{
+			for (uint32_t frame = 0; frame != kNumFrames; frame++)
+			{
+				const float t = float(frame) / float(kNumFrames - 1);
+				const float angle = glm::radians(-35.0f + 70.0f * std::abs(2.0f * t - 1.0f));
+				const glm::vec3 eye(6.0f * (t - 0.5f), 1.5f * std::sin(t * 6.0f), 0.0f);
+				const glm::vec3 target = eye + glm::vec3(std::sin(angle), 0.0f, -std::cos(angle));
+
+				renderer.setMatrices(proj, glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+				renderer.setCameraPosition(eye);
+				renderer.checkLoadedTextures();
+
+				CHECK(drawFrame(ctx.vkDev,
+					[&ctx](uint32_t img) { ctx.updateBuffers(img); },
+					[&ctx](VkCommandBuffer cmd, uint32_t img) { ctx.composeFrame(cmd, img); }));
+
+				maxFrustumCulled = std::max(maxFrustumCulled, renderer.getCullingStats().frustumCulled_);
+				maxOccluded = std::max(maxOccluded, renderer.getCullingStats().occluded_);
+			}
+		};
+
+		// 1) frustum culling, each swapchain image is verified when it is culled again
+		renderFrames();
+
+		const uint32_t frustumFrames = renderer.getNumVerifiedFrames();
+		printf("Frustum culling: %u frames verified, up to %u of %u shapes culled\n", frustumFrames, maxFrustumCulled, (uint32_t)sceneData.shapes_.size());
+		CHECK(frustumFrames + (uint32_t)ctx.vkDev.swapchainImages.size() >= kNumFrames);
+		CHECK(maxFrustumCulled >= uint32_t(kGridSize * kGridSize));
+
+		// 2) the CPU culling walks the scene BVH, it must draw exactly the shapes cullBoxes() keeps
+		renderer.setCullingMode(eCullingMode_CPU);
+		for (uint32_t frame = 0; frame != kNumFrames; frame++)
+		{
+			const float angle = glm::radians(360.0f * float(frame) / float(kNumFrames));
+			const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(std::sin(angle), 0.0f, -std::cos(angle)), glm::vec3(0.0f, 1.0f, 0.0f));
+
+			renderer.setMatrices(proj, view);
+			renderer.setCameraPosition(glm::vec3(0.0f));
+
+			CHECK(drawFrame(ctx.vkDev,
+				[&ctx](uint32_t img) { ctx.updateBuffers(img); },
+				[&ctx](VkCommandBuffer cmd, uint32_t img) { ctx.composeFrame(cmd, img); }));
+
+			glm::vec4 planes[6];
+			glm::vec4 corners[8];
+			getFrustumPlanes(proj * view, planes);
+			getFrustumCorners(proj * view, corners);
+			std::vector<uint32_t> mask;
+			const uint32_t numVisible = cullBoxes(sceneData.cullingBoxes_, planes, corners, mask);
+			CHECK(renderer.getCullingStats().frustumCulled_ == (uint32_t)sceneData.shapes_.size() - numVisible);
+		}
+		renderer.setCullingMode(eCullingMode_Verify);
+
+		// 3) two-phase occlusion culling, the last frame is verified against its depth
+		CHECK(renderer.setOcclusionCulling(true));
+		renderFrames();
+
+		const uint32_t occlusionFrames = renderer.getNumVerifiedFrames() - frustumFrames;
+		printf("Occlusion culling: %u frames verified, up to %u shapes occluded\n", occlusionFrames, maxOccluded);
+		CHECK(occlusionFrames >= kNumFrames - 1);
+		CHECK(maxOccluded > 0);
+
+		CHECK(renderer.getNumCullingMismatches() == 0);
+
+		vkDeviceWaitIdle(ctx.vkDev.device);
+	}
+
+	CHECK(getValidationErrorCount() == 0);
+
+	if (writeLUT)
+		std::filesystem::remove(brdfLUT);
+	std::filesystem::remove_all(dir);
+
+	return testResult();
+}
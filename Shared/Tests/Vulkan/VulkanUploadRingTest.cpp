@@ -0,0 +1,193 @@
+/**
+	VulkanUploadRing on a headless device: RGBA8 mip chains of many sizes (and a cube map) go through a ring much smaller than
+	all of them together, so the allocations wrap around the end of the buffer and wait for the fences of earlier batches.
+	Some uploads are mip tails whose level offsets start in the middle of the data, as the texture streamer sends them.
+	Every level is read back and compared with the source, and the validation layers (debug builds) must not report
+	anything about the layout transitions, the copies or the fence reuse.
+*/
+#include <RHI/Vulkan/Framework/VulkanUploadRing.hpp>
+
+// after the Vulkan headers: Tests.hpp defines CHECK() as a macro, UtilsVulkan.hpp declares a CHECK() function
+#include <Tests.hpp>
+
+// UtilsVulkan.cpp loads images with stb_image, the application defines it in one of its sources
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+static const VkDeviceSize kRingSize = 256 * 1024;
+static const uint32_t kNumBatches = 3;
+static const int kNumTextures = 48;
+
+struct TestTexture
+{
+	uint32_t w_ = 0;
+	uint32_t h_ = 0;
+	uint32_t layers_ = 1;
+	uint32_t numLevels_ = 0;
+
+	// all the levels of the source, the image holds levels [firstLevel_, numLevels_) of it as levels [0, numLevels_ - firstLevel_)
+	std::vector<uint8_t> data_;
+	std::vector<size_t> levelOffsets_;
+	uint32_t firstLevel_ = 0;
+
+	VkImage image_ = VK_NULL_HANDLE;
+	VkDeviceMemory memory_ = VK_NULL_HANDLE;
+
+	uint32_t getImageWidth() const { return std::max(w_ >> firstLevel_, 1u); }
+	uint32_t getImageHeight() const { return std::max(h_ >> firstLevel_, 1u); }
+	uint32_t getImageLevels() const { return numLevels_ - firstLevel_; }
+};
+
+static void makeTexture(TestTexture& t, uint32_t index)
+{
+	t.numLevels_ = 1;
+	while (std::max(t.w_, t.h_) >> t.numLevels_)
+		t.numLevels_++;
+
+	t.levelOffsets_.assign(1, 0);
+	for (uint32_t l = 0; l != t.numLevels_; l++)
+		t.levelOffsets_.push_back(t.levelOffsets_.back() + size_t(std::max(t.w_ >> l, 1u)) * std::max(t.h_ >> l, 1u) * 4 * t.layers_);
+
+	// different in every byte of every texture, a copy from a wrong offset shows up
+	t.data_.resize(t.levelOffsets_.back());
+	for (size_t i = 0; i != t.data_.size(); i++)
+		t.data_[i] = uint8_t(index * 131 + i * 7 + (i >> 9));
+}
+
+static bool createTestImage(VulkanRenderDevice& vkDev, TestTexture& t)
+{
+	return createImage(vkDev.device, vkDev.physicalDevice, t.getImageWidth(), t.getImageHeight(), VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		t.image_, t.memory_, (t.layers_ == 6) ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0, t.getImageLevels());
+}
+
+// every level of the image (in SHADER_READ_ONLY_OPTIMAL, as the ring leaves it) packed the way the source levels are
+static std::vector<uint8_t> readBack(VulkanRenderDevice& vkDev, const TestTexture& t)
+{
+	const size_t* offsets = t.levelOffsets_.data() + t.firstLevel_;
+	const VkDeviceSize size = offsets[t.getImageLevels()] - offsets[0];
+
+	VkBuffer buffer;
+	VkDeviceMemory memory;
+	if (!createBuffer(vkDev.device, vkDev.physicalDevice, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, memory))
+		return {};
+
+	std::vector<VkBufferImageCopy> regions(t.getImageLevels());
+	for (uint32_t l = 0; l != t.getImageLevels(); l++)
+	{
+		regions[l] = VkBufferImageCopy{};
+		regions[l].bufferOffset = offsets[l] - offsets[0];
+		regions[l].imageSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, l, 0, t.layers_ };
+		regions[l].imageExtent = VkExtent3D{ std::max(t.getImageWidth() >> l, 1u), std::max(t.getImageHeight() >> l, 1u), 1 };
+	}
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = t.image_;
+	barrier.subresourceRange = VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, t.getImageLevels(), 0, t.layers_ };
+
+	VkCommandBuffer commandBuffer = beginSingleTimeCommands(vkDev);
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	vkCmdCopyImageToBuffer(commandBuffer, t.image_, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, (uint32_t)regions.size(), regions.data());
+	endSingleTimeCommands(vkDev, commandBuffer);
+
+	std::vector<uint8_t> result(size);
+	downloadBufferData(vkDev, memory, 0, result.data(), size);
+
+	vkDestroyBuffer(vkDev.device, buffer, nullptr);
+	vkFreeMemory(vkDev.device, memory, nullptr);
+
+	return result;
+}
+
+int main()
+{
+	volkInitialize();
+
+	VulkanInstance vk;
+	VulkanRenderDevice vkDev;
+	VulkanContextCreator ctx(vk, vkDev, nullptr, 64, 64);
+
+	std::mt19937 rng(7);
+	std::vector<TestTexture> textures(kNumTextures);
+
+	for (int i = 0; i != kNumTextures; i++)
+	{
+		TestTexture& t = textures[i];
+		t.w_ = 1 + rng() % 160;
+		t.h_ = 1 + rng() % 160;
+		makeTexture(t, i);
+
+		// every fourth one is a mip tail, the streamer uploads those first
+		if (i % 4 == 3 && t.numLevels_ > 1)
+			t.firstLevel_ = 1 + rng() % (t.numLevels_ - 1);
+	}
+
+	// the layers of each level are consecutive in the data
+	textures.emplace_back();
+	textures.back().w_ = textures.back().h_ = 32;
+	textures.back().layers_ = 6;
+	makeTexture(textures.back(), kNumTextures);
+
+	{
+		VulkanUploadRing ring(vkDev, kRingSize, kNumBatches);
+
+		for (size_t i = 0; i != textures.size(); i++)
+		{
+			TestTexture& t = textures[i];
+			CHECK(createTestImage(vkDev, t));
+
+			const bool uploaded = ring.uploadImage(t.image_, VK_FORMAT_R8G8B8A8_UNORM, t.getImageWidth(), t.getImageHeight(), t.layers_,
+				t.data_.data(), t.levelOffsets_.data() + t.firstLevel_, t.getImageLevels());
+			CHECK(uploaded);
+
+			// a few uploads per frame, the ring submits by itself when it runs full
+			if (i % 3 == 2)
+				ring.submit();
+		}
+
+		// more than the whole ring is refused, the caller uploads it some other way
+		TestTexture large;
+		large.w_ = large.h_ = 512;
+		makeTexture(large, 0);
+		CHECK(createTestImage(vkDev, large));
+		CHECK(!ring.uploadImage(large.image_, VK_FORMAT_R8G8B8A8_UNORM, large.w_, large.h_, 1, large.data_.data(), large.levelOffsets_.data(), large.numLevels_));
+		vkDestroyImage(vkDev.device, large.image_, nullptr);
+		vkFreeMemory(vkDev.device, large.memory_, nullptr);
+
+		ring.flush();
+	}
+
+	for (size_t i = 0; i != textures.size(); i++)
+	{
+		const TestTexture& t = textures[i];
+		const std::vector<uint8_t> levels = readBack(vkDev, t);
+
+		const size_t begin = t.levelOffsets_[t.firstLevel_];
+		if (levels.size() != t.data_.size() - begin || memcmp(levels.data(), t.data_.data() + begin, levels.size()) != 0)
+		{
+			printf("Texture %u (%ux%u, %u layers, levels %u..%u) differs from its source\n",
+				(uint32_t)i, t.w_, t.h_, t.layers_, t.firstLevel_, t.numLevels_ - 1);
+			CHECK(false);
+		}
+
+		vkDestroyImage(vkDev.device, t.image_, nullptr);
+		vkFreeMemory(vkDev.device, t.memory_, nullptr);
+	}
+
+	CHECK(getValidationErrorCount() == 0);
+
+	return testResult();
+}